@@ -0,0 +1,712 @@
+#include "cJSON.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void * (*cjson_malloc)(size_t size) = malloc;
+static void (*cjson_free)(void * ptr) = free;
+
+void cJSON_InitHooks(cJSON_Hooks * hooks) {
+	cjson_malloc = (hooks && hooks->malloc_fn) ? hooks->malloc_fn : malloc;
+	cjson_free = (hooks && hooks->free_fn) ? hooks->free_fn : free;
+}
+
+void cJSON_free(void * object) {
+	cjson_free(object);
+}
+
+static cJSON * cjson_new_item() {
+	cJSON * item = cjson_malloc(sizeof(cJSON));
+	if (item) {
+		memset(item, 0, sizeof(cJSON));
+	}
+	return item;
+}
+
+static char * cjson_strdup(const char * string, size_t length) {
+	char * copy = cjson_malloc(length + 1);
+	if (copy) {
+		memcpy(copy, string, length);
+		copy[length] = 0;
+	}
+	return copy;
+}
+
+void cJSON_Delete(cJSON * item) {
+	while (item) {
+		cJSON * next = item->next;
+		if (item->child) {
+			cJSON_Delete(item->child);
+		}
+		if (item->valuestring) {
+			cjson_free(item->valuestring);
+		}
+		if (item->string) {
+			cjson_free(item->string);
+		}
+		cjson_free(item);
+		item = next;
+	}
+}
+
+// parser
+
+typedef struct {
+	const char * content;
+	size_t length;
+	size_t offset;
+} cjson_parser_t;
+
+static cJSON_bool cjson_parse_value(cJSON * item, cjson_parser_t * parser);
+
+static void cjson_skip_whitespace(cjson_parser_t * parser) {
+	while (parser->offset < parser->length && (unsigned char)parser->content[parser->offset] <= 32) {
+		parser->offset++;
+	}
+}
+
+static cJSON_bool cjson_can_read(const cjson_parser_t * parser, size_t size) {
+	return parser->offset + size <= parser->length;
+}
+
+static const char * cjson_at(const cjson_parser_t * parser) {
+	return parser->content + parser->offset;
+}
+
+static int cjson_hex(const char * input, unsigned int * value) {
+	*value = 0;
+	for (int i = 0; i<4; i++) {
+		char c = input[i];
+		*value <<= 4;
+		if (c >= '0' && c <= '9') {
+			*value |= c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			*value |= c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			*value |= c - 'A' + 10;
+		} else {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static char * cjson_parse_string_value(cjson_parser_t * parser) {
+	if (!cjson_can_read(parser, 1) || *cjson_at(parser) != '"') {
+		return NULL;
+	}
+	parser->offset++;
+
+	size_t end = parser->offset;
+	while (end < parser->length && parser->content[end] != '"') {
+		if (parser->content[end] == '\\') {
+			end++;
+		}
+		end++;
+	}
+	if (end >= parser->length) {
+		return NULL;
+	}
+
+	// escapes only shrink the string
+	char * output = cjson_malloc(end - parser->offset + 1);
+	if (output == NULL) {
+		return NULL;
+	}
+
+	char * out = output;
+	while (parser->offset < end) {
+		char c = parser->content[parser->offset++];
+		if (c != '\\') {
+			*out++ = c;
+			continue;
+		}
+
+		c = parser->content[parser->offset++];
+		switch (c) {
+		case 'b': *out++ = '\b'; break;
+		case 'f': *out++ = '\f'; break;
+		case 'n': *out++ = '\n'; break;
+		case 'r': *out++ = '\r'; break;
+		case 't': *out++ = '\t'; break;
+		case '"':
+		case '\\':
+		case '/': *out++ = c; break;
+		case 'u': {
+			unsigned int code = 0;
+			if (parser->offset + 4 > end || !cjson_hex(cjson_at(parser), &code)) {
+				cjson_free(output);
+				return NULL;
+			}
+			parser->offset += 4;
+			// no surrogate pairs, the firmware never receives them
+			if (code < 0x80) {
+				*out++ = code;
+			} else if (code < 0x800) {
+				*out++ = 0xC0 | (code >> 6);
+				*out++ = 0x80 | (code & 0x3F);
+			} else {
+				*out++ = 0xE0 | (code >> 12);
+				*out++ = 0x80 | ((code >> 6) & 0x3F);
+				*out++ = 0x80 | (code & 0x3F);
+			}
+			break;
+		}
+		default:
+			cjson_free(output);
+			return NULL;
+		}
+	}
+	*out = 0;
+	parser->offset = end + 1;
+
+	return output;
+}
+
+static cJSON_bool cjson_parse_number(cJSON * item, cjson_parser_t * parser) {
+	char buffer[64];
+	size_t length = 0;
+	while (parser->offset + length < parser->length && length < sizeof(buffer) - 1
+			&& strchr("0123456789+-eE.", parser->content[parser->offset + length])) {
+		buffer[length] = parser->content[parser->offset + length];
+		length++;
+	}
+	buffer[length] = 0;
+
+	char * end = NULL;
+	double number = strtod(buffer, &end);
+	if (end == buffer) {
+		return 0;
+	}
+
+	item->type = cJSON_Number;
+	item->valuedouble = number;
+	item->valueint = number >= INT32_MAX ? INT32_MAX : (number <= INT32_MIN ? INT32_MIN : (int)number);
+	parser->offset += end - buffer;
+
+	return 1;
+}
+
+static cJSON_bool cjson_parse_container(cJSON * item, cjson_parser_t * parser, char close, cJSON_bool keys) {
+	parser->offset++;
+	item->type = keys ? cJSON_Object : cJSON_Array;
+
+	cjson_skip_whitespace(parser);
+	if (cjson_can_read(parser, 1) && *cjson_at(parser) == close) {
+		parser->offset++;
+		return 1;
+	}
+
+	cJSON * tail = NULL;
+	while (1) {
+		cJSON * child = cjson_new_item();
+		if (child == NULL) {
+			return 0;
+		}
+		if (tail) {
+			tail->next = child;
+			child->prev = tail;
+		} else {
+			item->child = child;
+		}
+		tail = child;
+
+		cjson_skip_whitespace(parser);
+		if (keys) {
+			child->string = cjson_parse_string_value(parser);
+			if (child->string == NULL) {
+				return 0;
+			}
+			cjson_skip_whitespace(parser);
+			if (!cjson_can_read(parser, 1) || *cjson_at(parser) != ':') {
+				return 0;
+			}
+			parser->offset++;
+			cjson_skip_whitespace(parser);
+		}
+
+		if (!cjson_parse_value(child, parser)) {
+			return 0;
+		}
+
+		cjson_skip_whitespace(parser);
+		if (!cjson_can_read(parser, 1)) {
+			return 0;
+		}
+		char c = *cjson_at(parser);
+		parser->offset++;
+		if (c == close) {
+			item->child->prev = tail;
+			return 1;
+		}
+		if (c != ',') {
+			return 0;
+		}
+	}
+}
+
+static cJSON_bool cjson_parse_value(cJSON * item, cjson_parser_t * parser) {
+	if (!cjson_can_read(parser, 1)) {
+		return 0;
+	}
+
+	if (cjson_can_read(parser, 4) && strncmp(cjson_at(parser), "null", 4) == 0) {
+		item->type = cJSON_NULL;
+		parser->offset += 4;
+		return 1;
+	}
+	if (cjson_can_read(parser, 5) && strncmp(cjson_at(parser), "false", 5) == 0) {
+		item->type = cJSON_False;
+		parser->offset += 5;
+		return 1;
+	}
+	if (cjson_can_read(parser, 4) && strncmp(cjson_at(parser), "true", 4) == 0) {
+		item->type = cJSON_True;
+		item->valueint = 1;
+		parser->offset += 4;
+		return 1;
+	}
+
+	char c = *cjson_at(parser);
+	if (c == '"') {
+		item->type = cJSON_String;
+		item->valuestring = cjson_parse_string_value(parser);
+		return item->valuestring != NULL;
+	}
+	if (c == '-' || (c >= '0' && c <= '9')) {
+		return cjson_parse_number(item, parser);
+	}
+	if (c == '[') {
+		return cjson_parse_container(item, parser, ']', 0);
+	}
+	if (c == '{') {
+		return cjson_parse_container(item, parser, '}', 1);
+	}
+
+	return 0;
+}
+
+cJSON * cJSON_ParseWithLength(const char * value, size_t buffer_length) {
+	if (value == NULL || buffer_length == 0) {
+		return NULL;
+	}
+
+	cjson_parser_t parser = { .content = value, .length = buffer_length, .offset = 0 };
+	cJSON * item = cjson_new_item();
+	if (item == NULL) {
+		return NULL;
+	}
+
+	cjson_skip_whitespace(&parser);
+	if (!cjson_parse_value(item, &parser)) {
+		cJSON_Delete(item);
+		return NULL;
+	}
+
+	return item;
+}
+
+cJSON * cJSON_Parse(const char * value) {
+	return value ? cJSON_ParseWithLength(value, strlen(value) + 1) : NULL;
+}
+
+// printer
+
+typedef struct {
+	char * buffer;
+	size_t length;
+	size_t offset;
+	cJSON_bool format;
+	int depth;
+} cjson_printer_t;
+
+static char * cjson_ensure(cjson_printer_t * printer, size_t needed) {
+	if (printer->buffer == NULL) {
+		return NULL;
+	}
+
+	needed += printer->offset + 1;
+	if (needed <= printer->length) {
+		return printer->buffer + printer->offset;
+	}
+
+	size_t length = needed * 2;
+	char * buffer = cjson_malloc(length);
+	if (buffer == NULL) {
+		cjson_free(printer->buffer);
+		printer->buffer = NULL;
+		return NULL;
+	}
+	memcpy(buffer, printer->buffer, printer->offset + 1);
+	cjson_free(printer->buffer);
+	printer->buffer = buffer;
+	printer->length = length;
+
+	return printer->buffer + printer->offset;
+}
+
+static cJSON_bool cjson_print_raw(cjson_printer_t * printer, const char * text, size_t length) {
+	char * out = cjson_ensure(printer, length);
+	if (out == NULL) {
+		return 0;
+	}
+	memcpy(out, text, length);
+	out[length] = 0;
+	printer->offset += length;
+	return 1;
+}
+
+static cJSON_bool cjson_print_number(cjson_printer_t * printer, double number) {
+	char buffer[26];
+	int length;
+
+	if (isnan(number) || isinf(number)) {
+		length = sprintf(buffer, "null");
+	} else if (number == (double)(int)number) {
+		length = sprintf(buffer, "%d", (int)number);
+	} else {
+		// shortest of 15 digits that reads back the same, 17 otherwise
+		length = sprintf(buffer, "%1.15g", number);
+		double test = 0;
+		if (sscanf(buffer, "%lg", &test) != 1 || test != number) {
+			length = sprintf(buffer, "%1.17g", number);
+		}
+	}
+
+	return cjson_print_raw(printer, buffer, length);
+}
+
+static cJSON_bool cjson_print_string(cjson_printer_t * printer, const char * string) {
+	if (string == NULL) {
+		return cjson_print_raw(printer, "\"\"", 2);
+	}
+
+	size_t extra = 0;
+	for (const unsigned char * c = (const unsigned char *)string; *c; c++) {
+		if (*c == '"' || *c == '\\' || *c == '\b' || *c == '\f' || *c == '\n' || *c == '\r' || *c == '\t') {
+			extra += 1;
+		} else if (*c < 32) {
+			extra += 5;
+		}
+	}
+
+	size_t length = strlen(string);
+	char * out = cjson_ensure(printer, length + extra + 2);
+	if (out == NULL) {
+		return 0;
+	}
+
+	*out++ = '"';
+	for (const unsigned char * c = (const unsigned char *)string; *c; c++) {
+		switch (*c) {
+		case '"':  *out++ = '\\'; *out++ = '"'; break;
+		case '\\': *out++ = '\\'; *out++ = '\\'; break;
+		case '\b': *out++ = '\\'; *out++ = 'b'; break;
+		case '\f': *out++ = '\\'; *out++ = 'f'; break;
+		case '\n': *out++ = '\\'; *out++ = 'n'; break;
+		case '\r': *out++ = '\\'; *out++ = 'r'; break;
+		case '\t': *out++ = '\\'; *out++ = 't'; break;
+		default:
+			if (*c < 32) {
+				out += sprintf(out, "\\u%04x", *c);
+			} else {
+				*out++ = *c;
+			}
+		}
+	}
+	*out++ = '"';
+	*out = 0;
+	printer->offset += length + extra + 2;
+
+	return 1;
+}
+
+static cJSON_bool cjson_print_value(cjson_printer_t * printer, const cJSON * item);
+
+static cJSON_bool cjson_print_indent(cjson_printer_t * printer) {
+	if (!printer->format) {
+		return 1;
+	}
+	for (int i = 0; i<printer->depth; i++) {
+		if (!cjson_print_raw(printer, "\t", 1)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static cJSON_bool cjson_print_container(cjson_printer_t * printer, const cJSON * item, cJSON_bool keys) {
+	const char * open = keys ? "{" : "[";
+	const char * close = keys ? "}" : "]";
+
+	if (!cjson_print_raw(printer, open, 1)) {
+		return 0;
+	}
+	printer->depth++;
+	if (printer->format && keys && item->child && !cjson_print_raw(printer, "\n", 1)) {
+		return 0;
+	}
+
+	for (const cJSON * child = item->child; child; child = child->next) {
+		if (keys) {
+			if (!cjson_print_indent(printer) || !cjson_print_string(printer, child->string)) {
+				return 0;
+			}
+			if (!cjson_print_raw(printer, printer->format ? ":\t" : ":", printer->format ? 2 : 1)) {
+				return 0;
+			}
+		}
+		if (!cjson_print_value(printer, child)) {
+			return 0;
+		}
+		if (child->next && !cjson_print_raw(printer, (printer->format && !keys) ? ", " : ",", (printer->format && !keys) ? 2 : 1)) {
+			return 0;
+		}
+		if (printer->format && keys && !cjson_print_raw(printer, "\n", 1)) {
+			return 0;
+		}
+	}
+
+	printer->depth--;
+	if (keys && item->child && !cjson_print_indent(printer)) {
+		return 0;
+	}
+	return cjson_print_raw(printer, close, 1);
+}
+
+static cJSON_bool cjson_print_value(cjson_printer_t * printer, const cJSON * item) {
+	switch (item->type & 0xFF) {
+	case cJSON_NULL:
+		return cjson_print_raw(printer, "null", 4);
+	case cJSON_False:
+		return cjson_print_raw(printer, "false", 5);
+	case cJSON_True:
+		return cjson_print_raw(printer, "true", 4);
+	case cJSON_Number:
+		return cjson_print_number(printer, item->valuedouble);
+	case cJSON_String:
+		return cjson_print_string(printer, item->valuestring);
+	case cJSON_Array:
+		return cjson_print_container(printer, item, 0);
+	case cJSON_Object:
+		return cjson_print_container(printer, item, 1);
+	default:
+		return 0;
+	}
+}
+
+static char * cjson_print(const cJSON * item, cJSON_bool format) {
+	cjson_printer_t printer = {
+		.buffer = cjson_malloc(256),
+		.length = 256,
+		.offset = 0,
+		.format = format,
+	};
+	if (printer.buffer == NULL) {
+		return NULL;
+	}
+	printer.buffer[0] = 0;
+
+	if (!cjson_print_value(&printer, item)) {
+		cjson_free(printer.buffer);
+		return NULL;
+	}
+
+	// shrink to fit, as cJSON does when no realloc hook is set
+	char * result = cjson_strdup(printer.buffer, printer.offset);
+	cjson_free(printer.buffer);
+
+	return result;
+}
+
+char * cJSON_Print(const cJSON * item) {
+	return item ? cjson_print(item, 1) : NULL;
+}
+
+char * cJSON_PrintUnformatted(const cJSON * item) {
+	return item ? cjson_print(item, 0) : NULL;
+}
+
+// access
+
+int cJSON_GetArraySize(const cJSON * array) {
+	if (array == NULL) {
+		return 0;
+	}
+
+	int size = 0;
+	for (cJSON * child = array->child; child; child = child->next) {
+		size++;
+	}
+
+	return size;
+}
+
+cJSON * cJSON_GetObjectItem(const cJSON * const object, const char * const string) {
+	if (object == NULL || string == NULL) {
+		return NULL;
+	}
+
+	// case insensitive, as cJSON_GetObjectItem is
+	for (cJSON * child = object->child; child; child = child->next) {
+		if (child->string && strcasecmp(child->string, string) == 0) {
+			return child;
+		}
+	}
+
+	return NULL;
+}
+
+char * cJSON_GetStringValue(const cJSON * const item) {
+	return cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+double cJSON_GetNumberValue(const cJSON * const item) {
+	return cJSON_IsNumber(item) ? item->valuedouble : NAN;
+}
+
+cJSON_bool cJSON_IsFalse(const cJSON * const item) {
+	return item && (item->type & 0xFF) == cJSON_False;
+}
+
+cJSON_bool cJSON_IsTrue(const cJSON * const item) {
+	return item && (item->type & 0xFF) == cJSON_True;
+}
+
+cJSON_bool cJSON_IsBool(const cJSON * const item) {
+	return item && (item->type & (cJSON_True | cJSON_False)) != 0;
+}
+
+cJSON_bool cJSON_IsNull(const cJSON * const item) {
+	return item && (item->type & 0xFF) == cJSON_NULL;
+}
+
+cJSON_bool cJSON_IsNumber(const cJSON * const item) {
+	return item && (item->type & 0xFF) == cJSON_Number;
+}
+
+cJSON_bool cJSON_IsString(const cJSON * const item) {
+	return item && (item->type & 0xFF) == cJSON_String;
+}
+
+cJSON_bool cJSON_IsObject(const cJSON * const item) {
+	return item && (item->type & 0xFF) == cJSON_Object;
+}
+
+// construction
+
+cJSON * cJSON_CreateObject(void) {
+	cJSON * item = cjson_new_item();
+	if (item) {
+		item->type = cJSON_Object;
+	}
+	return item;
+}
+
+cJSON * cJSON_CreateArray(void) {
+	cJSON * item = cjson_new_item();
+	if (item) {
+		item->type = cJSON_Array;
+	}
+	return item;
+}
+
+cJSON * cJSON_CreateNumber(double num) {
+	cJSON * item = cjson_new_item();
+	if (item) {
+		item->type = cJSON_Number;
+		item->valuedouble = num;
+		item->valueint = num >= INT32_MAX ? INT32_MAX : (num <= INT32_MIN ? INT32_MIN : (int)num);
+	}
+	return item;
+}
+
+cJSON * cJSON_CreateString(const char * string) {
+	cJSON * item = cjson_new_item();
+	if (item) {
+		item->type = cJSON_String;
+		item->valuestring = cjson_strdup(string, strlen(string));
+		if (item->valuestring == NULL) {
+			cJSON_Delete(item);
+			return NULL;
+		}
+	}
+	return item;
+}
+
+cJSON * cJSON_CreateBool(cJSON_bool boolean) {
+	cJSON * item = cjson_new_item();
+	if (item) {
+		item->type = boolean ? cJSON_True : cJSON_False;
+	}
+	return item;
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON * array, cJSON * item) {
+	if (array == NULL || item == NULL || array == item) {
+		return 0;
+	}
+
+	cJSON * child = array->child;
+	if (child == NULL) {
+		array->child = item;
+		item->prev = item;
+		item->next = NULL;
+	} else {
+		// the first child keeps the tail in prev, as in cJSON
+		cJSON * tail = child->prev ? child->prev : child;
+		tail->next = item;
+		item->prev = tail;
+		child->prev = item;
+	}
+
+	return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON * object, const char * string, cJSON * item) {
+	if (object == NULL || string == NULL || item == NULL) {
+		return 0;
+	}
+
+	char * key = cjson_strdup(string, strlen(string));
+	if (key == NULL) {
+		return 0;
+	}
+	if (item->string) {
+		cjson_free(item->string);
+	}
+	item->string = key;
+
+	return cJSON_AddItemToArray(object, item);
+}
+
+static cJSON * cjson_add(cJSON * object, const char * name, cJSON * item) {
+	if (cJSON_AddItemToObject(object, name, item)) {
+		return item;
+	}
+	cJSON_Delete(item);
+	return NULL;
+}
+
+cJSON * cJSON_AddNumberToObject(cJSON * const object, const char * const name, const double number) {
+	return cjson_add(object, name, cJSON_CreateNumber(number));
+}
+
+cJSON * cJSON_AddStringToObject(cJSON * const object, const char * const name, const char * const string) {
+	return cjson_add(object, name, cJSON_CreateString(string));
+}
+
+cJSON * cJSON_AddBoolToObject(cJSON * const object, const char * const name, const cJSON_bool boolean) {
+	return cjson_add(object, name, cJSON_CreateBool(boolean));
+}
+
+cJSON * cJSON_AddObjectToObject(cJSON * const object, const char * const name) {
+	return cjson_add(object, name, cJSON_CreateObject());
+}
+
+cJSON * cJSON_AddArrayToObject(cJSON * const object, const char * const name) {
+	return cjson_add(object, name, cJSON_CreateArray());
+}
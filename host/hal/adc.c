@@ -0,0 +1,249 @@
+#include "host.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+// ADC: the continuous driver converts the pattern round-robin from a "DMA" thread that produces
+// one conversion frame per frame period of virtual time. Values come from the ADC channel signals.
+// The oneshot driver samples the signal on every read.
+
+#define HOST_ADC_CONVERSION_US 50
+
+struct adc_continuous_ctx_t {
+	pthread_mutex_t lock;
+	pthread_cond_t filled;
+	pthread_t thread;
+
+	uint32_t frame_size;
+	uint8_t * frame;
+	uint8_t * pool;
+	uint32_t pool_size;
+	uint32_t pool_head;
+	uint32_t pool_count;
+
+	adc_digi_pattern_config_t patterns[SOC_ADC_PATT_LEN_MAX];
+	uint32_t patterns_count;
+	uint32_t sample_freq_hz;
+	uint32_t pattern_index;
+
+	adc_continuous_evt_cbs_t callbacks;
+	void * user_data;
+
+	bool started;
+	bool thread_running;
+};
+
+struct adc_oneshot_unit_ctx_t {
+	adc_unit_t unit;
+};
+
+static uint16_t host_adc_sample(uint8_t channel) {
+	double value = host_signal_value(HOST_SIGNAL_ADC(channel));
+	if (value < 0) {
+		return 0;
+	}
+	return value > 4095 ? 4095 : (uint16_t)value;
+}
+
+static void * host_adc_dma(void * arg) {
+	adc_continuous_handle_t handle = arg;
+
+	while (true) {
+		pthread_mutex_lock(&handle->lock);
+		if (!handle->started) {
+			handle->thread_running = false;
+			pthread_mutex_unlock(&handle->lock);
+			return NULL;
+		}
+
+		uint32_t samples = handle->frame_size / SOC_ADC_DIGI_RESULT_BYTES;
+		uint32_t frame_us = (uint64_t)samples * 1000000ULL / handle->sample_freq_hz;
+
+		// one signal value per channel and frame, the signals are slow compared to a frame
+		uint16_t values[SOC_ADC_PATT_LEN_MAX];
+		for (uint32_t i = 0; i<handle->patterns_count; i++) {
+			values[i] = host_adc_sample(handle->patterns[i].channel);
+		}
+		pthread_mutex_unlock(&handle->lock);
+
+		host_delay_us(frame_us);
+
+		pthread_mutex_lock(&handle->lock);
+		for (uint32_t i = 0; i<samples; i++) {
+			adc_digi_output_data_t data = { 0 };
+			data.type1.channel = handle->patterns[handle->pattern_index].channel;
+			data.type1.data = values[handle->pattern_index];
+			handle->pattern_index = (handle->pattern_index + 1) % handle->patterns_count;
+			memcpy(handle->frame + i * SOC_ADC_DIGI_RESULT_BYTES, &data, SOC_ADC_DIGI_RESULT_BYTES);
+		}
+
+		bool overflow = handle->pool_count + handle->frame_size > handle->pool_size;
+		if (!overflow) {
+			for (uint32_t i = 0; i<handle->frame_size; i++) {
+				handle->pool[(handle->pool_head + handle->pool_count + i) % handle->pool_size] = handle->frame[i];
+			}
+			handle->pool_count += handle->frame_size;
+			pthread_cond_broadcast(&handle->filled);
+		}
+
+		adc_continuous_evt_data_t event = {
+			.conv_frame_buffer = handle->frame,
+			.size = handle->frame_size,
+		};
+		adc_continuous_callback_t callback = overflow ? handle->callbacks.on_pool_ovf : handle->callbacks.on_conv_done;
+		pthread_mutex_unlock(&handle->lock);
+
+		host_sensor_mark_sampled(HOST_DEVICE_ADC);
+
+		if (callback) {
+			callback(handle, &event, handle->user_data);
+		}
+	}
+}
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t * hdl_config, adc_continuous_handle_t * ret_handle) {
+	struct adc_continuous_ctx_t * handle = host_malloc(sizeof(struct adc_continuous_ctx_t));
+	memset(handle, 0, sizeof(struct adc_continuous_ctx_t));
+
+	pthread_mutex_init(&handle->lock, NULL);
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&handle->filled, &attr);
+	pthread_condattr_destroy(&attr);
+
+	handle->frame_size = hdl_config->conv_frame_size;
+	handle->frame = host_malloc(handle->frame_size);
+	handle->pool_size = hdl_config->max_store_buf_size;
+	handle->pool = host_malloc(handle->pool_size);
+
+	*ret_handle = handle;
+	return ESP_OK;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t * config) {
+	if (config->pattern_num == 0 || config->pattern_num > SOC_ADC_PATT_LEN_MAX
+			|| config->sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW || config->sample_freq_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) {
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	pthread_mutex_lock(&handle->lock);
+	if (handle->started) {
+		pthread_mutex_unlock(&handle->lock);
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	memcpy(handle->patterns, config->adc_pattern, config->pattern_num * sizeof(adc_digi_pattern_config_t));
+	handle->patterns_count = config->pattern_num;
+	handle->sample_freq_hz = config->sample_freq_hz;
+	handle->pattern_index = 0;
+	pthread_mutex_unlock(&handle->lock);
+
+	return ESP_OK;
+}
+
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t handle, const adc_continuous_evt_cbs_t * cbs, void * user_data) {
+	pthread_mutex_lock(&handle->lock);
+	handle->callbacks = *cbs;
+	handle->user_data = user_data;
+	pthread_mutex_unlock(&handle->lock);
+
+	return ESP_OK;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle) {
+	pthread_mutex_lock(&handle->lock);
+	if (handle->started || handle->patterns_count == 0) {
+		pthread_mutex_unlock(&handle->lock);
+		return ESP_ERR_INVALID_STATE;
+	}
+	handle->started = true;
+	handle->pattern_index = 0;
+
+	// a stopped thread may still finish its last frame, wait for it before starting another
+	while (handle->thread_running) {
+		pthread_mutex_unlock(&handle->lock);
+		pthread_join(handle->thread, NULL);
+		pthread_mutex_lock(&handle->lock);
+	}
+
+	handle->thread_running = true;
+	pthread_create(&handle->thread, NULL, host_adc_dma, handle);
+	pthread_mutex_unlock(&handle->lock);
+
+	return ESP_OK;
+}
+
+esp_err_t adc_continuous_stop(adc_continuous_handle_t handle) {
+	pthread_mutex_lock(&handle->lock);
+	if (!handle->started) {
+		pthread_mutex_unlock(&handle->lock);
+		return ESP_ERR_INVALID_STATE;
+	}
+	handle->started = false;
+	pthread_mutex_unlock(&handle->lock);
+
+	pthread_join(handle->thread, NULL);
+
+	return ESP_OK;
+}
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t * buf, uint32_t length_max, uint32_t * out_length, uint32_t timeout_ms) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	uint64_t ns = (uint64_t)timeout_ms * 1000000ULL / host_time_scale();
+	deadline.tv_sec += ns / 1000000000ULL;
+	deadline.tv_nsec += ns % 1000000000ULL;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&handle->lock);
+	while (handle->pool_count == 0 && timeout_ms > 0) {
+		if (pthread_cond_timedwait(&handle->filled, &handle->lock, &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+
+	uint32_t count = handle->pool_count < length_max ? handle->pool_count : length_max;
+	count -= count % SOC_ADC_DIGI_RESULT_BYTES;
+	for (uint32_t i = 0; i<count; i++) {
+		buf[i] = handle->pool[handle->pool_head];
+		handle->pool_head = (handle->pool_head + 1) % handle->pool_size;
+	}
+	handle->pool_count -= count;
+	pthread_mutex_unlock(&handle->lock);
+
+	*out_length = count;
+
+	return count ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t adc_continuous_flush_pool(adc_continuous_handle_t handle) {
+	pthread_mutex_lock(&handle->lock);
+	handle->pool_head = 0;
+	handle->pool_count = 0;
+	pthread_mutex_unlock(&handle->lock);
+
+	return ESP_OK;
+}
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t * init_config, adc_oneshot_unit_handle_t * ret_unit) {
+	struct adc_oneshot_unit_ctx_t * unit = host_malloc(sizeof(struct adc_oneshot_unit_ctx_t));
+	unit->unit = init_config->unit_id;
+	*ret_unit = unit;
+	return ESP_OK;
+}
+
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t, adc_channel_t, const adc_oneshot_chan_cfg_t *) {
+	return ESP_OK;
+}
+
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t, adc_channel_t chan, int * out_raw) {
+	host_delay_us(HOST_ADC_CONVERSION_US);
+	*out_raw = host_adc_sample(chan);
+	host_sensor_mark_sampled(HOST_DEVICE_ADC);
+	return ESP_OK;
+}
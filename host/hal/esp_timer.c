@@ -0,0 +1,123 @@
+#include "host.h"
+
+#include <pthread.h>
+
+// esp_timer: callbacks run one after another on the "esp_timer" task, deadlines are in virtual time
+
+#define HOST_TIMER_IDLE_WAIT_MS 100
+
+struct esp_timer {
+	esp_timer_cb_t callback;
+	void * arg;
+	const char * name;
+
+	bool active;
+	int64_t deadline;
+	uint64_t period;
+
+	struct esp_timer * next;
+};
+
+static struct esp_timer * host_timers = NULL;
+static pthread_mutex_t host_timers_lock = PTHREAD_MUTEX_INITIALIZER;
+static TaskHandle_t host_timer_task = NULL;
+
+static void host_timer_task_function(void *) {
+	while (true) {
+		int64_t now = esp_timer_get_time();
+		int64_t next = now + HOST_TIMER_IDLE_WAIT_MS * 1000;
+		struct esp_timer * expired = NULL;
+
+		pthread_mutex_lock(&host_timers_lock);
+		for (struct esp_timer * timer = host_timers; timer; timer = timer->next) {
+			if (!timer->active) {
+				continue;
+			}
+			if (timer->deadline <= now && (expired == NULL || timer->deadline < expired->deadline)) {
+				expired = timer;
+			} else if (timer->deadline < next) {
+				next = timer->deadline;
+			}
+		}
+
+		esp_timer_cb_t callback = NULL;
+		void * arg = NULL;
+		if (expired) {
+			callback = expired->callback;
+			arg = expired->arg;
+			if (expired->period) {
+				expired->deadline += expired->period;
+			} else {
+				expired->active = false;
+			}
+		}
+		pthread_mutex_unlock(&host_timers_lock);
+
+		if (callback) {
+			callback(arg);
+			continue;
+		}
+
+		TickType_t ticks = (next - now) / 1000 / portTICK_PERIOD_MS;
+		ulTaskNotifyTake(pdTRUE, ticks > 0 ? ticks : 1);
+	}
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t * create_args, esp_timer_handle_t * out_handle) {
+	struct esp_timer * timer = host_malloc(sizeof(struct esp_timer));
+	memset(timer, 0, sizeof(struct esp_timer));
+	timer->callback = create_args->callback;
+	timer->arg = create_args->arg;
+	timer->name = create_args->name;
+
+	pthread_mutex_lock(&host_timers_lock);
+	timer->next = host_timers;
+	host_timers = timer;
+	if (host_timer_task == NULL) {
+		xTaskCreate(host_timer_task_function, "esp_timer", 4096, NULL, 22, &host_timer_task);
+	}
+	pthread_mutex_unlock(&host_timers_lock);
+
+	*out_handle = timer;
+	return ESP_OK;
+}
+
+static esp_err_t host_timer_start(esp_timer_handle_t timer, uint64_t timeout, uint64_t period) {
+	pthread_mutex_lock(&host_timers_lock);
+	if (timer->active) {
+		pthread_mutex_unlock(&host_timers_lock);
+		return ESP_ERR_INVALID_STATE;
+	}
+	timer->active = true;
+	timer->deadline = esp_timer_get_time() + timeout;
+	timer->period = period;
+	pthread_mutex_unlock(&host_timers_lock);
+
+	xTaskNotifyGive(host_timer_task);
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+	return host_timer_start(timer, period, period);
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+	return host_timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+	pthread_mutex_lock(&host_timers_lock);
+	bool was_active = timer->active;
+	timer->active = false;
+	pthread_mutex_unlock(&host_timers_lock);
+
+	return was_active ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+	pthread_mutex_lock(&host_timers_lock);
+	bool active = timer->active;
+	pthread_mutex_unlock(&host_timers_lock);
+
+	return active;
+}
@@ -0,0 +1,592 @@
+#include "host.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+// FreeRTOS on pthreads. Every task is a thread, queues and semaphores are one object guarded by
+// a mutex with two condition variables. Priorities are ignored. Timeouts are in virtual time.
+
+#define HOST_MAX_TASKS 64
+#define HOST_TASK_NAME 16
+
+struct tskTaskControlBlock {
+	pthread_t thread;
+	char name[HOST_TASK_NAME];
+	TaskFunction_t function;
+	void * arg;
+
+	pthread_mutex_t lock;
+	pthread_cond_t notified;
+	uint32_t notify_value;
+	bool notify_pending;
+	bool deleted;
+
+	bool running;
+	clockid_t cpu_clock;
+};
+
+typedef enum {
+	HOST_QUEUE_QUEUE = 0,
+	HOST_QUEUE_SEMAPHORE,
+} host_queue_type_t;
+
+struct QueueDefinition {
+	pthread_mutex_t lock;
+	pthread_cond_t can_receive;
+	pthread_cond_t can_send;
+
+	host_queue_type_t type;
+	uint8_t * storage;
+	size_t item_size;
+	UBaseType_t length;
+	UBaseType_t head;
+	UBaseType_t count;
+
+	bool is_static;
+	bool storage_owned;
+};
+
+struct EventGroupDef_t {
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	EventBits_t bits;
+};
+
+_Static_assert(sizeof(struct QueueDefinition) <= sizeof(StaticQueue_t), "StaticQueue_t is too small");
+_Static_assert(sizeof(struct QueueDefinition) <= sizeof(StaticSemaphore_t), "StaticSemaphore_t is too small");
+
+static struct tskTaskControlBlock * host_tasks[HOST_MAX_TASKS];
+static uint8_t host_tasks_count = 0;
+static pthread_mutex_t host_tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t host_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static int64_t host_tasks_cpu_finished_us = 0;
+
+static __thread struct tskTaskControlBlock * host_current_task = NULL;
+
+static void host_cond_init(pthread_cond_t * cond) {
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+static struct timespec host_deadline(TickType_t ticks) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	uint64_t ns = (uint64_t)ticks * portTICK_PERIOD_MS * 1000000ULL / host_time_scale();
+	deadline.tv_sec += ns / 1000000000ULL;
+	deadline.tv_nsec += ns % 1000000000ULL;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	return deadline;
+}
+
+// waits on cond until done() or the timeout, lock is held. Returns done().
+static bool host_wait(pthread_cond_t * cond, pthread_mutex_t * lock, TickType_t ticks, bool (*done)(void *), void * arg) {
+	if (ticks == portMAX_DELAY) {
+		while (!done(arg)) {
+			pthread_cond_wait(cond, lock);
+		}
+		return true;
+	}
+
+	struct timespec deadline = host_deadline(ticks);
+	while (!done(arg)) {
+		if (pthread_cond_timedwait(cond, lock, &deadline) == ETIMEDOUT) {
+			return done(arg);
+		}
+	}
+	return true;
+}
+
+// tasks
+
+static struct tskTaskControlBlock * host_task_allocate(const char * name) {
+	struct tskTaskControlBlock * task = host_malloc(sizeof(struct tskTaskControlBlock));
+	memset(task, 0, sizeof(struct tskTaskControlBlock));
+	snprintf(task->name, sizeof(task->name), "%s", name);
+	pthread_mutex_init(&task->lock, NULL);
+	host_cond_init(&task->notified);
+
+	pthread_mutex_lock(&host_tasks_lock);
+	if (host_tasks_count < HOST_MAX_TASKS) {
+		host_tasks[host_tasks_count++] = task;
+	}
+	pthread_mutex_unlock(&host_tasks_lock);
+
+	return task;
+}
+
+static int64_t host_clock_us(clockid_t clock) {
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void host_task_finish(struct tskTaskControlBlock * task) {
+	pthread_mutex_lock(&host_tasks_lock);
+	task->deleted = true;
+	task->running = false;
+	host_tasks_cpu_finished_us += host_clock_us(CLOCK_THREAD_CPUTIME_ID);
+	pthread_mutex_unlock(&host_tasks_lock);
+}
+
+static void * host_task_entry(void * arg) {
+	struct tskTaskControlBlock * task = arg;
+	host_current_task = task;
+
+	pthread_mutex_lock(&host_tasks_lock);
+	pthread_getcpuclockid(pthread_self(), &task->cpu_clock);
+	task->running = true;
+	pthread_mutex_unlock(&host_tasks_lock);
+
+	task->function(task->arg);
+	// a FreeRTOS task must not return, the firmware always ends with vTaskDelete(NULL)
+	host_task_finish(task);
+	return NULL;
+}
+
+int64_t host_tasks_cpu_time_us() {
+	pthread_mutex_lock(&host_tasks_lock);
+	int64_t result = host_tasks_cpu_finished_us;
+	for (uint8_t i = 0; i<host_tasks_count; i++) {
+		struct tskTaskControlBlock * task = host_tasks[i];
+		if (task->running) {
+			result += host_clock_us(task->cpu_clock);
+		}
+	}
+	pthread_mutex_unlock(&host_tasks_lock);
+
+	return result;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask) {
+	struct tskTaskControlBlock * task = host_task_allocate(pcName);
+	task->function = pxTaskCode;
+	task->arg = pvParameters;
+
+	if (pxCreatedTask) {
+		*pxCreatedTask = task;
+	}
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	int res = pthread_create(&task->thread, &attr, host_task_entry, task);
+	pthread_attr_destroy(&attr);
+
+	if (res != 0) {
+		if (pxCreatedTask) {
+			*pxCreatedTask = NULL;
+		}
+		return pdFAIL;
+	}
+
+	return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, const BaseType_t) {
+	return xTaskCreate(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+	if (host_current_task == NULL) {
+		// the process main thread, a test body
+		host_current_task = host_task_allocate("host");
+		host_current_task->thread = pthread_self();
+	}
+	return host_current_task;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+	if (xTaskToDelete != NULL && xTaskToDelete != host_current_task) {
+		// deleting another task is not used by the firmware
+		fprintf(stderr, "vTaskDelete(%s) from another task is not supported on host\n", xTaskToDelete->name);
+		return;
+	}
+
+	TaskHandle_t task = xTaskGetCurrentTaskHandle();
+	if (task->function == NULL) {
+		// the process main thread keeps running
+		task->deleted = true;
+		return;
+	}
+
+	host_task_finish(task);
+	pthread_exit(NULL);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay) {
+	if (xTicksToDelay == 0) {
+		sched_yield();
+		return;
+	}
+
+	uint64_t ns = (uint64_t)xTicksToDelay * portTICK_PERIOD_MS * 1000000ULL / host_time_scale();
+	struct timespec delay = { .tv_sec = ns / 1000000000ULL, .tv_nsec = ns % 1000000000ULL };
+	while (nanosleep(&delay, &delay) != 0 && errno == EINTR);
+}
+
+TickType_t xTaskGetTickCount(void) {
+	return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) {
+	return 1024;
+}
+
+char * pcTaskGetName(TaskHandle_t xTaskToQuery) {
+	if (xTaskToQuery == NULL) {
+		xTaskToQuery = xTaskGetCurrentTaskHandle();
+	}
+	return xTaskToQuery->name;
+}
+
+TaskHandle_t xTaskGetHandle(const char * pcNameToQuery) {
+	TaskHandle_t result = NULL;
+
+	pthread_mutex_lock(&host_tasks_lock);
+	for (uint8_t i = 0; i<host_tasks_count && result == NULL; i++) {
+		if (!host_tasks[i]->deleted && strcmp(host_tasks[i]->name, pcNameToQuery) == 0) {
+			result = host_tasks[i];
+		}
+	}
+	pthread_mutex_unlock(&host_tasks_lock);
+
+	return result;
+}
+
+// notifications
+
+static bool host_notify_has_value(void * arg) {
+	return ((struct tskTaskControlBlock *) arg)->notify_value > 0;
+}
+
+static bool host_notify_is_pending(void * arg) {
+	return ((struct tskTaskControlBlock *) arg)->notify_pending;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction) {
+	BaseType_t result = pdPASS;
+
+	pthread_mutex_lock(&xTaskToNotify->lock);
+	switch (eAction) {
+	case eNoAction:
+		break;
+	case eSetBits:
+		xTaskToNotify->notify_value |= ulValue;
+		break;
+	case eIncrement:
+		xTaskToNotify->notify_value++;
+		break;
+	case eSetValueWithOverwrite:
+		xTaskToNotify->notify_value = ulValue;
+		break;
+	case eSetValueWithoutOverwrite:
+		if (xTaskToNotify->notify_pending) {
+			result = pdFAIL;
+		} else {
+			xTaskToNotify->notify_value = ulValue;
+		}
+		break;
+	}
+	xTaskToNotify->notify_pending = true;
+	pthread_cond_broadcast(&xTaskToNotify->notified);
+	pthread_mutex_unlock(&xTaskToNotify->lock);
+
+	return result;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction, BaseType_t * pxHigherPriorityTaskWoken) {
+	if (pxHigherPriorityTaskWoken) {
+		*pxHigherPriorityTaskWoken = pdFALSE;
+	}
+	return xTaskNotify(xTaskToNotify, ulValue, eAction);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+	return xTaskNotify(xTaskToNotify, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t * pxHigherPriorityTaskWoken) {
+	xTaskNotifyFromISR(xTaskToNotify, 0, eIncrement, pxHigherPriorityTaskWoken);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+	struct tskTaskControlBlock * task = xTaskGetCurrentTaskHandle();
+
+	pthread_mutex_lock(&task->lock);
+	host_wait(&task->notified, &task->lock, xTicksToWait, host_notify_has_value, task);
+
+	uint32_t result = task->notify_value;
+	if (result > 0) {
+		task->notify_value = xClearCountOnExit ? 0 : result - 1;
+	}
+	task->notify_pending = false;
+	pthread_mutex_unlock(&task->lock);
+
+	return result;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t * pulNotificationValue, TickType_t xTicksToWait) {
+	struct tskTaskControlBlock * task = xTaskGetCurrentTaskHandle();
+
+	pthread_mutex_lock(&task->lock);
+	if (!task->notify_pending) {
+		task->notify_value &= ~ulBitsToClearOnEntry;
+	}
+
+	bool received = host_wait(&task->notified, &task->lock, xTicksToWait, host_notify_is_pending, task);
+	if (pulNotificationValue) {
+		*pulNotificationValue = task->notify_value;
+	}
+	if (received) {
+		task->notify_value &= ~ulBitsToClearOnExit;
+	}
+	task->notify_pending = false;
+	pthread_mutex_unlock(&task->lock);
+
+	return received ? pdTRUE : pdFALSE;
+}
+
+// critical sections: one recursive lock for the whole system, as on a single core
+
+void vPortEnterCritical(portMUX_TYPE *) {
+	pthread_mutex_lock(&host_critical);
+}
+
+void vPortExitCritical(portMUX_TYPE *) {
+	pthread_mutex_unlock(&host_critical);
+}
+
+// queues and semaphores
+
+static QueueHandle_t host_queue_setup(struct QueueDefinition * queue, host_queue_type_t type, UBaseType_t length, size_t item_size, uint8_t * storage, bool is_static) {
+	memset(queue, 0, sizeof(struct QueueDefinition));
+	pthread_mutex_init(&queue->lock, NULL);
+	host_cond_init(&queue->can_receive);
+	host_cond_init(&queue->can_send);
+
+	queue->type = type;
+	queue->length = length;
+	queue->item_size = item_size;
+	queue->is_static = is_static;
+
+	if (type == HOST_QUEUE_QUEUE) {
+		queue->storage = storage;
+		if (queue->storage == NULL) {
+			queue->storage = host_malloc(length * item_size);
+			queue->storage_owned = true;
+		}
+	}
+
+	return queue;
+}
+
+static bool host_queue_not_empty(void * arg) {
+	return ((struct QueueDefinition *) arg)->count > 0;
+}
+
+static bool host_queue_not_full(void * arg) {
+	struct QueueDefinition * queue = arg;
+	return queue->count < queue->length;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize) {
+	return host_queue_setup(host_malloc(sizeof(struct QueueDefinition)), HOST_QUEUE_QUEUE, uxQueueLength, uxItemSize, NULL, false);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, uint8_t * pucQueueStorage, StaticQueue_t * pxQueueBuffer) {
+	return host_queue_setup((struct QueueDefinition *) pxQueueBuffer, HOST_QUEUE_QUEUE, uxQueueLength, uxItemSize, pucQueueStorage, true);
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void * pvItemToQueue, TickType_t xTicksToWait) {
+	pthread_mutex_lock(&xQueue->lock);
+	if (!host_wait(&xQueue->can_send, &xQueue->lock, xTicksToWait, host_queue_not_full, xQueue)) {
+		pthread_mutex_unlock(&xQueue->lock);
+		return pdFALSE;
+	}
+
+	if (xQueue->type == HOST_QUEUE_QUEUE) {
+		UBaseType_t tail = (xQueue->head + xQueue->count) % xQueue->length;
+		memcpy(xQueue->storage + tail * xQueue->item_size, pvItemToQueue, xQueue->item_size);
+	}
+	xQueue->count++;
+
+	pthread_cond_broadcast(&xQueue->can_receive);
+	pthread_mutex_unlock(&xQueue->lock);
+
+	return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void * pvItemToQueue, BaseType_t * pxHigherPriorityTaskWoken) {
+	if (pxHigherPriorityTaskWoken) {
+		*pxHigherPriorityTaskWoken = pdFALSE;
+	}
+	return xQueueSend(xQueue, pvItemToQueue, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait) {
+	pthread_mutex_lock(&xQueue->lock);
+	if (!host_wait(&xQueue->can_receive, &xQueue->lock, xTicksToWait, host_queue_not_empty, xQueue)) {
+		pthread_mutex_unlock(&xQueue->lock);
+		return pdFALSE;
+	}
+
+	if (xQueue->type == HOST_QUEUE_QUEUE) {
+		memcpy(pvBuffer, xQueue->storage + xQueue->head * xQueue->item_size, xQueue->item_size);
+		xQueue->head = (xQueue->head + 1) % xQueue->length;
+	}
+	xQueue->count--;
+
+	pthread_cond_broadcast(&xQueue->can_send);
+	pthread_mutex_unlock(&xQueue->lock);
+
+	return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue) {
+	pthread_mutex_lock(&xQueue->lock);
+	xQueue->head = 0;
+	xQueue->count = 0;
+	pthread_cond_broadcast(&xQueue->can_send);
+	pthread_mutex_unlock(&xQueue->lock);
+
+	return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue) {
+	pthread_mutex_lock(&xQueue->lock);
+	UBaseType_t count = xQueue->count;
+	pthread_mutex_unlock(&xQueue->lock);
+
+	return count;
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {
+	pthread_mutex_destroy(&xQueue->lock);
+	pthread_cond_destroy(&xQueue->can_receive);
+	pthread_cond_destroy(&xQueue->can_send);
+
+	if (xQueue->storage_owned) {
+		host_free(xQueue->storage);
+	}
+	if (!xQueue->is_static) {
+		host_free(xQueue);
+	}
+}
+
+static SemaphoreHandle_t host_semaphore(StaticSemaphore_t * buffer, UBaseType_t max, UBaseType_t initial) {
+	struct QueueDefinition * queue = buffer ? (struct QueueDefinition *) buffer : host_malloc(sizeof(struct QueueDefinition));
+	host_queue_setup(queue, HOST_QUEUE_SEMAPHORE, max, 0, NULL, buffer != NULL);
+	queue->count = initial;
+	return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+	return host_semaphore(NULL, 1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t * pxSemaphoreBuffer) {
+	return host_semaphore(pxSemaphoreBuffer, 1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+	return host_semaphore(NULL, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t * pxMutexBuffer) {
+	return host_semaphore(pxMutexBuffer, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+	return host_semaphore(NULL, max, initial);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial, StaticSemaphore_t * pxSemaphoreBuffer) {
+	return host_semaphore(pxSemaphoreBuffer, max, initial);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime) {
+	return xQueueReceive(xSemaphore, NULL, xBlockTime);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore) {
+	return xQueueSend(xSemaphore, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t * pxHigherPriorityTaskWoken) {
+	return xQueueSendFromISR(xSemaphore, NULL, pxHigherPriorityTaskWoken);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore) {
+	return uxQueueMessagesWaiting(xSemaphore);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore) {
+	vQueueDelete(xSemaphore);
+}
+
+// event groups
+
+typedef struct {
+	EventGroupHandle_t group;
+	EventBits_t bits;
+	bool all;
+} host_event_wait_t;
+
+static bool host_event_bits_set(void * arg) {
+	host_event_wait_t * wait = arg;
+	EventBits_t set = wait->group->bits & wait->bits;
+	return wait->all ? set == wait->bits : set != 0;
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+	EventGroupHandle_t group = host_malloc(sizeof(struct EventGroupDef_t));
+	pthread_mutex_init(&group->lock, NULL);
+	host_cond_init(&group->changed);
+	group->bits = 0;
+	return group;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor, const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits, TickType_t xTicksToWait) {
+	host_event_wait_t wait = {
+		.group = xEventGroup,
+		.bits = uxBitsToWaitFor,
+		.all = xWaitForAllBits,
+	};
+
+	pthread_mutex_lock(&xEventGroup->lock);
+	bool received = host_wait(&xEventGroup->changed, &xEventGroup->lock, xTicksToWait, host_event_bits_set, &wait);
+	EventBits_t result = xEventGroup->bits;
+	if (received && xClearOnExit) {
+		xEventGroup->bits &= ~uxBitsToWaitFor;
+	}
+	pthread_mutex_unlock(&xEventGroup->lock);
+
+	return result;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) {
+	pthread_mutex_lock(&xEventGroup->lock);
+	xEventGroup->bits |= uxBitsToSet;
+	EventBits_t result = xEventGroup->bits;
+	pthread_cond_broadcast(&xEventGroup->changed);
+	pthread_mutex_unlock(&xEventGroup->lock);
+
+	return result;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup) {
+	pthread_mutex_lock(&xEventGroup->lock);
+	EventBits_t result = xEventGroup->bits;
+	pthread_mutex_unlock(&xEventGroup->lock);
+
+	return result;
+}
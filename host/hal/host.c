@@ -0,0 +1,237 @@
+#include "host.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+
+#define HOST_SHUTDOWN_HANDLERS 8
+
+static uint32_t host_scale = 1;
+static int64_t host_started_us = 0;
+
+static _Atomic uint64_t host_alloc_allocs = 0;
+static _Atomic uint64_t host_alloc_frees = 0;
+static _Atomic uint64_t host_alloc_bytes = 0;
+static __thread host_alloc_stats_t host_alloc_current;
+
+static _Atomic uint32_t host_restarts = 0;
+static shutdown_handler_t host_shutdown_handlers[HOST_SHUTDOWN_HANDLERS];
+static uint8_t host_shutdown_handlers_count = 0;
+
+static bool host_log_enabled = false;
+
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+void __real_free(void * ptr);
+
+void app_main(void);
+
+int64_t host_real_time_us() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void host_init(uint32_t time_scale) {
+	host_scale = time_scale ? time_scale : 1;
+	host_started_us = host_real_time_us();
+	host_log_enabled = getenv("HOST_LOG") != NULL;
+	srand(1);
+}
+
+uint32_t host_time_scale() {
+	return host_scale;
+}
+
+int64_t esp_timer_get_time(void) {
+	if (host_started_us == 0) {
+		host_init(host_scale);
+	}
+	return (host_real_time_us() - host_started_us) * host_scale;
+}
+
+void host_run_for(uint32_t virtual_ms) {
+	vTaskDelay(pdMS_TO_TICKS(virtual_ms));
+}
+
+void host_delay_us(uint32_t virtual_us) {
+	uint64_t ns = (uint64_t)virtual_us * 1000 / host_scale;
+	struct timespec delay = { .tv_sec = ns / 1000000000ULL, .tv_nsec = ns % 1000000000ULL };
+	nanosleep(&delay, NULL);
+}
+
+static void host_app_task(void *) {
+	app_main();
+	vTaskDelete(NULL);
+}
+
+void host_start_app() {
+	xTaskCreate(host_app_task, "main", 3584, NULL, 1, NULL);
+}
+
+int64_t host_cpu_time_us() {
+	struct timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// heap accounting
+
+static void host_account_alloc(size_t size) {
+	host_alloc_current.allocs++;
+	host_alloc_current.bytes += size;
+	atomic_fetch_add(&host_alloc_allocs, 1);
+	atomic_fetch_add(&host_alloc_bytes, size);
+}
+
+static void host_account_free() {
+	host_alloc_current.frees++;
+	atomic_fetch_add(&host_alloc_frees, 1);
+}
+
+void * __wrap_malloc(size_t size) {
+	host_account_alloc(size);
+	return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t count, size_t size) {
+	host_account_alloc(count * size);
+	return __real_calloc(count, size);
+}
+
+void * __wrap_realloc(void * ptr, size_t size) {
+	if (ptr) {
+		host_account_free();
+	}
+	host_account_alloc(size);
+	return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void * ptr) {
+	if (ptr) {
+		host_account_free();
+	}
+	__real_free(ptr);
+}
+
+void * host_malloc(size_t size) {
+	return __real_malloc(size);
+}
+
+void host_free(void * ptr) {
+	__real_free(ptr);
+}
+
+void host_alloc_thread(host_alloc_stats_t * stats) {
+	*stats = host_alloc_current;
+}
+
+void host_alloc_global(host_alloc_stats_t * stats) {
+	stats->allocs = atomic_load(&host_alloc_allocs);
+	stats->frees = atomic_load(&host_alloc_frees);
+	stats->bytes = atomic_load(&host_alloc_bytes);
+}
+
+// esp_system
+
+void esp_restart(void) {
+	atomic_fetch_add(&host_restarts, 1);
+	fprintf(stderr, "esp_restart() called from task %s\n", pcTaskGetName(NULL));
+	vTaskDelete(NULL);
+	// vTaskDelete(NULL) does not return for a task, only the process main thread gets here
+	abort();
+}
+
+uint32_t host_restart_count() {
+	return atomic_load(&host_restarts);
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle) {
+	if (host_shutdown_handlers_count >= HOST_SHUTDOWN_HANDLERS) {
+		return ESP_ERR_NO_MEM;
+	}
+	host_shutdown_handlers[host_shutdown_handlers_count++] = handle;
+	return ESP_OK;
+}
+
+void host_shutdown() {
+	for (uint8_t i = 0; i<host_shutdown_handlers_count; i++) {
+		host_shutdown_handlers[i]();
+	}
+}
+
+esp_reset_reason_t esp_reset_reason(void) {
+	return ESP_RST_POWERON;
+}
+
+void host_error_check_failed(esp_err_t code, const char * file, int line, const char * expression) {
+	fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x at %s:%d\nexpression: %s\n", code, file, line, expression);
+	abort();
+}
+
+const char * esp_err_to_name(esp_err_t code) {
+	return code == ESP_OK ? "ESP_OK" : "ESP_ERR";
+}
+
+// heap
+
+uint32_t esp_get_free_heap_size(void) {
+	return 200 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void) {
+	return 150 * 1024;
+}
+
+size_t heap_caps_get_free_size(uint32_t) {
+	return esp_get_free_heap_size();
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t) {
+	return esp_get_minimum_free_heap_size();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t) {
+	return 100 * 1024;
+}
+
+size_t heap_caps_get_allocated_size(void * ptr) {
+	return malloc_usable_size(ptr);
+}
+
+uint32_t esp_cpu_get_cycle_count(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	// as a 240 MHz core would count
+	return (uint32_t)((uint64_t)now.tv_sec * 240000000ULL + (uint64_t)now.tv_nsec * 240 / 1000);
+}
+
+// log: the firmware disables it on boards with PMS7003, HOST_LOG=1 prints the rest
+
+void esp_log_write(esp_log_level_t level, const char * tag, const char * format, ...) {
+	if (!host_log_enabled) {
+		return;
+	}
+
+	static const char levels[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+	fprintf(stderr, "%c (%lld) %s: ", levels[level], (long long)(esp_timer_get_time() / 1000), tag);
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+
+	fputc('\n', stderr);
+}
+
+void esp_log_buffer_hexdump_internal(const char * tag, const void * buffer, uint16_t buff_len, esp_log_level_t level) {
+	if (!host_log_enabled) {
+		return;
+	}
+
+	for (uint16_t i = 0; i<buff_len; i++) {
+		fprintf(stderr, "%02x%c", ((const uint8_t *)buffer)[i], (i % 16 == 15 || i + 1 == buff_len) ? '\n' : ' ');
+	}
+}
@@ -0,0 +1,78 @@
+#include "host.h"
+
+// I2C master bus: transfers go to the device model attached to (port, address).
+// Each transfer takes the time 100 kHz SCL would need, 9 clocks per byte.
+
+#define HOST_I2C_MAX_DEVICES 8
+#define HOST_I2C_BYTE_US     90
+
+typedef struct {
+	uint8_t port;
+	uint16_t addr;
+	host_i2c_transfer_t transfer;
+	void * ctx;
+} host_i2c_model_t;
+
+struct i2c_master_bus_t {
+	i2c_port_num_t port;
+};
+
+struct i2c_master_dev_t {
+	i2c_port_num_t port;
+	uint16_t addr;
+};
+
+static host_i2c_model_t host_i2c_models[HOST_I2C_MAX_DEVICES];
+static uint8_t host_i2c_models_count = 0;
+
+void host_i2c_attach(uint8_t port, uint16_t addr, host_i2c_transfer_t transfer, void * ctx) {
+	if (host_i2c_models_count < HOST_I2C_MAX_DEVICES) {
+		host_i2c_models[host_i2c_models_count++] = (host_i2c_model_t) {
+			.port = port,
+			.addr = addr,
+			.transfer = transfer,
+			.ctx = ctx,
+		};
+	}
+}
+
+static esp_err_t host_i2c_transfer(i2c_master_dev_handle_t dev, const uint8_t * write, size_t write_size, uint8_t * read, size_t read_size) {
+	uint32_t bus_us = (1 + write_size + (read_size ? 1 + read_size : 0)) * HOST_I2C_BYTE_US;
+	host_delay_us(bus_us);
+
+	for (uint8_t i = 0; i<host_i2c_models_count; i++) {
+		if (host_i2c_models[i].port == dev->port && host_i2c_models[i].addr == dev->addr) {
+			return host_i2c_models[i].transfer(host_i2c_models[i].ctx, write, write_size, read, read_size);
+		}
+	}
+
+	// nobody acknowledged the address
+	return ESP_FAIL;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t * bus_config, i2c_master_bus_handle_t * ret_bus_handle) {
+	struct i2c_master_bus_t * bus = host_malloc(sizeof(struct i2c_master_bus_t));
+	bus->port = bus_config->i2c_port;
+	*ret_bus_handle = bus;
+	return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t * dev_config, i2c_master_dev_handle_t * ret_handle) {
+	struct i2c_master_dev_t * dev = host_malloc(sizeof(struct i2c_master_dev_t));
+	dev->port = bus_handle->port;
+	dev->addr = dev_config->device_address;
+	*ret_handle = dev;
+	return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t * write_buffer, size_t write_size, int) {
+	return host_i2c_transfer(i2c_dev, write_buffer, write_size, NULL, 0);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev, uint8_t * read_buffer, size_t read_size, int) {
+	return host_i2c_transfer(i2c_dev, NULL, 0, read_buffer, read_size);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev, const uint8_t * write_buffer, size_t write_size, uint8_t * read_buffer, size_t read_size, int) {
+	return host_i2c_transfer(i2c_dev, write_buffer, write_size, read_buffer, read_size);
+}
@@ -0,0 +1,390 @@
+#include "host.h"
+
+#include <errno.h>
+#include <pthread.h>
+
+// MQTT client and broker in one: the device is the only client. Publishes are counted and retained,
+// messages for subscribed topics (including the device's own publishes) go back to the device
+// from the "mqtt_task" task, one at a time, as esp-mqtt does.
+
+#define HOST_MQTT_MAX_SUBSCRIPTIONS 48
+#define HOST_MQTT_MAX_TOPICS        96
+
+typedef struct host_mqtt_message_t {
+	char * topic;
+	char * data;
+	int len;
+	struct host_mqtt_message_t * next;
+} host_mqtt_message_t;
+
+typedef struct {
+	char * topic;
+	char * retained;
+	int retained_len;
+	uint32_t published;
+	uint32_t delivered;
+} host_mqtt_topic_t;
+
+struct esp_mqtt_client {
+	esp_event_handler_t handler;
+	void * handler_arg;
+};
+
+static struct esp_mqtt_client host_mqtt_client;
+static pthread_mutex_t host_mqtt_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t host_mqtt_changed = PTHREAD_COND_INITIALIZER;
+
+static host_mqtt_message_t * host_mqtt_queue_head = NULL;
+static host_mqtt_message_t * host_mqtt_queue_tail = NULL;
+static bool host_mqtt_busy = false;
+static bool host_mqtt_is_connected = false;
+static bool host_mqtt_reconnect_requested = false;
+static bool host_mqtt_online = true;
+static int host_mqtt_msg_id = 0;
+
+static char * host_mqtt_subscriptions[HOST_MQTT_MAX_SUBSCRIPTIONS];
+static uint8_t host_mqtt_subscriptions_count = 0;
+
+static host_mqtt_topic_t host_mqtt_topics[HOST_MQTT_MAX_TOPICS];
+static uint8_t host_mqtt_topics_count = 0;
+
+static host_mqtt_observer_t host_mqtt_observer = NULL;
+static void * host_mqtt_observer_arg = NULL;
+
+static char * host_mqtt_strndup(const char * value, size_t len) {
+	char * result = host_malloc(len + 1);
+	memcpy(result, value, len);
+	result[len] = 0;
+	return result;
+}
+
+static host_mqtt_topic_t * host_mqtt_topic(const char * topic) {
+	for (uint8_t i = 0; i<host_mqtt_topics_count; i++) {
+		if (strcmp(host_mqtt_topics[i].topic, topic) == 0) {
+			return &host_mqtt_topics[i];
+		}
+	}
+
+	if (host_mqtt_topics_count >= HOST_MQTT_MAX_TOPICS) {
+		return NULL;
+	}
+
+	host_mqtt_topic_t * result = &host_mqtt_topics[host_mqtt_topics_count++];
+	memset(result, 0, sizeof(host_mqtt_topic_t));
+	result->topic = host_mqtt_strndup(topic, strlen(topic));
+	return result;
+}
+
+static bool host_mqtt_matches(const char * subscription, const char * topic) {
+	size_t len = strlen(subscription);
+	if (len >= 2 && strcmp(subscription + len - 2, "/#") == 0) {
+		return strncmp(subscription, topic, len - 2) == 0 && (topic[len - 2] == 0 || topic[len - 2] == '/');
+	}
+	return strcmp(subscription, topic) == 0;
+}
+
+static bool host_mqtt_subscribed(const char * topic) {
+	for (uint8_t i = 0; i<host_mqtt_subscriptions_count; i++) {
+		if (host_mqtt_matches(host_mqtt_subscriptions[i], topic)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// host_mqtt_lock is held
+static void host_mqtt_queue(const char * topic, const char * data, int len) {
+	host_mqtt_message_t * message = host_malloc(sizeof(host_mqtt_message_t));
+	message->topic = host_mqtt_strndup(topic, strlen(topic));
+	message->data = host_mqtt_strndup(data, len);
+	message->len = len;
+	message->next = NULL;
+
+	if (host_mqtt_queue_tail) {
+		host_mqtt_queue_tail->next = message;
+	} else {
+		host_mqtt_queue_head = message;
+	}
+	host_mqtt_queue_tail = message;
+
+	pthread_cond_broadcast(&host_mqtt_changed);
+}
+
+static void host_mqtt_dispatch(esp_mqtt_event_id_t event_id, host_mqtt_message_t * message) {
+	esp_mqtt_event_t event = {
+		.event_id = event_id,
+		.client = &host_mqtt_client,
+	};
+
+	if (message) {
+		event.topic = message->topic;
+		event.topic_len = strlen(message->topic);
+		event.data = message->data;
+		event.data_len = message->len;
+		event.total_data_len = message->len;
+	}
+
+	host_mqtt_client.handler(host_mqtt_client.handler_arg, "MQTT_EVENTS", event_id, &event);
+}
+
+static bool host_mqtt_has_work() {
+	return host_mqtt_queue_head != NULL || host_mqtt_reconnect_requested || host_mqtt_online != host_mqtt_is_connected;
+}
+
+static void host_mqtt_disconnect() {
+	host_mqtt_is_connected = false;
+	for (uint8_t i = 0; i<host_mqtt_subscriptions_count; i++) {
+		host_free(host_mqtt_subscriptions[i]);
+	}
+	host_mqtt_subscriptions_count = 0;
+}
+
+static void host_mqtt_task(void *) {
+	host_mqtt_dispatch(MQTT_EVENT_CONNECTED, NULL);
+
+	while (true) {
+		pthread_mutex_lock(&host_mqtt_lock);
+		while (!host_mqtt_has_work()) {
+			pthread_cond_wait(&host_mqtt_changed, &host_mqtt_lock);
+		}
+
+		if (host_mqtt_online != host_mqtt_is_connected) {
+			bool online = host_mqtt_online;
+			if (!online) {
+				host_mqtt_disconnect();
+			} else {
+				host_mqtt_is_connected = true;
+			}
+			host_mqtt_busy = true;
+			pthread_mutex_unlock(&host_mqtt_lock);
+
+			host_mqtt_dispatch(online ? MQTT_EVENT_CONNECTED : MQTT_EVENT_DISCONNECTED, NULL);
+
+			pthread_mutex_lock(&host_mqtt_lock);
+			host_mqtt_busy = false;
+			pthread_cond_broadcast(&host_mqtt_changed);
+			pthread_mutex_unlock(&host_mqtt_lock);
+			continue;
+		}
+
+		if (host_mqtt_reconnect_requested) {
+			host_mqtt_reconnect_requested = false;
+			host_mqtt_disconnect();
+			host_mqtt_busy = true;
+			pthread_mutex_unlock(&host_mqtt_lock);
+
+			host_mqtt_dispatch(MQTT_EVENT_DISCONNECTED, NULL);
+
+			pthread_mutex_lock(&host_mqtt_lock);
+			host_mqtt_is_connected = true;
+			pthread_mutex_unlock(&host_mqtt_lock);
+
+			host_mqtt_dispatch(MQTT_EVENT_CONNECTED, NULL);
+
+			pthread_mutex_lock(&host_mqtt_lock);
+			host_mqtt_busy = false;
+			pthread_cond_broadcast(&host_mqtt_changed);
+			pthread_mutex_unlock(&host_mqtt_lock);
+			continue;
+		}
+
+		host_mqtt_message_t * message = host_mqtt_queue_head;
+		host_mqtt_queue_head = message->next;
+		if (host_mqtt_queue_head == NULL) {
+			host_mqtt_queue_tail = NULL;
+		}
+
+		host_mqtt_topic_t * topic = host_mqtt_topic(message->topic);
+		if (topic) {
+			topic->delivered++;
+		}
+		host_mqtt_busy = true;
+		pthread_mutex_unlock(&host_mqtt_lock);
+
+		host_mqtt_dispatch(MQTT_EVENT_DATA, message);
+
+		host_free(message->topic);
+		host_free(message->data);
+		host_free(message);
+
+		pthread_mutex_lock(&host_mqtt_lock);
+		host_mqtt_busy = false;
+		pthread_cond_broadcast(&host_mqtt_changed);
+		pthread_mutex_unlock(&host_mqtt_lock);
+	}
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *) {
+	return &host_mqtt_client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t, esp_event_handler_t event_handler, void * event_handler_arg) {
+	client->handler = event_handler;
+	client->handler_arg = event_handler_arg;
+	return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t) {
+	pthread_mutex_lock(&host_mqtt_lock);
+	host_mqtt_is_connected = true;
+	pthread_mutex_unlock(&host_mqtt_lock);
+
+	return xTaskCreate(host_mqtt_task, "mqtt_task", 6144, NULL, 5, NULL) == pdPASS ? ESP_OK : ESP_FAIL;
+}
+
+int esp_mqtt_client_subscribe_single(esp_mqtt_client_handle_t, const char * topic, int) {
+	pthread_mutex_lock(&host_mqtt_lock);
+	if (host_mqtt_subscriptions_count >= HOST_MQTT_MAX_SUBSCRIPTIONS) {
+		pthread_mutex_unlock(&host_mqtt_lock);
+		return -1;
+	}
+
+	host_mqtt_subscriptions[host_mqtt_subscriptions_count++] = host_mqtt_strndup(topic, strlen(topic));
+
+	// retained messages go to a new subscriber
+	for (uint8_t i = 0; i<host_mqtt_topics_count; i++) {
+		if (host_mqtt_topics[i].retained && host_mqtt_matches(topic, host_mqtt_topics[i].topic)) {
+			host_mqtt_queue(host_mqtt_topics[i].topic, host_mqtt_topics[i].retained, host_mqtt_topics[i].retained_len);
+		}
+	}
+
+	int msg_id = ++host_mqtt_msg_id;
+	pthread_mutex_unlock(&host_mqtt_lock);
+
+	return msg_id;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t, const char * topic, const char * data, int len, int, int retain) {
+	if (len <= 0) {
+		len = data ? strlen(data) : 0;
+	}
+
+	pthread_mutex_lock(&host_mqtt_lock);
+	if (!host_mqtt_is_connected) {
+		pthread_mutex_unlock(&host_mqtt_lock);
+		return -1;
+	}
+
+	host_mqtt_topic_t * entry = host_mqtt_topic(topic);
+	if (entry) {
+		entry->published++;
+		if (retain) {
+			host_free(entry->retained);
+			entry->retained = host_mqtt_strndup(data, len);
+			entry->retained_len = len;
+		}
+	}
+
+	if (host_mqtt_subscribed(topic)) {
+		host_mqtt_queue(topic, data, len);
+	}
+
+	int msg_id = ++host_mqtt_msg_id;
+	host_mqtt_observer_t observer = host_mqtt_observer;
+	void * observer_arg = host_mqtt_observer_arg;
+	pthread_mutex_unlock(&host_mqtt_lock);
+
+	if (observer) {
+		observer(topic, data, len, observer_arg);
+	}
+
+	return msg_id;
+}
+
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char * topic, const char * data, int len, int qos, int retain, bool) {
+	return esp_mqtt_client_publish(client, topic, data, len, qos, retain);
+}
+
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t) {
+	return 0;
+}
+
+void host_mqtt_set_observer(host_mqtt_observer_t observer, void * arg) {
+	pthread_mutex_lock(&host_mqtt_lock);
+	host_mqtt_observer = observer;
+	host_mqtt_observer_arg = arg;
+	pthread_mutex_unlock(&host_mqtt_lock);
+}
+
+void host_mqtt_inject(const char * topic, const char * data) {
+	pthread_mutex_lock(&host_mqtt_lock);
+	if (host_mqtt_subscribed(topic)) {
+		host_mqtt_queue(topic, data, strlen(data));
+	}
+	pthread_mutex_unlock(&host_mqtt_lock);
+}
+
+bool host_mqtt_wait_idle(uint32_t timeout_real_ms) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout_real_ms / 1000;
+	deadline.tv_nsec += (timeout_real_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	bool idle = true;
+	pthread_mutex_lock(&host_mqtt_lock);
+	while (host_mqtt_has_work() || host_mqtt_busy) {
+		if (pthread_cond_timedwait(&host_mqtt_changed, &host_mqtt_lock, &deadline) == ETIMEDOUT) {
+			idle = !(host_mqtt_has_work() || host_mqtt_busy);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&host_mqtt_lock);
+
+	return idle;
+}
+
+bool host_mqtt_connected() {
+	pthread_mutex_lock(&host_mqtt_lock);
+	bool result = host_mqtt_is_connected && host_mqtt_subscriptions_count > 0;
+	pthread_mutex_unlock(&host_mqtt_lock);
+
+	return result;
+}
+
+void host_mqtt_set_online(bool online) {
+	pthread_mutex_lock(&host_mqtt_lock);
+	host_mqtt_online = online;
+	pthread_cond_broadcast(&host_mqtt_changed);
+	pthread_mutex_unlock(&host_mqtt_lock);
+}
+
+void host_mqtt_reconnect() {
+	pthread_mutex_lock(&host_mqtt_lock);
+	host_mqtt_reconnect_requested = true;
+	pthread_cond_broadcast(&host_mqtt_changed);
+	pthread_mutex_unlock(&host_mqtt_lock);
+}
+
+uint32_t host_mqtt_published(const char * topic) {
+	pthread_mutex_lock(&host_mqtt_lock);
+	host_mqtt_topic_t * entry = host_mqtt_topic(topic);
+	uint32_t result = entry ? entry->published : 0;
+	pthread_mutex_unlock(&host_mqtt_lock);
+
+	return result;
+}
+
+uint32_t host_mqtt_delivered(const char * topic) {
+	pthread_mutex_lock(&host_mqtt_lock);
+	host_mqtt_topic_t * entry = host_mqtt_topic(topic);
+	uint32_t result = entry ? entry->delivered : 0;
+	pthread_mutex_unlock(&host_mqtt_lock);
+
+	return result;
+}
+
+bool host_mqtt_retained(const char * topic, char * buffer, size_t buffer_size) {
+	pthread_mutex_lock(&host_mqtt_lock);
+	host_mqtt_topic_t * entry = host_mqtt_topic(topic);
+	bool result = entry && entry->retained;
+	if (result) {
+		snprintf(buffer, buffer_size, "%.*s", entry->retained_len, entry->retained);
+	}
+	pthread_mutex_unlock(&host_mqtt_lock);
+
+	return result;
+}
@@ -0,0 +1,128 @@
+#include "host.h"
+
+// WiFi always connects at once, SNTP and OTA do nothing. Events are dispatched synchronously.
+
+#define HOST_EVENT_HANDLERS 8
+
+typedef struct {
+	esp_event_base_t base;
+	int32_t id;
+	esp_event_handler_t handler;
+	void * arg;
+} host_event_handler_t;
+
+esp_event_base_t WIFI_EVENT = "WIFI_EVENT";
+esp_event_base_t IP_EVENT = "IP_EVENT";
+
+static host_event_handler_t host_event_handlers[HOST_EVENT_HANDLERS];
+static uint8_t host_event_handlers_count = 0;
+static int host_netif = 0;
+
+static void host_event_post(esp_event_base_t base, int32_t id) {
+	for (uint8_t i = 0; i<host_event_handlers_count; i++) {
+		host_event_handler_t * handler = &host_event_handlers[i];
+		if (handler->base == base && (handler->id == ESP_EVENT_ANY_ID || handler->id == id)) {
+			handler->handler(handler->arg, base, id, NULL);
+		}
+	}
+}
+
+esp_err_t esp_netif_init(void) {
+	return ESP_OK;
+}
+
+esp_err_t esp_event_loop_create_default(void) {
+	return ESP_OK;
+}
+
+void * esp_netif_create_default_wifi_sta(void) {
+	return &host_netif;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void * event_handler_arg, esp_event_handler_instance_t * instance) {
+	if (host_event_handlers_count >= HOST_EVENT_HANDLERS) {
+		return ESP_ERR_NO_MEM;
+	}
+
+	host_event_handler_t * handler = &host_event_handlers[host_event_handlers_count++];
+	handler->base = event_base;
+	handler->id = event_id;
+	handler->handler = event_handler;
+	handler->arg = event_handler_arg;
+
+	if (instance) {
+		*instance = handler;
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *) {
+	return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t, wifi_config_t *) {
+	return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t) {
+	return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) {
+	host_event_post(WIFI_EVENT, WIFI_EVENT_STA_START);
+	return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void) {
+	return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void) {
+	host_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP);
+	return ESP_OK;
+}
+
+void esp_sntp_setoperatingmode(esp_sntp_operatingmode_t) {
+}
+
+void esp_sntp_setservername(uint8_t, const char *) {
+}
+
+void esp_sntp_init(void) {
+}
+
+bool esp_sntp_enabled(void) {
+	return true;
+}
+
+// OTA: the running image is valid, an upgrade always fails
+
+static const esp_partition_t host_partition = { 0 };
+
+esp_err_t esp_https_ota(const esp_https_ota_config_t *) {
+	return ESP_FAIL;
+}
+
+esp_err_t esp_crt_bundle_attach(void *) {
+	return ESP_OK;
+}
+
+const esp_partition_t * esp_ota_get_running_partition(void) {
+	return &host_partition;
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t *, esp_ota_img_states_t * ota_state) {
+	*ota_state = ESP_OTA_IMG_NEW;
+	return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void) {
+	return ESP_OK;
+}
+
+esp_err_t esp_ota_get_partition_description(const esp_partition_t *, esp_app_desc_t * app_desc) {
+	memset(app_desc, 0, sizeof(esp_app_desc_t));
+	snprintf(app_desc->version, sizeof(app_desc->version), "host");
+	return ESP_OK;
+}
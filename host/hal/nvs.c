@@ -0,0 +1,149 @@
+#include "host.h"
+
+#include <pthread.h>
+
+// NVS in memory: namespace/key -> blob, lost on exit
+
+#define HOST_NVS_MAX_NAMESPACES 8
+#define HOST_NVS_NAME_SIZE      16
+
+typedef struct host_nvs_entry_t {
+	uint8_t namespace_index;
+	char key[HOST_NVS_NAME_SIZE];
+	uint8_t * value;
+	size_t size;
+	struct host_nvs_entry_t * next;
+} host_nvs_entry_t;
+
+static char host_nvs_namespaces[HOST_NVS_MAX_NAMESPACES][HOST_NVS_NAME_SIZE];
+static uint8_t host_nvs_namespaces_count = 0;
+static host_nvs_entry_t * host_nvs_entries = NULL;
+static uint32_t host_nvs_write_count = 0;
+static pthread_mutex_t host_nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static host_nvs_entry_t * host_nvs_find(nvs_handle_t handle, const char * key) {
+	for (host_nvs_entry_t * entry = host_nvs_entries; entry; entry = entry->next) {
+		if (entry->namespace_index == handle && strncmp(entry->key, key, HOST_NVS_NAME_SIZE - 1) == 0) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+esp_err_t nvs_flash_init(void) {
+	return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+	pthread_mutex_lock(&host_nvs_lock);
+	while (host_nvs_entries) {
+		host_nvs_entry_t * entry = host_nvs_entries;
+		host_nvs_entries = entry->next;
+		host_free(entry->value);
+		host_free(entry);
+	}
+	pthread_mutex_unlock(&host_nvs_lock);
+
+	return ESP_OK;
+}
+
+esp_err_t nvs_open(const char * namespace_name, nvs_open_mode_t open_mode, nvs_handle_t * out_handle) {
+	esp_err_t res = ESP_OK;
+
+	pthread_mutex_lock(&host_nvs_lock);
+	uint8_t index = 0;
+	while (index < host_nvs_namespaces_count && strncmp(host_nvs_namespaces[index], namespace_name, HOST_NVS_NAME_SIZE - 1) != 0) {
+		index++;
+	}
+
+	if (index == host_nvs_namespaces_count) {
+		if (index < HOST_NVS_MAX_NAMESPACES) {
+			snprintf(host_nvs_namespaces[index], HOST_NVS_NAME_SIZE, "%s", namespace_name);
+			host_nvs_namespaces_count++;
+		} else {
+			res = ESP_ERR_NO_MEM;
+		}
+	}
+	pthread_mutex_unlock(&host_nvs_lock);
+
+	*out_handle = index;
+	return res;
+}
+
+void nvs_close(nvs_handle_t) {
+}
+
+esp_err_t nvs_commit(nvs_handle_t) {
+	return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char * key, void * out_value, size_t * length) {
+	esp_err_t res = ESP_OK;
+
+	pthread_mutex_lock(&host_nvs_lock);
+	host_nvs_entry_t * entry = host_nvs_find(handle, key);
+	if (entry == NULL) {
+		res = ESP_ERR_NVS_NOT_FOUND;
+	} else if (out_value == NULL) {
+		*length = entry->size;
+	} else if (*length < entry->size) {
+		res = ESP_ERR_NVS_INVALID_LENGTH;
+	} else {
+		memcpy(out_value, entry->value, entry->size);
+		*length = entry->size;
+	}
+	pthread_mutex_unlock(&host_nvs_lock);
+
+	return res;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char * key, const void * value, size_t length) {
+	pthread_mutex_lock(&host_nvs_lock);
+	host_nvs_entry_t * entry = host_nvs_find(handle, key);
+	if (entry == NULL) {
+		entry = host_malloc(sizeof(host_nvs_entry_t));
+		memset(entry, 0, sizeof(host_nvs_entry_t));
+		entry->namespace_index = handle;
+		snprintf(entry->key, HOST_NVS_NAME_SIZE, "%s", key);
+		entry->next = host_nvs_entries;
+		host_nvs_entries = entry;
+	} else {
+		host_free(entry->value);
+	}
+
+	entry->value = host_malloc(length ? length : 1);
+	memcpy(entry->value, value, length);
+	entry->size = length;
+	host_nvs_write_count++;
+	pthread_mutex_unlock(&host_nvs_lock);
+
+	return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char * key) {
+	esp_err_t res = ESP_ERR_NVS_NOT_FOUND;
+
+	pthread_mutex_lock(&host_nvs_lock);
+	for (host_nvs_entry_t ** entry = &host_nvs_entries; *entry; entry = &(*entry)->next) {
+		if ((*entry)->namespace_index == handle && strncmp((*entry)->key, key, HOST_NVS_NAME_SIZE - 1) == 0) {
+			host_nvs_entry_t * removed = *entry;
+			*entry = removed->next;
+			host_free(removed->value);
+			host_free(removed);
+			host_nvs_write_count++;
+			res = ESP_OK;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&host_nvs_lock);
+
+	return res;
+}
+
+uint32_t host_nvs_writes() {
+	pthread_mutex_lock(&host_nvs_lock);
+	uint32_t result = host_nvs_write_count;
+	pthread_mutex_unlock(&host_nvs_lock);
+
+	return result;
+}
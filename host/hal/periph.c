@@ -0,0 +1,362 @@
+#include "host.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// GPIO, LEDC, PCNT, touch and RMT. LEDC channel 0 drives a fan whose speed follows the duty,
+// its tachometer pulses (2 per revolution) are counted by every PCNT unit.
+
+#define HOST_GPIO_MAX          40
+#define HOST_LEDC_CHANNELS     2
+#define HOST_FAN_PULSES_PER_REV 2
+#define HOST_TOUCH_UNTOUCHED   1000
+
+static pthread_mutex_t host_periph_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// gpio
+
+static uint8_t host_gpio_levels[HOST_GPIO_MAX];
+
+esp_err_t gpio_config(const gpio_config_t * config) {
+	if (config->pin_bit_mask >> HOST_GPIO_MAX) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+	if (gpio_num < 0 || gpio_num >= HOST_GPIO_MAX) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	host_gpio_levels[gpio_num] = level ? 1 : 0;
+	return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+	if (gpio_num < 0 || gpio_num >= HOST_GPIO_MAX) {
+		return 0;
+	}
+	return host_gpio_levels[gpio_num];
+}
+
+esp_err_t gpio_pullup_en(gpio_num_t) {
+	return ESP_OK;
+}
+
+// ledc: fades complete at once
+
+static uint8_t host_ledc_resolution = LEDC_TIMER_10_BIT;
+static uint32_t host_ledc_duty[HOST_LEDC_CHANNELS];
+static uint32_t host_ledc_fade_target[HOST_LEDC_CHANNELS];
+
+// pcnt: pulses since the last clear, integrated lazily over the fan speed
+struct pcnt_unit_t {
+	double count;
+	int64_t updated_at;
+	bool running;
+};
+
+struct pcnt_chan_t {
+	pcnt_unit_handle_t unit;
+};
+
+static double host_fan_rpm_locked() {
+	uint32_t max = 1UL << host_ledc_resolution;
+	uint32_t duty = host_ledc_duty[LEDC_CHANNEL_0];
+	return (double)HOST_FAN_MAX_RPM * (duty > max ? max : duty) / max;
+}
+
+uint32_t host_fan_rpm() {
+	pthread_mutex_lock(&host_periph_lock);
+	uint32_t rpm = host_fan_rpm_locked();
+	pthread_mutex_unlock(&host_periph_lock);
+	return rpm;
+}
+
+static void host_pcnt_update(pcnt_unit_handle_t unit) {
+	int64_t now = esp_timer_get_time();
+	if (unit->running) {
+		unit->count += host_fan_rpm_locked() * HOST_FAN_PULSES_PER_REV / 60.0 * (now - unit->updated_at) / 1000000.0;
+	}
+	unit->updated_at = now;
+}
+
+// every running unit has to be brought up to date before the fan speed changes
+static struct pcnt_unit_t * host_pcnt_units[4];
+static uint8_t host_pcnt_units_count = 0;
+
+static void host_ledc_set(ledc_channel_t channel, uint32_t duty) {
+	pthread_mutex_lock(&host_periph_lock);
+	for (uint8_t i = 0; i<host_pcnt_units_count; i++) {
+		host_pcnt_update(host_pcnt_units[i]);
+	}
+	host_ledc_duty[channel] = duty;
+	pthread_mutex_unlock(&host_periph_lock);
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t * timer_conf) {
+	if (timer_conf->duty_resolution < LEDC_TIMER_1_BIT || timer_conf->duty_resolution >= LEDC_TIMER_BIT_MAX) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	host_ledc_resolution = timer_conf->duty_resolution;
+	return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t * ledc_conf) {
+	if (ledc_conf->channel >= HOST_LEDC_CHANNELS) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	host_ledc_set(ledc_conf->channel, ledc_conf->duty);
+	return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int) {
+	return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t, ledc_channel_t channel, uint32_t target_duty, int) {
+	if (channel >= HOST_LEDC_CHANNELS) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	host_ledc_fade_target[channel] = target_duty;
+	return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t, ledc_channel_t channel, ledc_fade_mode_t) {
+	if (channel >= HOST_LEDC_CHANNELS) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	host_ledc_set(channel, host_ledc_fade_target[channel]);
+	return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t, ledc_channel_t) {
+	return ESP_OK;
+}
+
+esp_err_t ledc_set_duty_and_update(ledc_mode_t, ledc_channel_t channel, uint32_t duty, uint32_t) {
+	if (channel >= HOST_LEDC_CHANNELS) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	host_ledc_set(channel, duty);
+	return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t, ledc_channel_t channel, uint32_t duty) {
+	if (channel >= HOST_LEDC_CHANNELS) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	host_ledc_fade_target[channel] = duty;
+	return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel) {
+	return ledc_fade_start(mode, channel, LEDC_FADE_NO_WAIT);
+}
+
+uint32_t ledc_get_duty(ledc_mode_t, ledc_channel_t channel) {
+	if (channel >= HOST_LEDC_CHANNELS) {
+		return 0;
+	}
+	pthread_mutex_lock(&host_periph_lock);
+	uint32_t duty = host_ledc_duty[channel];
+	pthread_mutex_unlock(&host_periph_lock);
+	return duty;
+}
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t *, pcnt_unit_handle_t * ret_unit) {
+	if (host_pcnt_units_count >= sizeof(host_pcnt_units) / sizeof(host_pcnt_units[0])) {
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	struct pcnt_unit_t * unit = host_malloc(sizeof(struct pcnt_unit_t));
+	memset(unit, 0, sizeof(struct pcnt_unit_t));
+
+	pthread_mutex_lock(&host_periph_lock);
+	host_pcnt_units[host_pcnt_units_count++] = unit;
+	pthread_mutex_unlock(&host_periph_lock);
+
+	*ret_unit = unit;
+	return ESP_OK;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t *, pcnt_channel_handle_t * ret_chan) {
+	struct pcnt_chan_t * channel = host_malloc(sizeof(struct pcnt_chan_t));
+	channel->unit = unit;
+	*ret_chan = channel;
+	return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t, pcnt_channel_edge_action_t, pcnt_channel_edge_action_t) {
+	return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t, const pcnt_glitch_filter_config_t *) {
+	return ESP_OK;
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t) {
+	return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit) {
+	pthread_mutex_lock(&host_periph_lock);
+	host_pcnt_update(unit);
+	unit->running = true;
+	pthread_mutex_unlock(&host_periph_lock);
+	return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit) {
+	pthread_mutex_lock(&host_periph_lock);
+	host_pcnt_update(unit);
+	unit->count = 0;
+	pthread_mutex_unlock(&host_periph_lock);
+	return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int * value) {
+	pthread_mutex_lock(&host_periph_lock);
+	host_pcnt_update(unit);
+	*value = (int)unit->count;
+	pthread_mutex_unlock(&host_periph_lock);
+	return ESP_OK;
+}
+
+// touch: nobody touches the pad, the interrupt never fires
+
+static uint16_t host_touch_thresholds[TOUCH_PAD_MAX];
+
+esp_err_t touch_pad_init(void) {
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_set_fsm_mode(touch_fsm_mode_t) {
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_set_voltage(touch_high_volt_t, touch_low_volt_t, touch_volt_atten_t) {
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_config(touch_pad_t touch_num, uint16_t threshold) {
+	return touch_pad_set_thresh(touch_num, threshold);
+}
+
+esp_err_t touch_pad_filter_start(uint32_t) {
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_read_filtered(touch_pad_t touch_num, uint16_t * touch_value) {
+	if (touch_num >= TOUCH_PAD_MAX) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	*touch_value = HOST_TOUCH_UNTOUCHED;
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_read_raw_data(touch_pad_t touch_num, uint16_t * touch_value) {
+	return touch_pad_read_filtered(touch_num, touch_value);
+}
+
+esp_err_t touch_pad_set_thresh(touch_pad_t touch_num, uint16_t threshold) {
+	if (touch_num >= TOUCH_PAD_MAX) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	host_touch_thresholds[touch_num] = threshold;
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_set_trigger_mode(touch_trigger_mode_t) {
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_isr_register(intr_handler_t, void *) {
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_intr_enable(void) {
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_intr_disable(void) {
+	return ESP_OK;
+}
+
+esp_err_t touch_pad_intr_clear(void) {
+	return ESP_OK;
+}
+
+uint32_t touch_pad_get_status(void) {
+	return 0;
+}
+
+esp_err_t touch_pad_clear_status(void) {
+	return ESP_OK;
+}
+
+// rmt: encoders encode nothing, transmissions complete at once
+
+struct rmt_channel_t {
+	int gpio_num;
+};
+
+static size_t host_rmt_encode(rmt_encoder_t *, rmt_channel_handle_t, const void *, size_t, rmt_encode_state_t * ret_state) {
+	*ret_state = RMT_ENCODING_COMPLETE;
+	return 0;
+}
+
+static esp_err_t host_rmt_reset(rmt_encoder_t *) {
+	return ESP_OK;
+}
+
+static esp_err_t host_rmt_del(rmt_encoder_t * encoder) {
+	host_free(encoder);
+	return ESP_OK;
+}
+
+static esp_err_t host_rmt_new_encoder(rmt_encoder_handle_t * ret_encoder) {
+	rmt_encoder_t * encoder = host_malloc(sizeof(rmt_encoder_t));
+	encoder->encode = host_rmt_encode;
+	encoder->reset = host_rmt_reset;
+	encoder->del = host_rmt_del;
+	*ret_encoder = encoder;
+	return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *, rmt_encoder_handle_t * ret_encoder) {
+	return host_rmt_new_encoder(ret_encoder);
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *, rmt_encoder_handle_t * ret_encoder) {
+	return host_rmt_new_encoder(ret_encoder);
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder) {
+	return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder) {
+	return encoder->reset(encoder);
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t * config, rmt_channel_handle_t * ret_chan) {
+	struct rmt_channel_t * channel = host_malloc(sizeof(struct rmt_channel_t));
+	channel->gpio_num = config->gpio_num;
+	*ret_chan = channel;
+	return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t) {
+	return ESP_OK;
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t channel, rmt_encoder_handle_t encoder, const void * payload, size_t payload_bytes, const rmt_transmit_config_t *) {
+	rmt_encode_state_t state = RMT_ENCODING_RESET;
+	encoder->encode(encoder, channel, payload, payload_bytes, &state);
+	return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t, int) {
+	return ESP_OK;
+}
@@ -0,0 +1,359 @@
+#include "host.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+// Device models behind the simulated buses. Every model answers with the current value of its
+// signals, encoded the way the real sensor does it, and stamps the time of the measurement.
+
+#define HOST_BME280_ADDRESS 0x76
+#define HOST_SGP41_ADDRESS  0x59
+#define HOST_PMS7003_PORT   1
+#define HOST_MHZ19B_PORT    2
+
+#define HOST_PMS7003_PERIOD_US 1000000
+
+static pthread_mutex_t host_signals_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_signal_t host_signals[HOST_SIGNAL_MAX];
+static uint32_t host_noise_state = 1;
+
+static _Atomic int64_t host_sampled_at[HOST_DEVICE_MAX];
+
+void host_signal_set(host_signal_id_t id, host_signal_t signal) {
+	pthread_mutex_lock(&host_signals_lock);
+	host_signals[id] = signal;
+	pthread_mutex_unlock(&host_signals_lock);
+}
+
+double host_signal_value(host_signal_id_t id) {
+	double t = esp_timer_get_time() / 1000000.0;
+
+	pthread_mutex_lock(&host_signals_lock);
+	host_signal_t signal = host_signals[id];
+	// xorshift, the same sequence on every run
+	host_noise_state ^= host_noise_state << 13;
+	host_noise_state ^= host_noise_state >> 17;
+	host_noise_state ^= host_noise_state << 5;
+	double noise = ((double)host_noise_state / UINT32_MAX * 2.0 - 1.0) * signal.noise;
+	pthread_mutex_unlock(&host_signals_lock);
+
+	double value = signal.base + noise;
+	if (signal.period_s > 0) {
+		value += signal.amplitude * sin(2.0 * M_PI * t / signal.period_s);
+	}
+	return value;
+}
+
+int64_t host_sensor_sampled_at(host_device_t device) {
+	return host_sampled_at[device];
+}
+
+void host_sensor_mark_sampled(host_device_t device) {
+	host_sampled_at[device] = esp_timer_get_time();
+}
+
+// BME280: register file, measurements are compensated with the datasheet floating point
+// formulas run backwards (bisection over the raw ADC value) from the signals.
+
+typedef struct {
+	uint16_t T1;
+	int16_t T2, T3;
+	uint16_t P1;
+	int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+	uint8_t H1;
+	int16_t H2;
+	uint8_t H3;
+	int16_t H4, H5;
+	int8_t H6;
+} host_bme280_calibration_t;
+
+// datasheet example values
+static const host_bme280_calibration_t host_bme280_calibration = {
+	.T1 = 27504, .T2 = 26435, .T3 = -1000,
+	.P1 = 36477, .P2 = -10685, .P3 = 3024, .P4 = 2855, .P5 = 140, .P6 = -7, .P7 = 15500, .P8 = -14600, .P9 = 6000,
+	.H1 = 75, .H2 = 370, .H3 = 0, .H4 = 313, .H5 = 50, .H6 = 30,
+};
+
+static uint8_t host_bme280_registers[256];
+static pthread_mutex_t host_bme280_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double host_bme280_temperature(int32_t raw, double * t_fine) {
+	const host_bme280_calibration_t * c = &host_bme280_calibration;
+	double var1 = (raw / 16384.0 - c->T1 / 1024.0) * c->T2;
+	double var2 = (raw / 131072.0 - c->T1 / 8192.0) * (raw / 131072.0 - c->T1 / 8192.0) * c->T3;
+	*t_fine = var1 + var2;
+	return (var1 + var2) / 5120.0;
+}
+
+static double host_bme280_pressure(int32_t raw, double t_fine) {
+	const host_bme280_calibration_t * c = &host_bme280_calibration;
+	double var1 = t_fine / 2.0 - 64000.0;
+	double var2 = var1 * var1 * c->P6 / 32768.0;
+	var2 = var2 + var1 * c->P5 * 2.0;
+	var2 = var2 / 4.0 + c->P4 * 65536.0;
+	var1 = (c->P3 * var1 * var1 / 524288.0 + c->P2 * var1) / 524288.0;
+	var1 = (1.0 + var1 / 32768.0) * c->P1;
+	double p = 1048576.0 - raw;
+	p = (p - var2 / 4096.0) * 6250.0 / var1;
+	var1 = c->P9 * p * p / 2147483648.0;
+	var2 = p * c->P8 / 32768.0;
+	return p + (var1 + var2 + c->P7) / 16.0;
+}
+
+static double host_bme280_humidity(int32_t raw, double t_fine) {
+	const host_bme280_calibration_t * c = &host_bme280_calibration;
+	double h = t_fine - 76800.0;
+	h = (raw - (c->H4 * 64.0 + c->H5 / 16384.0 * h)) * (c->H2 / 65536.0 * (1.0 + c->H6 / 67108864.0 * h * (1.0 + c->H3 / 67108864.0 * h)));
+	return h * (1.0 - c->H1 * h / 524288.0);
+}
+
+// smallest raw value in [low, high] with f(raw) >= target, f is increasing (or decreasing when sign is -1)
+static int32_t host_bme280_invert(double (*f)(int32_t, double), double arg, double target, int32_t low, int32_t high, int sign) {
+	while (low < high) {
+		int32_t middle = low + (high - low) / 2;
+		if (sign * f(middle, arg) >= sign * target) {
+			high = middle;
+		} else {
+			low = middle + 1;
+		}
+	}
+	return low;
+}
+
+static double host_bme280_temperature_of(int32_t raw, double) {
+	double t_fine;
+	return host_bme280_temperature(raw, &t_fine);
+}
+
+static void host_bme280_measure() {
+	int32_t raw_t = host_bme280_invert(host_bme280_temperature_of, 0, host_signal_value(HOST_SIGNAL_TEMPERATURE), 0, (1 << 20) - 1, 1);
+	double t_fine;
+	host_bme280_temperature(raw_t, &t_fine);
+	int32_t raw_p = host_bme280_invert(host_bme280_pressure, t_fine, host_signal_value(HOST_SIGNAL_PRESSURE), 0, (1 << 20) - 1, -1);
+	int32_t raw_h = host_bme280_invert(host_bme280_humidity, t_fine, host_signal_value(HOST_SIGNAL_HUMIDITY), 0, 0xFFFF, 1);
+
+	uint8_t * data = &host_bme280_registers[0xF7];
+	data[0] = raw_p >> 12;
+	data[1] = raw_p >> 4;
+	data[2] = (raw_p & 0xF) << 4;
+	data[3] = raw_t >> 12;
+	data[4] = raw_t >> 4;
+	data[5] = (raw_t & 0xF) << 4;
+	data[6] = raw_h >> 8;
+	data[7] = raw_h;
+
+	host_sensor_mark_sampled(HOST_DEVICE_BME280);
+}
+
+static void host_bme280_reset() {
+	const host_bme280_calibration_t * c = &host_bme280_calibration;
+	const uint16_t words[12] = {
+		c->T1, (uint16_t)c->T2, (uint16_t)c->T3,
+		c->P1, (uint16_t)c->P2, (uint16_t)c->P3, (uint16_t)c->P4, (uint16_t)c->P5, (uint16_t)c->P6, (uint16_t)c->P7, (uint16_t)c->P8, (uint16_t)c->P9,
+	};
+
+	memset(host_bme280_registers, 0, sizeof(host_bme280_registers));
+	for (uint8_t i = 0; i<12; i++) {
+		host_bme280_registers[0x88 + i * 2] = words[i] & 0xFF;
+		host_bme280_registers[0x89 + i * 2] = words[i] >> 8;
+	}
+	host_bme280_registers[0xA1] = c->H1;
+	host_bme280_registers[0xD0] = 0x60;
+	host_bme280_registers[0xE1] = c->H2 & 0xFF;
+	host_bme280_registers[0xE2] = (uint16_t)c->H2 >> 8;
+	host_bme280_registers[0xE3] = c->H3;
+	host_bme280_registers[0xE4] = c->H4 >> 4;
+	host_bme280_registers[0xE5] = (c->H4 & 0xF) | ((c->H5 & 0xF) << 4);
+	host_bme280_registers[0xE6] = c->H5 >> 4;
+	host_bme280_registers[0xE7] = (uint8_t)c->H6;
+}
+
+static esp_err_t host_bme280_transfer(void *, const uint8_t * write, size_t write_size, uint8_t * read, size_t read_size) {
+	if (write_size == 0) {
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	pthread_mutex_lock(&host_bme280_lock);
+
+	uint8_t reg = write[0];
+	// register/value pairs, the measurement starts on a write of ctrl_meas with a forced mode
+	for (size_t i = 0; i + 1 < write_size; i += 2) {
+		host_bme280_registers[write[i]] = write[i + 1];
+		if (write[i] == 0xF4 && (write[i + 1] & 0x03) != 0x00 && (write[i + 1] & 0x03) != 0x03) {
+			host_bme280_measure();
+		}
+	}
+
+	if (read_size) {
+		// normal mode: the sensor measures on its own, the data is always fresh
+		if (reg == 0xF7 && (host_bme280_registers[0xF4] & 0x03) == 0x03) {
+			host_bme280_measure();
+		}
+		for (size_t i = 0; i<read_size; i++) {
+			read[i] = host_bme280_registers[(reg + i) & 0xFF];
+		}
+	}
+
+	pthread_mutex_unlock(&host_bme280_lock);
+
+	return ESP_OK;
+}
+
+// SGP41: the answer of the last command is latched until it is read
+
+static uint8_t host_sgp41_reply[9];
+static size_t host_sgp41_reply_size = 0;
+static pthread_mutex_t host_sgp41_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t host_sgp41_crc(uint8_t msb, uint8_t lsb) {
+	uint8_t crc = 0xFF;
+	uint8_t bytes[2] = { msb, lsb };
+	for (uint8_t i = 0; i<2; i++) {
+		crc ^= bytes[i];
+		for (uint8_t bit = 0; bit<8; bit++) {
+			crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+static void host_sgp41_word(uint16_t value) {
+	uint8_t * word = &host_sgp41_reply[host_sgp41_reply_size];
+	word[0] = value >> 8;
+	word[1] = value & 0xFF;
+	word[2] = host_sgp41_crc(word[0], word[1]);
+	host_sgp41_reply_size += 3;
+}
+
+static uint16_t host_sgp41_ticks(host_signal_id_t id) {
+	double value = host_signal_value(id);
+	return value < 0 ? 0 : (value > 0xFFFF ? 0xFFFF : (uint16_t)value);
+}
+
+static esp_err_t host_sgp41_transfer(void *, const uint8_t * write, size_t write_size, uint8_t * read, size_t read_size) {
+	pthread_mutex_lock(&host_sgp41_lock);
+
+	if (write_size >= 2) {
+		uint16_t command = (write[0] << 8) | write[1];
+		host_sgp41_reply_size = 0;
+		switch (command) {
+		case 0x3682:
+			host_sgp41_word(0x0000);
+			host_sgp41_word(0x0415);
+			host_sgp41_word(0x2A41);
+			break;
+		case 0x280E:
+			host_sgp41_word(0xD400);
+			break;
+		case 0x2612:
+			host_sgp41_word(host_sgp41_ticks(HOST_SIGNAL_VOC_RAW));
+			break;
+		case 0x2619:
+			host_sgp41_word(host_sgp41_ticks(HOST_SIGNAL_VOC_RAW));
+			host_sgp41_word(host_sgp41_ticks(HOST_SIGNAL_NOX_RAW));
+			host_sensor_mark_sampled(HOST_DEVICE_SGP41);
+			break;
+		default:
+			break;
+		}
+	}
+
+	esp_err_t res = ESP_OK;
+	if (read_size) {
+		if (read_size > host_sgp41_reply_size) {
+			// nothing to answer, the sensor does not acknowledge the read
+			res = ESP_FAIL;
+		} else {
+			memcpy(read, host_sgp41_reply, read_size);
+		}
+	}
+
+	pthread_mutex_unlock(&host_sgp41_lock);
+
+	return res;
+}
+
+// MH-Z19B: answers every 9 byte command frame at once
+
+static void host_mhz19b_write(void *, int port, const uint8_t * data, size_t size) {
+	if (size != 9 || data[0] != 0xFF || data[1] != 0x01) {
+		return;
+	}
+
+	uint8_t reply[9] = { 0xFF, data[2] };
+	if (data[2] == 0x86) {
+		double value = host_signal_value(HOST_SIGNAL_CO2);
+		uint16_t ppm = value < 0 ? 0 : (value > 5000 ? 5000 : (uint16_t)value);
+		reply[2] = ppm >> 8;
+		reply[3] = ppm & 0xFF;
+		reply[4] = (uint8_t)(host_signal_value(HOST_SIGNAL_TEMPERATURE) + 40);
+		host_sensor_mark_sampled(HOST_DEVICE_MHZ19B);
+	}
+
+	uint8_t crc = 0;
+	for (uint8_t i = 1; i<8; i++) {
+		crc += reply[i];
+	}
+	reply[8] = 255 - crc + 1;
+
+	host_uart_feed(port, reply, sizeof(reply));
+}
+
+// PMS7003: active mode, one data frame per second
+
+static void host_pms7003_frame(void *) {
+	double pm25 = host_signal_value(HOST_SIGNAL_PM25);
+	if (pm25 < 0) {
+		pm25 = 0;
+	}
+
+	uint16_t fields[13] = {
+		pm25 * 0.7, pm25, pm25 * 1.3,	// CF=1
+		pm25 * 0.7, pm25, pm25 * 1.3,	// atmospheric
+		pm25 * 150, pm25 * 45, pm25 * 8, pm25 * 1.5, pm25 * 0.4, pm25 * 0.1,
+		0,
+	};
+
+	uint8_t frame[32] = { 0x42, 0x4D, 0x00, 0x1C };
+	for (uint8_t i = 0; i<13; i++) {
+		frame[4 + i * 2] = fields[i] >> 8;
+		frame[5 + i * 2] = fields[i] & 0xFF;
+	}
+
+	uint16_t sum = 0;
+	for (uint8_t i = 0; i<30; i++) {
+		sum += frame[i];
+	}
+	frame[30] = sum >> 8;
+	frame[31] = sum & 0xFF;
+
+	host_uart_feed(HOST_PMS7003_PORT, frame, sizeof(frame));
+	host_sensor_mark_sampled(HOST_DEVICE_PMS7003);
+}
+
+void host_sensors_init() {
+	host_signal_set(HOST_SIGNAL_TEMPERATURE, (host_signal_t) { .base = 23.0, .amplitude = 2.0, .period_s = 3600, .noise = 0.05 });
+	host_signal_set(HOST_SIGNAL_HUMIDITY, (host_signal_t) { .base = 45.0, .amplitude = 10.0, .period_s = 5400, .noise = 0.2 });
+	host_signal_set(HOST_SIGNAL_PRESSURE, (host_signal_t) { .base = 100500.0, .amplitude = 300.0, .period_s = 7200, .noise = 5.0 });
+	host_signal_set(HOST_SIGNAL_VOC_RAW, (host_signal_t) { .base = 30000.0, .amplitude = 800.0, .period_s = 1800, .noise = 40.0 });
+	host_signal_set(HOST_SIGNAL_NOX_RAW, (host_signal_t) { .base = 16000.0, .amplitude = 200.0, .period_s = 2400, .noise = 20.0 });
+	host_signal_set(HOST_SIGNAL_CO2, (host_signal_t) { .base = 650.0, .amplitude = 150.0, .period_s = 3000, .noise = 5.0 });
+	host_signal_set(HOST_SIGNAL_PM25, (host_signal_t) { .base = 12.0, .amplitude = 6.0, .period_s = 2000, .noise = 1.0 });
+	for (uint8_t channel = 0; channel<10; channel++) {
+		host_signal_set(HOST_SIGNAL_ADC(channel), (host_signal_t) { .base = 1500.0, .amplitude = 300.0, .period_s = 1200 + channel * 100, .noise = 8.0 });
+	}
+
+	host_bme280_reset();
+	host_i2c_attach(0, HOST_BME280_ADDRESS, host_bme280_transfer, NULL);
+	host_i2c_attach(0, HOST_SGP41_ADDRESS, host_sgp41_transfer, NULL);
+	host_uart_attach(HOST_MHZ19B_PORT, host_mhz19b_write, NULL);
+
+	esp_timer_handle_t timer = NULL;
+	esp_timer_create_args_t args = {
+		.callback = host_pms7003_frame,
+		.name = "pms7003 model",
+	};
+	esp_timer_create(&args, &timer);
+	esp_timer_start_periodic(timer, HOST_PMS7003_PERIOD_US);
+}
@@ -0,0 +1,164 @@
+#include "host.h"
+
+#include <errno.h>
+#include <pthread.h>
+
+// UART driver: writes go to the device model on the port, bytes from the device land in the RX
+// buffer and raise an UART_DATA event, like the IDF driver with an event queue.
+
+#define HOST_UART_PORTS 3
+
+typedef struct {
+	bool installed;
+	uint8_t * rx;
+	size_t rx_size;
+	size_t rx_head;
+	size_t rx_count;
+	QueueHandle_t events;
+
+	host_uart_write_t on_write;
+	void * ctx;
+} host_uart_t;
+
+static host_uart_t host_uarts[HOST_UART_PORTS];
+static pthread_mutex_t host_uart_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t host_uart_received = PTHREAD_COND_INITIALIZER;
+
+void host_uart_attach(int port, host_uart_write_t on_write, void * ctx) {
+	if (port < HOST_UART_PORTS) {
+		host_uarts[port].on_write = on_write;
+		host_uarts[port].ctx = ctx;
+	}
+}
+
+void host_uart_feed(int port, const uint8_t * data, size_t size) {
+	if (port >= HOST_UART_PORTS || !host_uarts[port].installed) {
+		return;
+	}
+
+	host_uart_t * uart = &host_uarts[port];
+	bool overflow = false;
+
+	pthread_mutex_lock(&host_uart_lock);
+	for (size_t i = 0; i<size; i++) {
+		if (uart->rx_count == uart->rx_size) {
+			overflow = true;
+			break;
+		}
+		uart->rx[(uart->rx_head + uart->rx_count) % uart->rx_size] = data[i];
+		uart->rx_count++;
+	}
+	pthread_cond_broadcast(&host_uart_received);
+	pthread_mutex_unlock(&host_uart_lock);
+
+	if (uart->events) {
+		uart_event_t event = {
+			.type = overflow ? UART_BUFFER_FULL : UART_DATA,
+			.size = size,
+		};
+		xQueueSend(uart->events, &event, 0);
+	}
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int, int queue_size, QueueHandle_t * uart_queue, int) {
+	if (uart_num >= HOST_UART_PORTS || host_uarts[uart_num].installed) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	host_uart_t * uart = &host_uarts[uart_num];
+	uart->rx = host_malloc(rx_buffer_size);
+	uart->rx_size = rx_buffer_size;
+	uart->rx_head = 0;
+	uart->rx_count = 0;
+	uart->events = NULL;
+	if (uart_queue) {
+		uart->events = xQueueCreate(queue_size, sizeof(uart_event_t));
+		*uart_queue = uart->events;
+	}
+	uart->installed = true;
+
+	return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t, const uart_config_t *) {
+	return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t, int, int, int, int) {
+	return ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void * buf, uint32_t length, TickType_t ticks_to_wait) {
+	if (uart_num >= HOST_UART_PORTS || !host_uarts[uart_num].installed) {
+		return -1;
+	}
+
+	host_uart_t * uart = &host_uarts[uart_num];
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	uint64_t ns = (uint64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000000ULL / host_time_scale();
+	deadline.tv_sec += ns / 1000000000ULL;
+	deadline.tv_nsec += ns % 1000000000ULL;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&host_uart_lock);
+	while (uart->rx_count < length && ticks_to_wait > 0) {
+		if (pthread_cond_timedwait(&host_uart_received, &host_uart_lock, &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+
+	uint32_t count = uart->rx_count < length ? uart->rx_count : length;
+	for (uint32_t i = 0; i<count; i++) {
+		((uint8_t *)buf)[i] = uart->rx[uart->rx_head];
+		uart->rx_head = (uart->rx_head + 1) % uart->rx_size;
+	}
+	uart->rx_count -= count;
+	pthread_mutex_unlock(&host_uart_lock);
+
+	return count;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void * src, size_t size) {
+	if (uart_num >= HOST_UART_PORTS || !host_uarts[uart_num].installed) {
+		return -1;
+	}
+
+	// 9600 8N1: about 1 ms per byte
+	host_delay_us(size * 1042);
+
+	if (host_uarts[uart_num].on_write) {
+		host_uarts[uart_num].on_write(host_uarts[uart_num].ctx, uart_num, src, size);
+	}
+
+	return size;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num) {
+	if (uart_num >= HOST_UART_PORTS || !host_uarts[uart_num].installed) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	pthread_mutex_lock(&host_uart_lock);
+	host_uarts[uart_num].rx_head = 0;
+	host_uarts[uart_num].rx_count = 0;
+	pthread_mutex_unlock(&host_uart_lock);
+
+	return ESP_OK;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t * size) {
+	if (uart_num >= HOST_UART_PORTS || !host_uarts[uart_num].installed) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	pthread_mutex_lock(&host_uart_lock);
+	*size = host_uarts[uart_num].rx_count;
+	pthread_mutex_unlock(&host_uart_lock);
+
+	return ESP_OK;
+}
@@ -0,0 +1,117 @@
+#ifndef HOST_INCLUDE_HOST_H_
+#define HOST_INCLUDE_HOST_H_
+
+#include "idf_host.h"
+
+// Control interface of the host build. The firmware sees only the IDF API from idf_host.h,
+// tests and benchmarks drive the simulated world through these functions.
+
+// Time: the firmware runs on a virtual clock (esp_timer_get_time, ticks, delays) that goes
+// time_scale times faster than the wall clock. Call once, before anything else.
+void host_init(uint32_t time_scale);
+uint32_t host_time_scale();
+int64_t host_real_time_us();
+// sleeps the calling thread for virtual_ms of firmware time
+void host_run_for(uint32_t virtual_ms);
+void host_delay_us(uint32_t virtual_us);
+// app_main() in its own "main" task, as the IDF startup code does
+void host_start_app();
+
+// Heap accounting: malloc/calloc/realloc/free are wrapped at link time.
+// host_malloc/host_free bypass the accounting, the simulated hardware uses them.
+typedef struct {
+	uint64_t allocs;
+	uint64_t frees;
+	uint64_t bytes;
+} host_alloc_stats_t;
+
+void host_alloc_thread(host_alloc_stats_t * stats);
+void host_alloc_global(host_alloc_stats_t * stats);
+void * host_malloc(size_t size);
+void host_free(void * ptr);
+
+// esp_restart() ends the calling task and is counted here, shutdown handlers run on host_shutdown()
+uint32_t host_restart_count();
+void host_shutdown();
+
+// CPU time of the whole process, including the simulated hardware
+int64_t host_cpu_time_us();
+// CPU time of the FreeRTOS tasks only (firmware, esp_timer and MQTT client tasks), deleted ones included
+int64_t host_tasks_cpu_time_us();
+
+// MQTT broker: publishes are recorded and retained, subscribed topics are echoed back to the
+// device from the "mqtt_task" task, as a real broker does.
+typedef void (*host_mqtt_observer_t)(const char * topic, const char * data, int len, void * arg);
+
+void host_mqtt_set_observer(host_mqtt_observer_t observer, void * arg);
+// a message from another client
+void host_mqtt_inject(const char * topic, const char * data);
+// waits until every queued message is delivered and handled
+bool host_mqtt_wait_idle(uint32_t timeout_real_ms);
+bool host_mqtt_connected();
+// drops the connection and connects again: the device subscribes again and gets retained messages
+void host_mqtt_reconnect();
+// offline: the device is disconnected and its publishes fail until it is online again
+void host_mqtt_set_online(bool online);
+uint32_t host_mqtt_published(const char * topic);
+uint32_t host_mqtt_delivered(const char * topic);
+bool host_mqtt_retained(const char * topic, char * buffer, size_t buffer_size);
+
+// NVS: number of nvs_set_blob/nvs_erase_key calls
+uint32_t host_nvs_writes();
+
+// Scripted sensor signals: base + amplitude * sin(2 * pi * t / period) + uniform noise, t is virtual time
+typedef enum {
+	HOST_SIGNAL_TEMPERATURE = 0,	// C
+	HOST_SIGNAL_HUMIDITY,			// %
+	HOST_SIGNAL_PRESSURE,			// Pa
+	HOST_SIGNAL_VOC_RAW,			// SGP41 ticks
+	HOST_SIGNAL_NOX_RAW,			// SGP41 ticks
+	HOST_SIGNAL_CO2,				// ppm
+	HOST_SIGNAL_PM25,				// ug/m3
+	HOST_SIGNAL_ADC_CHANNEL0,		// raw 12-bit ADC counts, one signal per channel
+	HOST_SIGNAL_MAX = HOST_SIGNAL_ADC_CHANNEL0 + 10
+} host_signal_id_t;
+
+#define HOST_SIGNAL_ADC(channel) ((host_signal_id_t)(HOST_SIGNAL_ADC_CHANNEL0 + (channel)))
+
+typedef struct {
+	double base;
+	double amplitude;
+	double period_s;
+	double noise;
+} host_signal_t;
+
+void host_signal_set(host_signal_id_t id, host_signal_t signal);
+double host_signal_value(host_signal_id_t id);
+
+typedef enum {
+	HOST_DEVICE_BME280 = 0,
+	HOST_DEVICE_SGP41,
+	HOST_DEVICE_MHZ19B,
+	HOST_DEVICE_PMS7003,
+	HOST_DEVICE_ADC,
+
+	HOST_DEVICE_MAX
+} host_device_t;
+
+// attaches BME280 and SGP41 to I2C port 0, PMS7003 to UART1, MH-Z19B to UART2 and sets default signals
+void host_sensors_init();
+// virtual time (us) of the last measurement a device returned, 0 if none
+int64_t host_sensor_sampled_at(host_device_t device);
+void host_sensor_mark_sampled(host_device_t device);
+
+// Device models
+typedef esp_err_t (*host_i2c_transfer_t)(void * ctx, const uint8_t * write, size_t write_size, uint8_t * read, size_t read_size);
+typedef void (*host_uart_write_t)(void * ctx, int port, const uint8_t * data, size_t size);
+
+void host_i2c_attach(uint8_t port, uint16_t addr, host_i2c_transfer_t transfer, void * ctx);
+void host_uart_attach(int port, host_uart_write_t on_write, void * ctx);
+// bytes sent by the device, they show up in the RX buffer and as an UART_DATA event
+void host_uart_feed(int port, const uint8_t * data, size_t size);
+
+// fan on the LEDC channel of the PWM fan, pulses go to the PCNT unit
+#define HOST_FAN_MAX_RPM 2400
+uint32_t host_fan_rpm();
+
+#endif /* HOST_INCLUDE_HOST_H_ */
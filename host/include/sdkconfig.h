@@ -0,0 +1,124 @@
+#ifndef HOST_SDKCONFIG_H_
+#define HOST_SDKCONFIG_H_
+
+// Project options for the host build: every component enabled, Kconfig defaults otherwise.
+// Keep in sync with src/main/Kconfig.projbuild when options are added.
+
+#define CONFIG_WIFI_SSID "host"
+#define CONFIG_WIFI_PASSWORD "host"
+#define CONFIG_WIFI_TOPIC "/system/wifi/command"
+#define CONFIG_WIFI_SNTP_SERVER "pool.ntp.org"
+#define CONFIG_WIFI_TZ "UTC0"
+#define CONFIG_MQTT_BROKER_URI "mqtt://localhost"
+#define CONFIG_MQTT_BROKER_USERNAME ""
+#define CONFIG_MQTT_BROKER_PASSWORD ""
+#define CONFIG_MQTT_TOPICS_PREFIX "/air/0"
+#define CONFIG_MQTT_PAYLOAD_COMPACT 1
+#define CONFIG_MQTT_JOURNAL_ENABLED 1
+#define CONFIG_MQTT_JOURNAL_SIZE 16384
+#define CONFIG_MQTT_JOURNAL_REPLAY_BATCH 10
+#define CONFIG_SNAPSHOT_ENABLED 1
+#define CONFIG_SNAPSHOT_TOPIC "/snapshot"
+#define CONFIG_SNAPSHOT_PERIOD 60
+#define CONFIG_SNAPSHOT_STALE_AFTER 90
+#define CONFIG_DIAG_ENABLED 1
+#define CONFIG_DIAG_TOPIC "/system/diag"
+#define CONFIG_DIAG_PERIOD 60
+#define CONFIG_PROFILER_ENABLED 1
+#define CONFIG_PROFILER_TOPIC_COMMAND "/system/profiler"
+#define CONFIG_MQTT_HEALTHCHECK_ENABLED 1
+#define CONFIG_MQTT_HEALTHCHECK_TOPIC "/system/healthcheck"
+#define CONFIG_SCHEDULER_TOPIC_COMMAND "/system/scheduler/command"
+#define CONFIG_MQTT_OTA_ENABLED 1
+#define CONFIG_MQTT_OTA_TOPIC "/system/ota"
+#define CONFIG_MQTT_OTA_VERSION_TOPIC "/system/ota/version"
+#define CONFIG_LED_ENABLED 1
+#define CONFIG_LED_GPIO 4
+#define CONFIG_LED_TOPIC_COMMANDS "/led/command"
+#define CONFIG_I2C_ENABLED 1
+#define CONFIG_I2C_GPIO_SCL 22
+#define CONFIG_I2C_GPIO_SDA 21
+#define CONFIG_I2C1_ENABLED 1
+#define CONFIG_I2C1_GPIO_SCL 19
+#define CONFIG_I2C1_GPIO_SDA 18
+#define CONFIG_I2C_STATS_ENABLED 1
+#define CONFIG_I2C_TOPIC_STATS "/i2c/stats"
+#define CONFIG_I2C_STATS_PERIOD 60
+#define CONFIG_SGP41_ENABLED 1
+#define CONFIG_SGP41_TOPIC_DATA "/sgp41/data"
+#define CONFIG_SGP41_TOPIC_COMMAND "/sgp41/command"
+#define CONFIG_SGP41_I2C_PORT 0
+#define CONFIG_SGP41_GAS_INDEX_FIXED_POINT 1
+#define CONFIG_BME280_ENABLED 1
+#define CONFIG_BME280_TOPIC_DATA "/bme280/data"
+#define CONFIG_BME280_TOPIC_COMMAND "/bme280/command"
+#define CONFIG_BME280_I2C_PORT 0
+#define CONFIG_BME280_SAMPLE_PERIOD 5
+#define CONFIG_TOUCHPAD_ENABLED 1
+#define CONFIG_TOUCHPAD_ID 2
+#define CONFIG_TOUCHPAD_TOPIC_DATA "/touchpad/data"
+#define CONFIG_FAN_ENABLED 1
+#define CONFIG_FAN_GPIO 25
+#define CONFIG_FAN_TOPIC_DATA "/fan/command"
+#define CONFIG_FANPWM_ENABLED 1
+#define CONFIG_FANPWM_GPIO 26
+#define CONFIG_FANPWM_FREQUENCY 25000
+#define CONFIG_FANPWM_RESOLUTION 10
+#define CONFIG_FANPWM_FADE_TIME 2000
+#define CONFIG_FANPWM_PI_KP 20
+#define CONFIG_FANPWM_PI_KI 10
+#define CONFIG_FANPWM_TOPIC_COMMAND "/fanpwm/command"
+#define CONFIG_FANTACH_ENABLED 1
+#define CONFIG_FANTACH_GPIO 27
+#define CONFIG_FANTACH_FAN_PWM 1
+#define CONFIG_FANTACH_PULSES_PER_REVOLUTION 2
+#define CONFIG_FANTACH_STALL_RPM 200
+#define CONFIG_FANTACH_STALL_TIMEOUT 10
+#define CONFIG_FANTACH_TOPIC_DATA "/fantach/data"
+#define CONFIG_VENTILATION_ENABLED 1
+#define CONFIG_VENTILATION_FAN_PERCENT 100
+#define CONFIG_VENTILATION_HUMIDITY_ON 70
+#define CONFIG_VENTILATION_HUMIDITY_OFF 60
+#define CONFIG_VENTILATION_HUMIDITY_DARK_ON 0
+#define CONFIG_VENTILATION_LIGHT_DARK 40
+#define CONFIG_VENTILATION_H2S_ON 20
+#define CONFIG_VENTILATION_H2S_OFF 10
+#define CONFIG_VENTILATION_CO2_ON 1200
+#define CONFIG_VENTILATION_CO2_OFF 900
+#define CONFIG_VENTILATION_TVOC_ON 400
+#define CONFIG_VENTILATION_TVOC_OFF 300
+#define CONFIG_VENTILATION_MIN_ON_TIME 300
+#define CONFIG_VENTILATION_OVERRIDE_TIMEOUT 3600
+#define CONFIG_VENTILATION_ACTIVE_FROM 0
+#define CONFIG_VENTILATION_ACTIVE_TO 24
+#define CONFIG_VENTILATION_TOPIC_DATA "/ventilation/data"
+#define CONFIG_VENTILATION_TOPIC_COMMAND "/ventilation/command"
+#define CONFIG_MQ136_ENABLED 1
+#define CONFIG_MQ136_ADC_CHANNEL 5
+#define CONFIG_MQ136_TOPIC_DATA "/mq136/data"
+#define CONFIG_MQ136_TOPIC_COMMAND "/mq136/command"
+#define CONFIG_O2A2_ENABLED 1
+#define CONFIG_O2A2_ADC_CHANNEL 7
+#define CONFIG_O2A2_TOPIC_DATA "/o2a2/data"
+#define CONFIG_O2A2_TOPIC_COMMAND "/o2a2/command"
+#define CONFIG_MQ7_ENABLED 1
+#define CONFIG_MQ7_ADC_CHANNEL 4
+#define CONFIG_MQ7_TOPIC_DATA "/mq7/data"
+#define CONFIG_MQ7_TOPIC_COMMAND "/mq7/command"
+#define CONFIG_LIGHT_ENABLED 1
+#define CONFIG_LIGHT_ADC_CHANNEL 6
+#define CONFIG_LIGHT_TOPIC_DATA "/light/data"
+#define CONFIG_LIGHT_TOPIC_COMMAND "/light/command"
+#define CONFIG_MHZ19B_ENABLED 1
+#define CONFIG_MHZ19B_RX 17
+#define CONFIG_MHZ19B_TX 16
+#define CONFIG_MHZ19B_TOPIC_DATA "/mhz19b/data"
+#define CONFIG_MHZ19B_TOPIC_COMMAND "/mhz19b/command"
+#define CONFIG_PMS7003_ENABLED 1
+#define CONFIG_PMS7003_RX 3
+#define CONFIG_PMS7003_TX 1
+#define CONFIG_PMS7003_RESET 18
+#define CONFIG_PMS7003_TOPIC_DATA "/pms7003/data"
+#define CONFIG_PMS7003_TOPIC_COMMAND "/pms7003/command"
+
+#endif /* HOST_SDKCONFIG_H_ */
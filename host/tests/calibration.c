@@ -0,0 +1,175 @@
+#include "host.h"
+#include "host_test.h"
+
+// adc_v_core_calibrate_execute() and its context are private to the driver
+#include "adc/adc_v_core/adc_v_core.c"
+
+#include <time.h>
+
+// Compares the bisection calibration of adc_v_core with the linear A0 sweep it replaced
+// on the MQ7, MQ136 and O2A2 models: status and A0 (the value reached for partial calibrations),
+// evaluations and CPU time per calibration.
+
+double mq7_adc2rsro(uint16_t adc, uint16_t calibration_value);
+double mq7_apply_compensation(double value, int8_t compensation_t, uint8_t compensation_h, bool * success);
+double mq7_rsro2value(double rs_ro);
+double mq136_adc2rsro(uint16_t adc, uint16_t calibration_value);
+double mq136_apply_compensation(double value, int8_t compensation_t, uint8_t compensation_h, bool * success);
+double mq136_rsro2value(double rs_ro);
+double o2a2_adc2rsro(uint16_t adc, uint16_t calibration_value);
+double o2a2_apply_compensation(double rsro, int8_t compensation_t, uint8_t compensation_h, bool * success);
+double o2a2_rsro2value(double rsro);
+
+typedef struct {
+	const char * name;
+	adc_v_core__functions_t functions;
+	uint16_t find_value_x10;
+	uint16_t max_a0;
+	int8_t min_t;
+	int8_t max_t;
+} calibration_model_t;
+
+static const calibration_model_t calibration_models[] = {
+	{ "mq7",   { &adc_v_core_startup_allowed, &mq7_adc2rsro,   &mq7_apply_compensation,   &mq7_rsro2value },   0,   4094, -10, 50 },
+	{ "mq136", { &adc_v_core_startup_allowed, &mq136_adc2rsro, &mq136_apply_compensation, &mq136_rsro2value }, 0,   4094, -10, 70 },
+	{ "o2a2",  { &adc_v_core_startup_allowed, &o2a2_adc2rsro,  &o2a2_apply_compensation,  &o2a2_rsro2value },  209, 0,    -20, 50 },
+};
+
+#define CALIBRATION_MODELS (sizeof(calibration_models) / sizeof(calibration_models[0]))
+
+// The sweep as it was before the bisection, without its vTaskDelay every 50 steps. It starts at A0 = 1:
+// from A0 = 0 it failed with ADC_V_CORE_CALIBRATE_STATUS__ERROR, as an uncalibrated value.
+static uint8_t calibration_sweep(adc_v_core_context_t * context, uint16_t adc, bool full, uint32_t * iterations) {
+	uint16_t delta = full ? ADC_V_CORE_CALIBRATE_DELTA_A0 : ADC_V_CORE_CALIBRATE_DELTA_AUTORECALIBRATE_A0;
+
+	uint16_t min_a0 = ((adc <= delta) ? 1 : (adc - delta));
+	uint16_t max_a0 = ((((uint32_t) adc + (uint32_t)delta) > (uint32_t)0xFFFF) ? 0xFFFF : (adc + delta));
+
+	bool findmin = (context->calibrate_find_value_x10 == 0) ? true : false;
+	double found_value = findmin ? 1000000 : 0;
+	uint16_t found_value_a0 = adc;
+
+	double result = 0;
+	for (uint16_t i = min_a0; i<max_a0; i++) {
+		context->calibration_value = i;
+		(*iterations)++;
+
+		if (!adc_v_core_adc2result(context, adc, false, &result)) {
+			context->calibration_value = adc;
+			return ADC_V_CORE_CALIBRATE_STATUS__ERROR;
+		}
+
+		if (adc_v_core_calibrate_is_found(context, result)) {
+			return ADC_V_CORE_CALIBRATE_STATUS__OK;
+		}
+
+		if ((findmin && result < found_value) || (!findmin && result > found_value)) {
+			found_value = result;
+			found_value_a0 = i;
+		}
+	}
+
+	context->calibration_value = found_value_a0;
+	return ADC_V_CORE_CALIBRATE_STATUS__PARTICAL;
+}
+
+static int64_t calibration_cpu_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+int main() {
+	printf("%-6s %-14s %6s %9s %9s %14s %14s %12s %12s\n", "model", "window", "cases", "mismatch", "partial",
+			"sweep evals", "bisect evals", "sweep, us", "bisect, us");
+
+	for (uint8_t m = 0; m<CALIBRATION_MODELS; m++) {
+		const calibration_model_t * model = &calibration_models[m];
+
+		// MQ7 and MQ136 once more without their A0 limit, as the bisection was before it
+		for (uint8_t variant = 0; variant < (model->max_a0 ? 4 : 2); variant++) {
+			bool full = variant % 2;
+			bool limited = variant < 2;
+
+			adc_v_core_context_t context = { 0 };
+			context.tag = (char *)model->name;
+			context.functions = model->functions;
+			context.calibrate_find_value_x10 = model->find_value_x10;
+			context.calibrate_max_a0 = limited ? model->max_a0 : 0;
+			bool findmin = model->find_value_x10 == 0;
+
+			uint32_t cases = 0;
+			uint32_t mismatches = 0;
+			uint32_t partial = 0;
+			uint64_t sweep_iterations = 0;
+			uint32_t bisect_iterations = 0;
+			uint32_t bisect_iterations_max = 0;
+			int64_t sweep_ns = 0;
+			int64_t bisect_ns = 0;
+
+			for (uint16_t adc = 50; adc < 4096; adc += 45) {
+				for (int8_t t = model->min_t; t <= model->max_t; t += 10) {
+					for (uint8_t h = 20; h <= 90; h += 35) {
+						context.compensation_t = t;
+						context.compensation_h = h;
+
+						uint32_t iterations = 0;
+						int64_t start = calibration_cpu_ns();
+						uint8_t sweep_status = calibration_sweep(&context, adc, full, &iterations);
+						sweep_ns += calibration_cpu_ns() - start;
+						uint16_t sweep_a0 = context.calibration_value;
+						double sweep_value = 0;
+						adc_v_core_adc2result(&context, adc, false, &sweep_value);
+
+						adc_v_core_calibrate_result_t stats = { 0 };
+						start = calibration_cpu_ns();
+						uint8_t bisect_status = adc_v_core_calibrate_execute(&context, adc, full, &stats);
+						bisect_ns += calibration_cpu_ns() - start;
+						uint16_t bisect_a0 = context.calibration_value;
+						double bisect_value = 0;
+						adc_v_core_adc2result(&context, adc, false, &bisect_value);
+
+						cases++;
+						sweep_iterations += iterations;
+						bisect_iterations += stats.iterations;
+						if (stats.iterations > bisect_iterations_max) {
+							bisect_iterations_max = stats.iterations;
+						}
+						if (bisect_status == ADC_V_CORE_CALIBRATE_STATUS__PARTICAL) {
+							partial++;
+						}
+
+						bool same;
+						if (sweep_status == ADC_V_CORE_CALIBRATE_STATUS__OK) {
+							same = bisect_status == sweep_status && bisect_a0 == sweep_a0;
+						} else {
+							// the sweep never tried its last A0, the bisection does: it may match there or be closer
+							same = bisect_status == ADC_V_CORE_CALIBRATE_STATUS__OK ||
+									(findmin ? bisect_value <= sweep_value + 0.05 : bisect_value >= sweep_value - 0.05);
+						}
+
+						if (!same) {
+							mismatches++;
+							if (limited && mismatches <= 3) {
+								fprintf(stderr, "%s: adc = %u, t = %d, h = %u, full = %u: sweep status %u A0 %u value %f, bisection status %u A0 %u value %f\n",
+										model->name, adc, t, h, full, sweep_status, sweep_a0, sweep_value, bisect_status, bisect_a0, bisect_value);
+							}
+						}
+					}
+				}
+			}
+
+			printf("%-6s %-14s %6u %9u %9u %14.1f %8.1f (%2u) %12.2f %12.2f\n", model->name,
+					full ? (limited ? "full" : "full, no limit") : (limited ? "auto" : "auto, no limit"),
+					cases, mismatches, partial, (double)sweep_iterations / cases, (double)bisect_iterations / cases, bisect_iterations_max,
+					sweep_ns / 1000.0 / cases, bisect_ns / 1000.0 / cases);
+
+			if (limited) {
+				HOST_CHECK(mismatches == 0, "%s: %u calibrations worse than the sweep", model->name, mismatches);
+				HOST_CHECK(bisect_iterations_max <= (full ? 13 : 9), "%s: up to %u evaluations", model->name, bisect_iterations_max);
+			}
+		}
+	}
+
+	return host_test_result();
+}
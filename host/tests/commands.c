@@ -0,0 +1,90 @@
+#include "host.h"
+#include "host_test.h"
+
+#include "common/mqtt.h"
+
+// Commands on the command topics. The device publishes its replies retained to the same
+// topics it is subscribed to, so the broker delivers every reply back to it: a reply that parses
+// as a command again loops forever and rewrites NVS on each round, and again on every reconnect.
+// Every command must settle with a bounded number of NVS writes, a repeated one with none.
+
+#define COMMANDS_WARMUP_MS  (30 * 1000)
+#define COMMANDS_IDLE_MS    5000
+
+typedef struct {
+	const char * topic;
+	const char * command;
+	uint32_t max_nvs_writes;
+} commands_case_t;
+
+static const commands_case_t commands_cases[] = {
+	{ MQTT_TOPIC(CONFIG_PMS7003_TOPIC_COMMAND), "{\"type\":\"report_policy\",\"min_interval\":10,\"fields\":{\"particles_0_3\":{\"abs\":50,\"rel\":0}}}", 1 },
+	{ MQTT_TOPIC(CONFIG_MHZ19B_TOPIC_COMMAND),  "{\"type\":\"report_policy\",\"max_silence\":600}", 1 },
+	{ MQTT_TOPIC(CONFIG_SGP41_TOPIC_COMMAND),   "{\"type\":\"report_policy\",\"fields\":{\"tvoc\":{\"abs\":5}}}", 1 },
+	{ MQTT_TOPIC(CONFIG_BME280_TOPIC_COMMAND),  "{\"type\":\"report_policy\",\"min_interval\":30}", 1 },
+	{ MQTT_TOPIC(CONFIG_LIGHT_TOPIC_COMMAND),   "{\"type\":\"report_policy\",\"fields\":{\"light\":{\"abs\":5}}}", 1 },
+	{ MQTT_TOPIC(CONFIG_MQ7_TOPIC_COMMAND),     "{\"type\":\"report_policy\",\"max_silence\":900}", 1 },
+	{ MQTT_TOPIC(CONFIG_BME280_TOPIC_COMMAND),  "{\"type\":\"profile\",\"osr_h\":2,\"filter\":4}", 1 },
+	{ MQTT_TOPIC(CONFIG_PROFILER_TOPIC_COMMAND), "{\"type\":\"profiler\"}", 0 },
+};
+
+#define COMMANDS_CASES (sizeof(commands_cases) / sizeof(commands_cases[0]))
+
+static bool commands_send(const commands_case_t * test, uint32_t * nvs_writes, uint32_t * replies) {
+	uint32_t writes_before = host_nvs_writes();
+	uint32_t published_before = host_mqtt_published(test->topic);
+
+	host_mqtt_inject(test->topic, test->command);
+	bool idle = host_mqtt_wait_idle(COMMANDS_IDLE_MS);
+
+	*nvs_writes = host_nvs_writes() - writes_before;
+	*replies = host_mqtt_published(test->topic) - published_before;
+	return idle;
+}
+
+int main() {
+	host_init(50);
+	host_sensors_init();
+	host_start_app();
+
+	host_run_for(COMMANDS_WARMUP_MS);
+	HOST_CHECK(host_mqtt_connected(), "no MQTT connection after warmup");
+	HOST_CHECK(host_mqtt_wait_idle(COMMANDS_IDLE_MS), "startup messages not handled");
+
+	printf("%-24s %10s %8s %14s\n", "topic", "nvs writes", "replies", "repeated: nvs");
+
+	for (uint8_t i = 0; i<COMMANDS_CASES; i++) {
+		const commands_case_t * test = &commands_cases[i];
+
+		uint32_t writes = 0, replies = 0;
+		bool idle = commands_send(test, &writes, &replies);
+		HOST_CHECK(idle, "%s: the reply echo does not settle", test->topic);
+		HOST_CHECK(writes <= test->max_nvs_writes, "%s: %u NVS writes", test->topic, writes);
+		HOST_CHECK(replies == 1, "%s: %u replies", test->topic, replies);
+
+		uint32_t repeated_writes = 0, repeated_replies = 0;
+		idle = commands_send(test, &repeated_writes, &repeated_replies);
+		HOST_CHECK(idle, "%s: the repeated command does not settle", test->topic);
+		HOST_CHECK(repeated_writes == 0, "%s: %u NVS writes for an unchanged setting", test->topic, repeated_writes);
+
+		printf("%-24s %10u %8u %14u\n", test->topic, writes, replies, repeated_writes);
+	}
+
+	// the ventilation control owns the fan: a direct fan command is its manual override
+	uint32_t ventilation_before = host_mqtt_published(MQTT_TOPIC(CONFIG_VENTILATION_TOPIC_DATA));
+	host_mqtt_inject(MQTT_TOPIC(CONFIG_FAN_TOPIC_DATA), "{\"state\":true}");
+	HOST_CHECK(host_mqtt_wait_idle(COMMANDS_IDLE_MS), "fan command does not settle");
+	HOST_CHECK(host_mqtt_published(MQTT_TOPIC(CONFIG_VENTILATION_TOPIC_DATA)) == ventilation_before + 1, "fan command is not a ventilation override");
+	host_mqtt_inject(MQTT_TOPIC(CONFIG_VENTILATION_TOPIC_COMMAND), "{\"type\":\"auto\"}");
+	HOST_CHECK(host_mqtt_wait_idle(COMMANDS_IDLE_MS), "ventilation command does not settle");
+
+	// the retained replies come back after a reconnect
+	uint32_t writes_before = host_nvs_writes();
+	host_mqtt_reconnect();
+	host_run_for(5000);
+	HOST_CHECK(host_mqtt_connected(), "no MQTT connection after reconnect");
+	HOST_CHECK(host_mqtt_wait_idle(COMMANDS_IDLE_MS), "retained messages do not settle after reconnect");
+	HOST_CHECK(host_nvs_writes() == writes_before, "%u NVS writes after reconnect", host_nvs_writes() - writes_before);
+
+	return host_test_result();
+}
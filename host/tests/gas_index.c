@@ -0,0 +1,147 @@
+#include "host.h"
+#include "host_test.h"
+
+#include "i2c/sgp41/sgp41_api.h"
+#include "i2c/sgp41/raw2index/sensirion_gas_index_algorithm.h"
+#include "i2c/sgp41/raw2index/sensirion_gas_index_algorithm_fix16.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Replays synthetic 7-day SGP41 raw traces at the firmware sampling interval through the float
+// and the Q16.16 gas index algorithms: index deviation and CPU time per sample of each.
+//
+//   gas_index [days]
+//
+// The traces: a daily baseline drift, noise, a step of the baseline every day and events
+// (cooking, airing) of 20-90 minutes a few times a day. "voc+" is a harsh room: large drift,
+// noise and steps.
+
+#define GAS_INDEX_SAMPLES_PER_DAY (24 * 60 * 60 / SGP41_SAMPLING_INTERVAL)
+
+typedef struct {
+	const char * name;
+	int32_t algorithm_type;
+	double baseline;
+	double drift;		// daily amplitude
+	double noise;
+	double step;		// baseline change every day, alternating sign
+	double event;		// raw change at the peak of an event
+	// max deviation allowed and measured
+	int32_t max_deviation;
+	double max_mean_deviation;
+} gas_index_trace_t;
+
+static const gas_index_trace_t gas_index_traces[] = {
+	{ "voc",  GasIndexAlgorithm_ALGORITHM_TYPE_VOC, 30000, 300,  30,  300, -3000, 1, 0.02 },
+	{ "voc+", GasIndexAlgorithm_ALGORITHM_TYPE_VOC, 30000, 800, 100, 1500, -8000, 1, 0.02 },
+	{ "nox",  GasIndexAlgorithm_ALGORITHM_TYPE_NOX, 16000, 150,  20,  100,  2500, 1, 0.005 },
+};
+
+static uint32_t gas_index_random_state = 2463534242u;
+
+static double gas_index_random() {
+	gas_index_random_state ^= gas_index_random_state << 13;
+	gas_index_random_state ^= gas_index_random_state >> 17;
+	gas_index_random_state ^= gas_index_random_state << 5;
+	return (double)gas_index_random_state / 4294967295.0;
+}
+
+static int64_t gas_index_cpu_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int32_t * gas_index_build_trace(const gas_index_trace_t * trace, uint32_t samples) {
+	int32_t * raw = host_malloc(samples * sizeof(int32_t));
+
+	double step = 0;
+	uint32_t event_start = 0;
+	uint32_t event_length = 0;
+
+	for (uint32_t i = 0; i<samples; i++) {
+		double day = (double)i / GAS_INDEX_SAMPLES_PER_DAY;
+		if (i > 0 && i % GAS_INDEX_SAMPLES_PER_DAY == 0) {
+			step += ((i / GAS_INDEX_SAMPLES_PER_DAY) % 2) ? trace->step : -trace->step;
+		}
+
+		// about 4 events a day
+		if (i >= event_start + event_length && gas_index_random() < 4.0 / GAS_INDEX_SAMPLES_PER_DAY) {
+			event_start = i;
+			event_length = (20 + gas_index_random() * 70) * 60 / SGP41_SAMPLING_INTERVAL;
+		}
+
+		double event = 0;
+		if (i >= event_start && i < event_start + event_length) {
+			// fast rise, slow decay
+			double t = (double)(i - event_start) / event_length;
+			event = trace->event * (t < 0.2 ? t / 0.2 : exp(-(t - 0.2) * 4.0));
+		}
+
+		double value = trace->baseline + trace->drift * sin(2.0 * M_PI * day) + step + event
+				+ (gas_index_random() * 2.0 - 1.0) * trace->noise;
+		raw[i] = value < 0 ? 0 : (value > 65535 ? 65535 : (int32_t)value);
+	}
+
+	return raw;
+}
+
+int main(int argc, char ** argv) {
+	uint32_t days = argc > 1 ? atoi(argv[1]) : 7;
+	uint32_t samples = days * GAS_INDEX_SAMPLES_PER_DAY;
+
+	printf("%u days at %d s, %u samples per trace\n", days, SGP41_SAMPLING_INTERVAL, samples);
+	printf("%-5s %14s %14s %10s %14s %14s\n", "trace", "max deviation", "mean deviation", "differ", "float, ns", "fix16, ns");
+
+	for (uint8_t t = 0; t<sizeof(gas_index_traces) / sizeof(gas_index_traces[0]); t++) {
+		const gas_index_trace_t * trace = &gas_index_traces[t];
+		int32_t * raw = gas_index_build_trace(trace, samples);
+		int32_t * index_float = host_malloc(samples * sizeof(int32_t));
+		int32_t * index_fix16 = host_malloc(samples * sizeof(int32_t));
+
+		GasIndexAlgorithmParams params_float;
+		GasIndexAlgorithm_init_with_sampling_interval(&params_float, trace->algorithm_type, SGP41_SAMPLING_INTERVAL);
+		int64_t start = gas_index_cpu_ns();
+		for (uint32_t i = 0; i<samples; i++) {
+			GasIndexAlgorithm_process(&params_float, raw[i], &index_float[i]);
+		}
+		int64_t float_ns = gas_index_cpu_ns() - start;
+
+		GasIndexAlgorithmFix16Params params_fix16;
+		GasIndexAlgorithmFix16_init_with_sampling_interval(&params_fix16, trace->algorithm_type, SGP41_SAMPLING_INTERVAL);
+		start = gas_index_cpu_ns();
+		for (uint32_t i = 0; i<samples; i++) {
+			GasIndexAlgorithmFix16_process(&params_fix16, raw[i], &index_fix16[i]);
+		}
+		int64_t fix16_ns = gas_index_cpu_ns() - start;
+
+		int32_t max_deviation = 0;
+		uint64_t total_deviation = 0;
+		uint32_t differ = 0;
+		for (uint32_t i = 0; i<samples; i++) {
+			int32_t deviation = abs(index_float[i] - index_fix16[i]);
+			total_deviation += deviation;
+			if (deviation > 0) {
+				differ++;
+			}
+			if (deviation > max_deviation) {
+				max_deviation = deviation;
+			}
+		}
+
+		double mean_deviation = (double)total_deviation / samples;
+		printf("%-5s %14d %14.3f %9.2f%% %14.1f %14.1f\n", trace->name, max_deviation, mean_deviation, 100.0 * differ / samples,
+				(double)float_ns / samples, (double)fix16_ns / samples);
+
+		HOST_CHECK(max_deviation <= trace->max_deviation, "%s: max deviation %d", trace->name, max_deviation);
+		HOST_CHECK(mean_deviation <= trace->max_mean_deviation, "%s: mean deviation %f", trace->name, mean_deviation);
+
+		host_free(raw);
+		host_free(index_float);
+		host_free(index_fix16);
+	}
+
+	return host_test_result();
+}
@@ -0,0 +1,28 @@
+#ifndef HOST_TESTS_HOST_TEST_H_
+#define HOST_TESTS_HOST_TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal checks for the host tests: a failed check is reported and fails the test at exit.
+
+static int host_test_failures = 0;
+
+#define HOST_CHECK(condition, ...) do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #condition); \
+			fprintf(stderr, __VA_ARGS__); \
+			fputc('\n', stderr); \
+			host_test_failures++; \
+		} \
+	} while (0)
+
+static inline int host_test_result() {
+	if (host_test_failures) {
+		fprintf(stderr, "%d check(s) failed\n", host_test_failures);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+#endif /* HOST_TESTS_HOST_TEST_H_ */
@@ -0,0 +1,106 @@
+#include "host.h"
+#include "host_test.h"
+
+#include "common/mqtt.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// Offline journal: telemetry published while the broker is unreachable is replayed after
+// reconnect, retained. Live readings must not overtake the replay: a journaled (older, "ts")
+// message published after a live one would leave a stale retained value on the broker.
+// A long outage also restarts the device from the MQTT healthcheck, the journal survives it.
+//
+//   journal [offline virtual minutes]
+
+#define JOURNAL_WARMUP_MS  (2 * 60 * 1000)
+#define JOURNAL_DRAIN_MS   (3 * 60 * 1000)
+#define JOURNAL_MAX_TOPICS 32
+
+typedef struct {
+	char topic[64];
+	uint32_t journaled;
+	uint32_t live;
+	uint32_t stale;		// journaled after a live one
+} journal_topic_t;
+
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool journal_measuring = false;
+static journal_topic_t journal_topics[JOURNAL_MAX_TOPICS];
+static uint8_t journal_topics_count = 0;
+
+static void journal_observer(const char * topic, const char * data, int len, void *) {
+	pthread_mutex_lock(&journal_lock);
+	if (!journal_measuring) {
+		pthread_mutex_unlock(&journal_lock);
+		return;
+	}
+
+	journal_topic_t * entry = NULL;
+	for (uint8_t i = 0; i<journal_topics_count; i++) {
+		if (strcmp(journal_topics[i].topic, topic) == 0) {
+			entry = &journal_topics[i];
+			break;
+		}
+	}
+	if (entry == NULL && journal_topics_count < JOURNAL_MAX_TOPICS) {
+		entry = &journal_topics[journal_topics_count++];
+		snprintf(entry->topic, sizeof(entry->topic), "%s", topic);
+	}
+
+	if (entry) {
+		if (len > 6 && strncmp(data, "{\"ts\":", 6) == 0) {
+			entry->journaled++;
+			if (entry->live > 0) {
+				entry->stale++;
+			}
+		} else {
+			entry->live++;
+		}
+	}
+	pthread_mutex_unlock(&journal_lock);
+}
+
+int main(int argc, char ** argv) {
+	uint32_t minutes = argc > 1 ? atoi(argv[1]) : 10;
+
+	host_init(50);
+	host_sensors_init();
+	host_mqtt_set_observer(journal_observer, NULL);
+	host_start_app();
+
+	host_run_for(JOURNAL_WARMUP_MS);
+	HOST_CHECK(host_mqtt_connected(), "no MQTT connection after warmup");
+
+	host_mqtt_set_online(false);
+	host_run_for(minutes * 60 * 1000);
+
+	pthread_mutex_lock(&journal_lock);
+	journal_measuring = true;
+	pthread_mutex_unlock(&journal_lock);
+
+	host_mqtt_set_online(true);
+	host_run_for(JOURNAL_DRAIN_MS);
+	HOST_CHECK(host_mqtt_connected(), "no MQTT connection after going online");
+
+	pthread_mutex_lock(&journal_lock);
+	journal_measuring = false;
+
+	printf("%-32s %10s %8s %8s\n", "topic", "journaled", "live", "stale");
+
+	uint32_t journaled = 0, live = 0;
+	for (uint8_t i = 0; i<journal_topics_count; i++) {
+		journal_topic_t * entry = &journal_topics[i];
+		printf("%-32s %10u %8u %8u\n", entry->topic, entry->journaled, entry->live, entry->stale);
+
+		journaled += entry->journaled;
+		live += entry->live;
+		HOST_CHECK(entry->stale == 0, "%s: %u journaled messages after a live one", entry->topic, entry->stale);
+	}
+	pthread_mutex_unlock(&journal_lock);
+
+	HOST_CHECK(journaled > 0, "nothing replayed from the journal");
+	HOST_CHECK(live > 0, "no live publishes after the replay");
+
+	return host_test_result();
+}
@@ -0,0 +1,179 @@
+#include "host.h"
+#include "host_test.h"
+
+#include "cJSON.h"
+#include "cjson/json_writer.h"
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+// The telemetry payloads built with json_writer against the cJSON tree + cJSON_Print they replaced:
+// payload bytes, heap allocations and CPU time per payload. The json_writer output must parse
+// back to the same values, non-finite floats to null as cJSON printed them.
+
+#define JSON_ROUNDS 20000
+
+typedef struct {
+	const char * name;
+	const char * number_type;	// 'i' - int, 'f' - float with decimals
+	double value;
+	uint8_t decimals;
+} json_field_t;
+
+typedef struct {
+	const char * name;
+	json_field_t fields[12];
+	uint8_t count;
+} json_payload_t;
+
+static const json_payload_t json_payloads[] = {
+	{ "bme280", {
+		{ "temperature", "f", 23.47, 2 }, { "humidity", "f", 41.23, 2 }, { "pressure", "i", 100934, 0 },
+		{ "heatindex", "i", 24, 0 }, { "absolute_humidity", "f", 8.71, 2 } }, 5 },
+	{ "sgp41", {
+		{ "tvoc", "i", 112, 0 }, { "nox", "i", 1, 0 }, { "tvoc_raw", "i", 30121, 0 }, { "nox_raw", "i", 16250, 0 } }, 4 },
+	{ "pms7003", {
+		{ "cf1_pm_1_0", "i", 7, 0 }, { "cf1_pm_2_5", "i", 11, 0 }, { "cf1_pm_10_0", "i", 13, 0 },
+		{ "atmospheric_pm_1_0", "i", 7, 0 }, { "atmospheric_pm_2_5", "i", 11, 0 }, { "atmospheric_pm_10_0", "i", 13, 0 },
+		{ "particles_0_3", "i", 1203, 0 }, { "particles_0_5", "i", 351, 0 }, { "particles_1_0", "i", 62, 0 },
+		{ "particles_2_5", "i", 9, 0 }, { "particles_5_0", "i", 2, 0 }, { "particles_10_0", "i", 0, 0 } }, 12 },
+	{ "mq7", {
+		{ "co", "i", 3, 0 }, { "co_raw", "f", 3.187, 3 } }, 2 },
+};
+
+#define JSON_PAYLOADS (sizeof(json_payloads) / sizeof(json_payloads[0]))
+
+typedef struct {
+	uint64_t allocs;
+	uint64_t bytes;
+	size_t length;
+	double ns;
+} json_result_t;
+
+static int64_t json_cpu_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static size_t json_with_cjson(const json_payload_t * payload, bool formatted) {
+	cJSON *root = cJSON_CreateObject();
+	for (uint8_t i = 0; i<payload->count; i++) {
+		cJSON_AddNumberToObject(root, payload->fields[i].name, payload->fields[i].value);
+	}
+
+	char * json = formatted ? cJSON_Print(root) : cJSON_PrintUnformatted(root);
+	size_t length = json ? strlen(json) : 0;
+	cJSON_free(json);
+	cJSON_Delete(root);
+
+	return length;
+}
+
+static size_t json_with_writer(const json_payload_t * payload, char * out, size_t out_size) {
+	char buffer[480];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	for (uint8_t i = 0; i<payload->count; i++) {
+		const json_field_t * field = &payload->fields[i];
+		if (field->number_type[0] == 'f') {
+			json_writer_add_float(&writer, field->name, field->value, field->decimals);
+		} else {
+			json_writer_add_int(&writer, field->name, (int32_t)field->value);
+		}
+	}
+
+	const char * json = json_writer_end(&writer);
+	if (json == NULL) {
+		return 0;
+	}
+
+	if (out) {
+		strncpy(out, json, out_size - 1);
+		out[out_size - 1] = 0;
+	}
+
+	return strlen(json);
+}
+
+static void json_measure(const json_payload_t * payload, uint8_t method, json_result_t * result) {
+	host_alloc_stats_t before, after;
+	host_alloc_thread(&before);
+
+	volatile size_t length = 0;
+	int64_t start = json_cpu_ns();
+	for (uint32_t i = 0; i<JSON_ROUNDS; i++) {
+		length = method == 0 ? json_with_writer(payload, NULL, 0) : json_with_cjson(payload, method == 1);
+	}
+	int64_t ns = json_cpu_ns() - start;
+
+	host_alloc_thread(&after);
+
+	result->allocs = (after.allocs - before.allocs) / JSON_ROUNDS;
+	result->bytes = (after.bytes - before.bytes) / JSON_ROUNDS;
+	result->length = length;
+	result->ns = (double)ns / JSON_ROUNDS;
+}
+
+int main() {
+	static const char * const methods[] = { "json_writer", "cJSON_Print", "cJSON_PrintUnformatted" };
+
+	printf("%-8s %-24s %8s %8s %12s %10s\n", "payload", "method", "bytes", "allocs", "heap bytes", "ns");
+
+	for (uint8_t p = 0; p<JSON_PAYLOADS; p++) {
+		const json_payload_t * payload = &json_payloads[p];
+
+		json_result_t results[3];
+		for (uint8_t m = 0; m<3; m++) {
+			json_measure(payload, m, &results[m]);
+			printf("%-8s %-24s %8zu %8llu %12llu %10.1f\n", payload->name, methods[m], results[m].length,
+					(unsigned long long)results[m].allocs, (unsigned long long)results[m].bytes, results[m].ns);
+		}
+
+		HOST_CHECK(results[0].length > 0, "%s: json_writer buffer too small", payload->name);
+		HOST_CHECK(results[0].allocs == 0, "%s: json_writer allocates", payload->name);
+		HOST_CHECK(results[0].length <= results[1].length, "%s: json_writer payload larger than cJSON_Print", payload->name);
+
+		char json[480];
+		json_with_writer(payload, json, sizeof(json));
+		cJSON * root = cJSON_Parse(json);
+		HOST_CHECK(root != NULL, "%s: json_writer output does not parse: %s", payload->name, json);
+		if (root == NULL) {
+			continue;
+		}
+
+		HOST_CHECK(cJSON_GetArraySize(root) == payload->count, "%s: %d fields", payload->name, cJSON_GetArraySize(root));
+		for (uint8_t i = 0; i<payload->count; i++) {
+			const json_field_t * field = &payload->fields[i];
+			cJSON * item = cJSON_GetObjectItem(root, field->name);
+			double tolerance = 0.5 * pow(10.0, -field->decimals);
+			HOST_CHECK(cJSON_IsNumber(item) && fabs(cJSON_GetNumberValue(item) - field->value) <= tolerance,
+					"%s: %s differs in %s", payload->name, field->name, json);
+		}
+		cJSON_Delete(root);
+	}
+
+	// a failed sensor read or a division by zero must not break the whole message
+	static const double non_finite[] = { NAN, INFINITY, -INFINITY };
+	for (uint8_t i = 0; i<sizeof(non_finite) / sizeof(non_finite[0]); i++) {
+		char buffer[64];
+		json_writer_t writer;
+		json_writer_begin(&writer, buffer, sizeof(buffer));
+		json_writer_add_float(&writer, "value", non_finite[i], 2);
+		json_writer_add_int(&writer, "next", 1);
+		const char * json = json_writer_end(&writer);
+
+		cJSON * root = json ? cJSON_Parse(json) : NULL;
+		HOST_CHECK(root != NULL, "%f: json_writer output does not parse: %s", non_finite[i], json ? json : "(overflow)");
+		if (root == NULL) {
+			continue;
+		}
+
+		HOST_CHECK(cJSON_IsNull(cJSON_GetObjectItem(root, "value")), "%f: not null in %s", non_finite[i], json);
+		HOST_CHECK(cJSON_GetNumberValue(cJSON_GetObjectItem(root, "next")) == 1, "%f: next field lost in %s", non_finite[i], json);
+		cJSON_Delete(root);
+	}
+
+	return host_test_result();
+}
@@ -0,0 +1,109 @@
+#include "host.h"
+#include "host_test.h"
+
+// the tables and their ranges are private to the drivers
+#include "adc/mq7/mq7.c"
+#include "adc/mq136/mq136.c"
+
+#include <math.h>
+#include <time.h>
+
+// Accuracy of the MQ7/MQ136 lookup tables against the exact formulas over the table ranges,
+// and the CPU time of one evaluation of each.
+
+#define LUT_RSRO_STEPS	40000
+#define LUT_T_STEPS		1000
+
+typedef double (*lut_function_t)(double x);
+
+typedef struct {
+	const char * name;
+	lut_function_t table;
+	lut_function_t exact;
+	double x_min;
+	double x_max;
+	uint32_t steps;
+	// allowed error: absolute or relative to the exact value, whichever is larger
+	double max_error;
+	double max_relative_error;
+	// at integer x, the table nodes
+	double max_node_error;
+} lut_case_t;
+
+static int64_t lut_cpu_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static double lut_time_ns(lut_function_t function, double x_min, double x_max, uint32_t steps) {
+	volatile double sink = 0;
+
+	int64_t start = lut_cpu_ns();
+	for (uint32_t i = 0; i<=steps; i++) {
+		sink += function(x_min + (x_max - x_min) * i / steps);
+	}
+
+	return (double)(lut_cpu_ns() - start) / (steps + 1);
+}
+
+int main() {
+	HOST_CHECK(adc_v_core_lut_build(&mq7_lut_rsro, &mq7_rsro2value_exact, MQ7_LUT_RSRO_MIN, MQ7_LUT_RSRO_MAX, MQ7_LUT_RSRO_SIZE), "mq7 rs/ro table");
+	HOST_CHECK(adc_v_core_lut_build(&mq7_lut_t, &mq7_delta_t_exact, MQ7_LUT_T_MIN, MQ7_LUT_T_MAX, MQ7_LUT_T_MAX - MQ7_LUT_T_MIN + 1), "mq7 T table");
+	HOST_CHECK(adc_v_core_lut_build(&mq136_lut_rsro, &mq136_rsro2value_exact, MQ136_LUT_RSRO_MIN, MQ136_LUT_RSRO_MAX, MQ136_LUT_RSRO_SIZE), "mq136 rs/ro table");
+	HOST_CHECK(adc_v_core_lut_build(&mq136_lut_t, &mq136_delta_t_exact, MQ136_LUT_T_MIN, MQ136_LUT_T_MAX, MQ136_LUT_T_MAX - MQ136_LUT_T_MIN + 1), "mq136 T table");
+
+	const lut_case_t cases[] = {
+		{ "mq7 rs/ro -> ppm",   &mq7_rsro2value,   &mq7_rsro2value_exact,   MQ7_LUT_RSRO_MIN,   MQ7_LUT_RSRO_MAX,   LUT_RSRO_STEPS, 2.0, 0.005, 0.05 },
+		{ "mq7 T",              &mq7_delta_t,      &mq7_delta_t_exact,      MQ7_LUT_T_MIN,      MQ7_LUT_T_MAX,      LUT_T_STEPS,    0.0, 0.005, 1e-5 },
+		{ "mq136 rs/ro -> ppm", &mq136_rsro2value, &mq136_rsro2value_exact, MQ136_LUT_RSRO_MIN, MQ136_LUT_RSRO_MAX, LUT_RSRO_STEPS, 2.0, 0.005, 0.05 },
+		{ "mq136 T",            &mq136_delta_t,    &mq136_delta_t_exact,    MQ136_LUT_T_MIN,    MQ136_LUT_T_MAX,    LUT_T_STEPS,    0.0, 0.005, 1e-5 },
+	};
+
+	printf("%-20s %12s %12s %10s %16s %12s %12s\n", "table", "max error", "at x", "max rel", "max node error", "table, ns", "exact, ns");
+
+	for (uint8_t c = 0; c<sizeof(cases) / sizeof(cases[0]); c++) {
+		const lut_case_t * test = &cases[c];
+
+		double max_error = 0;
+		double max_error_x = 0;
+		double max_relative = 0;
+		double max_node_error = 0;
+		uint32_t failures = 0;
+
+		for (uint32_t i = 0; i<=test->steps; i++) {
+			double x = test->x_min + (test->x_max - test->x_min) * i / test->steps;
+			double exact = test->exact(x);
+			double error = fabs(test->table(x) - exact);
+
+			if (error > max_error) {
+				max_error = error;
+				max_error_x = x;
+			}
+			if (fabs(exact) > 1e-9 && error / fabs(exact) > max_relative) {
+				max_relative = error / fabs(exact);
+			}
+			if (error > test->max_error && error > test->max_relative_error * fabs(exact)) {
+				failures++;
+			}
+		}
+
+		for (double x = ceil(test->x_min); x <= test->x_max; x += 1.0) {
+			double error = fabs(test->table(x) - test->exact(x));
+			if (error > max_node_error) {
+				max_node_error = error;
+			}
+		}
+
+		double table_ns = lut_time_ns(test->table, test->x_min, test->x_max, test->steps);
+		double exact_ns = lut_time_ns(test->exact, test->x_min, test->x_max, test->steps);
+
+		printf("%-20s %12.6f %12.4f %9.4f%% %16.8f %12.1f %12.1f\n", test->name, max_error, max_error_x, max_relative * 100.0,
+				max_node_error, table_ns, exact_ns);
+
+		HOST_CHECK(failures == 0, "%s: %u points off by more than %.2f or %.1f%%", test->name, failures, test->max_error, test->max_relative_error * 100.0);
+		HOST_CHECK(max_node_error <= test->max_node_error, "%s: %f at an integer x", test->name, max_node_error);
+	}
+
+	return host_test_result();
+}
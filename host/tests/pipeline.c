@@ -0,0 +1,141 @@
+#include "host.h"
+#include "host_test.h"
+
+#include "common/mqtt.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// Runs app_main with every component enabled against the scripted sensors and reports what one
+// publish cycle costs: CPU time, heap allocations and the age of the data when it is published.
+//
+//   pipeline [virtual minutes] [time scale]
+
+#define PIPELINE_WARMUP_MS (2 * 60 * 1000)
+
+typedef struct {
+	const char * topic;
+	host_device_t device;
+	uint32_t published;
+	int64_t latency_total_us;
+	int64_t latency_max_us;
+	uint32_t latency_count;
+} pipeline_topic_t;
+
+static pipeline_topic_t pipeline_topics[] = {
+	{ MQTT_TOPIC(CONFIG_BME280_TOPIC_DATA),  HOST_DEVICE_BME280 },
+	{ MQTT_TOPIC(CONFIG_SGP41_TOPIC_DATA),   HOST_DEVICE_SGP41 },
+	{ MQTT_TOPIC(CONFIG_MHZ19B_TOPIC_DATA),  HOST_DEVICE_MHZ19B },
+	{ MQTT_TOPIC(CONFIG_PMS7003_TOPIC_DATA), HOST_DEVICE_PMS7003 },
+	{ MQTT_TOPIC(CONFIG_MQ7_TOPIC_DATA),     HOST_DEVICE_ADC },
+	{ MQTT_TOPIC(CONFIG_MQ136_TOPIC_DATA),   HOST_DEVICE_ADC },
+	{ MQTT_TOPIC(CONFIG_O2A2_TOPIC_DATA),    HOST_DEVICE_ADC },
+	{ MQTT_TOPIC(CONFIG_LIGHT_TOPIC_DATA),   HOST_DEVICE_ADC },
+	{ MQTT_TOPIC(CONFIG_FANTACH_TOPIC_DATA), HOST_DEVICE_MAX },
+	{ MQTT_TOPIC(CONFIG_VENTILATION_TOPIC_DATA), HOST_DEVICE_MAX },
+	{ MQTT_TOPIC(CONFIG_SNAPSHOT_TOPIC),     HOST_DEVICE_MAX },
+};
+
+#define PIPELINE_TOPICS (sizeof(pipeline_topics) / sizeof(pipeline_topics[0]))
+
+static pthread_mutex_t pipeline_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool pipeline_measuring = false;
+static uint32_t pipeline_published = 0;
+
+static void pipeline_observer(const char * topic, const char *, int, void *) {
+	int64_t now = esp_timer_get_time();
+
+	pthread_mutex_lock(&pipeline_lock);
+	for (uint8_t i = 0; i<PIPELINE_TOPICS; i++) {
+		pipeline_topic_t * entry = &pipeline_topics[i];
+		if (strcmp(entry->topic, topic) != 0) {
+			continue;
+		}
+
+		entry->published++;
+		if (!pipeline_measuring) {
+			break;
+		}
+
+		pipeline_published++;
+		if (entry->device != HOST_DEVICE_MAX && host_sensor_sampled_at(entry->device) > 0) {
+			int64_t latency = now - host_sensor_sampled_at(entry->device);
+			entry->latency_total_us += latency;
+			entry->latency_count++;
+			if (latency > entry->latency_max_us) {
+				entry->latency_max_us = latency;
+			}
+		}
+		break;
+	}
+	pthread_mutex_unlock(&pipeline_lock);
+}
+
+int main(int argc, char ** argv) {
+	uint32_t minutes = argc > 1 ? atoi(argv[1]) : 10;
+	uint32_t scale = argc > 2 ? atoi(argv[2]) : 50;
+
+	host_init(scale);
+	host_sensors_init();
+	host_mqtt_set_observer(pipeline_observer, NULL);
+	host_start_app();
+
+	host_run_for(PIPELINE_WARMUP_MS);
+	HOST_CHECK(host_mqtt_connected(), "no MQTT connection after warmup");
+
+	// a fresh NVS has no calibration, the gas sensors publish nothing until calibrated
+	host_mqtt_inject(MQTT_TOPIC(CONFIG_MQ7_TOPIC_COMMAND), "{\"type\":\"calibrate\"}");
+	host_mqtt_inject(MQTT_TOPIC(CONFIG_MQ136_TOPIC_COMMAND), "{\"type\":\"calibrate\"}");
+	host_mqtt_inject(MQTT_TOPIC(CONFIG_O2A2_TOPIC_COMMAND), "{\"type\":\"calibrate\"}");
+	HOST_CHECK(host_mqtt_wait_idle(10000), "calibration commands not handled");
+
+	host_alloc_stats_t alloc_start, alloc_end;
+	host_alloc_global(&alloc_start);
+	int64_t cpu_start = host_tasks_cpu_time_us();
+	int64_t process_cpu_start = host_cpu_time_us();
+	int64_t virtual_start = esp_timer_get_time();
+
+	pthread_mutex_lock(&pipeline_lock);
+	pipeline_measuring = true;
+	pthread_mutex_unlock(&pipeline_lock);
+
+	host_run_for(minutes * 60 * 1000);
+
+	pthread_mutex_lock(&pipeline_lock);
+	pipeline_measuring = false;
+	uint32_t published = pipeline_published;
+	pthread_mutex_unlock(&pipeline_lock);
+
+	int64_t cpu_us = host_tasks_cpu_time_us() - cpu_start;
+	int64_t process_cpu_us = host_cpu_time_us() - process_cpu_start;
+	int64_t virtual_us = esp_timer_get_time() - virtual_start;
+	host_alloc_global(&alloc_end);
+
+	uint64_t allocs = alloc_end.allocs - alloc_start.allocs;
+	uint64_t bytes = alloc_end.bytes - alloc_start.bytes;
+
+	printf("%u virtual minutes at x%u, %u data publishes\n", minutes, scale, published);
+	printf("task CPU: %lld us total, %.1f us per publish, %.3f%% of virtual time (process with simulated hardware: %lld us)\n",
+			(long long)cpu_us, published ? (double)cpu_us / published : 0.0, 100.0 * cpu_us / virtual_us, (long long)process_cpu_us);
+	printf("heap: %llu allocations (%llu bytes), %.2f allocations and %.1f bytes per publish, %lld outstanding\n",
+			(unsigned long long)allocs, (unsigned long long)bytes,
+			published ? (double)allocs / published : 0.0, published ? (double)bytes / published : 0.0,
+			(long long)(alloc_end.allocs - alloc_end.frees));
+
+	printf("%-28s %10s %16s %16s\n", "topic", "publishes", "mean age, ms", "max age, ms");
+	for (uint8_t i = 0; i<PIPELINE_TOPICS; i++) {
+		pipeline_topic_t * entry = &pipeline_topics[i];
+		if (entry->latency_count) {
+			printf("%-28s %10u %16.1f %16.1f\n", entry->topic, entry->published,
+					entry->latency_total_us / 1000.0 / entry->latency_count, entry->latency_max_us / 1000.0);
+		} else {
+			printf("%-28s %10u %16s %16s\n", entry->topic, entry->published, "-", "-");
+		}
+
+		HOST_CHECK(entry->published > 0, "nothing published to %s", entry->topic);
+	}
+
+	HOST_CHECK(host_restart_count() == 0, "%u restarts", host_restart_count());
+
+	return host_test_result();
+}
@@ -1,18 +1,269 @@
 #include "adc.h"
 
-#include "esp_adc/adc_oneshot.h"
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_continuous.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
-adc_oneshot_unit_handle_t adc_channel;
+#include "math.h"
+#include "string.h"
+
+#include "../common/diag.h"
+#include "../common/profiler.h"
+#include "../log/log.h"
+
+// Channels are converted on demand: adc_read() runs the continuous (DMA) driver on the requested
+// channel for one burst and stops it again, so the driver interrupts only while a reading is taken.
+// Every sample of the window is the mean of a block of ADC_SAMPLE_FREQ_HZ / rate conversions.
+// Readers get mean/median/stddev over the window.
+
+#define ADC_SAMPLE_FREQ_HZ          SOC_ADC_SAMPLE_FREQ_THRES_LOW
+#define ADC_FRAME_SIZE              512
+#define ADC_POOL_SIZE               2048
+#define ADC_MAX_CHANNELS            8
+#define ADC_READ_TIMEOUT_MS         100
+
+#define ADC_MUTEX_AWAIT             ((TickType_t) 100)
+
+typedef struct {
+	uint8_t  channel;
+	uint8_t  window;
+	uint16_t rate_hz;
+} adc_channel_context_t;
+
+static adc_continuous_handle_t adc_handle = NULL;
+static SemaphoreHandle_t adc_mutex = NULL;
+
+static adc_channel_context_t adc_channels[ADC_MAX_CHANNELS];
+static uint8_t adc_channels_count = 0;
+
+static uint8_t adc_frame[ADC_FRAME_SIZE];
+
+static adc_channel_context_t * adc_find_channel(uint8_t channel) {
+	for (uint8_t i = 0; i<adc_channels_count; i++) {
+		if (adc_channels[i].channel == channel) {
+			return &(adc_channels[i]);
+		}
+	}
+
+	return NULL;
+}
+
+static esp_err_t adc_burst(const adc_channel_context_t * context, uint16_t * samples, uint8_t * count) {
+	adc_digi_pattern_config_t pattern = {
+		.atten     = ADC_ATTEN_DB_12,
+		.channel   = context->channel,
+		.unit      = ADC_UNIT_1,
+		.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+	};
+
+	adc_continuous_config_t config = {
+		.pattern_num = 1,
+		.adc_pattern = &pattern,
+		.sample_freq_hz = ADC_SAMPLE_FREQ_HZ,
+		.conv_mode = ADC_CONV_SINGLE_UNIT_1,
+		.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+	};
+
+	esp_err_t res = adc_continuous_config(adc_handle, &config);
+	if (res) {
+		LOGE(LOG_ADC, "adc_continuous_config error: %04X", res);
+		return res;
+	}
+
+	// the pool may keep the tail of the previous burst, another channel
+	adc_continuous_flush_pool(adc_handle);
+
+	res = adc_continuous_start(adc_handle);
+	if (res) {
+		LOGE(LOG_ADC, "adc_continuous_start error: %04X", res);
+		return res;
+	}
+
+	uint32_t block = ADC_SAMPLE_FREQ_HZ / context->rate_hz;
+	uint32_t block_sum = 0;
+	uint32_t block_count = 0;
+
+	*count = 0;
+	while (*count < context->window) {
+		uint32_t length = 0;
+		res = adc_continuous_read(adc_handle, adc_frame, ADC_FRAME_SIZE, &length, ADC_READ_TIMEOUT_MS);
+		if (res != ESP_OK) {
+			LOGE(LOG_ADC, "adc_continuous_read error: %04X, %d samples read", res, *count);
+			break;
+		}
+
+		for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length && *count < context->window; i += SOC_ADC_DIGI_RESULT_BYTES) {
+			const adc_digi_output_data_t * data = (const adc_digi_output_data_t *)(adc_frame + i);
+			if (data->type1.channel != context->channel) {
+				continue;
+			}
+
+			block_sum += data->type1.data;
+			block_count++;
+			if (block_count == block) {
+				samples[(*count)++] = (block_sum + block / 2) / block;
+				block_sum = 0;
+				block_count = 0;
+			}
+		}
+	}
+
+	adc_continuous_stop(adc_handle);
+
+	return (*count > 0) ? ESP_OK : res;
+}
 
 void adc_init() {
-    adc_oneshot_unit_init_cfg_t init_config1 = {
-        .unit_id = ADC_UNIT_1,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config1, &adc_channel));
+	adc_continuous_handle_cfg_t handle_config = {
+		.max_store_buf_size = ADC_POOL_SIZE,
+		.conv_frame_size = ADC_FRAME_SIZE,
+	};
+	ESP_ERROR_CHECK(adc_continuous_new_handle(&handle_config, &adc_handle));
+
+	adc_mutex = xSemaphoreCreateMutex();
+	if (adc_mutex == NULL) {
+		LOGE(LOG_ADC, "Cant init mutex");
+	}
+
+	memset(adc_channels, 0, sizeof(adc_channels));
+	adc_channels_count = 0;
+}
+
+esp_err_t adc_register_channel(uint8_t channel) {
+	if (adc_handle == NULL || adc_mutex == NULL) {
+		LOGE(LOG_ADC, "ADC not initialized yet");
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	if (xSemaphoreTake(adc_mutex, ADC_MUTEX_AWAIT) != pdTRUE) {
+		return ESP_ERR_TIMEOUT;
+	}
+
+	esp_err_t res = ESP_OK;
+	if (adc_find_channel(channel) == NULL) {
+		if (adc_channels_count < ADC_MAX_CHANNELS) {
+			adc_channel_context_t * context = &(adc_channels[adc_channels_count]);
+			context->channel = channel;
+			context->window  = ADC_WINDOW_DEFAULT;
+			context->rate_hz = ADC_RATE_DEFAULT;
+
+			adc_channels_count++;
+		} else {
+			LOGE(LOG_ADC, "Cant register channel %d: too many channels", channel);
+			res = ESP_ERR_NO_MEM;
+		}
+	}
+
+	xSemaphoreGive(adc_mutex);
+
+	return res;
 }
 
-adc_oneshot_unit_handle_t adc_get_channel() {
-	return adc_channel;
+esp_err_t adc_set_window(uint8_t channel, uint8_t window, uint16_t rate_hz) {
+	if (adc_mutex == NULL) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	if (xSemaphoreTake(adc_mutex, ADC_MUTEX_AWAIT) != pdTRUE) {
+		return ESP_ERR_TIMEOUT;
+	}
+
+	adc_channel_context_t * context = adc_find_channel(channel);
+	if (context == NULL) {
+		xSemaphoreGive(adc_mutex);
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	if (window == 0) {
+		window = 1;
+	} else if (window > ADC_WINDOW_MAX) {
+		window = ADC_WINDOW_MAX;
+	}
+
+	if (rate_hz < ADC_RATE_MIN) {
+		rate_hz = ADC_RATE_MIN;
+	} else if (rate_hz > ADC_SAMPLE_FREQ_HZ) {
+		rate_hz = ADC_SAMPLE_FREQ_HZ;
+	}
+
+	context->window = window;
+	context->rate_hz = rate_hz;
+
+	xSemaphoreGive(adc_mutex);
+
+	return ESP_OK;
+}
+
+void adc_get_window(uint8_t channel, uint8_t * window, uint16_t * rate_hz) {
+	*window  = ADC_WINDOW_DEFAULT;
+	*rate_hz = ADC_RATE_DEFAULT;
+
+	if (adc_mutex == NULL || xSemaphoreTake(adc_mutex, ADC_MUTEX_AWAIT) != pdTRUE) {
+		return;
+	}
+
+	adc_channel_context_t * context = adc_find_channel(channel);
+	if (context) {
+		*window  = context->window;
+		*rate_hz = context->rate_hz;
+	}
+
+	xSemaphoreGive(adc_mutex);
+}
+
+esp_err_t adc_read(uint8_t channel, adc_stats_t * stats) {
+	PROFILER_SCOPE(PROFILER_SPAN_ADC);
+
+	if (adc_handle == NULL || adc_mutex == NULL) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	uint16_t samples[ADC_WINDOW_MAX];
+	uint8_t count = 0;
+
+	// one burst at a time: the driver converts a single pattern
+	if (xSemaphoreTake(adc_mutex, ADC_MUTEX_AWAIT) != pdTRUE) {
+		return ESP_ERR_TIMEOUT;
+	}
+
+	adc_channel_context_t * context = adc_find_channel(channel);
+	if (context == NULL) {
+		xSemaphoreGive(adc_mutex);
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	esp_err_t res = adc_burst(context, samples, &count);
+
+	xSemaphoreGive(adc_mutex);
+
+	if (res != ESP_OK) {
+		return res;
+	}
+
+	uint32_t sum = 0;
+	for (uint8_t i = 0; i<count; i++) {
+		sum += samples[i];
+
+		// insertion sort, window is small
+		uint16_t value = samples[i];
+		int8_t j = i - 1;
+		while (j >= 0 && samples[j] > value) {
+			samples[j + 1] = samples[j];
+			j--;
+		}
+		samples[j + 1] = value;
+	}
+
+	float mean = (float)sum / (float)count;
+	float variance = 0;
+	for (uint8_t i = 0; i<count; i++) {
+		variance += ((float)samples[i] - mean) * ((float)samples[i] - mean);
+	}
+
+	stats->count  = count;
+	stats->mean   = (uint16_t)(mean + 0.5f);
+	stats->median = (count % 2) ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+	stats->stddev = sqrtf(variance / (float)count);
+
+	return ESP_OK;
 }
@@ -1,9 +1,28 @@
 #ifndef MAIN_ADC_ADC_H_
 #define MAIN_ADC_ADC_H_
 
-#include "esp_adc/adc_oneshot.h"
+#include "stdint.h"
+#include "esp_err.h"
+
+#define ADC_WINDOW_MAX     64
+#define ADC_WINDOW_DEFAULT 32
+// samples per second within a burst: the default window takes 40 ms, two 50 Hz mains periods
+#define ADC_RATE_DEFAULT   800
+#define ADC_RATE_MIN       100
+
+typedef struct {
+	uint16_t mean;
+	uint16_t median;
+	float    stddev;
+	uint8_t  count;
+} adc_stats_t;
 
 void adc_init();
-adc_oneshot_unit_handle_t adc_get_channel();
+esp_err_t adc_register_channel(uint8_t channel);
+
+esp_err_t adc_set_window(uint8_t channel, uint8_t window, uint16_t rate_hz);
+void adc_get_window(uint8_t channel, uint8_t * window, uint16_t * rate_hz);
+
+esp_err_t adc_read(uint8_t channel, adc_stats_t * stats);
 
 #endif /* MAIN_ADC_ADC_H_ */
@@ -1,9 +1,5 @@
 #include "adc_v_core.h"
 
-#include "esp_adc/adc_oneshot.h"
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
-#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -13,14 +9,18 @@
 #include "sdkconfig.h"
 #include "cJSON.h"
 #include "../../cjson/cjson_helper.h"
+#include "../../cjson/json_writer.h"
 #include "../../common/mqtt.h"
-#include "../../i2c/bme280/bme280_api.h"
+#include "../../common/scheduler.h"
+#include "../../common/snapshot.h"
+#include "../../common/report_policy.h"
+#include "../../common/diag.h"
+#include "../../i2c/bme280/bme280.h"
 #include "../../log/log.h"
 #include "../adc.h"
 #include "adc_v_core_nvs.h"
 
-#define ADC_V_CORE_APPLY_COMPENSATION_PERIOD	60000000
-#define ADC_V_CORE_EXEC_PERIOD  				30000000
+#define ADC_V_CORE_EXEC_PERIOD  				30000
 #define ADC_V_CORE_COMPENSATION_NOVALUE      	126
 #define ADC_V_CORE_COMPENSATION_IGNORED      	125
 #define ADC_V_CORE_CALIBRATION_NOVALUE			0xFFFF
@@ -41,9 +41,12 @@
 #define POSTFIX_RESULT_ZERO_OFFSET  'z'
 #define POSTFIX_RESULT_SCALE_FACTOR 's'
 #define POSTFIX_AUTO_CALIBRATE      'a'
+#define POSTFIX_ADC_WINDOW          'w'
+#define POSTFIX_ADC_RATE            'r'
 
 typedef struct {
 	char * name;
+	char * name_raw;
 	char * topic_data;
 	char * topic_command;
 	char * tag;
@@ -54,6 +57,7 @@ typedef struct {
 
 	uint16_t calibration_value;
 	uint16_t calibrate_find_value_x10;
+	uint16_t calibrate_max_a0;
 	bool     auto_calibration_enabled;
 
 	uint16_t result_zero_offset;
@@ -64,12 +68,20 @@ typedef struct {
 	uint8_t compensation_h;
 
 	adc_v_core__functions_t  functions;
+
+	const char * report_fields[1];
+	report_policy_t report_policy;
 } adc_v_core_context_t;
 
+typedef struct {
+	uint8_t iterations;
+	double  residual;
+} adc_v_core_calibrate_result_t;
+
 void adc_v_core_timer_exec_function(void* arg);
-void adc_v_core_timer_apply_correction_function(void* arg);
+void adc_v_core_apply_compensation(const bme280_data_t * data, void * arg);
 void adc_v_core_init_auto_compensation(adc_v_core_context_t * context);
-uint8_t adc_v_core_calibrate_execute(adc_v_core_context_t * context, uint16_t adc, bool full);
+uint8_t adc_v_core_calibrate_execute(adc_v_core_context_t * context, uint16_t adc, bool full, adc_v_core_calibrate_result_t * stats);
 
 bool adc_v_core_adc2result(adc_v_core_context_t * context, uint16_t adc, bool autocalibration, double * result) {
 	if (context->calibration_value == ADC_V_CORE_CALIBRATION_NOVALUE || context->calibration_value == 0) {
@@ -103,7 +115,7 @@ bool adc_v_core_adc2result(adc_v_core_context_t * context, uint16_t adc, bool au
 				context->autorecalibrate_counter++;
 			} else {
 				LOGW(context->tag, "rsro->ppm : result=%f. Start fast auto-recalibration to find zero.", _result);
-				adc_v_core_calibrate_execute(context, adc, false);
+				adc_v_core_calibrate_execute(context, adc, false, NULL);
 				context->autorecalibrate_counter = 0;
 			}
 		} else {
@@ -119,20 +131,21 @@ bool adc_v_core_adc2result(adc_v_core_context_t * context, uint16_t adc, bool au
 	return true;
 }
 
-uint8_t adc_v_core_calibrate(adc_v_core_context_t * context) {
+uint8_t adc_v_core_calibrate(adc_v_core_context_t * context, adc_v_core_calibrate_result_t * stats) {
 	if (!context->functions.is_startup_allowed()) {
 		LOGE(context->tag, "Calibration not allowed");
 		return ADC_V_CORE_CALIBRATE_STATUS__NOT_ALLOWED;
 	}
 
-	int value = 0;
-	esp_err_t res = adc_oneshot_read(adc_get_channel(), (adc_channel_t) (context->adc_channel), &value);
+	adc_stats_t adc_stats = { 0 };
+	esp_err_t res = adc_read(context->adc_channel, &adc_stats);
 	if (res != ESP_OK) {
 		LOGE(context->tag, "Cant read ADC value, err=%04X", res);
 		return ADC_V_CORE_CALIBRATE_STATUS__ERROR;
 	}
 
-	context->calibration_value = (uint16_t)value;
+	uint16_t value = adc_stats.mean;
+	context->calibration_value = value;
 
 	// check - Have I data for a humidity and temperatore calibration?
 	int8_t _t = context->compensation_t;
@@ -143,21 +156,25 @@ uint8_t adc_v_core_calibrate(adc_v_core_context_t * context) {
 		return ADC_V_CORE_CALIBRATE_STATUS__NO_COMPES;
 	}
 
-	uint8_t status = adc_v_core_calibrate_execute(context, value, true);
+	uint8_t status = adc_v_core_calibrate_execute(context, value, true, stats);
 	adc_v_core_nws_write(context->tag, context->calibration_value);
 
 	return status;
 }
 
 bool adc_v_core_read_value(adc_v_core_context_t * context, double * result) {
-	int value = 0;
-	esp_err_t res = adc_oneshot_read(adc_get_channel(), (adc_channel_t) (context->adc_channel), &value);
+	adc_stats_t stats = { 0 };
+	esp_err_t res = adc_read(context->adc_channel, &stats);
 	if (res != ESP_OK) {
 		LOGE(context->tag, "Cant read ADC value. Error %04X", res);
 		return false;
 	}
 
-	bool adcres =  adc_v_core_adc2result(context, value, context->auto_calibration_enabled, result);
+#if ADC_V_CORE_DEBUG_CALCULATION
+	LOGI(context->tag, "ADC window: samples = %d; mean = %d; median = %d; stddev = %f", stats.count, stats.mean, stats.median, stats.stddev);
+#endif
+
+	bool adcres =  adc_v_core_adc2result(context, stats.mean, context->auto_calibration_enabled, result);
 
 	if (context->result_zero_offset > 0) {
 		*result = *result - (double)context->result_zero_offset;
@@ -170,71 +187,125 @@ bool adc_v_core_read_value(adc_v_core_context_t * context, double * result) {
 	return adcres;
 }
 
-uint8_t adc_v_core_calibrate_execute(adc_v_core_context_t * context, uint16_t adc, bool full) {
+bool adc_v_core_calibrate_probe(adc_v_core_context_t * context, uint16_t adc, uint16_t a0, adc_v_core_calibrate_result_t * stats, double * result) {
+	context->calibration_value = a0;
+	stats->iterations++;
+
+	return adc_v_core_adc2result(context, adc, false, result);
+}
+
+bool adc_v_core_calibrate_is_found(adc_v_core_context_t * context, double result) {
+	if (context->calibrate_find_value_x10 == 0) {
+		return result < 0.5;
+	} else {
+		return result > (((double)context->calibrate_find_value_x10) / 10.0 - 0.5);
+	}
+}
+
+double adc_v_core_calibrate_residual(adc_v_core_context_t * context, double result) {
+	return result - ((double)context->calibrate_find_value_x10) / 10.0;
+}
+
+// All sensor models are monotonic in A0 up to calibrate_max_a0, so the lowest A0 giving the expected value
+// is found by bisection: ~13 evaluations for a full +/-700 window and ~9 for the auto-recalibration one
+// instead of a linear sweep. When nothing matches, only the window endpoints are compared: the best of them.
+uint8_t adc_v_core_calibrate_execute(adc_v_core_context_t * context, uint16_t adc, bool full, adc_v_core_calibrate_result_t * stats) {
 	uint16_t delta = full ? ADC_V_CORE_CALIBRATE_DELTA_A0 : ADC_V_CORE_CALIBRATE_DELTA_AUTORECALIBRATE_A0;
 
-	uint16_t min_a0 = ((adc < delta) ? 0 : (adc - delta));
+	uint16_t min_a0 = ((adc <= delta) ? 1 : (adc - delta));
 	uint16_t max_a0 = ((((uint32_t) adc + (uint32_t)delta) > (uint32_t)0xFFFF) ? 0xFFFF : (adc + delta));
+	if (context->calibrate_max_a0 > 0 && max_a0 > context->calibrate_max_a0) {
+		max_a0 = context->calibrate_max_a0;
+	}
+	if (max_a0 < min_a0) {
+		max_a0 = min_a0;
+	}
 
-	bool findmin = (context->calibrate_find_value_x10 == 0) ? true : false;
-	double found_value = findmin ? 1000000 : 0;
-	uint16_t found_value_a0 = adc;
+	adc_v_core_calibrate_result_t temp_stats = { 0 };
+	if (stats == NULL) {
+		stats = &temp_stats;
+	}
 
-	double result = 0;
-	for (uint16_t i = min_a0; i<max_a0; i++) {
-		if (i % 50 == 0) {
-			vTaskDelay(1);
-		}
+	stats->iterations = 0;
+	stats->residual = 0;
+
+	double result_min = 0;
+	double result_max = 0;
 
-		context->calibration_value = i;
+	if (!adc_v_core_calibrate_probe(context, adc, min_a0, stats, &result_min) ||
+		!adc_v_core_calibrate_probe(context, adc, max_a0, stats, &result_max)) {
+		context->calibration_value = adc;
+		LOGE(context->tag, "Calibration - error in adc_v_core_adc2result");
+		return ADC_V_CORE_CALIBRATE_STATUS__ERROR;
+	}
+
+	if (adc_v_core_calibrate_is_found(context, result_min)) {
+		context->calibration_value = min_a0;
+		stats->residual = adc_v_core_calibrate_residual(context, result_min);
+		LOGI(context->tag, "Calibration - compensation applied. Result: %f; A0: %d -> %d", result_min, adc, min_a0);
+		return ADC_V_CORE_CALIBRATE_STATUS__OK;
+	}
+
+	if (!adc_v_core_calibrate_is_found(context, result_max)) {
+		bool findmin = (context->calibrate_find_value_x10 == 0) ? true : false;
+		bool use_max = findmin ? (result_max < result_min) : (result_max > result_min);
+
+		double found_value = use_max ? result_max : result_min;
+		uint16_t found_value_a0 = use_max ? max_a0 : min_a0;
+
+		LOGW(context->tag, "Calibration - compensation applied partially. value = %f; A0: %d -> %d", found_value, adc, found_value_a0);
+		context->calibration_value = found_value_a0;
+		stats->residual = adc_v_core_calibrate_residual(context, found_value);
+
+		return ADC_V_CORE_CALIBRATE_STATUS__PARTICAL;
+	}
+
+	// min_a0 is 'not found' and max_a0 is 'found': shrink the window around the boundary
+	double result = 0;
+	while (max_a0 - min_a0 > 1) {
+		uint16_t middle = min_a0 + (max_a0 - min_a0) / 2;
 
-		if (!adc_v_core_adc2result(context, adc, false, &result)) {
+		if (!adc_v_core_calibrate_probe(context, adc, middle, stats, &result)) {
 			context->calibration_value = adc;
 			LOGE(context->tag, "Calibration - error in adc_v_core_adc2result");
 			return ADC_V_CORE_CALIBRATE_STATUS__ERROR;
 		}
 
-		if (
-			(findmin && result < 0.5) ||
-			(!findmin && result > (((double)context->calibrate_find_value_x10) / 10.0 - 0.5))
-				) {
-			LOGI(context->tag, "Calibration - compensation applied. Result: %f; A0: %d -> %d", result, adc, i);
-			return ADC_V_CORE_CALIBRATE_STATUS__OK;
-		}
-
-		if (
-				(findmin && result < found_value) ||
-				(!findmin && result > found_value)
-			) {
-			found_value = result;
-			found_value_a0 = i;
+		if (adc_v_core_calibrate_is_found(context, result)) {
+			max_a0 = middle;
+			result_max = result;
+		} else {
+			min_a0 = middle;
 		}
 	}
 
-	LOGW(context->tag, "Calibration - compensation applied partially. value = %f; A0: %d -> %d", found_value, adc, found_value_a0);
-	context->calibration_value = found_value_a0;
+	context->calibration_value = max_a0;
+	stats->residual = adc_v_core_calibrate_residual(context, result_max);
+
+	LOGI(context->tag, "Calibration - compensation applied. Result: %f; A0: %d -> %d; iterations: %d", result_max, adc, max_a0, stats->iterations);
 
-	return ADC_V_CORE_CALIBRATE_STATUS__PARTICAL;
+	return ADC_V_CORE_CALIBRATE_STATUS__OK;
 }
 
-void adc_v_core_commands(const char * data, void * arg) {
+void adc_v_core_commands(const char * data, size_t len, void * arg) {
 	adc_v_core_context_t * context = (adc_v_core_context_t *)arg;
 
-	cJSON *root = cJSON_Parse(data);
+	cJSON *root = cJSON_ParseWithLength(data, len);
 	if (root == NULL) {
 		return;
 	}
 
 	char * type = cJSON_GetStringValue(cJSON_GetObjectItem(root, "type"));
-	if (type) {
+	if (type && !report_policy_command(&context->report_policy, root, context->topic_command)) {
 		if (strcmp(type, "calibrate") == 0) {
-			uint8_t status = adc_v_core_calibrate(context);
-			char * reply = (char *)malloc(18);
+			adc_v_core_calibrate_result_t stats = { 0 };
+			uint8_t status = adc_v_core_calibrate(context, &stats);
+			char * reply = (char *)diag_malloc(DIAG_HEAP_ADC, 80);
 			if (reply) {
-				memset(reply, 0, 18);
-				snprintf(reply, 17, "{\"status\": %d}", status);
-				mqtt_publish(context->topic_command, reply);
-				free(reply);
+				memset(reply, 0, 80);
+				snprintf(reply, 79, "{\"status\": %d, \"iterations\": %d, \"residual\": %f}", status, stats.iterations, stats.residual);
+				mqtt_publish_nojournal(context->topic_command, reply);
+				diag_free(DIAG_HEAP_ADC, reply);
 			}
 
 			adc_v_core_timer_exec_function(arg);
@@ -246,9 +317,9 @@ void adc_v_core_commands(const char * data, void * arg) {
 			}
 
 			uint8_t scale = get_number8_from_json(cJSON_GetObjectItem(root, "scale"), context->result_scale_factor);
-			if (zero != context->result_scale_factor) {
+			if (scale != context->result_scale_factor) {
 				context->result_scale_factor = scale;
-				adc_v_core_nws_write_postfix(context->tag, POSTFIX_RESULT_SCALE_FACTOR, zero);
+				adc_v_core_nws_write_postfix(context->tag, POSTFIX_RESULT_SCALE_FACTOR, scale);
 			}
 
 			uint8_t auto_calibrate = get_boolean_from_json(cJSON_GetObjectItem(root, "auto"), 1, 0, 0xFF);
@@ -256,19 +327,35 @@ void adc_v_core_commands(const char * data, void * arg) {
 				if ((context->auto_calibration_enabled && auto_calibrate == 0) ||
 					(!context->auto_calibration_enabled && auto_calibrate == 1)) {
 					context->auto_calibration_enabled = (auto_calibrate == 1);
-					adc_v_core_nws_write_postfix(context->tag, POSTFIX_AUTO_CALIBRATE, zero);
+					adc_v_core_nws_write_postfix(context->tag, POSTFIX_AUTO_CALIBRATE, auto_calibrate);
 				}
 			}
 
-			char * reply = (char *)malloc(50);
+			uint8_t window = 0;
+			uint16_t rate = 0;
+			adc_get_window(context->adc_channel, &window, &rate);
+
+			uint8_t new_window = get_number8_from_json(cJSON_GetObjectItem(root, "window"), window);
+			uint16_t new_rate = get_number16_from_json(cJSON_GetObjectItem(root, "rate"), rate);
+			if (new_window != window || new_rate != rate) {
+				if (adc_set_window(context->adc_channel, new_window, new_rate) == ESP_OK) {
+					adc_get_window(context->adc_channel, &window, &rate);
+					adc_v_core_nws_write_postfix(context->tag, POSTFIX_ADC_WINDOW, window);
+					adc_v_core_nws_write_postfix(context->tag, POSTFIX_ADC_RATE, rate);
+				}
+			}
+
+			char * reply = (char *)diag_malloc(DIAG_HEAP_ADC, 80);
 			if (reply) {
-				memset(reply, 0, 50);
-				snprintf(reply, 49, "{\"zero\": %d, \"scale\": %d, \"auto\": %s}",
+				memset(reply, 0, 80);
+				snprintf(reply, 79, "{\"zero\": %d, \"scale\": %d, \"auto\": %s, \"window\": %d, \"rate\": %d}",
 						context->result_zero_offset,
 						context->result_scale_factor,
-						(context->auto_calibration_enabled ? "true" : "false"));
-				mqtt_publish(context->topic_command, reply);
-				free(reply);
+						(context->auto_calibration_enabled ? "true" : "false"),
+						window,
+						rate);
+				mqtt_publish_nojournal(context->topic_command, reply);
+				diag_free(DIAG_HEAP_ADC, reply);
 			}
 		}
 	}
@@ -288,35 +375,37 @@ void adc_v_core_timer_exec_function(void* arg) {
 		return;
 	}
 
-	cJSON *root = cJSON_CreateObject();
-	cJSON_AddNumberToObject(root, context->name, (result < 0 ? (uint16_t)0 : (uint16_t)result));
-	char * tmp = malloc(strlen(context->name) + 4 + 1);
-	if (tmp) {
-		strcpy(tmp, context->name);
-		strcpy(tmp + strlen(tmp), "_raw");
-		cJSON_AddNumberToObject(root, tmp, result);
-		free(tmp);
+	snapshot_set_float(context->name, result, 2);
+
+	float values[1] = { result };
+	if (!report_policy_check(&context->report_policy, values)) {
+		return;
 	}
 
-	char * json = cJSON_Print(root);
-	mqtt_publish(context->topic_data, json);
-	cJSON_free(json);
+	char buffer[JSON_WRITER_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_int(&writer, context->name, (result < 0 ? (uint16_t)0 : (uint16_t)result));
+	json_writer_add_float(&writer, context->name_raw, result, 3);
 
-	cJSON_Delete(root);
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(context->topic_data, json);
+	}
 }
 
 void adc_v_core_init(const adc_v_core_setup_t * settings) {
 	adc_v_core__buildconfig_t buildconfig = settings->buildconfig;
 
-    adc_oneshot_chan_cfg_t config = {
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-        .atten = ADC_ATTEN_DB_12,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_get_channel(), (adc_channel_t) buildconfig.adc_channel, &config));
+    esp_err_t res = adc_register_channel(buildconfig.adc_channel);
+    if (res != ESP_OK) {
+        LOGE(buildconfig.tag, "Cant register ADC channel %d: %04X", buildconfig.adc_channel, res);
+    	return;
+    }
 
     LOGI(buildconfig.tag, "ADC initialized");
 
-    adc_v_core_context_t * context = malloc(sizeof(adc_v_core_context_t));
+    adc_v_core_context_t * context = diag_malloc(DIAG_HEAP_ADC, sizeof(adc_v_core_context_t));
     if (context == NULL) {
         LOGE(buildconfig.tag, "OOM: context");
     	return;
@@ -324,28 +413,36 @@ void adc_v_core_init(const adc_v_core_setup_t * settings) {
 
     memset(context, 0, sizeof(adc_v_core_context_t));
 
-    context->name = (char *)malloc(strlen(buildconfig.name) + 1);
+    context->name = (char *)diag_malloc(DIAG_HEAP_ADC, strlen(buildconfig.name) + 1);
     if (context->name == NULL) {
         LOGE(buildconfig.tag, "OOM: name");
     	return;
     }
     strcpy(context->name, buildconfig.name);
 
-    context->topic_data = (char *)malloc(strlen(buildconfig.topic_data) + 1);
+    context->name_raw = (char *)diag_malloc(DIAG_HEAP_ADC, strlen(buildconfig.name) + 4 + 1);
+    if (context->name_raw == NULL) {
+        LOGE(buildconfig.tag, "OOM: name_raw");
+    	return;
+    }
+    strcpy(context->name_raw, buildconfig.name);
+    strcat(context->name_raw, "_raw");
+
+    context->topic_data = (char *)diag_malloc(DIAG_HEAP_ADC, strlen(buildconfig.topic_data) + 1);
     if (context->topic_data == NULL) {
         LOGE(buildconfig.tag, "OOM: topic_data");
     	return;
     }
     strcpy(context->topic_data, buildconfig.topic_data);
 
-    context->topic_command = (char *)malloc(strlen(buildconfig.topic_command) + 1);
+    context->topic_command = (char *)diag_malloc(DIAG_HEAP_ADC, strlen(buildconfig.topic_command) + 1);
     if (context->topic_command == NULL) {
         LOGE(buildconfig.tag, "OOM: topic_command");
     	return;
     }
     strcpy(context->topic_command, buildconfig.topic_command);
 
-    context->tag = (char *)malloc(strlen(buildconfig.tag) + 1);
+    context->tag = (char *)diag_malloc(DIAG_HEAP_ADC, strlen(buildconfig.tag) + 1);
     if (context->tag == NULL) {
         LOGE(buildconfig.tag, "OOM: topic_data");
     	return;
@@ -370,11 +467,22 @@ void adc_v_core_init(const adc_v_core_setup_t * settings) {
     adc_v_core_nws_read_postfix(buildconfig.tag, POSTFIX_AUTO_CALIBRATE, &temp);
     context->auto_calibration_enabled = temp;
 
+    uint16_t window = ADC_WINDOW_DEFAULT;
+    uint16_t rate = ADC_RATE_DEFAULT;
+    adc_v_core_nws_read_postfix(buildconfig.tag, POSTFIX_ADC_WINDOW, &window);
+    adc_v_core_nws_read_postfix(buildconfig.tag, POSTFIX_ADC_RATE, &rate);
+    adc_set_window(buildconfig.adc_channel, window, rate);
+
     context->compensation_h = ADC_V_CORE_COMPENSATION_NOVALUE;
     context->compensation_t = ADC_V_CORE_COMPENSATION_NOVALUE;
     context->compensation_settings = settings->compensation;
     context->autorecalibrate_counter = 0;
     context->calibrate_find_value_x10 = settings->calibrate_find_value_x10;
+    context->calibrate_max_a0 = settings->calibrate_max_a0;
+
+    const report_policy_deadband_t deadband = { .absolute = 0, .relative = 2 };
+    context->report_fields[0] = context->name;
+    report_policy_init(&context->report_policy, context->tag, context->report_fields, 1, &deadband);
 
     if (context->calibration_value != ADC_V_CORE_CALIBRATION_NOVALUE) {
     	LOGI(buildconfig.tag, "Calibration value: A0 = %d", context->calibration_value);
@@ -382,14 +490,7 @@ void adc_v_core_init(const adc_v_core_setup_t * settings) {
     	LOGW(buildconfig.tag, "No calibration value. Use type='calibrate' request");
     }
 
-	esp_timer_create_args_t periodic_timer_args = {
-		.callback = &adc_v_core_timer_exec_function,
-		.arg = context,
-	};
-
-	esp_timer_handle_t periodic_timer;
-	ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-	ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, ADC_V_CORE_EXEC_PERIOD));
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_ADC, context->tag, ADC_V_CORE_EXEC_PERIOD, &adc_v_core_timer_exec_function, context));
 
 	mqtt_subscribe(buildconfig.topic_command, adc_v_core_commands, context);
 
@@ -401,41 +502,27 @@ void adc_v_core_init(const adc_v_core_setup_t * settings) {
 }
 
 void adc_v_core_init_auto_compensation(adc_v_core_context_t * context) {
-	esp_timer_create_args_t periodic_timer_args = {
-		.callback = &adc_v_core_timer_apply_correction_function,
-		.arg = context
-	};
-
-	esp_timer_handle_t periodic_timer;
-	ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-	ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, ADC_V_CORE_APPLY_COMPENSATION_PERIOD));
-
-	adc_v_core_timer_apply_correction_function(context);
+	ESP_ERROR_CHECK(bme280_subscribe(adc_v_core_apply_compensation, context));
 }
 
-void adc_v_core_timer_apply_correction_function(void* arg) {
-#if CONFIG_BME280_ENABLED
-	bme280_data_t data = {0};
-	if (bme280_read(&data) == ESP_OK) {
-		adc_v_core_context_t * context = (adc_v_core_context_t *) arg;
-
-		if (context->compensation_settings.temperature &&
-				data.temperature >= context->compensation_settings.min_t &&
-				data.temperature <= context->compensation_settings.max_t) {
-			context->compensation_t = data.temperature;
-		} else {
-			context->compensation_t = context->compensation_settings.temperature ?
-					ADC_V_CORE_COMPENSATION_NOVALUE : ADC_V_CORE_COMPENSATION_IGNORED;
-		}
+void adc_v_core_apply_compensation(const bme280_data_t * data, void * arg) {
+	adc_v_core_context_t * context = (adc_v_core_context_t *) arg;
 
-		if (context->compensation_settings.humidity && data.humidity <= 100) {
-			context->compensation_h = data.humidity;
-		} else {
-			context->compensation_h = context->compensation_settings.humidity ?
-					ADC_V_CORE_COMPENSATION_NOVALUE : ADC_V_CORE_COMPENSATION_IGNORED;
-		}
+	if (context->compensation_settings.temperature &&
+			data->temperature >= context->compensation_settings.min_t &&
+			data->temperature <= context->compensation_settings.max_t) {
+		context->compensation_t = data->temperature;
+	} else {
+		context->compensation_t = context->compensation_settings.temperature ?
+				ADC_V_CORE_COMPENSATION_NOVALUE : ADC_V_CORE_COMPENSATION_IGNORED;
+	}
+
+	if (context->compensation_settings.humidity && data->humidity <= 100) {
+		context->compensation_h = data->humidity;
+	} else {
+		context->compensation_h = context->compensation_settings.humidity ?
+				ADC_V_CORE_COMPENSATION_NOVALUE : ADC_V_CORE_COMPENSATION_IGNORED;
 	}
-#endif
 }
 
 bool adc_v_core_startup_allowed() {
@@ -37,6 +37,8 @@ typedef struct {
 	adc_v_core__compensation_t       compensation;
 	adc_v_core__buildconfig_t        buildconfig;
 	uint16_t                         calibrate_find_value_x10;
+	// highest A0 the calibration may try (the model must be monotonic up to it), 0 - no limit
+	uint16_t                         calibrate_max_a0;
 } adc_v_core_setup_t;
 
 bool adc_v_core_startup_allowed();
@@ -0,0 +1,48 @@
+#include "adc_v_core_lut.h"
+
+#include "stdlib.h"
+
+bool adc_v_core_lut_build(adc_v_core_lut_t * lut, adc_v_core_lut_function_t function, float x_min, float x_max, uint16_t size) {
+	lut->values = NULL;
+	lut->size = 0;
+
+	if (size < 2 || x_max <= x_min) {
+		return false;
+	}
+
+	float * values = (float *)malloc(size * sizeof(float));
+	if (values == NULL) {
+		return false;
+	}
+
+	lut->x_min = x_min;
+	lut->x_max = x_max;
+	lut->step  = (x_max - x_min) / (float)(size - 1);
+
+	for (uint16_t i = 0; i<size; i++) {
+		values[i] = (float)function((double)x_min + (double)i * ((double)x_max - (double)x_min) / (double)(size - 1));
+	}
+
+	lut->values = values;
+	lut->size = size;
+
+	return true;
+}
+
+bool adc_v_core_lut_eval(const adc_v_core_lut_t * lut, float x, float * result) {
+	if (lut->values == NULL || x < lut->x_min || x > lut->x_max) {
+		return false;
+	}
+
+	float position = (x - lut->x_min) / lut->step;
+	uint16_t index = (uint16_t)position;
+	if (index >= lut->size - 1) {
+		*result = lut->values[lut->size - 1];
+		return true;
+	}
+
+	float fraction = position - (float)index;
+	*result = lut->values[index] + (lut->values[index + 1] - lut->values[index]) * fraction;
+
+	return true;
+}
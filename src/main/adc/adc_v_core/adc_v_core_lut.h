@@ -0,0 +1,23 @@
+#ifndef MAIN_ADC_ADC_V_CORE_ADC_V_CORE_LUT_H_
+#define MAIN_ADC_ADC_V_CORE_ADC_V_CORE_LUT_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+// Piecewise-linear table of a double function, sampled once at init in float.
+// Outside of [x_min, x_max] callers fall back to the exact function.
+
+typedef double (*adc_v_core_lut_function_t)(double x);
+
+typedef struct {
+	float    x_min;
+	float    x_max;
+	float    step;
+	uint16_t size;
+	float *  values;
+} adc_v_core_lut_t;
+
+bool adc_v_core_lut_build(adc_v_core_lut_t * lut, adc_v_core_lut_function_t function, float x_min, float x_max, uint16_t size);
+bool adc_v_core_lut_eval(const adc_v_core_lut_t * lut, float x, float * result);
+
+#endif /* MAIN_ADC_ADC_V_CORE_ADC_V_CORE_LUT_H_ */
@@ -1,6 +1,7 @@
 #include "adc_v_core_nvs.h"
 
 #include "../../common/nvs_rw.h"
+#include "../../common/diag.h"
 #include "../../log/log.h"
 #include "string.h"
 
@@ -35,7 +36,7 @@ void adc_v_core_nws_write(const char * name, uint16_t value) {
 
 void adc_v_core_nws_read_postfix(const char * name, char postfix, uint16_t * to) {
 	uint8_t len = strlen(name);
-	char * tmp = malloc(len + 2 + 1);
+	char * tmp = diag_malloc(DIAG_HEAP_ADC, len + 2 + 1);
 	if (tmp) {
 		memset(tmp, 0, len + 2 + 1);
 		strcpy(tmp, name);
@@ -45,13 +46,13 @@ void adc_v_core_nws_read_postfix(const char * name, char postfix, uint16_t * to)
 
 		adc_v_core_nws_read(tmp, to);
 
-		free(tmp);
+		diag_free(DIAG_HEAP_ADC, tmp);
 	}
 }
 
 void adc_v_core_nws_write_postfix(const char * name, char postfix, uint16_t value) {
 	uint8_t len = strlen(name);
-	char * tmp = malloc(len + 2 + 1);
+	char * tmp = diag_malloc(DIAG_HEAP_ADC, len + 2 + 1);
 	if (tmp) {
 		memset(tmp, 0, len + 2 + 1);
 		strcpy(tmp, name);
@@ -61,6 +62,6 @@ void adc_v_core_nws_write_postfix(const char * name, char postfix, uint16_t valu
 
 		adc_v_core_nws_write(tmp, value);
 
-		free(tmp);
+		diag_free(DIAG_HEAP_ADC, tmp);
 	}
 }
@@ -1,18 +1,16 @@
 #include "light.h"
 
-#include "esp_adc/adc_oneshot.h"
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
-#include "esp_timer.h"
-
 #include "sdkconfig.h"
-#include "cJSON.h"
-#include "../../cjson/cjson_helper.h"
+#include "../../cjson/json_writer.h"
 #include "../../common/mqtt.h"
+#include "../../common/scheduler.h"
+#include "../../common/snapshot.h"
+#include "../../common/report_policy.h"
+#include "cJSON.h"
 #include "../../log/log.h"
 #include "../adc.h"
 
-#define LIGHT_EXEC_PERIOD	30000000
+#define LIGHT_EXEC_PERIOD	30000
 #define LIGHT_NOVALUE       0xFF
 
 #define LIGHT_DEBUG			true
@@ -25,14 +23,31 @@
 #define LIGHT_ADC_TO_RESULT(value) \
 	(value > LIGHT_ADC_ZERO ? (100 * (value - LIGHT_ADC_ZERO) / (LIGHT_ADC_MAX - LIGHT_ADC_ZERO)) : 0)
 
+static const char * const light_report_fields[] = { "light" };
+static const report_policy_deadband_t light_report_deadbands[] = { { .absolute = 3 } };
+static report_policy_t light_report_policy;
+
+void light_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
+	if (root == NULL) {
+		return;
+	}
+
+	report_policy_command(&light_report_policy, root, MQTT_TOPIC(CONFIG_LIGHT_TOPIC_COMMAND));
+
+	cJSON_Delete(root);
+}
+
 uint8_t light_read_value() {
-	int value = 0;
-	esp_err_t res = adc_oneshot_read(adc_get_channel(), (adc_channel_t) CONFIG_LIGHT_ADC_CHANNEL, &value);
+	adc_stats_t stats = { 0 };
+	esp_err_t res = adc_read(CONFIG_LIGHT_ADC_CHANNEL, &stats);
 	if (res != ESP_OK) {
 		LOGE(LOG_LIGHT, "Cant read ADC value. Error %04X", res);
 		return LIGHT_NOVALUE;
 	}
 
+	uint16_t value = stats.mean;
+
 	uint8_t result = (uint8_t) LIGHT_ADC_TO_RESULT(value);
 
 #if LIGHT_DEBUG
@@ -48,34 +63,38 @@ void light_timer_exec_function(void* arg) {
 		return;
 	}
 
-	cJSON *root = cJSON_CreateObject();
-	cJSON_AddNumberToObject(root, "light", value);
+	snapshot_set_int("light", value);
 
-	char * json = cJSON_Print(root);
-	mqtt_publish(CONFIG_LIGHT_TOPIC_DATA, json);
-	cJSON_free(json);
+	float values[1] = { value };
+	if (!report_policy_check(&light_report_policy, values)) {
+		return;
+	}
 
-	cJSON_Delete(root);
+	char buffer[JSON_WRITER_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_int(&writer, "light", value);
+
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(MQTT_TOPIC(CONFIG_LIGHT_TOPIC_DATA), json);
+	}
 }
 
 void light_init() {
-	adc_oneshot_chan_cfg_t config = {
-		.bitwidth = ADC_BITWIDTH_DEFAULT,
-		.atten = ADC_ATTEN_DB_12,
-	};
-	ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_get_channel(), (adc_channel_t) CONFIG_LIGHT_ADC_CHANNEL, &config));
+	esp_err_t res = adc_register_channel(CONFIG_LIGHT_ADC_CHANNEL);
+	if (res != ESP_OK) {
+		LOGE(LOG_LIGHT, "Cant register ADC channel %d: %04X", CONFIG_LIGHT_ADC_CHANNEL, res);
+		return;
+	}
 
     LOGI(LOG_LIGHT, "ADC initialized");
 
-	esp_timer_create_args_t periodic_timer_args = {
-		.callback = &light_timer_exec_function,
-		/* name is optional, but may help identify the timer when debugging */
-		.name = "light publish value"
-	};
+	report_policy_init(&light_report_policy, "light", light_report_fields, 1, light_report_deadbands);
+
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_LIGHT_TOPIC_COMMAND), light_commands, NULL);
 
-	esp_timer_handle_t periodic_timer;
-	ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-	ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, LIGHT_EXEC_PERIOD));
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_ADC, "light publish value", LIGHT_EXEC_PERIOD, &light_timer_exec_function, NULL));
 
     LOGI(LOG_LIGHT, "Driver initialized");
 }
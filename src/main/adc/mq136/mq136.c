@@ -5,6 +5,8 @@
 #include "sdkconfig.h"
 
 #include "../adc_v_core/adc_v_core.h"
+#include "../adc_v_core/adc_v_core_lut.h"
+#include "../../common/mqtt.h"
 #include "../../log/log.h"
 
 #define MQ136_DEBUG_COMPENSATIONS 		false
@@ -12,6 +14,15 @@
 #define MQ136_AM		   				((double)4095.0)
 #define MQ136_COMPENSATION_DEFAULT_H	33.0
 
+#define MQ136_LUT_RSRO_MIN			0.0f
+#define MQ136_LUT_RSRO_MAX			4.0f
+#define MQ136_LUT_RSRO_SIZE			401
+#define MQ136_LUT_T_MIN				(-10)
+#define MQ136_LUT_T_MAX				(70)
+
+static adc_v_core_lut_t mq136_lut_rsro = { 0 };
+static adc_v_core_lut_t mq136_lut_t = { 0 };
+
 // Math:
 // As  = ADC value for current measurement (adc variable)
 // Ao  = ADC value for zero-measurement    (calibrated value)
@@ -28,6 +39,19 @@ double mq136_adc2rsro(uint16_t adc, uint16_t calibration_value) {
 	return ((double)calibration_value * (MQ136_AM - (double)adc)) / temp;
 }
 
+double mq136_delta_t_exact(double t) {
+	return 9.4232*exp(-0.0001651*(t+20.0)) + 1.3875*exp(-0.063899*(t+20.0)) - 8.4365;
+}
+
+static double mq136_delta_t(double t) {
+	float result = 0;
+	if (adc_v_core_lut_eval(&mq136_lut_t, (float)t, &result)) {
+		return result;
+	}
+
+	return mq136_delta_t_exact(t);
+}
+
 // Temperature compensation: T = T+20; and used next formula
 // y = A*e^(-Bx) + C*e^(-Dx) + F
 // Where:
@@ -49,7 +73,7 @@ double mq136_apply_compensation(double value, int8_t compensation_t, uint8_t com
 	double delta_h = ((h-33.0)*delta_h_85_33)/52.0;
 
 	// 2. find T delta for this temperature and 33% humidity (it's compensation allready applied)
-	double delta_t = 9.4232*exp(-0.0001651*(t+20.0)) + 1.3875*exp(-0.063899*(t+20.0)) - 8.4365;
+	double delta_t = mq136_delta_t(t);
 
 	// 3. total compensation: humidity moves graph down
 	double compensation = delta_t - delta_h;
@@ -80,13 +104,29 @@ double mq136_apply_compensation(double value, int8_t compensation_t, uint8_t com
 // C = 1357.4
 // D = 0.013213
 // F = -1322.4
-double mq136_rsro2value(double rs_ro) {
+double mq136_rsro2value_exact(double rs_ro) {
 	return 4551.6*exp(-5.4194*rs_ro) + 1357.4*exp(-0.013213*rs_ro) - 1322.4;
 }
 
+double mq136_rsro2value(double rs_ro) {
+	float result = 0;
+	if (adc_v_core_lut_eval(&mq136_lut_rsro, (float)rs_ro, &result)) {
+		return result;
+	}
+
+	return mq136_rsro2value_exact(rs_ro);
+}
+
 void mq136_init() {
+	if (!adc_v_core_lut_build(&mq136_lut_rsro, &mq136_rsro2value_exact, MQ136_LUT_RSRO_MIN, MQ136_LUT_RSRO_MAX, MQ136_LUT_RSRO_SIZE) ||
+		!adc_v_core_lut_build(&mq136_lut_t, &mq136_delta_t_exact, MQ136_LUT_T_MIN, MQ136_LUT_T_MAX, MQ136_LUT_T_MAX - MQ136_LUT_T_MIN + 1)) {
+		LOGW(LOG_MQ136, "Cant build lookup tables, exact formulas will be used");
+	}
+
 	adc_v_core_setup_t setup = {
 		.calibrate_find_value_x10 = 0,
+		// Rs/Ro has a pole at Ao = Am and changes its sign above it
+		.calibrate_max_a0 = (uint16_t)MQ136_AM - 1,
 
 		.compensation = {
 			.min_t = -10,
@@ -97,8 +137,8 @@ void mq136_init() {
 
 		.buildconfig = {
 			.adc_channel = CONFIG_MQ136_ADC_CHANNEL,
-			.topic_data = CONFIG_MQ136_TOPIC_DATA,
-			.topic_command = CONFIG_MQ136_TOPIC_COMMAND,
+			.topic_data = MQTT_TOPIC(CONFIG_MQ136_TOPIC_DATA),
+			.topic_command = MQTT_TOPIC(CONFIG_MQ136_TOPIC_COMMAND),
 			.name = "h2s",
 			.tag = LOG_MQ136
 		},
@@ -5,12 +5,23 @@
 #include "math.h"
 
 #include "../adc_v_core/adc_v_core.h"
+#include "../adc_v_core/adc_v_core_lut.h"
+#include "../../common/mqtt.h"
 #include "../../log/log.h"
 
 #define MQ7_DEBUG_COMPENSATIONS 	false
 
 #define MQ7_AM		   				((double)4095.0)
 
+#define MQ7_LUT_RSRO_MIN			0.0f
+#define MQ7_LUT_RSRO_MAX			4.0f
+#define MQ7_LUT_RSRO_SIZE			401
+#define MQ7_LUT_T_MIN				(-10)
+#define MQ7_LUT_T_MAX				(50)
+
+static adc_v_core_lut_t mq7_lut_rsro = { 0 };
+static adc_v_core_lut_t mq7_lut_t = { 0 };
+
 
 // Math:
 // As  = ADC value for current measurement (adc variable)
@@ -28,6 +39,19 @@ double mq7_adc2rsro(uint16_t adc, uint16_t calibration_value) {
 	return ((double)calibration_value * (MQ7_AM - (double)adc)) / temp;
 }
 
+double mq7_delta_t_exact(double t) {
+	return 0.746382*exp(-0.031302*(t+20.0)) + 1.689218*exp(-0.266425*(t+20.0)) + 0.786563;
+}
+
+static double mq7_delta_t(double t) {
+	float result = 0;
+	if (adc_v_core_lut_eval(&mq7_lut_t, (float)t, &result)) {
+		return result;
+	}
+
+	return mq7_delta_t_exact(t);
+}
+
 // Temperature compensation: T = T+20; and used next formula
 // y = A*e^(-Bx) + C*e^(-Dx) + F
 // Where:
@@ -49,7 +73,7 @@ double mq7_apply_compensation(double value, int8_t compensation_t, uint8_t compe
 	double delta_h = ((h-33.0)*delta_h_85_33)/52.0;
 
 	// 2. find T delta for this temperature and 33% humidity (it's compensation allready applied)
-	double delta_t = 0.746382*exp(-0.031302*(t+20.0)) + 1.689218*exp(-0.266425*(t+20.0)) + 0.786563;
+	double delta_t = mq7_delta_t(t);
 
 	// 3. total compensation: humidity moves graph down
 	double compensation = delta_t - delta_h;
@@ -80,13 +104,29 @@ double mq7_apply_compensation(double value, int8_t compensation_t, uint8_t compe
 // C = 816.79
 // D = 2.7196
 // F = 36.189
-double mq7_rsro2value(double rs_ro) {
+double mq7_rsro2value_exact(double rs_ro) {
 	return 10865*exp(-13.158*rs_ro) + 816.79*exp(-2.7196*rs_ro) + 36.189;
 }
 
+double mq7_rsro2value(double rs_ro) {
+	float result = 0;
+	if (adc_v_core_lut_eval(&mq7_lut_rsro, (float)rs_ro, &result)) {
+		return result;
+	}
+
+	return mq7_rsro2value_exact(rs_ro);
+}
+
 void mq7_init() {
+	if (!adc_v_core_lut_build(&mq7_lut_rsro, &mq7_rsro2value_exact, MQ7_LUT_RSRO_MIN, MQ7_LUT_RSRO_MAX, MQ7_LUT_RSRO_SIZE) ||
+		!adc_v_core_lut_build(&mq7_lut_t, &mq7_delta_t_exact, MQ7_LUT_T_MIN, MQ7_LUT_T_MAX, MQ7_LUT_T_MAX - MQ7_LUT_T_MIN + 1)) {
+		LOGW(LOG_MQ7, "Cant build lookup tables, exact formulas will be used");
+	}
+
 	adc_v_core_setup_t setup = {
 		.calibrate_find_value_x10 = 0,
+		// Rs/Ro has a pole at Ao = Am and changes its sign above it
+		.calibrate_max_a0 = (uint16_t)MQ7_AM - 1,
 
 		.compensation = {
 			.min_t = -10,
@@ -97,8 +137,8 @@ void mq7_init() {
 
 		.buildconfig = {
 			.adc_channel = CONFIG_MQ7_ADC_CHANNEL,
-			.topic_data = CONFIG_MQ7_TOPIC_DATA,
-			.topic_command = CONFIG_MQ7_TOPIC_COMMAND,
+			.topic_data = MQTT_TOPIC(CONFIG_MQ7_TOPIC_DATA),
+			.topic_command = MQTT_TOPIC(CONFIG_MQ7_TOPIC_COMMAND),
 			.name = "co",
 			.tag = LOG_MQ7
 		},
@@ -5,6 +5,7 @@
 #include "sdkconfig.h"
 
 #include "../adc_v_core/adc_v_core.h"
+#include "../../common/mqtt.h"
 #include "../../log/log.h"
 #include "../../common/delay_timer.h"
 
@@ -77,8 +78,8 @@ void o2a2_init() {
 
 		.buildconfig = {
 			.adc_channel = CONFIG_O2A2_ADC_CHANNEL,
-			.topic_data = CONFIG_O2A2_TOPIC_DATA,
-			.topic_command = CONFIG_O2A2_TOPIC_COMMAND,
+			.topic_data = MQTT_TOPIC(CONFIG_O2A2_TOPIC_DATA),
+			.topic_command = MQTT_TOPIC(CONFIG_O2A2_TOPIC_COMMAND),
 			.name = "o2",
 			.tag = LOG_O2A2
 		},
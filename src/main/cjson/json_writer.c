@@ -0,0 +1,119 @@
+#include "json_writer.h"
+
+#include "sdkconfig.h"
+
+#include "stdio.h"
+#include "stdarg.h"
+#include "math.h"
+
+#include "../common/profiler.h"
+
+#if CONFIG_MQTT_PAYLOAD_COMPACT
+#define JSON_WRITER_INDENT    ""
+#define JSON_WRITER_COLON     ":"
+#define JSON_WRITER_CLOSE     "}"
+#else
+#define JSON_WRITER_INDENT    "\n\t"
+#define JSON_WRITER_COLON     ":\t"
+#define JSON_WRITER_CLOSE     "\n}"
+#endif
+
+static void json_writer_append(json_writer_t * writer, const char * format, ...) {
+	if (writer->overflow) {
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	int written = vsnprintf(writer->buffer + writer->length, writer->size - writer->length, format, args);
+	va_end(args);
+
+	if (written < 0 || (size_t)written >= writer->size - writer->length) {
+		writer->overflow = true;
+		return;
+	}
+
+	writer->length += written;
+}
+
+static void json_writer_key(json_writer_t * writer, const char * name) {
+	json_writer_append(writer, "%s" JSON_WRITER_INDENT "\"%s\"" JSON_WRITER_COLON, (writer->empty ? "" : ","), name);
+	writer->empty = false;
+}
+
+void json_writer_begin(json_writer_t * writer, char * buffer, size_t size) {
+	writer->buffer = buffer;
+	writer->size = size;
+	writer->length = 0;
+	writer->empty = true;
+	writer->overflow = (size == 0);
+#if CONFIG_PROFILER_ENABLED
+	writer->started = esp_timer_get_time();
+#endif
+
+	json_writer_append(writer, "{");
+}
+
+void json_writer_add_int(json_writer_t * writer, const char * name, int32_t value) {
+	json_writer_key(writer, name);
+	json_writer_append(writer, "%ld", (long)value);
+}
+
+void json_writer_add_int64(json_writer_t * writer, const char * name, int64_t value) {
+	json_writer_key(writer, name);
+	json_writer_append(writer, "%lld", (long long)value);
+}
+
+void json_writer_add_float(json_writer_t * writer, const char * name, double value, uint8_t decimals) {
+	json_writer_key(writer, name);
+	// "%f" prints nan/inf, which is not JSON: null as cJSON did
+	if (!isfinite(value)) {
+		json_writer_append(writer, "null");
+		return;
+	}
+	json_writer_append(writer, "%.*f", decimals, value);
+}
+
+void json_writer_add_string(json_writer_t * writer, const char * name, const char * value) {
+	json_writer_key(writer, name);
+	json_writer_append(writer, "\"%s\"", value);
+}
+
+void json_writer_add_bool(json_writer_t * writer, const char * name, bool value) {
+	json_writer_key(writer, name);
+	json_writer_append(writer, value ? "true" : "false");
+}
+
+void json_writer_begin_array(json_writer_t * writer, const char * name) {
+	json_writer_key(writer, name);
+	json_writer_append(writer, "[");
+	writer->empty = true;
+}
+
+void json_writer_add_array_string(json_writer_t * writer, const char * value) {
+	json_writer_append(writer, "%s\"%s\"", (writer->empty ? "" : ","), value);
+	writer->empty = false;
+}
+
+void json_writer_end_array(json_writer_t * writer) {
+	json_writer_append(writer, "]");
+	writer->empty = false;
+}
+
+void json_writer_begin_object(json_writer_t * writer, const char * name) {
+	json_writer_key(writer, name);
+	json_writer_append(writer, "{");
+	writer->empty = true;
+}
+
+void json_writer_end_object(json_writer_t * writer) {
+	json_writer_append(writer, "}");
+	writer->empty = false;
+}
+
+const char * json_writer_end(json_writer_t * writer) {
+	json_writer_append(writer, writer->empty ? "}" : JSON_WRITER_CLOSE);
+	PROFILER_STOP(PROFILER_SPAN_JSON, writer->started);
+
+	return writer->overflow ? NULL : writer->buffer;
+}
@@ -0,0 +1,45 @@
+#ifndef MAIN_CJSON_JSON_WRITER_H_
+#define MAIN_CJSON_JSON_WRITER_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "sdkconfig.h"
+
+// Writes a flat JSON object directly into a caller buffer, without a cJSON tree and heap allocations.
+// Whitespace follows cJSON_Print() unless CONFIG_MQTT_PAYLOAD_COMPACT is set.
+
+#define JSON_WRITER_BUFFER_SIZE 160
+
+typedef struct {
+	char *   buffer;
+	size_t   size;
+	size_t   length;
+	bool     empty;
+	bool     overflow;
+#if CONFIG_PROFILER_ENABLED
+	int64_t  started;
+#endif
+} json_writer_t;
+
+void json_writer_begin(json_writer_t * writer, char * buffer, size_t size);
+
+void json_writer_add_int(json_writer_t * writer, const char * name, int32_t value);
+void json_writer_add_int64(json_writer_t * writer, const char * name, int64_t value);
+void json_writer_add_float(json_writer_t * writer, const char * name, double value, uint8_t decimals);
+void json_writer_add_string(json_writer_t * writer, const char * name, const char * value);
+void json_writer_add_bool(json_writer_t * writer, const char * name, bool value);
+
+// array of strings: begin_array, add_array_string..., end_array
+void json_writer_begin_array(json_writer_t * writer, const char * name);
+void json_writer_add_array_string(json_writer_t * writer, const char * value);
+void json_writer_end_array(json_writer_t * writer);
+
+// nested object: begin_object, add_*..., end_object
+void json_writer_begin_object(json_writer_t * writer, const char * name);
+void json_writer_end_object(json_writer_t * writer);
+
+// returns NULL if the buffer was too small
+const char * json_writer_end(json_writer_t * writer);
+
+#endif /* MAIN_CJSON_JSON_WRITER_H_ */
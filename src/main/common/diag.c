@@ -0,0 +1,165 @@
+#include "diag.h"
+
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "stdlib.h"
+#include "string.h"
+#include "cJSON.h"
+
+#include "mqtt.h"
+#include "scheduler.h"
+#include "../cjson/json_writer.h"
+#include "../log/log.h"
+
+#define DIAG_MAX_TASKS    16
+#define DIAG_BUFFER_SIZE  1024
+
+static const char * diag_heap_names[DIAG_HEAP_MAX] = {
+	[DIAG_HEAP_MQTT]  = "mqtt",
+	[DIAG_HEAP_JSON]  = "json",
+	[DIAG_HEAP_NVS]   = "nvs",
+	[DIAG_HEAP_ADC]   = "adc",
+	[DIAG_HEAP_I2C]   = "i2c",
+	[DIAG_HEAP_OTHER] = "other",
+};
+
+// ESP-IDF tasks, looked up by name when publishing
+static const char * diag_system_tasks[] = { "main", "mqtt_task", "tiT", "wifi", "sys_evt", "esp_timer" };
+
+static diag_heap_stats_t diag_heap_stats[DIAG_HEAP_MAX];
+static TaskHandle_t diag_tasks[DIAG_MAX_TASKS];
+static uint8_t diag_tasks_count = 0;
+
+static portMUX_TYPE diag_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void * diag_malloc(diag_heap_t subsystem, size_t size) {
+	void * ptr = malloc(size);
+	size_t allocated = ptr ? heap_caps_get_allocated_size(ptr) : 0;
+
+	portENTER_CRITICAL(&diag_lock);
+	diag_heap_stats_t * stats = &diag_heap_stats[subsystem];
+	if (ptr) {
+		stats->allocs++;
+		stats->bytes += allocated;
+		if (stats->bytes > stats->bytes_peak) {
+			stats->bytes_peak = stats->bytes;
+		}
+	} else {
+		stats->failures++;
+	}
+	portEXIT_CRITICAL(&diag_lock);
+
+	return ptr;
+}
+
+void diag_free(diag_heap_t subsystem, void * ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+
+	size_t allocated = heap_caps_get_allocated_size(ptr);
+	free(ptr);
+
+	portENTER_CRITICAL(&diag_lock);
+	diag_heap_stats_t * stats = &diag_heap_stats[subsystem];
+	stats->frees++;
+	stats->bytes -= (allocated > stats->bytes) ? stats->bytes : allocated;
+	portEXIT_CRITICAL(&diag_lock);
+}
+
+void diag_get_heap_stats(diag_heap_t subsystem, diag_heap_stats_t * stats) {
+	portENTER_CRITICAL(&diag_lock);
+	*stats = diag_heap_stats[subsystem];
+	portEXIT_CRITICAL(&diag_lock);
+}
+
+void diag_register_task(TaskHandle_t task) {
+	if (task == NULL) {
+		return;
+	}
+
+	portENTER_CRITICAL(&diag_lock);
+	if (diag_tasks_count < DIAG_MAX_TASKS) {
+		diag_tasks[diag_tasks_count++] = task;
+	}
+	portEXIT_CRITICAL(&diag_lock);
+}
+
+static void * diag_json_malloc(size_t size) {
+	return diag_malloc(DIAG_HEAP_JSON, size);
+}
+
+static void diag_json_free(void * ptr) {
+	diag_free(DIAG_HEAP_JSON, ptr);
+}
+
+#if CONFIG_DIAG_ENABLED
+static void diag_add_task(json_writer_t * writer, TaskHandle_t task) {
+	// high-water mark is in bytes on ESP-IDF
+	json_writer_add_int(writer, pcTaskGetName(task), uxTaskGetStackHighWaterMark(task));
+}
+
+// {"uptime":s,"heap":{"free":b,"min_free":b,"largest_block":b},
+//  "alloc":{"<subsystem>":{"allocs":n,"frees":n,"failures":n,"bytes":b,"peak":b},...},
+//  "stack":{"<task>":<min free stack, bytes>,...}}
+static void diag_publish(void *) {
+	static char buffer[DIAG_BUFFER_SIZE];
+
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_int(&writer, "uptime", esp_timer_get_time() / 1000000);
+
+	json_writer_begin_object(&writer, "heap");
+	json_writer_add_int(&writer, "free", heap_caps_get_free_size(MALLOC_CAP_8BIT));
+	json_writer_add_int(&writer, "min_free", heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+	json_writer_add_int(&writer, "largest_block", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+	json_writer_end_object(&writer);
+
+	json_writer_begin_object(&writer, "alloc");
+	for (uint8_t i = 0; i<DIAG_HEAP_MAX; i++) {
+		diag_heap_stats_t stats;
+		diag_get_heap_stats(i, &stats);
+
+		json_writer_begin_object(&writer, diag_heap_names[i]);
+		json_writer_add_int(&writer, "allocs", stats.allocs);
+		json_writer_add_int(&writer, "frees", stats.frees);
+		json_writer_add_int(&writer, "failures", stats.failures);
+		json_writer_add_int(&writer, "bytes", stats.bytes);
+		json_writer_add_int(&writer, "peak", stats.bytes_peak);
+		json_writer_end_object(&writer);
+	}
+	json_writer_end_object(&writer);
+
+	json_writer_begin_object(&writer, "stack");
+	for (uint8_t i = 0; i<sizeof(diag_system_tasks) / sizeof(diag_system_tasks[0]); i++) {
+		TaskHandle_t task = xTaskGetHandle(diag_system_tasks[i]);
+		if (task) {
+			diag_add_task(&writer, task);
+		}
+	}
+	for (uint8_t i = 0; i<diag_tasks_count; i++) {
+		diag_add_task(&writer, diag_tasks[i]);
+	}
+	json_writer_end_object(&writer);
+
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish_nolog(MQTT_TOPIC(CONFIG_DIAG_TOPIC), json);
+	} else {
+		LOGE(LOG_MQTT, "Diagnostics do not fit into %d bytes", DIAG_BUFFER_SIZE);
+	}
+}
+#endif
+
+void diag_init() {
+	cJSON_Hooks hooks = {
+		.malloc_fn = diag_json_malloc,
+		.free_fn = diag_json_free,
+	};
+	cJSON_InitHooks(&hooks);
+
+#if CONFIG_DIAG_ENABLED
+	scheduler_add(SCHEDULER_BUS_SYSTEM, "diag", CONFIG_DIAG_PERIOD * 1000, diag_publish, NULL);
+#endif
+}
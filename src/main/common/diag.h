@@ -0,0 +1,42 @@
+#ifndef MAIN_COMMON_DIAG_H_
+#define MAIN_COMMON_DIAG_H_
+
+#include "stdint.h"
+#include "stddef.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Heap and stack diagnostics, published periodically on CONFIG_DIAG_TOPIC.
+// Allocations made through diag_malloc()/diag_free() are counted per subsystem,
+// cJSON allocations are counted as DIAG_HEAP_JSON.
+
+typedef enum {
+	DIAG_HEAP_MQTT = 0,
+	DIAG_HEAP_JSON,
+	DIAG_HEAP_NVS,
+	DIAG_HEAP_ADC,
+	DIAG_HEAP_I2C,
+	DIAG_HEAP_OTHER,
+
+	DIAG_HEAP_MAX
+} diag_heap_t;
+
+typedef struct {
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+	uint32_t bytes;		// currently allocated
+	uint32_t bytes_peak;
+} diag_heap_stats_t;
+
+void diag_init();
+
+void * diag_malloc(diag_heap_t subsystem, size_t size);
+void diag_free(diag_heap_t subsystem, void * ptr);
+
+void diag_get_heap_stats(diag_heap_t subsystem, diag_heap_stats_t * stats);
+
+// Long-living tasks whose stack high-water mark is published. Safe to call before diag_init().
+void diag_register_task(TaskHandle_t task);
+
+#endif /* MAIN_COMMON_DIAG_H_ */
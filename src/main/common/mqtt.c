@@ -5,62 +5,168 @@
 #include "sdkconfig.h"
 #include "mqtt_healthcheck.h"
 #include "mqtt_ota.h"
+#include "mqtt_journal.h"
+#include "diag.h"
+#include "profiler.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #include "../log/log.h"
 
 #define MAX_MQTT_URI_LEN 100
 #define MAX_MQTT_USER_PASS 20
 
+// Fixed-size subscription table with an open-addressing FNV-1a index on the full (prefixed) topic.
+// Topics ending with "/#" are matched by prefix when there is no exact match.
+#define MQTT_MAX_SUBSCRIPTIONS   32
+#define MQTT_HASH_BUCKETS        64
+#define MQTT_HASH_EMPTY          0xFF
+#define MQTT_REASSEMBLY_SIZE     4096
+
 typedef struct mqtt_callback_mapping_t {
-	char * topic;
+	const char * topic;
+	uint16_t topic_len;
+	uint32_t hash;
+	bool wildcard;
 	mqtt_topic_callback_t function;
 	bool logmessages;
 	void * arg;
 } mqtt_callback_mapping_t;
 
-mqtt_callback_mapping_t* callbacks = NULL;
-uint8_t callbacks_count = 0;
+static mqtt_callback_mapping_t callbacks[MQTT_MAX_SUBSCRIPTIONS];
+static uint8_t callbacks_hash[MQTT_HASH_BUCKETS];
+static volatile uint8_t callbacks_count = 0;
 esp_mqtt_client_handle_t client;
+static volatile bool mqtt_connected = false;
+
+// Chunked MQTT_EVENT_DATA is reassembled here. Chunks of one message arrive back to back from the MQTT task.
+static char mqtt_reassembly_buffer[MQTT_REASSEMBLY_SIZE];
+static const mqtt_callback_mapping_t * mqtt_reassembly_target = NULL;
+static int mqtt_reassembly_len = 0;
 
 void mqtt_subscribe_impl(const char * topic, mqtt_topic_callback_t callback, void * arg, bool logmessages);
-void mqtt_publish_impl(const char * topic, const char * message, bool logmessages);
+void mqtt_publish_impl(const char * topic, const char * message, bool logmessages, bool journal);
+
+#if CONFIG_MQTT_JOURNAL_ENABLED
+#define MQTT_JOURNAL_REPLAY_INTERVAL 1000
+
+static TaskHandle_t mqtt_journal_task_handle = NULL;
+#endif
+
+static uint32_t mqtt_topic_hash(const char * topic, size_t len) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i<len; i++) {
+		hash ^= (uint8_t)topic[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static const mqtt_callback_mapping_t * mqtt_find_callback(const char * topic, int topic_len) {
+	uint32_t hash = mqtt_topic_hash(topic, topic_len);
+
+	for (uint8_t i = 0; i<MQTT_HASH_BUCKETS; i++) {
+		uint8_t index = callbacks_hash[(hash + i) & (MQTT_HASH_BUCKETS - 1)];
+		if (index == MQTT_HASH_EMPTY) {
+			break;
+		}
+
+		const mqtt_callback_mapping_t * entry = &callbacks[index];
+		if (!entry->wildcard && entry->hash == hash && entry->topic_len == topic_len && memcmp(entry->topic, topic, topic_len) == 0) {
+			return entry;
+		}
+	}
+
+	// "prefix/#" matches "prefix" and everything below it
+	for (uint8_t i = 0; i<callbacks_count; i++) {
+		const mqtt_callback_mapping_t * entry = &callbacks[i];
+		if (entry->wildcard && topic_len >= entry->topic_len - 2 && memcmp(entry->topic, topic, entry->topic_len - 2) == 0
+				&& (topic_len == entry->topic_len - 2 || topic[entry->topic_len - 2] == '/')) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void mqtt_dispatch(const mqtt_callback_mapping_t * entry, const char * data, int data_len) {
+	if (entry->logmessages) {
+		LOGI(LOG_MQTT, "Received message in topic %s : %.*s", entry->topic, data_len, data);
+	}
+
+	entry->function(data, data_len, entry->arg);
+}
+
+static void mqtt_event_data(esp_mqtt_event_handle_t event) {
+	if (event->data == NULL || event->data_len <= 0) {
+		return;
+	}
+
+	// single chunk: hand the client buffer to the callback as is
+	if (event->current_data_offset == 0 && event->data_len == event->total_data_len) {
+		if (event->topic && event->topic_len) {
+			const mqtt_callback_mapping_t * entry = mqtt_find_callback(event->topic, event->topic_len);
+			if (entry) {
+				mqtt_dispatch(entry, event->data, event->data_len);
+			}
+		}
+		return;
+	}
+
+	if (event->current_data_offset == 0) {
+		mqtt_reassembly_target = NULL;
+		mqtt_reassembly_len = 0;
+
+		if (event->topic == NULL || event->topic_len == 0) {
+			return;
+		}
+
+		if (event->total_data_len > MQTT_REASSEMBLY_SIZE) {
+			LOGW(LOG_MQTT, "Message in topic %.*s dropped: %d bytes, max %d", event->topic_len, event->topic, event->total_data_len, MQTT_REASSEMBLY_SIZE);
+			return;
+		}
+
+		mqtt_reassembly_target = mqtt_find_callback(event->topic, event->topic_len);
+	}
+
+	if (mqtt_reassembly_target == NULL || event->current_data_offset != mqtt_reassembly_len) {
+		mqtt_reassembly_target = NULL;
+		return;
+	}
+
+	memcpy(mqtt_reassembly_buffer + mqtt_reassembly_len, event->data, event->data_len);
+	mqtt_reassembly_len += event->data_len;
+
+	if (mqtt_reassembly_len >= event->total_data_len) {
+		mqtt_dispatch(mqtt_reassembly_target, mqtt_reassembly_buffer, mqtt_reassembly_len);
+		mqtt_reassembly_target = NULL;
+		mqtt_reassembly_len = 0;
+	}
+}
 
 static void mqtt_event_handler_cb(esp_mqtt_event_handle_t event) {
-	if (callbacks_count == 0 || event == NULL) {
+	if (event == NULL) {
 		return;
 	}
 
 	switch (event->event_id) {
 	case MQTT_EVENT_CONNECTED:
+		mqtt_connected = true;
 		for (int i = 0; i<callbacks_count; i++) {
-			if (callbacks[i].topic) {
-				esp_mqtt_client_subscribe_single(event->client, callbacks[i].topic, 0);
-			}
+			esp_mqtt_client_subscribe_single(event->client, callbacks[i].topic, 0);
 		}
+#if CONFIG_MQTT_JOURNAL_ENABLED
+		if (mqtt_journal_task_handle) {
+			xTaskNotifyGive(mqtt_journal_task_handle);
+		}
+#endif
+		break;
+	case MQTT_EVENT_DISCONNECTED:
+		mqtt_connected = false;
 		break;
 	case MQTT_EVENT_DATA:
-		if (event->data && event->topic && event->data_len && event->topic_len && event->data_len < 1024 && event->topic_len < 1024) {
-			char * _data = malloc(event->data_len + 1);
-			if (_data){
-				memset(_data, 0, event->data_len + 1);
-				strncpy(_data, event->data, event->data_len);
-
-				for (int i = 0; i<callbacks_count; i++) {
-					if (callbacks[i].topic && strncmp(callbacks[i].topic, event->topic, event->topic_len) == 0) {
-						if (callbacks[i].logmessages) {
-							LOGI(LOG_MQTT, "Received message in topic %s : %s", callbacks[i].topic, _data);
-						}
-
-						callbacks[i].function(_data, callbacks[i].arg);
-
-						break;
-					}
-				}
-
-				free(_data);
-			} else {
-				LOGE(LOG_MQTT, "OOM malloc %d bytes", (event->data_len + 1));
-			}
+		if (callbacks_count > 0) {
+			mqtt_event_data(event);
 		}
 		break;
 	default:
@@ -72,68 +178,118 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 	mqtt_event_handler_cb(event_data);
 }
 
-char * mqtt_prepend_prefix(const char * topic) {
-	if (topic == NULL) {
-		return NULL;
-	}
-
-	char * str = malloc(strlen(CONFIG_MQTT_TOPICS_PREFIX) + strlen(topic) + 1);
-	if (str == NULL) {
-		return NULL;
-	}
-
-	strcpy(str, CONFIG_MQTT_TOPICS_PREFIX);
-	strcpy(str + strlen(CONFIG_MQTT_TOPICS_PREFIX), topic);
-
-	return str;
-}
-
 void mqtt_publish_sync(const char * topic, const char * message) {
-	if (client) {
-		char * temp = mqtt_prepend_prefix(topic);
-		if (temp == NULL) {
-			return;
-		}
+	PROFILER_SCOPE(PROFILER_SPAN_PUBLISH);
 
-		if (esp_mqtt_client_publish(client, temp, message, 0, 0, 1) >= 0) {
-	    	LOGI(LOG_MQTT, "MQTT publish OK topic = %s, message = %s", temp, message);
+	if (client) {
+		if (esp_mqtt_client_publish(client, topic, message, 0, 0, 1) >= 0) {
+	    	LOGI(LOG_MQTT, "MQTT publish OK topic = %s, message = %s", topic, message);
 		} else {
-			mqtt_publish(topic, message);
+			mqtt_publish_nojournal(topic, message);
 		}
-
-		free(temp);
-		temp = NULL;
 	}
 }
 
 void mqtt_publish(const char * topic, const char * message) {
-	mqtt_publish_impl(topic, message, true);
+	mqtt_publish_impl(topic, message, true, true);
 }
 
 void mqtt_publish_nolog(const char * topic, const char * message) {
-	mqtt_publish_impl(topic, message, false);
+	mqtt_publish_impl(topic, message, false, false);
 }
 
-void mqtt_publish_impl(const char * topic, const char * message, bool logmessages) {
-	if (client) {
-		char * temp = mqtt_prepend_prefix(topic);
-		if (temp == NULL) {
-			return;
+void mqtt_publish_nojournal(const char * topic, const char * message) {
+	mqtt_publish_impl(topic, message, true, false);
+}
+
+static bool mqtt_enqueue(const char * topic, const char * message, bool logmessages) {
+	if (client == NULL || !mqtt_connected) {
+		return false;
+	}
+
+	bool result = esp_mqtt_client_enqueue(client, topic, message, 0, 0, 1, 1) >= 0;
+	if (result) {
+		if (logmessages) {
+			LOGI(LOG_MQTT, "MQTT enqueue OK topic = %s, message = %s", topic, message);
 		}
+	} else {
+		LOGE(LOG_MQTT, "MQTT enqueue error: topic = %s, message = %s", topic, message);
+	}
 
-		if (esp_mqtt_client_enqueue(client, temp, message, 0, 0, 1, 1) >= 0) {
+	return result;
+}
+
+void mqtt_publish_impl(const char * topic, const char * message, bool logmessages, bool journal) {
+	PROFILER_SCOPE(PROFILER_SPAN_PUBLISH);
+
+#if CONFIG_MQTT_JOURNAL_ENABLED
+	// Queued behind a non-empty journal: sent before the replay ends, the message would be
+	// followed by older retained readings of the same topic and the broker would keep a stale one.
+	if (journal && mqtt_journal_count() > 0) {
+		if (mqtt_journal_store(topic, message)) {
+			if (mqtt_connected && mqtt_journal_task_handle) {
+				xTaskNotifyGive(mqtt_journal_task_handle);
+			}
 			if (logmessages) {
-				LOGI(LOG_MQTT, "MQTT enqueue OK topic = %s, message = %s", temp, message);
+				LOGI(LOG_MQTT, "MQTT journal replay running, queued topic = %s (%lu queued)", topic, mqtt_journal_count());
 			}
-		} else {
-	    	LOGE(LOG_MQTT, "MQTT enqueue error: topic = %s, message = %s", temp, message);
 		}
+		return;
+	}
+#endif
 
-		free(temp);
-		temp = NULL;
+	if (mqtt_enqueue(topic, message, logmessages)) {
+		return;
 	}
+
+#if CONFIG_MQTT_JOURNAL_ENABLED
+	if (journal && mqtt_journal_store(topic, message) && logmessages) {
+		LOGW(LOG_MQTT, "MQTT offline, journaled topic = %s (%lu queued)", topic, mqtt_journal_count());
+	}
+#endif
 }
 
+#if CONFIG_MQTT_JOURNAL_ENABLED
+// Replays journaled messages in batches once connected, in order and retained as they would have been.
+// JSON objects get the original "ts" (unix time) prepended.
+static void mqtt_journal_task(void *) {
+	static char topic[MQTT_JOURNAL_MAX_TOPIC];
+	static char message[MQTT_JOURNAL_MAX_MESSAGE];
+	static char payload[MQTT_JOURNAL_MAX_MESSAGE + 24];
+
+	while (true) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		if (mqtt_journal_count() > 0) {
+			LOGI(LOG_MQTT, "Journal replay: %lu messages", mqtt_journal_count());
+		}
+
+		while (mqtt_connected && mqtt_journal_count() > 0) {
+			for (uint8_t i = 0; i<CONFIG_MQTT_JOURNAL_REPLAY_BATCH; i++) {
+				uint32_t timestamp;
+				if (!mqtt_journal_peek(topic, message, &timestamp)) {
+					break;
+				}
+
+				const char * data = message;
+				if (timestamp && message[0] == '{') {
+					snprintf(payload, sizeof(payload), "{\"ts\":%lu%s%s", timestamp, message[1] == '}' ? "" : ",", message + 1);
+					data = payload;
+				}
+
+				if (!mqtt_enqueue(topic, data, false)) {
+					break;
+				}
+
+				mqtt_journal_pop();
+			}
+
+			vTaskDelay(MQTT_JOURNAL_REPLAY_INTERVAL / portTICK_PERIOD_MS);
+		}
+	}
+}
+#endif
+
 void mqtt_subscribe_nolog(const char * topic, mqtt_topic_callback_t callback, void * arg) {
 	mqtt_subscribe_impl(topic, callback, arg, false);
 }
@@ -148,57 +304,69 @@ void mqtt_subscribe_impl(const char * topic, mqtt_topic_callback_t callback, voi
 		return;
 	}
 
-	char * prepended_topic = mqtt_prepend_prefix(topic);
+	if (topic == NULL) {
+		return;
+	}
 
-	if (callbacks != NULL) {
-		for (uint8_t i = 0; i<callbacks_count; i++) {
-			if (strcmp(callbacks[i].topic, prepended_topic) == 0) {
-				if (callbacks[i].function != callback) {
-					LOGW(LOG_MQTT, "Duplicated subscription to topic %s. Callback overrided from %p to %p", prepended_topic, callbacks[i].function, callback);
-					callbacks[i].function = callback;
-				} else {
-					LOGW(LOG_MQTT, "Duplicated subscription to topic %s with same callback", prepended_topic);
-				}
+	size_t topic_len = strlen(topic);
+	bool wildcard = topic_len >= 2 && strcmp(topic + topic_len - 2, "/#") == 0;
 
-				callbacks[i].logmessages = logmessages;
-				callbacks[i].arg = arg;
+	for (uint8_t i = 0; i<callbacks_count; i++) {
+		if (strcmp(callbacks[i].topic, topic) == 0) {
+			if (callbacks[i].function != callback) {
+				LOGW(LOG_MQTT, "Duplicated subscription to topic %s. Callback overrided from %p to %p", topic, callbacks[i].function, callback);
+				callbacks[i].function = callback;
+			} else {
+				LOGW(LOG_MQTT, "Duplicated subscription to topic %s with same callback", topic);
+			}
 
-				free(prepended_topic);
-				prepended_topic = NULL;
+			callbacks[i].logmessages = logmessages;
+			callbacks[i].arg = arg;
 
-				return;
-			}
+			return;
 		}
 	}
 
-	mqtt_callback_mapping_t* newtable = (mqtt_callback_mapping_t*) malloc(sizeof(mqtt_callback_mapping_t) * (callbacks_count + 1));
-	memset(newtable, 0, sizeof(mqtt_callback_mapping_t) * (callbacks_count + 1));
-
-	if (callbacks_count > 0) {
-		memcpy(newtable, callbacks, sizeof(mqtt_callback_mapping_t) * callbacks_count);
-		free(callbacks);
-		callbacks = NULL;
+	if (callbacks_count >= MQTT_MAX_SUBSCRIPTIONS) {
+		LOGE(LOG_MQTT, "Cant subscribe on topic %s: max %d subscriptions", topic, MQTT_MAX_SUBSCRIPTIONS);
+		return;
 	}
 
-	callbacks = newtable;
-
-	callbacks[callbacks_count].topic       = prepended_topic;
-	callbacks[callbacks_count].function    = callback;
-	callbacks[callbacks_count].logmessages = logmessages;
-	callbacks[callbacks_count].arg         = arg;
+	if (callbacks_count == 0) {
+		memset(callbacks_hash, MQTT_HASH_EMPTY, sizeof(callbacks_hash));
+	}
 
-	if (callbacks[callbacks_count].topic) {
-		LOGI(LOG_MQTT, "Client subscribed on topic %s", callbacks[callbacks_count].topic);
-	} else {
-		LOGE(LOG_MQTT, "Cant allocate memory to subscribe on topic %s%s", CONFIG_MQTT_TOPICS_PREFIX, topic);
+	uint8_t index = callbacks_count;
+	mqtt_callback_mapping_t * entry = &callbacks[index];
+	entry->topic       = topic;
+	entry->topic_len   = topic_len;
+	entry->hash        = mqtt_topic_hash(topic, topic_len);
+	entry->wildcard    = wildcard;
+	entry->function    = callback;
+	entry->logmessages = logmessages;
+	entry->arg         = arg;
+
+	if (!wildcard) {
+		uint32_t bucket = entry->hash;
+		while (callbacks_hash[bucket & (MQTT_HASH_BUCKETS - 1)] != MQTT_HASH_EMPTY) {
+			bucket++;
+		}
+		callbacks_hash[bucket & (MQTT_HASH_BUCKETS - 1)] = index;
 	}
 
 	callbacks_count++;
+
+	LOGI(LOG_MQTT, "Client subscribed on topic %s", topic);
 }
 
 void mqtt_start() {
 	client = NULL;
 
+#if CONFIG_MQTT_JOURNAL_ENABLED
+	xTaskCreate(mqtt_journal_task, "mqtt journal replay", 3072, NULL, 5, &mqtt_journal_task_handle);
+	diag_register_task(mqtt_journal_task_handle);
+#endif
+
 	esp_mqtt_client_config_t mqtt_cfg = {
 		.broker.address.uri = CONFIG_MQTT_BROKER_URI,
 		.credentials = {
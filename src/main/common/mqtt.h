@@ -2,15 +2,29 @@
 #define MAIN_COMMON_MQTT_H_
 
 #include "stdbool.h"
+#include "stddef.h"
+#include "sdkconfig.h"
 
-typedef void (* mqtt_topic_callback_t)(const char * data, void * arg);
+// Full topic name, built at compile time: MQTT_TOPIC(CONFIG_LED_TOPIC_COMMANDS).
+// All mqtt_* functions take full topics, the prefix is never added at runtime.
+#define MQTT_TOPIC(topic) CONFIG_MQTT_TOPICS_PREFIX topic
+
+// data is not NUL-terminated and is valid only during the call.
+typedef void (* mqtt_topic_callback_t)(const char * data, size_t len, void * arg);
 
 void mqtt_start();
 
+// Topic ending with "/#" subscribes to the whole subtree. The topic string is not copied
+// and must stay valid, normally it is a MQTT_TOPIC() literal.
 void mqtt_subscribe(const char * topic, mqtt_topic_callback_t callback, void * arg);
 void mqtt_subscribe_nolog(const char * topic, mqtt_topic_callback_t callback, void * arg);
+// Telemetry: journaled while offline (CONFIG_MQTT_JOURNAL_ENABLED) and published after the journal replay
 void mqtt_publish(const char * topic, const char * message);
+// Events: published right away or dropped, never journaled
 void mqtt_publish_sync(const char * topic, const char * message);
+// Command replies and other messages which make no sense later: never journaled
+void mqtt_publish_nojournal(const char * topic, const char * message);
+// Never logged nor journaled
 void mqtt_publish_nolog(const char * topic, const char * message);
 
 #endif /* MAIN_COMMON_MQTT_H_ */
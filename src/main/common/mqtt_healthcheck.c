@@ -18,15 +18,18 @@ uint8_t mqtt_healthcheck_errors_count = 0;
 uint8_t mqtt_healthcheck_sended_counter = 0;
 uint8_t mqtt_healthcheck_received_counter = 0;
 
-void mqtt_healthcheck_events(const char * data, void *) {
-	if (strcmp(data, "restart") == 0) {
+void mqtt_healthcheck_events(const char * data, size_t len, void *) {
+	if (len == 7 && strncmp(data, "restart", 7) == 0) {
 		// remove 'restart' from MQTT topic to avoid infinite restart loop
-		mqtt_publish_sync(CONFIG_MQTT_HEALTHCHECK_TOPIC, "-1");
+		mqtt_publish_sync(MQTT_TOPIC(CONFIG_MQTT_HEALTHCHECK_TOPIC), "-1");
 
-		LOGE(LOG_MQTT, "Healthcheck received %s command. Restart!", data);
+		LOGE(LOG_MQTT, "Healthcheck received restart command. Restart!");
 		esp_restart();
-	} else {
-		int v = atoi(data);
+	} else if (len > 0 && len < 5) {
+		char value[5] = { 0 };
+		memcpy(value, data, len);
+
+		int v = atoi(value);
 		if (v >= 0) {
 			mqtt_healthcheck_received_counter = v;
 		}
@@ -50,7 +53,7 @@ void mqtt_healthcheck_task(void* arg) {
 	char message[5];
 	memset(message, 0, 5);
 	snprintf(message, 5, "%d", mqtt_healthcheck_sended_counter);
-	mqtt_publish_nolog(CONFIG_MQTT_HEALTHCHECK_TOPIC, message);
+	mqtt_publish_nolog(MQTT_TOPIC(CONFIG_MQTT_HEALTHCHECK_TOPIC), message);
 }
 
 void mqtt_healthcheck_init() {
@@ -58,7 +61,7 @@ void mqtt_healthcheck_init() {
 	mqtt_healthcheck_sended_counter = 0;
 	mqtt_healthcheck_received_counter = 0;
 
-	mqtt_subscribe_nolog(CONFIG_MQTT_HEALTHCHECK_TOPIC, mqtt_healthcheck_events, NULL);
+	mqtt_subscribe_nolog(MQTT_TOPIC(CONFIG_MQTT_HEALTHCHECK_TOPIC), mqtt_healthcheck_events, NULL);
 
 	esp_timer_create_args_t periodic_timer_args = {
 			.callback = &mqtt_healthcheck_task,
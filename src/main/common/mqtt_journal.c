@@ -0,0 +1,201 @@
+#include "mqtt_journal.h"
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "string.h"
+#include "time.h"
+
+#include "wifi.h"
+#include "../log/log.h"
+
+// "JRN2": records hold full (prefixed) topics
+#define MQTT_JOURNAL_MAGIC 0x4A524E32
+
+typedef struct {
+	uint32_t timestamp;
+	uint16_t topic_len;
+	uint16_t message_len;
+} mqtt_journal_record_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t used;
+	uint32_t count;
+	uint8_t data[CONFIG_MQTT_JOURNAL_SIZE];
+} mqtt_journal_t;
+
+// not cleared on esp_restart(), so the healthcheck reboot does not lose queued data
+static __NOINIT_ATTR mqtt_journal_t mqtt_journal;
+
+static StaticSemaphore_t mqtt_journal_mutex_buffer;
+static SemaphoreHandle_t mqtt_journal_mutex = NULL;
+
+static void mqtt_journal_clear() {
+	mqtt_journal.magic = MQTT_JOURNAL_MAGIC;
+	mqtt_journal.head  = 0;
+	mqtt_journal.tail  = 0;
+	mqtt_journal.used  = 0;
+	mqtt_journal.count = 0;
+}
+
+static void mqtt_journal_write(uint32_t offset, const void * src, uint32_t len) {
+	uint32_t first = CONFIG_MQTT_JOURNAL_SIZE - offset;
+	if (first > len) {
+		first = len;
+	}
+
+	memcpy(mqtt_journal.data + offset, src, first);
+	memcpy(mqtt_journal.data, (const uint8_t *)src + first, len - first);
+}
+
+static void mqtt_journal_read(uint32_t offset, void * dst, uint32_t len) {
+	uint32_t first = CONFIG_MQTT_JOURNAL_SIZE - offset;
+	if (first > len) {
+		first = len;
+	}
+
+	memcpy(dst, mqtt_journal.data + offset, first);
+	memcpy((uint8_t *)dst + first, mqtt_journal.data, len - first);
+}
+
+static uint32_t mqtt_journal_advance(uint32_t offset, uint32_t len) {
+	return (offset + len) % CONFIG_MQTT_JOURNAL_SIZE;
+}
+
+static void mqtt_journal_drop_oldest() {
+	mqtt_journal_record_t record;
+	mqtt_journal_read(mqtt_journal.tail, &record, sizeof(record));
+
+	uint32_t size = sizeof(record) + record.topic_len + record.message_len;
+	mqtt_journal.tail = mqtt_journal_advance(mqtt_journal.tail, size);
+	mqtt_journal.used -= size;
+	mqtt_journal.count--;
+}
+
+static bool mqtt_journal_is_consistent() {
+	if (mqtt_journal.magic != MQTT_JOURNAL_MAGIC || mqtt_journal.head >= CONFIG_MQTT_JOURNAL_SIZE
+			|| mqtt_journal.tail >= CONFIG_MQTT_JOURNAL_SIZE || mqtt_journal.used > CONFIG_MQTT_JOURNAL_SIZE) {
+		return false;
+	}
+
+	uint32_t offset = mqtt_journal.tail;
+	uint32_t used = 0;
+	for (uint32_t i = 0; i<mqtt_journal.count; i++) {
+		if (used + sizeof(mqtt_journal_record_t) > mqtt_journal.used) {
+			return false;
+		}
+
+		mqtt_journal_record_t record;
+		mqtt_journal_read(offset, &record, sizeof(record));
+		if (record.topic_len == 0 || record.topic_len >= MQTT_JOURNAL_MAX_TOPIC || record.message_len >= MQTT_JOURNAL_MAX_MESSAGE) {
+			return false;
+		}
+
+		uint32_t size = sizeof(record) + record.topic_len + record.message_len;
+		offset = mqtt_journal_advance(offset, size);
+		used += size;
+	}
+
+	return used == mqtt_journal.used && offset == mqtt_journal.head;
+}
+
+void mqtt_journal_init() {
+	mqtt_journal_mutex = xSemaphoreCreateMutexStatic(&mqtt_journal_mutex_buffer);
+
+	esp_reset_reason_t reason = esp_reset_reason();
+	if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT || !mqtt_journal_is_consistent()) {
+		mqtt_journal_clear();
+	} else if (mqtt_journal.count > 0) {
+		LOGI(LOG_MQTT, "Journal restored: %lu messages, %lu bytes", mqtt_journal.count, mqtt_journal.used);
+	}
+}
+
+bool mqtt_journal_store(const char * topic, const char * message) {
+	if (mqtt_journal_mutex == NULL || topic == NULL || message == NULL) {
+		return false;
+	}
+
+	mqtt_journal_record_t record = {
+		.timestamp   = wifi_time_valid() ? (uint32_t)time(NULL) : 0,
+		.topic_len   = strlen(topic),
+		.message_len = strlen(message),
+	};
+
+	if (record.topic_len == 0 || record.topic_len >= MQTT_JOURNAL_MAX_TOPIC || record.message_len >= MQTT_JOURNAL_MAX_MESSAGE) {
+		return false;
+	}
+
+	uint32_t size = sizeof(record) + record.topic_len + record.message_len;
+
+	xSemaphoreTake(mqtt_journal_mutex, portMAX_DELAY);
+
+	while (mqtt_journal.used + size > CONFIG_MQTT_JOURNAL_SIZE) {
+		mqtt_journal_drop_oldest();
+	}
+
+	uint32_t offset = mqtt_journal.head;
+	mqtt_journal_write(offset, &record, sizeof(record));
+	offset = mqtt_journal_advance(offset, sizeof(record));
+	mqtt_journal_write(offset, topic, record.topic_len);
+	offset = mqtt_journal_advance(offset, record.topic_len);
+	mqtt_journal_write(offset, message, record.message_len);
+
+	mqtt_journal.head = mqtt_journal_advance(offset, record.message_len);
+	mqtt_journal.used += size;
+	mqtt_journal.count++;
+
+	xSemaphoreGive(mqtt_journal_mutex);
+
+	return true;
+}
+
+uint32_t mqtt_journal_count() {
+	return mqtt_journal_mutex ? mqtt_journal.count : 0;
+}
+
+bool mqtt_journal_peek(char * topic, char * message, uint32_t * timestamp) {
+	if (mqtt_journal_mutex == NULL) {
+		return false;
+	}
+
+	xSemaphoreTake(mqtt_journal_mutex, portMAX_DELAY);
+
+	bool result = mqtt_journal.count > 0;
+	if (result) {
+		mqtt_journal_record_t record;
+		mqtt_journal_read(mqtt_journal.tail, &record, sizeof(record));
+
+		uint32_t offset = mqtt_journal_advance(mqtt_journal.tail, sizeof(record));
+		mqtt_journal_read(offset, topic, record.topic_len);
+		topic[record.topic_len] = 0;
+
+		offset = mqtt_journal_advance(offset, record.topic_len);
+		mqtt_journal_read(offset, message, record.message_len);
+		message[record.message_len] = 0;
+
+		*timestamp = record.timestamp;
+	}
+
+	xSemaphoreGive(mqtt_journal_mutex);
+
+	return result;
+}
+
+void mqtt_journal_pop() {
+	if (mqtt_journal_mutex == NULL) {
+		return;
+	}
+
+	xSemaphoreTake(mqtt_journal_mutex, portMAX_DELAY);
+
+	if (mqtt_journal.count > 0) {
+		mqtt_journal_drop_oldest();
+	}
+
+	xSemaphoreGive(mqtt_journal_mutex);
+}
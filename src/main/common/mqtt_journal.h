@@ -0,0 +1,25 @@
+#ifndef MAIN_COMMON_MQTT_JOURNAL_H_
+#define MAIN_COMMON_MQTT_JOURNAL_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+// Offline telemetry journal: messages which could not be published are kept
+// in a RAM ring (survives software restarts) and replayed after reconnect.
+
+#define MQTT_JOURNAL_MAX_TOPIC   64
+#define MQTT_JOURNAL_MAX_MESSAGE 512
+
+void mqtt_journal_init();
+
+// Oldest records are dropped when the ring is full.
+bool mqtt_journal_store(const char * topic, const char * message);
+
+uint32_t mqtt_journal_count();
+
+// Copies the oldest record (NUL-terminated) without removing it. timestamp is 0 if time was not synced.
+bool mqtt_journal_peek(char * topic, char * message, uint32_t * timestamp);
+void mqtt_journal_pop();
+
+#endif /* MAIN_COMMON_MQTT_JOURNAL_H_ */
@@ -36,11 +36,12 @@ void mqtt_ota_upgrade(void * arg) {
     vTaskDelete(NULL);
 }
 
-void mqtt_ota_commands(const char * data, void *) {
-	if (strncmp(data, "https://", 8) == 0) {
-		char * url = malloc(strlen(data) + 1);
+void mqtt_ota_commands(const char * data, size_t len, void *) {
+	if (len > 8 && strncmp(data, "https://", 8) == 0) {
+		char * url = malloc(len + 1);
 		if (url != NULL) {
-			strcpy(url, data);
+			memcpy(url, data, len);
+			url[len] = 0;
 			xTaskCreate(mqtt_ota_upgrade, "Perform OTA upgrade", 4096, url, 10, NULL);
 		}
 	}
@@ -49,7 +50,7 @@ void mqtt_ota_commands(const char * data, void *) {
 
 void mqtt_ota_init() {
 #if CONFIG_MQTT_OTA_ENABLED
-	mqtt_subscribe(CONFIG_MQTT_OTA_TOPIC, mqtt_ota_commands, NULL);
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_MQTT_OTA_TOPIC), mqtt_ota_commands, NULL);
 #endif
 }
 
@@ -67,7 +68,7 @@ void mqtt_ota_on_started() {
 	esp_app_desc_t running_app_info;
 	if (esp_ota_get_partition_description(running, &running_app_info) == ESP_OK) {
 		LOGI(LOG_OTA, "Running firmware version: %s", running_app_info.version);
-		mqtt_publish(CONFIG_MQTT_OTA_VERSION_TOPIC, running_app_info.version);
+		mqtt_publish(MQTT_TOPIC(CONFIG_MQTT_OTA_VERSION_TOPIC), running_app_info.version);
 	}
 #endif
 }
@@ -110,14 +110,10 @@ esp_err_t nvs_write_buffer(const char* name, const uint8_t* buffer, size_t buffe
 }
 
 uint32_t nvs_read_32t(const char* name, uint32_t default_value) {
-	size_t size = sizeof(uint32_t);
-	uint8_t * buffer = (uint8_t *)malloc(size);
-	if (buffer == NULL) {
-		return default_value;
-	}
+	size_t size = 0;
+	uint8_t * buffer = NULL;
 
 	if (nvs_read_buffer(name, &buffer, &size)) {
-		free(buffer);
 		return default_value;
 	}
 
@@ -137,21 +133,13 @@ uint32_t nvs_read_32t(const char* name, uint32_t default_value) {
 }
 
 esp_err_t nvs_write_32t(const char* name, uint32_t value) {
-	size_t size = sizeof(uint32_t);
-	uint8_t * buffer = (uint8_t *)malloc(size);
-	if (buffer == NULL) {
-		return ESP_ERR_NO_MEM;
-	}
+	uint8_t buffer[sizeof(uint32_t)];
 
-	for (int8_t i = size - 1; i>=0; i--) {
-		buffer[i] = (value % 0xFF);
+	for (int8_t i = sizeof(buffer) - 1; i>=0; i--) {
+		buffer[i] = (value & 0xFF);
 		value = value >> 8;
 	}
 
-	esp_err_t res = nvs_write_buffer(name, buffer, size);
-
-	free(buffer);
-
-	return res;
+	return nvs_write_buffer(name, buffer, sizeof(buffer));
 }
 
@@ -0,0 +1,131 @@
+#include "profiler.h"
+
+#if CONFIG_PROFILER_ENABLED
+
+#include "string.h"
+#include "freertos/FreeRTOS.h"
+#include "cJSON.h"
+
+#include "mqtt.h"
+#include "../log/log.h"
+
+#define PROFILER_BUCKETS 10
+
+typedef struct {
+	uint32_t count;
+	uint32_t max;
+	uint64_t total;
+	uint32_t buckets[PROFILER_BUCKETS];
+} profiler_histogram_t;
+
+static const char * profiler_span_names[PROFILER_SPAN_MAX] = {
+	[PROFILER_SPAN_I2C]       = "i2c",
+	[PROFILER_SPAN_UART]      = "uart",
+	[PROFILER_SPAN_ADC]       = "adc",
+	[PROFILER_SPAN_GAS_INDEX] = "gas_index",
+	[PROFILER_SPAN_JSON]      = "json",
+	[PROFILER_SPAN_PUBLISH]   = "publish",
+	[PROFILER_SPAN_TOUCHPAD]  = "touchpad",
+	[PROFILER_SPAN_LED]       = "led",
+};
+
+// upper bounds in us, the last bucket takes everything above
+static const uint32_t profiler_bucket_limits[PROFILER_BUCKETS - 1] = { 10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000 };
+
+static profiler_histogram_t profiler_histograms[PROFILER_SPAN_MAX];
+static portMUX_TYPE profiler_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void profiler_record(profiler_span_t span, int64_t duration_us) {
+	if (span >= PROFILER_SPAN_MAX) {
+		return;
+	}
+
+	uint32_t duration = duration_us < 0 ? 0 : (duration_us > UINT32_MAX ? UINT32_MAX : duration_us);
+
+	uint8_t bucket = 0;
+	while (bucket < PROFILER_BUCKETS - 1 && duration > profiler_bucket_limits[bucket]) {
+		bucket++;
+	}
+
+	portENTER_CRITICAL(&profiler_lock);
+	profiler_histogram_t * histogram = &profiler_histograms[span];
+	histogram->count++;
+	histogram->total += duration;
+	if (duration > histogram->max) {
+		histogram->max = duration;
+	}
+	histogram->buckets[bucket]++;
+	portEXIT_CRITICAL(&profiler_lock);
+}
+
+void profiler_scope_end(profiler_scope_t * scope) {
+	profiler_record(scope->span, esp_timer_get_time() - scope->started);
+}
+
+// {"buckets":[10,50,...],"spans":{"i2c":{"count":n,"avg":us,"max":us,"hist":[n,...]},...}}
+// hist has one more element than buckets: durations above the last limit.
+// No "type": the reply goes to the command topic and the broker echoes it back.
+static void profiler_reply() {
+	profiler_histogram_t histograms[PROFILER_SPAN_MAX];
+	portENTER_CRITICAL(&profiler_lock);
+	memcpy(histograms, profiler_histograms, sizeof(histograms));
+	portEXIT_CRITICAL(&profiler_lock);
+
+	cJSON * root = cJSON_CreateObject();
+
+	cJSON * buckets = cJSON_AddArrayToObject(root, "buckets");
+	for (uint8_t i = 0; i<PROFILER_BUCKETS - 1; i++) {
+		cJSON_AddItemToArray(buckets, cJSON_CreateNumber(profiler_bucket_limits[i]));
+	}
+
+	cJSON * spans = cJSON_AddObjectToObject(root, "spans");
+	for (uint8_t i = 0; i<PROFILER_SPAN_MAX; i++) {
+		profiler_histogram_t * histogram = &histograms[i];
+		if (histogram->count == 0) {
+			continue;
+		}
+
+		cJSON * span = cJSON_AddObjectToObject(spans, profiler_span_names[i]);
+		cJSON_AddNumberToObject(span, "count", histogram->count);
+		cJSON_AddNumberToObject(span, "avg", histogram->total / histogram->count);
+		cJSON_AddNumberToObject(span, "max", histogram->max);
+
+		cJSON * hist = cJSON_AddArrayToObject(span, "hist");
+		for (uint8_t j = 0; j<PROFILER_BUCKETS; j++) {
+			cJSON_AddItemToArray(hist, cJSON_CreateNumber(histogram->buckets[j]));
+		}
+	}
+
+	char * json = cJSON_PrintUnformatted(root);
+	if (json) {
+		mqtt_publish_nojournal(MQTT_TOPIC(CONFIG_PROFILER_TOPIC_COMMAND), json);
+		cJSON_free(json);
+	}
+
+	cJSON_Delete(root);
+}
+
+static void profiler_commands(const char * data, size_t len, void *) {
+	cJSON * root = cJSON_ParseWithLength(data, len);
+	if (root == NULL) {
+		return;
+	}
+
+	char * type = cJSON_GetStringValue(cJSON_GetObjectItem(root, "type"));
+	if (type && strcmp(type, "profiler") == 0) {
+		profiler_reply();
+	} else if (type && strcmp(type, "profiler_reset") == 0) {
+		portENTER_CRITICAL(&profiler_lock);
+		memset(profiler_histograms, 0, sizeof(profiler_histograms));
+		portEXIT_CRITICAL(&profiler_lock);
+		LOGI(LOG_MQTT, "Profiler histograms cleared");
+	}
+
+	cJSON_Delete(root);
+}
+
+void profiler_init() {
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_PROFILER_TOPIC_COMMAND), profiler_commands, NULL);
+}
+
+#endif
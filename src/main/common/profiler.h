@@ -0,0 +1,51 @@
+#ifndef MAIN_COMMON_PROFILER_H_
+#define MAIN_COMMON_PROFILER_H_
+
+#include "stdint.h"
+#include "sdkconfig.h"
+
+// Latency histograms of named spans. {"type":"profiler"} on CONFIG_PROFILER_TOPIC_COMMAND replies
+// with the histograms, {"type":"profiler_reset"} clears them.
+// Without CONFIG_PROFILER_ENABLED the macros below compile to nothing.
+
+typedef enum {
+	PROFILER_SPAN_I2C = 0,
+	PROFILER_SPAN_UART,
+	PROFILER_SPAN_ADC,
+	PROFILER_SPAN_GAS_INDEX,
+	PROFILER_SPAN_JSON,
+	PROFILER_SPAN_PUBLISH,
+	PROFILER_SPAN_TOUCHPAD,
+	PROFILER_SPAN_LED,
+
+	PROFILER_SPAN_MAX
+} profiler_span_t;
+
+#if CONFIG_PROFILER_ENABLED
+#include "esp_timer.h"
+
+typedef struct {
+	profiler_span_t span;
+	int64_t started;
+} profiler_scope_t;
+
+void profiler_init();
+void profiler_record(profiler_span_t span, int64_t duration_us);
+void profiler_scope_end(profiler_scope_t * scope);
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b)  PROFILER_CONCAT_(a, b)
+
+// Times the rest of the enclosing block, early returns included
+#define PROFILER_SCOPE(span) \
+	profiler_scope_t PROFILER_CONCAT(profiler_scope_, __LINE__) __attribute__((cleanup(profiler_scope_end))) = { (span), esp_timer_get_time() }
+
+#define PROFILER_START(name)      int64_t name = esp_timer_get_time()
+#define PROFILER_STOP(span, name) profiler_record((span), esp_timer_get_time() - (name))
+#else
+#define PROFILER_SCOPE(span)
+#define PROFILER_START(name)
+#define PROFILER_STOP(span, name)
+#endif
+
+#endif /* MAIN_COMMON_PROFILER_H_ */
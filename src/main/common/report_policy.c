@@ -0,0 +1,164 @@
+#include "report_policy.h"
+
+#include "esp_timer.h"
+#include "string.h"
+#include "stdio.h"
+#include "math.h"
+
+#include "mqtt.h"
+#include "nvs_rw.h"
+#include "../cjson/cjson_helper.h"
+#include "../log/log.h"
+
+#define REPORT_POLICY_NVS_VERSION 1
+
+typedef struct {
+	uint8_t version;
+	uint8_t fields_count;
+	uint32_t min_interval;
+	uint32_t max_silence;
+	report_policy_deadband_t deadbands[REPORT_POLICY_MAX_FIELDS];
+} report_policy_nvs_t;
+
+static void report_policy_load(report_policy_t * policy) {
+	size_t buffer_size = 0;
+	uint8_t * buffer = NULL;
+
+	if (nvs_read_buffer(policy->nvs_name, &buffer, &buffer_size) != ESP_OK) {
+		return;
+	}
+
+	report_policy_nvs_t stored;
+	bool valid = (buffer_size == sizeof(report_policy_nvs_t));
+	if (valid) {
+		memcpy(&stored, buffer, sizeof(report_policy_nvs_t));
+	}
+	free(buffer);
+
+	if (!valid || stored.version != REPORT_POLICY_NVS_VERSION || stored.fields_count != policy->fields_count) {
+		LOGW(LOG_MQTT, "Bad report policy %s in NVS", policy->nvs_name);
+		return;
+	}
+
+	policy->min_interval = stored.min_interval;
+	policy->max_silence = stored.max_silence;
+	memcpy(policy->deadbands, stored.deadbands, sizeof(policy->deadbands));
+}
+
+static void report_policy_save(report_policy_t * policy) {
+	report_policy_nvs_t stored = {
+		.version = REPORT_POLICY_NVS_VERSION,
+		.fields_count = policy->fields_count,
+		.min_interval = policy->min_interval,
+		.max_silence = policy->max_silence,
+	};
+	memcpy(stored.deadbands, policy->deadbands, sizeof(stored.deadbands));
+
+	esp_err_t res = nvs_write_buffer(policy->nvs_name, (const uint8_t *)&stored, sizeof(report_policy_nvs_t));
+	if (res != ESP_OK) {
+		LOGE(LOG_MQTT, "Cant store report policy %s: %04X", policy->nvs_name, res);
+	}
+}
+
+void report_policy_init(report_policy_t * policy, const char * name, const char * const * field_names, uint8_t fields_count, const report_policy_deadband_t * deadbands) {
+	memset(policy, 0, sizeof(report_policy_t));
+
+	snprintf(policy->nvs_name, sizeof(policy->nvs_name), "%s_rp", name);
+	policy->field_names = field_names;
+	policy->fields_count = fields_count > REPORT_POLICY_MAX_FIELDS ? REPORT_POLICY_MAX_FIELDS : fields_count;
+	policy->max_silence = REPORT_POLICY_DEFAULT_MAX_SILENCE;
+	memcpy(policy->deadbands, deadbands, sizeof(report_policy_deadband_t) * policy->fields_count);
+
+	report_policy_load(policy);
+}
+
+static bool report_policy_changed(const report_policy_deadband_t * deadband, float last, float value) {
+	float delta = fabsf(value - last);
+
+	if (deadband->absolute <= 0 && deadband->relative <= 0) {
+		return delta > 0;
+	}
+
+	// delta > 0: from a last value of 0 the relative deadband is 0 as well
+	return (deadband->absolute > 0 && delta >= deadband->absolute)
+			|| (deadband->relative > 0 && delta > 0 && delta >= fabsf(last) * deadband->relative / 100);
+}
+
+bool report_policy_check(report_policy_t * policy, const float * values) {
+	int64_t now = esp_timer_get_time();
+	int64_t elapsed = (now - policy->published_at) / 1000000;
+
+	bool publish = !policy->published;
+	if (!publish && elapsed >= policy->min_interval) {
+		publish = policy->max_silence && elapsed >= policy->max_silence;
+
+		for (uint8_t i = 0; i<policy->fields_count && !publish; i++) {
+			publish = report_policy_changed(&policy->deadbands[i], policy->last[i], values[i]);
+		}
+	}
+
+	if (publish) {
+		memcpy(policy->last, values, sizeof(float) * policy->fields_count);
+		policy->published_at = now;
+		policy->published = true;
+	}
+
+	return publish;
+}
+
+// {"type":"report_policy","min_interval":0,"max_silence":300,"fields":{"co2":{"abs":20,"rel":0}}}
+// Every key is optional, the reply contains the resulting settings. NVS is written only on a change.
+bool report_policy_command(report_policy_t * policy, cJSON * root, const char * reply_topic) {
+	char * type = cJSON_GetStringValue(cJSON_GetObjectItem(root, "type"));
+	if (type == NULL || strcmp(type, "report_policy") != 0) {
+		return false;
+	}
+
+	uint32_t min_interval = get_number32_from_json(cJSON_GetObjectItem(root, "min_interval"), policy->min_interval);
+	uint32_t max_silence = get_number32_from_json(cJSON_GetObjectItem(root, "max_silence"), policy->max_silence);
+	bool changed = min_interval != policy->min_interval || max_silence != policy->max_silence;
+	policy->min_interval = min_interval;
+	policy->max_silence = max_silence;
+
+	cJSON * fields = cJSON_GetObjectItem(root, "fields");
+	for (uint8_t i = 0; fields && i<policy->fields_count; i++) {
+		cJSON * field = cJSON_GetObjectItem(fields, policy->field_names[i]);
+		if (field) {
+			report_policy_deadband_t deadband = {
+				.absolute = get_float_from_json(cJSON_GetObjectItem(field, "abs"), policy->deadbands[i].absolute),
+				.relative = get_float_from_json(cJSON_GetObjectItem(field, "rel"), policy->deadbands[i].relative),
+			};
+			if (deadband.absolute != policy->deadbands[i].absolute || deadband.relative != policy->deadbands[i].relative) {
+				policy->deadbands[i] = deadband;
+				changed = true;
+			}
+		}
+	}
+
+	if (changed) {
+		report_policy_save(policy);
+		policy->published = false;
+	}
+
+	// no "type" in the reply: the broker echoes it back on the command topic
+	cJSON * reply = cJSON_CreateObject();
+	cJSON_AddNumberToObject(reply, "min_interval", policy->min_interval);
+	cJSON_AddNumberToObject(reply, "max_silence", policy->max_silence);
+
+	cJSON * reply_fields = cJSON_AddObjectToObject(reply, "fields");
+	for (uint8_t i = 0; i<policy->fields_count; i++) {
+		cJSON * field = cJSON_AddObjectToObject(reply_fields, policy->field_names[i]);
+		cJSON_AddNumberToObject(field, "abs", policy->deadbands[i].absolute);
+		cJSON_AddNumberToObject(field, "rel", policy->deadbands[i].relative);
+	}
+
+	char * json = cJSON_PrintUnformatted(reply);
+	if (json) {
+		mqtt_publish_nojournal(reply_topic, json);
+		cJSON_free(json);
+	}
+
+	cJSON_Delete(reply);
+
+	return true;
+}
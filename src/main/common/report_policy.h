@@ -0,0 +1,41 @@
+#ifndef MAIN_COMMON_REPORT_POLICY_H_
+#define MAIN_COMMON_REPORT_POLICY_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "cJSON.h"
+
+// Report-on-change: a reading is published only when a field moved out of its deadband
+// (and min_interval passed), or when nothing was published for max_silence seconds.
+// Settings are changed with {"type":"report_policy", ...} on the sensor command topic and kept in NVS.
+
+#define REPORT_POLICY_MAX_FIELDS          12
+#define REPORT_POLICY_DEFAULT_MAX_SILENCE 300
+
+typedef struct {
+	float absolute;	// 0 - disabled
+	float relative;	// percent of the last published value, 0 - disabled. Both disabled: any change.
+} report_policy_deadband_t;
+
+typedef struct {
+	char nvs_name[16];
+	const char * const * field_names;
+	uint8_t fields_count;
+	uint32_t min_interval;	// sec
+	uint32_t max_silence;	// sec, 0 - no heartbeat
+	report_policy_deadband_t deadbands[REPORT_POLICY_MAX_FIELDS];
+	float last[REPORT_POLICY_MAX_FIELDS];
+	int64_t published_at;
+	bool published;
+} report_policy_t;
+
+// name is used as NVS key prefix and must not be longer than 12 characters
+void report_policy_init(report_policy_t * policy, const char * name, const char * const * field_names, uint8_t fields_count, const report_policy_deadband_t * deadbands);
+
+// returns true if values must be published and remembers them as published
+bool report_policy_check(report_policy_t * policy, const float * values);
+
+// returns false if root is not a report_policy command
+bool report_policy_command(report_policy_t * policy, cJSON * root, const char * reply_topic);
+
+#endif /* MAIN_COMMON_REPORT_POLICY_H_ */
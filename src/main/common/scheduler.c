@@ -0,0 +1,247 @@
+#include "scheduler.h"
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "string.h"
+
+#include "cJSON.h"
+#include "mqtt.h"
+#include "diag.h"
+#include "../log/log.h"
+
+#define SCHEDULER_MAX_JOBS_PER_BUS   8
+#define SCHEDULER_TASK_STACK_SIZE    4096
+#define SCHEDULER_TASK_PRIORITY      5
+#define SCHEDULER_MUTEX_AWAIT        ((TickType_t) 100)
+
+typedef struct {
+	const char *             name;
+	scheduler_job_function_t function;
+	void *                   arg;
+	int64_t                  period;
+	int64_t                  deadline;
+
+	uint32_t count;
+	uint32_t overruns;
+	uint32_t duration_last;
+	uint32_t duration_max;
+	uint64_t duration_total;
+	uint32_t jitter_last;
+	uint32_t jitter_max;
+} scheduler_job_t;
+
+typedef struct {
+	const char *      task_name;
+	TaskHandle_t      task;
+	SemaphoreHandle_t mutex;
+	uint8_t           count;
+
+	// sorted by deadline, the nearest first
+	scheduler_job_t   jobs[SCHEDULER_MAX_JOBS_PER_BUS];
+} scheduler_bus_context_t;
+
+static scheduler_bus_context_t scheduler_buses[SCHEDULER_BUS_MAX] = {
+	[SCHEDULER_BUS_I2C]   = { .task_name = "scheduler i2c" },
+	[SCHEDULER_BUS_UART1] = { .task_name = "scheduler uart1" },
+	[SCHEDULER_BUS_UART2] = { .task_name = "scheduler uart2" },
+	[SCHEDULER_BUS_ADC]   = { .task_name = "scheduler adc" },
+	[SCHEDULER_BUS_SYSTEM] = { .task_name = "scheduler system" },
+};
+
+// move job at index to the position defined by its deadline
+static void scheduler_reorder(scheduler_bus_context_t * bus, uint8_t index) {
+	scheduler_job_t job = bus->jobs[index];
+
+	while (index + 1 < bus->count && bus->jobs[index + 1].deadline <= job.deadline) {
+		bus->jobs[index] = bus->jobs[index + 1];
+		index++;
+	}
+
+	while (index > 0 && bus->jobs[index - 1].deadline > job.deadline) {
+		bus->jobs[index] = bus->jobs[index - 1];
+		index--;
+	}
+
+	bus->jobs[index] = job;
+}
+
+static void scheduler_task(void * arg) {
+	scheduler_bus_context_t * bus = (scheduler_bus_context_t *)arg;
+	TickType_t tick_us = portTICK_PERIOD_MS * 1000;
+
+	while (true) {
+		xSemaphoreTake(bus->mutex, portMAX_DELAY);
+		scheduler_job_t job = bus->jobs[0];
+		xSemaphoreGive(bus->mutex);
+
+		int64_t now = esp_timer_get_time();
+		if (job.deadline > now) {
+			// round up: never start a job before its deadline
+			TickType_t ticks = (job.deadline - now + tick_us - 1) / tick_us;
+			ulTaskNotifyTake(pdTRUE, ticks);
+			continue;
+		}
+
+		int64_t started = esp_timer_get_time();
+		job.function(job.arg);
+		int64_t finished = esp_timer_get_time();
+
+		xSemaphoreTake(bus->mutex, portMAX_DELAY);
+
+		// job is still the first one: new jobs are only inserted with a later deadline
+		scheduler_job_t * current = &(bus->jobs[0]);
+		uint32_t duration = (uint32_t)(finished - started);
+		uint32_t jitter = (uint32_t)(started - current->deadline);
+
+		current->count++;
+		current->duration_last = duration;
+		current->duration_total += duration;
+		if (duration > current->duration_max) {
+			current->duration_max = duration;
+		}
+		current->jitter_last = jitter;
+		if (jitter > current->jitter_max) {
+			current->jitter_max = jitter;
+		}
+
+		current->deadline += current->period;
+		if (current->deadline <= finished) {
+			// skip missed periods instead of running the job back-to-back
+			current->overruns++;
+			current->deadline = finished + current->period;
+		}
+
+		scheduler_reorder(bus, 0);
+
+		xSemaphoreGive(bus->mutex);
+	}
+}
+
+esp_err_t scheduler_add(scheduler_bus_t bus_id, const char * name, uint32_t period_ms, scheduler_job_function_t function, void * arg) {
+	if (bus_id >= SCHEDULER_BUS_MAX || function == NULL || period_ms == 0) {
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	scheduler_bus_context_t * bus = &(scheduler_buses[bus_id]);
+	if (bus->mutex == NULL) {
+		bus->mutex = xSemaphoreCreateMutex();
+		if (bus->mutex == NULL) {
+			LOGE(LOG_SCHEDULER, "Cant create mutex for %s", bus->task_name);
+			return ESP_ERR_NO_MEM;
+		}
+	}
+
+	xSemaphoreTake(bus->mutex, portMAX_DELAY);
+
+	if (bus->count >= SCHEDULER_MAX_JOBS_PER_BUS) {
+		xSemaphoreGive(bus->mutex);
+		LOGE(LOG_SCHEDULER, "Cant add job %s: too many jobs on %s", name, bus->task_name);
+		return ESP_ERR_NO_MEM;
+	}
+
+	scheduler_job_t * job = &(bus->jobs[bus->count]);
+	memset(job, 0, sizeof(scheduler_job_t));
+	job->name = name;
+	job->function = function;
+	job->arg = arg;
+	job->period = (int64_t)period_ms * 1000;
+	job->deadline = esp_timer_get_time() + job->period;
+
+	bus->count++;
+	scheduler_reorder(bus, bus->count - 1);
+
+	xSemaphoreGive(bus->mutex);
+
+	if (bus->task == NULL) {
+		xTaskCreate(scheduler_task, bus->task_name, SCHEDULER_TASK_STACK_SIZE, bus, SCHEDULER_TASK_PRIORITY, &(bus->task));
+		if (bus->task == NULL) {
+			LOGE(LOG_SCHEDULER, "Cant start task %s", bus->task_name);
+			return ESP_ERR_NO_MEM;
+		}
+		diag_register_task(bus->task);
+	} else {
+		xTaskNotifyGive(bus->task);
+	}
+
+	LOGI(LOG_SCHEDULER, "Job %s added to %s, period %lu ms", name, bus->task_name, period_ms);
+
+	return ESP_OK;
+}
+
+uint8_t scheduler_get_stats(scheduler_bus_t bus_id, scheduler_job_stats_t * stats, uint8_t max_count) {
+	if (bus_id >= SCHEDULER_BUS_MAX) {
+		return 0;
+	}
+
+	scheduler_bus_context_t * bus = &(scheduler_buses[bus_id]);
+	if (bus->mutex == NULL || xSemaphoreTake(bus->mutex, SCHEDULER_MUTEX_AWAIT) != pdTRUE) {
+		return 0;
+	}
+
+	uint8_t count = (bus->count < max_count) ? bus->count : max_count;
+	for (uint8_t i = 0; i<count; i++) {
+		scheduler_job_t * job = &(bus->jobs[i]);
+		stats[i].name = job->name;
+		stats[i].period_ms = job->period / 1000;
+		stats[i].count = job->count;
+		stats[i].overruns = job->overruns;
+		stats[i].duration_last_us = job->duration_last;
+		stats[i].duration_max_us = job->duration_max;
+		stats[i].duration_avg_us = job->count ? (uint32_t)(job->duration_total / job->count) : 0;
+		stats[i].jitter_last_us = job->jitter_last;
+		stats[i].jitter_max_us = job->jitter_max;
+	}
+
+	xSemaphoreGive(bus->mutex);
+
+	return count;
+}
+
+static void scheduler_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
+	if (root == NULL) {
+		return;
+	}
+
+	char * type = cJSON_GetStringValue(cJSON_GetObjectItem(root, "type"));
+	if (type != NULL && strcmp(type, "stats") == 0) {
+		cJSON *reply = cJSON_CreateArray();
+		scheduler_job_stats_t stats[SCHEDULER_MAX_JOBS_PER_BUS];
+
+		for (uint8_t bus = 0; bus<SCHEDULER_BUS_MAX; bus++) {
+			uint8_t count = scheduler_get_stats(bus, stats, SCHEDULER_MAX_JOBS_PER_BUS);
+			for (uint8_t i = 0; i<count; i++) {
+				cJSON *item = cJSON_CreateObject();
+				cJSON_AddStringToObject(item, "bus", scheduler_buses[bus].task_name);
+				cJSON_AddStringToObject(item, "name", stats[i].name);
+				cJSON_AddNumberToObject(item, "period", stats[i].period_ms);
+				cJSON_AddNumberToObject(item, "count", stats[i].count);
+				cJSON_AddNumberToObject(item, "overruns", stats[i].overruns);
+				cJSON_AddNumberToObject(item, "duration_last", stats[i].duration_last_us);
+				cJSON_AddNumberToObject(item, "duration_avg", stats[i].duration_avg_us);
+				cJSON_AddNumberToObject(item, "duration_max", stats[i].duration_max_us);
+				cJSON_AddNumberToObject(item, "jitter_last", stats[i].jitter_last_us);
+				cJSON_AddNumberToObject(item, "jitter_max", stats[i].jitter_max_us);
+				cJSON_AddItemToArray(reply, item);
+			}
+		}
+
+		char * json = cJSON_PrintUnformatted(reply);
+		if (json) {
+			mqtt_publish_nojournal(MQTT_TOPIC(CONFIG_SCHEDULER_TOPIC_COMMAND), json);
+			cJSON_free(json);
+		}
+
+		cJSON_Delete(reply);
+	}
+
+	cJSON_Delete(root);
+}
+
+void scheduler_init() {
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_SCHEDULER_TOPIC_COMMAND), scheduler_commands, NULL);
+}
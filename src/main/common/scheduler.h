@@ -0,0 +1,40 @@
+#ifndef MAIN_COMMON_SCHEDULER_H_
+#define MAIN_COMMON_SCHEDULER_H_
+
+#include "stdint.h"
+#include "esp_err.h"
+
+// Periodic sensor jobs. Every bus has its own worker task, so a slow UART transaction
+// can't delay I2C sampling. Jobs of one bus run in deadline order.
+
+typedef enum {
+	SCHEDULER_BUS_I2C = 0,
+	SCHEDULER_BUS_UART1,
+	SCHEDULER_BUS_UART2,
+	SCHEDULER_BUS_ADC,
+	SCHEDULER_BUS_SYSTEM,	// jobs without own hardware: aggregation, reporting
+
+	SCHEDULER_BUS_MAX
+} scheduler_bus_t;
+
+typedef void (*scheduler_job_function_t)(void * arg);
+
+typedef struct {
+	const char * name;
+	uint32_t period_ms;
+	uint32_t count;
+	uint32_t overruns;
+	uint32_t duration_last_us;
+	uint32_t duration_max_us;
+	uint32_t duration_avg_us;
+	uint32_t jitter_last_us;
+	uint32_t jitter_max_us;
+} scheduler_job_stats_t;
+
+void scheduler_init();
+
+esp_err_t scheduler_add(scheduler_bus_t bus, const char * name, uint32_t period_ms, scheduler_job_function_t function, void * arg);
+
+uint8_t scheduler_get_stats(scheduler_bus_t bus, scheduler_job_stats_t * stats, uint8_t max_count);
+
+#endif /* MAIN_COMMON_SCHEDULER_H_ */
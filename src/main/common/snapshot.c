@@ -0,0 +1,150 @@
+#include "snapshot.h"
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "string.h"
+#include "time.h"
+
+#include "mqtt.h"
+#include "wifi.h"
+#include "scheduler.h"
+#include "../cjson/json_writer.h"
+#include "../log/log.h"
+
+#define SNAPSHOT_BUFFER_SIZE 1024
+
+typedef struct {
+	const char * name;
+	float value;
+	uint8_t decimals;
+	int64_t updated_at;
+} snapshot_field_t;
+
+static snapshot_field_t snapshot_fields[SNAPSHOT_MAX_FIELDS];
+static uint8_t snapshot_fields_count = 0;
+
+static StaticSemaphore_t snapshot_mutex_buffer;
+static SemaphoreHandle_t snapshot_mutex = NULL;
+
+static snapshot_field_t * snapshot_find(const char * name) {
+	for (uint8_t i = 0; i<snapshot_fields_count; i++) {
+		if (strcmp(snapshot_fields[i].name, name) == 0) {
+			return &snapshot_fields[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void snapshot_set(const char * name, float value, uint8_t decimals) {
+	if (snapshot_mutex == NULL) {
+		return;
+	}
+
+	xSemaphoreTake(snapshot_mutex, portMAX_DELAY);
+
+	snapshot_field_t * field = snapshot_find(name);
+	if (field == NULL && snapshot_fields_count < SNAPSHOT_MAX_FIELDS) {
+		field = &snapshot_fields[snapshot_fields_count++];
+		field->name = name;
+	}
+
+	if (field) {
+		field->value = value;
+		field->decimals = decimals;
+		field->updated_at = esp_timer_get_time();
+	} else {
+		LOGW(LOG_MQTT, "Snapshot is full, field %s ignored", name);
+	}
+
+	xSemaphoreGive(snapshot_mutex);
+}
+
+void snapshot_set_int(const char * name, int32_t value) {
+	snapshot_set(name, value, 0);
+}
+
+void snapshot_set_float(const char * name, float value, uint8_t decimals) {
+	snapshot_set(name, value, decimals);
+}
+
+bool snapshot_get(const char * name, float * value, uint32_t * age_ms) {
+	if (snapshot_mutex == NULL) {
+		return false;
+	}
+
+	xSemaphoreTake(snapshot_mutex, portMAX_DELAY);
+
+	snapshot_field_t * field = snapshot_find(name);
+	if (field) {
+		*value = field->value;
+		*age_ms = (esp_timer_get_time() - field->updated_at) / 1000;
+	}
+
+	xSemaphoreGive(snapshot_mutex);
+
+	return field != NULL;
+}
+
+#if CONFIG_SNAPSHOT_ENABLED
+// {"ts":<unix time or 0>,"<field>":<value>,...,"stale":["<field not updated for CONFIG_SNAPSHOT_STALE_AFTER>",...]}
+static void snapshot_publish(void *) {
+	static char buffer[SNAPSHOT_BUFFER_SIZE];
+
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_int(&writer, "ts", wifi_time_valid() ? (int32_t)time(NULL) : 0);
+
+	xSemaphoreTake(snapshot_mutex, portMAX_DELAY);
+
+	if (snapshot_fields_count == 0) {
+		xSemaphoreGive(snapshot_mutex);
+		return;
+	}
+
+	int64_t now = esp_timer_get_time();
+	bool stale[SNAPSHOT_MAX_FIELDS];
+	bool has_stale = false;
+
+	for (uint8_t i = 0; i<snapshot_fields_count; i++) {
+		snapshot_field_t * field = &snapshot_fields[i];
+		if (field->decimals) {
+			json_writer_add_float(&writer, field->name, field->value, field->decimals);
+		} else {
+			json_writer_add_int(&writer, field->name, (int32_t)field->value);
+		}
+
+		stale[i] = (now - field->updated_at) > (int64_t)CONFIG_SNAPSHOT_STALE_AFTER * 1000000;
+		has_stale |= stale[i];
+	}
+
+	if (has_stale) {
+		json_writer_begin_array(&writer, "stale");
+		for (uint8_t i = 0; i<snapshot_fields_count; i++) {
+			if (stale[i]) {
+				json_writer_add_array_string(&writer, snapshot_fields[i].name);
+			}
+		}
+		json_writer_end_array(&writer);
+	}
+
+	xSemaphoreGive(snapshot_mutex);
+
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(MQTT_TOPIC(CONFIG_SNAPSHOT_TOPIC), json);
+	} else {
+		LOGE(LOG_MQTT, "Snapshot does not fit into %d bytes", SNAPSHOT_BUFFER_SIZE);
+	}
+}
+#endif
+
+void snapshot_init() {
+	snapshot_mutex = xSemaphoreCreateMutexStatic(&snapshot_mutex_buffer);
+
+#if CONFIG_SNAPSHOT_ENABLED
+	scheduler_add(SCHEDULER_BUS_SYSTEM, "snapshot", CONFIG_SNAPSHOT_PERIOD * 1000, snapshot_publish, NULL);
+#endif
+}
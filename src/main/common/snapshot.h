@@ -0,0 +1,21 @@
+#ifndef MAIN_COMMON_SNAPSHOT_H_
+#define MAIN_COMMON_SNAPSHOT_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+// Latest value of every sensor field. Drivers update it after each reading,
+// with CONFIG_SNAPSHOT_ENABLED all fields are published together as one message.
+
+#define SNAPSHOT_MAX_FIELDS 32
+
+void snapshot_init();
+
+// name must be a string with static lifetime
+void snapshot_set_int(const char * name, int32_t value);
+void snapshot_set_float(const char * name, float value, uint8_t decimals);
+
+// returns false if the field was never set. age_ms is the time since the last update.
+bool snapshot_get(const char * name, float * value, uint32_t * age_ms);
+
+#endif /* MAIN_COMMON_SNAPSHOT_H_ */
@@ -2,17 +2,20 @@
 
 #include "../log/log.h"
 #include "string.h"
+#include "stdlib.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_smartconfig.h"
+#include "esp_sntp.h"
 #include "sdkconfig.h"
 
 #include "wifi_nvs.h"
 #include "mqtt.h"
 #include "cJSON.h"
+#include "time.h"
 
 #define WIFI_MAXIMUM_RETRY 30
 #define WIFI_CONNECTED_BIT 				BIT0
@@ -24,6 +27,9 @@
 #define WIFI_BG_RECONNECT_TASK_STACK_SIZE  2048
 #define WIFI_BG_RECONNECT_DELAY		 (30000 / portTICK_PERIOD_MS)
 
+// 2024-01-01: anything earlier is the default time after a power-on
+#define WIFI_TIME_VALID_AFTER 1704067200
+
 #define WIFI_CONNECT \
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config) ); \
     ESP_ERROR_CHECK(esp_wifi_start() ); \
@@ -77,8 +83,8 @@ static void event_handler(void* arg, esp_event_base_t event_base,
     }
 }
 
-void wifi_mqtt_listener(const char * data, void *) {
-	cJSON *root = cJSON_Parse(data);
+void wifi_mqtt_listener(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
 	if (root == NULL) {
 		return;
 	}
@@ -173,7 +179,19 @@ void wifi_init() {
 
 	xEventGroupSetBits(s_wifi_event_group, WIFI_ALLOW_BG_RECONNECT_BIT);
 
-    mqtt_subscribe(CONFIG_WIFI_TOPIC, wifi_mqtt_listener, NULL);
+	esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+	esp_sntp_setservername(0, CONFIG_WIFI_SNTP_SERVER);
+	esp_sntp_init();
+
+	// localtime_r() is UTC without it
+	setenv("TZ", CONFIG_WIFI_TZ, 1);
+	tzset();
+
+    mqtt_subscribe(MQTT_TOPIC(CONFIG_WIFI_TOPIC), wifi_mqtt_listener, NULL);
 
 	LOGI(LOG_WIFI, "WIFI configured");
 }
+
+bool wifi_time_valid() {
+	return time(NULL) > WIFI_TIME_VALID_AFTER;
+}
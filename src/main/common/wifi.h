@@ -1,6 +1,11 @@
 #ifndef MAIN_COMMON_WIFI_H_
 #define MAIN_COMMON_WIFI_H_
 
+#include "stdbool.h"
+
 void wifi_init();
 
+// system time is set: synced by SNTP or kept by RTC over a software restart
+bool wifi_time_valid();
+
 #endif /* MAIN_COMMON_WIFI_H_ */
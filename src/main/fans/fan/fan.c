@@ -2,6 +2,8 @@
 
 #include "../../cjson/cjson_helper.h"
 #include "../../common/mqtt.h"
+#include "../../fans/fan_tach/fan_tach.h"
+#include "../../fans/ventilation/ventilation.h"
 #include "../../log/log.h"
 
 #include "string.h"
@@ -12,22 +14,26 @@
 #define FAN_CHANGE_STATUS_DISABLED 0
 #define FAN_CHANGE_STATUS_NOT_SET  2
 
-esp_err_t fan_start();
-esp_err_t fan_stop();
-
-void fan_commands(const char * data, void *) {
-	cJSON *root = cJSON_Parse(data);
+void fan_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
 	if (root == NULL) {
 		return;
 	}
 
 	uint8_t state = get_boolean_from_json(cJSON_GetObjectItem(root, "state"), FAN_CHANGE_STATUS_ENABLED, FAN_CHANGE_STATUS_DISABLED, FAN_CHANGE_STATUS_NOT_SET);
 
+#if CONFIG_VENTILATION_ENABLED
+	// the ventilation control owns the fan, a direct command is a manual override
+	if (state != FAN_CHANGE_STATUS_NOT_SET) {
+		ventilation_override(state == FAN_CHANGE_STATUS_ENABLED);
+	}
+#else
 	if (state == FAN_CHANGE_STATUS_ENABLED) {
 		fan_start();
 	} else if (state == FAN_CHANGE_STATUS_DISABLED) {
 		fan_stop();
 	}
+#endif
 
 	cJSON_Delete(root);
 }
@@ -49,7 +55,7 @@ void fan_init() {
 
 	fan_stop();
 
-	mqtt_subscribe(CONFIG_FAN_TOPIC_DATA, fan_commands, NULL);
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_FAN_TOPIC_DATA), fan_commands, NULL);
 }
 
 
@@ -61,6 +67,10 @@ esp_err_t fan_start() {
 		LOGI(LOG_FAN, "HIGH level on pin %d activated.", CONFIG_FAN_GPIO);
 	}
 
+#if CONFIG_FANTACH_ENABLED && !CONFIG_FANTACH_FAN_PWM
+	fan_tach_set_running(res == ESP_OK);
+#endif
+
 	return res;
 }
 
@@ -72,6 +82,10 @@ esp_err_t fan_stop() {
 		LOGI(LOG_FAN, "LOW level on pin %d activated.", CONFIG_FAN_GPIO);
 	}
 
+#if CONFIG_FANTACH_ENABLED && !CONFIG_FANTACH_FAN_PWM
+	fan_tach_set_running(false);
+#endif
+
 	return res;
 }
 
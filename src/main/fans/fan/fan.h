@@ -1,6 +1,11 @@
 #ifndef MAIN_FAN_FAN_H_
 #define MAIN_FAN_FAN_H_
 
+#include "esp_err.h"
+
 void fan_init();
 
+esp_err_t fan_start();
+esp_err_t fan_stop();
+
 #endif /* MAIN_FAN_FAN_H_ */
@@ -1,25 +1,92 @@
 #include "../../fans/fan_pwm/fan_pwm.h"
 
 #include "fan_pwm_api.h"
+#include "fan_pwm_nvs.h"
 #include "../../cjson/cjson_helper.h"
 #include "../../fans/fan_pwm/fan_pwm_api.h"
+#include "../../fans/fan_tach/fan_tach.h"
+#include "../../fans/ventilation/ventilation.h"
 #include "../../common/mqtt.h"
 #include "../../log/log.h"
 
 #include "sdkconfig.h"
 
 #define FAN_PWM_NOCHANGE 250
+#define FAN_PWM_RPM_NOCHANGE 0xFFFFFFFF
 
-void fan_pwm_commands(const char * data, void *) {
-	cJSON *root = cJSON_Parse(data);
+// the ventilation control drives the cooler fan when there is no external one
+#define FAN_PWM_VENTILATION (CONFIG_VENTILATION_ENABLED && !CONFIG_FAN_ENABLED)
+
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+// integral term in percent, seeded from the open loop duty so switching to closed loop does not jump
+static volatile float fan_pwm_integral = 0;
+
+#if !FAN_PWM_VENTILATION
+static void fan_pwm_set_target(uint32_t rpm) {
+	if (rpm != 0 && fan_pwm_get_target_rpm() == 0) {
+		fan_pwm_integral = fan_pwm_nws_read();
+	}
+
+	fan_pwm_set_target_rpm(rpm);
+}
+#endif
+
+// PI controller, runs after every tachometer sample
+static void fan_pwm_control(uint32_t rpm, bool, void *) {
+	// fan_pwm_set_percent() clears the target: the loop stops as soon as anything sets the speed directly
+	uint32_t target = fan_pwm_get_target_rpm();
+	if (target == 0) {
+		return;
+	}
+
+	float error = (float) target - rpm;
+	float integral = fan_pwm_integral + error * CONFIG_FANPWM_PI_KI / 1000 * FAN_TACH_SAMPLE_PERIOD / 1000;
+
+	// anti-windup: the integral alone never asks for more than the output can give
+	if (integral < 0) {
+		integral = 0;
+	} else if (integral > 100) {
+		integral = 100;
+	}
+	fan_pwm_integral = integral;
+
+	float output = integral + error * CONFIG_FANPWM_PI_KP / 1000;
+	fan_pwm_set_output(output);
+}
+#endif
+
+void fan_pwm_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
 	if (root == NULL) {
 		return;
 	}
 
+#if FAN_PWM_VENTILATION
+	// the ventilation control owns this fan at CONFIG_VENTILATION_FAN_PERCENT: {"percent":x} is a manual
+	// override on or off, {"rpm":N} is not applied
+	uint8_t percent = get_number8_from_json(cJSON_GetObjectItem(root, "percent"), FAN_PWM_NOCHANGE);
+	if (percent != FAN_PWM_NOCHANGE) {
+		ventilation_override(percent > 0);
+	} else if (cJSON_GetObjectItem(root, "rpm")) {
+		LOGI(LOG_FANPWM, "rpm ignored, the fan is controlled by ventilation");
+	}
+#else
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+	// {"rpm":N} holds the speed, {"rpm":0} or {"percent":x} returns to open loop
+	uint32_t rpm = get_number32_from_json(cJSON_GetObjectItem(root, "rpm"), FAN_PWM_RPM_NOCHANGE);
+	if (rpm != FAN_PWM_RPM_NOCHANGE) {
+		fan_pwm_set_target(rpm);
+		if (rpm == 0) {
+			fan_pwm_set_percent(fan_pwm_nws_read());
+		}
+	}
+#endif
+
 	uint8_t percent = get_number8_from_json(cJSON_GetObjectItem(root, "percent"), FAN_PWM_NOCHANGE);
 	if (percent != FAN_PWM_NOCHANGE) {
 		fan_pwm_set_percent(percent);
 	}
+#endif
 
 	cJSON_Delete(root);
 }
@@ -32,5 +99,11 @@ void fanpwm_init() {
 		LOGI(LOG_FANPWM, "Cant initlize FAN PWM driver: %04X", res);
 	}
 
-	mqtt_subscribe(CONFIG_FANPWM_TOPIC_COMMAND, fan_pwm_commands, NULL);
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+	// the target is restored by fan_pwm_port_init(), the integral starts from the stored duty
+	fan_pwm_integral = fan_pwm_nws_read();
+	fan_tach_set_listener(fan_pwm_control, NULL);
+#endif
+
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_FANPWM_TOPIC_COMMAND), fan_pwm_commands, NULL);
 }
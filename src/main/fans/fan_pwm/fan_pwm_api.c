@@ -1,59 +1,96 @@
 #include "fan_pwm_api.h"
 
 #include "fan_pwm_nvs.h"
+#include "../../fans/fan_tach/fan_tach.h"
+#include "../../common/nvs_rw.h"
 #include "../../log/log.h"
 
-#include "driver/gpio.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "driver/ledc.h"
+#include "stdbool.h"
 
-static TaskHandle_t fan_pwm_task_handle = NULL;
+// LEDC generates the signal, so steady state costs no CPU. Setpoint changes are faded in hardware.
+#define FAN_PWM_SPEED_MODE LEDC_LOW_SPEED_MODE
+#define FAN_PWM_TIMER      LEDC_TIMER_0
+#define FAN_PWM_CHANNEL    LEDC_CHANNEL_0
+#define FAN_PWM_DUTY_MAX   (1UL << CONFIG_FANPWM_RESOLUTION)
 
-#define FAN_PWM_HIGL_LEVEL_TIME 500
-#define FAN_PWM_LOW_LEVEL_CALC(percent) ((uint32_t)((FAN_PWM_HIGL_LEVEL_TIME * ( 100 - percent )) / percent))
+#define FAN_PWM_RPM_NVS_NAME "fan_pwm_rpm"
 
-static void fan_pwm_task(void* arg) {
-	uint32_t low_time = (uint32_t) arg;
+static bool fan_pwm_initialized = false;
 
-	while (true) {
-		esp_err_t res = gpio_set_level(CONFIG_FANPWM_GPIO, 1);
-		if (res) {
-			LOGE(LOG_FANPWM, "Cant set HIGH level on pin %d: %d", CONFIG_FANPWM_GPIO, res);
-			fan_pwm_task_handle = NULL;
-			vTaskDelete(NULL);
-		}
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+static volatile uint32_t fan_pwm_target_rpm = 0;
 
-		vTaskDelay(FAN_PWM_HIGL_LEVEL_TIME / portTICK_PERIOD_MS);
+void fan_pwm_set_target_rpm(uint32_t rpm) {
+	if (rpm == fan_pwm_target_rpm) {
+		return;
+	}
 
-		res = gpio_set_level(CONFIG_FANPWM_GPIO, 0);
-		if (res) {
-			LOGE(LOG_FANPWM, "Cant set LOW level on pin %d: %d", CONFIG_FANPWM_GPIO, res);
-			fan_pwm_task_handle = NULL;
-			vTaskDelete(NULL);
-		}
+	fan_pwm_target_rpm = rpm;
+	nvs_write_32t(FAN_PWM_RPM_NVS_NAME, rpm);
 
-		vTaskDelay(low_time / portTICK_PERIOD_MS);
-	}
+	LOGI(LOG_FANPWM, "Target speed %lu rpm", rpm);
+}
+
+uint32_t fan_pwm_get_target_rpm() {
+	return fan_pwm_target_rpm;
 }
+#endif
 
 esp_err_t fan_pwm_port_init() {
-	gpio_config_t config = {
-		.intr_type = GPIO_INTR_DISABLE,
-	    .mode = GPIO_MODE_OUTPUT,
-		.pin_bit_mask = 1ULL << CONFIG_FANPWM_GPIO,
-		.pull_down_en = GPIO_PULLDOWN_ENABLE,
-		.pull_up_en = GPIO_PULLUP_DISABLE,
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+	fan_pwm_target_rpm = nvs_read_32t(FAN_PWM_RPM_NVS_NAME, 0);
+#endif
+
+	ledc_timer_config_t timer_config = {
+		.speed_mode = FAN_PWM_SPEED_MODE,
+		.duty_resolution = CONFIG_FANPWM_RESOLUTION,
+		.timer_num = FAN_PWM_TIMER,
+		.freq_hz = CONFIG_FANPWM_FREQUENCY,
+		.clk_cfg = LEDC_AUTO_CLK,
 	};
 
-	esp_err_t res = gpio_config(&config);
+	esp_err_t res = ledc_timer_config(&timer_config);
 	if (res) {
-		LOGI(LOG_FANPWM, "Cant init GPIO. error %d", res);
+		LOGE(LOG_FANPWM, "Cant configure timer for %d Hz with %d bit resolution: %d", CONFIG_FANPWM_FREQUENCY, CONFIG_FANPWM_RESOLUTION, res);
 		return res;
 	}
 
-	LOGI(LOG_FANPWM, "Driver initialized on port %d", CONFIG_FANPWM_GPIO);
+	uint8_t percent = fan_pwm_nws_read();
+	if (percent > 100) {
+		percent = 100;
+	}
+
+	ledc_channel_config_t channel_config = {
+		.gpio_num = CONFIG_FANPWM_GPIO,
+		.speed_mode = FAN_PWM_SPEED_MODE,
+		.channel = FAN_PWM_CHANNEL,
+		.intr_type = LEDC_INTR_DISABLE,
+		.timer_sel = FAN_PWM_TIMER,
+		.duty = FAN_PWM_DUTY_MAX * percent / 100,
+		.hpoint = 0,
+	};
+
+	res = ledc_channel_config(&channel_config);
+	if (res) {
+		LOGE(LOG_FANPWM, "Cant configure channel on pin %d: %d", CONFIG_FANPWM_GPIO, res);
+		return res;
+	}
+
+	res = ledc_fade_func_install(0);
+	if (res) {
+		LOGE(LOG_FANPWM, "Cant install fade service: %d", res);
+		return res;
+	}
+
+	fan_pwm_initialized = true;
+
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+	fan_tach_set_running(percent > 0);
+#endif
 
-	fan_pwm_set_percent(fan_pwm_nws_read());
+	LOGI(LOG_FANPWM, "Driver initialized on port %d: %d Hz, %d bit, %d%%", CONFIG_FANPWM_GPIO, CONFIG_FANPWM_FREQUENCY, CONFIG_FANPWM_RESOLUTION, percent);
 
 	return ESP_OK;
 }
@@ -63,36 +100,73 @@ esp_err_t fan_pwm_set_percent(uint8_t percent) {
 		percent = 100;
 	}
 
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+	// a speed set by percent (ventilation, {"percent":x}) must not be overridden by the PI loop
+	fan_pwm_set_target_rpm(0);
+#endif
+
 	fan_pwm_nws_write(percent);
 
-	if (fan_pwm_task_handle) {
-		vTaskDelete(fan_pwm_task_handle);
-		fan_pwm_task_handle = NULL;
+	if (!fan_pwm_initialized) {
+		return ESP_ERR_INVALID_STATE;
 	}
 
-	if (percent == 100) {
-		esp_err_t res = gpio_set_level(CONFIG_FANPWM_GPIO, 1);
-		if (res) {
-			LOGE(LOG_FANPWM, "Cant set HIGH level on pin %d: %d", CONFIG_FANPWM_GPIO, res);
-		} else {
-			LOGI(LOG_FANPWM, "HIGH level on pin %d activated.", CONFIG_FANPWM_GPIO);
+	uint32_t duty = FAN_PWM_DUTY_MAX * percent / 100;
+
+	// a running ramp is replaced by the new one, starting from the current duty
+	ledc_fade_stop(FAN_PWM_SPEED_MODE, FAN_PWM_CHANNEL);
+
+	esp_err_t res;
+	if (CONFIG_FANPWM_FADE_TIME > 0) {
+		res = ledc_set_fade_with_time(FAN_PWM_SPEED_MODE, FAN_PWM_CHANNEL, duty, CONFIG_FANPWM_FADE_TIME);
+		if (res == ESP_OK) {
+			res = ledc_fade_start(FAN_PWM_SPEED_MODE, FAN_PWM_CHANNEL, LEDC_FADE_NO_WAIT);
 		}
+	} else {
+		res = ledc_set_duty_and_update(FAN_PWM_SPEED_MODE, FAN_PWM_CHANNEL, duty, 0);
+	}
 
-		return res;
+	if (res) {
+		LOGE(LOG_FANPWM, "Cant set duty %lu on pin %d: %d", duty, CONFIG_FANPWM_GPIO, res);
 	} else {
-		esp_err_t res = gpio_set_level(CONFIG_FANPWM_GPIO, 0);
-		if (res) {
-			LOGE(LOG_FANPWM, "Cant set LOW level on pin %d: %d", CONFIG_FANPWM_GPIO, res);
-		} else {
-			LOGI(LOG_FANPWM, "HIGH level on pin %d activated.", CONFIG_FANPWM_GPIO);
-		}
+		LOGI(LOG_FANPWM, "Fan speed set to %d%% (duty %lu of %lu)", percent, duty, FAN_PWM_DUTY_MAX);
 	}
 
-	if (percent > 0) {
-		uint32_t low_time = FAN_PWM_LOW_LEVEL_CALC(percent);
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+	fan_tach_set_running(percent > 0);
+#endif
 
-		xTaskCreate(fan_pwm_task, "fan_pwm running task", 1024, (void *) low_time, 10, &fan_pwm_task_handle);
+	return res;
+}
+
+esp_err_t fan_pwm_set_output(float percent) {
+	if (!fan_pwm_initialized) {
+		return ESP_ERR_INVALID_STATE;
 	}
 
-	return ESP_OK;
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+	if (fan_pwm_target_rpm == 0) {
+		return ESP_ERR_INVALID_STATE;
+	}
+#endif
+
+	if (percent < 0) {
+		percent = 0;
+	} else if (percent > 100) {
+		percent = 100;
+	}
+
+	uint32_t duty = FAN_PWM_DUTY_MAX * percent / 100;
+
+	ledc_fade_stop(FAN_PWM_SPEED_MODE, FAN_PWM_CHANNEL);
+	esp_err_t res = ledc_set_duty_and_update(FAN_PWM_SPEED_MODE, FAN_PWM_CHANNEL, duty, 0);
+	if (res) {
+		LOGE(LOG_FANPWM, "Cant set duty %lu on pin %d: %d", duty, CONFIG_FANPWM_GPIO, res);
+	}
+
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+	fan_tach_set_running(duty > 0);
+#endif
+
+	return res;
 }
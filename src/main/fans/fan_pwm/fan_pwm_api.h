@@ -2,9 +2,21 @@
 #define MAIN_GPIO_FAN_PWM_FAN_PWM_API_H_
 
 #include "esp_err.h"
+#include "stdint.h"
+#include "sdkconfig.h"
 
 esp_err_t fan_pwm_port_init();
 
+// stored in NVS and applied with a ramp, ends closed-loop control
 esp_err_t fan_pwm_set_percent(uint8_t percent);
 
+// applied immediately and not stored, for closed-loop control: refused while there is no rpm target
+esp_err_t fan_pwm_set_output(float percent);
+
+#if CONFIG_FANTACH_ENABLED && CONFIG_FANTACH_FAN_PWM
+// closed-loop speed, stored in NVS. 0 - open loop, the duty set with fan_pwm_set_percent() is kept
+void fan_pwm_set_target_rpm(uint32_t rpm);
+uint32_t fan_pwm_get_target_rpm();
+#endif
+
 #endif /* MAIN_GPIO_FAN_PWM_FAN_PWM_API_H_ */
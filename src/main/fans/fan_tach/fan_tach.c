@@ -0,0 +1,169 @@
+#include "fan_tach.h"
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "driver/pulse_cnt.h"
+#include "driver/gpio.h"
+
+#include "../../cjson/json_writer.h"
+#include "../../common/mqtt.h"
+#include "../../common/scheduler.h"
+#include "../../common/snapshot.h"
+#include "../../common/report_policy.h"
+#include "../../log/log.h"
+
+#define FAN_TACH_HIGH_LIMIT  30000
+#define FAN_TACH_GLITCH_NS   1000
+
+static const char * const fan_tach_report_fields[] = { "rpm" };
+static const report_policy_deadband_t fan_tach_report_deadbands[] = { { .absolute = 100 } };
+static report_policy_t fan_tach_report_policy;
+
+static pcnt_unit_handle_t fan_tach_unit = NULL;
+static int64_t fan_tach_sampled_at = 0;
+
+static volatile uint32_t fan_tach_rpm = 0;
+static volatile bool fan_tach_running = false;
+static volatile bool fan_tach_stalled = false;
+static int64_t fan_tach_spinning_at = 0;	// last time the fan was seen spinning or was started
+
+static fan_tach_listener_t fan_tach_listener = NULL;
+static void * fan_tach_listener_arg = NULL;
+
+void fan_tach_set_running(bool running) {
+	if (running && !fan_tach_running) {
+		// spin-up time counts against the stall timeout
+		fan_tach_spinning_at = esp_timer_get_time();
+	}
+
+	fan_tach_running = running;
+}
+
+void fan_tach_set_listener(fan_tach_listener_t listener, void * arg) {
+	fan_tach_listener_arg = arg;
+	fan_tach_listener = listener;
+}
+
+uint32_t fan_tach_get_rpm() {
+	return fan_tach_rpm;
+}
+
+bool fan_tach_is_stalled() {
+	return fan_tach_stalled;
+}
+
+static void fan_tach_publish() {
+	char buffer[JSON_WRITER_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_int(&writer, "rpm", fan_tach_rpm);
+	json_writer_add_bool(&writer, "running", fan_tach_running);
+	json_writer_add_bool(&writer, "stalled", fan_tach_stalled);
+
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(MQTT_TOPIC(CONFIG_FANTACH_TOPIC_DATA), json);
+	}
+}
+
+static void fan_tach_sample(void *) {
+	int count = 0;
+	if (pcnt_unit_get_count(fan_tach_unit, &count) != ESP_OK) {
+		return;
+	}
+	pcnt_unit_clear_count(fan_tach_unit);
+
+	int64_t now = esp_timer_get_time();
+	int64_t elapsed = now - fan_tach_sampled_at;
+	fan_tach_sampled_at = now;
+
+	if (elapsed <= 0) {
+		return;
+	}
+
+	uint32_t rpm = (uint64_t) count * 60000000 / CONFIG_FANTACH_PULSES_PER_REVOLUTION / elapsed;
+	fan_tach_rpm = rpm;
+
+	bool stalled = false;
+	if (!fan_tach_running || rpm >= CONFIG_FANTACH_STALL_RPM) {
+		fan_tach_spinning_at = now;
+	} else {
+		stalled = (now - fan_tach_spinning_at) >= (int64_t) CONFIG_FANTACH_STALL_TIMEOUT * 1000000;
+	}
+
+	bool alarm = (stalled != fan_tach_stalled);
+	fan_tach_stalled = stalled;
+
+	if (alarm && stalled) {
+		LOGE(LOG_FANTACH, "Fan stalled: %lu rpm for %d s", rpm, CONFIG_FANTACH_STALL_TIMEOUT);
+	} else if (alarm) {
+		LOGI(LOG_FANTACH, "Fan recovered: %lu rpm", rpm);
+	}
+
+	snapshot_set_int("fan_rpm", rpm);
+
+	float values[1] = { rpm };
+	// stall changes are published right away, regardless of the report policy
+	if (report_policy_check(&fan_tach_report_policy, values) || alarm) {
+		fan_tach_publish();
+	}
+
+	if (fan_tach_listener) {
+		fan_tach_listener(rpm, stalled, fan_tach_listener_arg);
+	}
+}
+
+void fan_tach_init() {
+	pcnt_unit_config_t unit_config = {
+		.low_limit = -1,
+		.high_limit = FAN_TACH_HIGH_LIMIT,
+	};
+
+	esp_err_t res = pcnt_new_unit(&unit_config, &fan_tach_unit);
+	if (res) {
+		LOGE(LOG_FANTACH, "Cant create pulse counter: %d", res);
+		return;
+	}
+
+	pcnt_glitch_filter_config_t filter_config = {
+		.max_glitch_ns = FAN_TACH_GLITCH_NS,
+	};
+	pcnt_unit_set_glitch_filter(fan_tach_unit, &filter_config);
+
+	pcnt_chan_config_t channel_config = {
+		.edge_gpio_num = CONFIG_FANTACH_GPIO,
+		.level_gpio_num = -1,
+	};
+
+	pcnt_channel_handle_t channel = NULL;
+	res = pcnt_new_channel(fan_tach_unit, &channel_config, &channel);
+	if (res) {
+		LOGE(LOG_FANTACH, "Cant create pulse counter channel on pin %d: %d", CONFIG_FANTACH_GPIO, res);
+		return;
+	}
+
+	// tach output is open collector
+	gpio_pullup_en(CONFIG_FANTACH_GPIO);
+
+	pcnt_channel_set_edge_action(channel, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD);
+
+	res = pcnt_unit_enable(fan_tach_unit);
+	if (res == ESP_OK) {
+		res = pcnt_unit_clear_count(fan_tach_unit);
+	}
+	if (res == ESP_OK) {
+		res = pcnt_unit_start(fan_tach_unit);
+	}
+	if (res) {
+		LOGE(LOG_FANTACH, "Cant start pulse counter: %d", res);
+		return;
+	}
+
+	fan_tach_sampled_at = esp_timer_get_time();
+
+	report_policy_init(&fan_tach_report_policy, "fantach", fan_tach_report_fields, 1, fan_tach_report_deadbands);
+
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_SYSTEM, "fan tach", FAN_TACH_SAMPLE_PERIOD, &fan_tach_sample, NULL));
+
+	LOGI(LOG_FANTACH, "Tachometer initialized on pin %d", CONFIG_FANTACH_GPIO);
+}
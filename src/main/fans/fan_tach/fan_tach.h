@@ -0,0 +1,26 @@
+#ifndef MAIN_FANS_FAN_TACH_FAN_TACH_H_
+#define MAIN_FANS_FAN_TACH_FAN_TACH_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+// Fan tachometer on the pulse counter. RPM is sampled every FAN_TACH_SAMPLE_PERIOD and published
+// on CONFIG_FANTACH_TOPIC_DATA together with the commanded fan state. A fan commanded to run that
+// stays below CONFIG_FANTACH_STALL_RPM for CONFIG_FANTACH_STALL_TIMEOUT seconds raises a stall alarm.
+
+#define FAN_TACH_SAMPLE_PERIOD 1000
+
+// called after every sample from the scheduler system task
+typedef void (* fan_tach_listener_t)(uint32_t rpm, bool stalled, void * arg);
+
+void fan_tach_init();
+
+// the fan driver reports whether the fan should spin, stall detection is active only then
+void fan_tach_set_running(bool running);
+
+void fan_tach_set_listener(fan_tach_listener_t listener, void * arg);
+
+uint32_t fan_tach_get_rpm();
+bool fan_tach_is_stalled();
+
+#endif /* MAIN_FANS_FAN_TACH_FAN_TACH_H_ */
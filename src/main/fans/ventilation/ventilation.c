@@ -0,0 +1,311 @@
+#include "ventilation.h"
+
+#include "sdkconfig.h"
+
+#if CONFIG_VENTILATION_ENABLED
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "string.h"
+#include "time.h"
+
+#include "../../cjson/cjson_helper.h"
+#include "../../cjson/json_writer.h"
+#include "../../common/mqtt.h"
+#include "../../common/scheduler.h"
+#include "../../common/snapshot.h"
+#include "../../common/wifi.h"
+#include "../../i2c/bme280/bme280.h"
+#include "../../led/led.h"
+#include "../../log/log.h"
+
+#if CONFIG_FAN_ENABLED
+#include "../../fans/fan/fan.h"
+#else
+#include "../../fans/fan_pwm/fan_pwm_api.h"
+#endif
+
+// readings older than that are ignored
+#define VENTILATION_MAX_AGE_MS (5 * 60 * 1000)
+
+#define VENTILATION_COLOR_OFF        0x000000
+#define VENTILATION_COLOR_AUTO_ON    0x0000FF
+#define VENTILATION_COLOR_MANUAL_ON  0x00FF00
+#define VENTILATION_COLOR_MANUAL_OFF 0xFF0000
+
+#define VENTILATION_STATE_NOT_SET 2
+
+typedef struct {
+	const char * name;	// snapshot field
+	float on;
+	float off;
+	bool dark;			// counts only while the light is off
+	bool active;
+} ventilation_input_t;
+
+static ventilation_input_t ventilation_inputs[] = {
+	{ .name = "humidity", .on = CONFIG_VENTILATION_HUMIDITY_ON, .off = CONFIG_VENTILATION_HUMIDITY_OFF },
+#if CONFIG_LIGHT_ENABLED && CONFIG_VENTILATION_HUMIDITY_DARK_ON > 0
+	{ .name = "humidity", .on = CONFIG_VENTILATION_HUMIDITY_DARK_ON, .off = CONFIG_VENTILATION_HUMIDITY_OFF, .dark = true },
+#endif
+#if CONFIG_MQ136_ENABLED
+	{ .name = "h2s", .on = CONFIG_VENTILATION_H2S_ON, .off = CONFIG_VENTILATION_H2S_OFF },
+#endif
+#if CONFIG_MHZ19B_ENABLED
+	{ .name = "co2", .on = CONFIG_VENTILATION_CO2_ON, .off = CONFIG_VENTILATION_CO2_OFF },
+#endif
+#if CONFIG_SGP41_ENABLED
+	{ .name = "tvoc", .on = CONFIG_VENTILATION_TVOC_ON, .off = CONFIG_VENTILATION_TVOC_OFF },
+#endif
+};
+
+#define VENTILATION_INPUTS (sizeof(ventilation_inputs) / sizeof(ventilation_inputs[0]))
+
+typedef struct {
+	bool fan;
+	bool manual;
+	int64_t manual_until;	// 0 - until switched back to automatic mode
+	int64_t started_at;
+	const char * reason;	// input that started the fan in automatic mode
+} ventilation_state_t;
+
+static ventilation_state_t ventilation_state = { 0 };
+static bool ventilation_published = false;
+
+static StaticSemaphore_t ventilation_mutex_buffer;
+static SemaphoreHandle_t ventilation_mutex = NULL;
+
+static void ventilation_set_fan(bool on) {
+	ventilation_state.fan = on;
+	if (on) {
+		ventilation_state.started_at = esp_timer_get_time();
+	}
+
+#if CONFIG_FAN_ENABLED
+	if (on) {
+		fan_start();
+	} else {
+		fan_stop();
+	}
+#else
+	fan_pwm_set_percent(on ? CONFIG_VENTILATION_FAN_PERCENT : 0);
+#endif
+}
+
+static void ventilation_publish() {
+	char buffer[JSON_WRITER_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_string(&writer, "mode", ventilation_state.manual ? "manual" : "auto");
+	json_writer_add_bool(&writer, "fan", ventilation_state.fan);
+
+	if (ventilation_state.manual && ventilation_state.manual_until) {
+		int64_t left = (ventilation_state.manual_until - esp_timer_get_time()) / 1000000;
+		json_writer_add_int(&writer, "override_left", left > 0 ? left : 0);
+	} else if (!ventilation_state.manual && ventilation_state.fan && ventilation_state.reason) {
+		json_writer_add_string(&writer, "reason", ventilation_state.reason);
+	}
+
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(MQTT_TOPIC(CONFIG_VENTILATION_TOPIC_DATA), json);
+		ventilation_published = true;
+	}
+}
+
+static void ventilation_set_auto() {
+	ventilation_state.manual = false;
+	ventilation_state.manual_until = 0;
+	ventilation_state.reason = NULL;
+	ventilation_set_fan(false);
+	led_set_color(VENTILATION_COLOR_OFF);
+
+	LOGI(LOG_VENTILATION, "Automatic mode");
+}
+
+// timeout_s: 0 - no timeout
+static void ventilation_set_manual(bool on, uint32_t timeout_s) {
+	ventilation_state.manual = true;
+	ventilation_state.manual_until = timeout_s ? esp_timer_get_time() + (int64_t) timeout_s * 1000000 : 0;
+	ventilation_set_fan(on);
+	led_set_color(on ? VENTILATION_COLOR_MANUAL_ON : VENTILATION_COLOR_MANUAL_OFF);
+
+	LOGI(LOG_VENTILATION, "Manual mode, fan %s for %lu s", on ? "on" : "off", timeout_s);
+}
+
+static bool ventilation_read(const char * name, float * value) {
+	uint32_t age_ms = 0;
+
+	if (strcmp(name, "humidity") == 0) {
+		bme280_data_t data;
+		if (!bme280_get(&data, &age_ms)) {
+			return false;
+		}
+		*value = data.humidity;
+	} else if (!snapshot_get(name, value, &age_ms)) {
+		return false;
+	}
+
+	return age_ms <= VENTILATION_MAX_AGE_MS;
+}
+
+static bool ventilation_start_allowed() {
+	if (CONFIG_VENTILATION_ACTIVE_FROM == 0 && CONFIG_VENTILATION_ACTIVE_TO == 24) {
+		return true;
+	}
+
+	if (!wifi_time_valid()) {
+		return true;
+	}
+
+	time_t now = time(NULL);
+	struct tm tm;
+	localtime_r(&now, &tm);
+
+	if (CONFIG_VENTILATION_ACTIVE_FROM <= CONFIG_VENTILATION_ACTIVE_TO) {
+		return tm.tm_hour >= CONFIG_VENTILATION_ACTIVE_FROM && tm.tm_hour < CONFIG_VENTILATION_ACTIVE_TO;
+	} else {
+		return tm.tm_hour >= CONFIG_VENTILATION_ACTIVE_FROM || tm.tm_hour < CONFIG_VENTILATION_ACTIVE_TO;
+	}
+}
+
+static void ventilation_control(void *) {
+	xSemaphoreTake(ventilation_mutex, portMAX_DELAY);
+
+	int64_t now = esp_timer_get_time();
+	// the first state after boot is always published
+	bool changed = !ventilation_published;
+
+	bool dark = false;
+#if CONFIG_LIGHT_ENABLED
+	float light = 0;
+	dark = ventilation_read("light", &light) && light <= CONFIG_VENTILATION_LIGHT_DARK;
+#endif
+
+	const char * reason = NULL;
+	for (uint8_t i = 0; i<VENTILATION_INPUTS; i++) {
+		ventilation_input_t * input = &ventilation_inputs[i];
+
+		float value = 0;
+		if ((input->dark && !dark) || !ventilation_read(input->name, &value)) {
+			input->active = false;
+		} else {
+			// hysteresis: stays active until the value drops to the off-threshold
+			input->active = value >= input->on || (input->active && value > input->off);
+		}
+
+		if (input->active && reason == NULL) {
+			reason = input->name;
+		}
+	}
+
+	if (ventilation_state.manual && ventilation_state.manual_until && now >= ventilation_state.manual_until) {
+		LOGI(LOG_VENTILATION, "Manual override expired");
+		ventilation_set_auto();
+		changed = true;
+	}
+
+	if (!ventilation_state.manual) {
+		if (reason && !ventilation_state.fan && ventilation_start_allowed()) {
+			LOGI(LOG_VENTILATION, "Fan started by %s", reason);
+			ventilation_state.reason = reason;
+			ventilation_set_fan(true);
+			led_set_color(VENTILATION_COLOR_AUTO_ON);
+			changed = true;
+		} else if (!reason && ventilation_state.fan && now - ventilation_state.started_at >= (int64_t) CONFIG_VENTILATION_MIN_ON_TIME * 1000000) {
+			LOGI(LOG_VENTILATION, "Fan stopped");
+			ventilation_state.reason = NULL;
+			ventilation_set_fan(false);
+			led_set_color(VENTILATION_COLOR_OFF);
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		ventilation_publish();
+	}
+
+	xSemaphoreGive(ventilation_mutex);
+}
+
+void ventilation_on_click(uint8_t click_index) {
+	if (ventilation_mutex == NULL || (click_index != 1 && click_index != 2)) {
+		return;
+	}
+
+	xSemaphoreTake(ventilation_mutex, portMAX_DELAY);
+
+	if (click_index == 1) {
+		ventilation_set_auto();
+	} else {
+		ventilation_set_manual(!ventilation_state.fan, CONFIG_VENTILATION_OVERRIDE_TIMEOUT);
+	}
+
+	ventilation_publish();
+
+	xSemaphoreGive(ventilation_mutex);
+}
+
+void ventilation_override(bool on) {
+	if (ventilation_mutex == NULL) {
+		return;
+	}
+
+	xSemaphoreTake(ventilation_mutex, portMAX_DELAY);
+
+	ventilation_set_manual(on, CONFIG_VENTILATION_OVERRIDE_TIMEOUT);
+	ventilation_publish();
+
+	xSemaphoreGive(ventilation_mutex);
+}
+
+// {"type":"auto"}
+// {"type":"manual","state":true,"timeout":3600} - state toggles the fan if not set, timeout 0 - until {"type":"auto"}
+// {"type":"status"}
+static void ventilation_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
+	if (root == NULL) {
+		return;
+	}
+
+	char * type = cJSON_GetStringValue(cJSON_GetObjectItem(root, "type"));
+	if (type == NULL) {
+		cJSON_Delete(root);
+		return;
+	}
+
+	xSemaphoreTake(ventilation_mutex, portMAX_DELAY);
+
+	bool known = true;
+	if (strcmp(type, "auto") == 0) {
+		ventilation_set_auto();
+	} else if (strcmp(type, "manual") == 0) {
+		uint8_t state = get_boolean_from_json(cJSON_GetObjectItem(root, "state"), true, false, VENTILATION_STATE_NOT_SET);
+		uint32_t timeout = get_number32_from_json(cJSON_GetObjectItem(root, "timeout"), CONFIG_VENTILATION_OVERRIDE_TIMEOUT);
+
+		ventilation_set_manual(state == VENTILATION_STATE_NOT_SET ? !ventilation_state.fan : state, timeout);
+	} else {
+		known = strcmp(type, "status") == 0;
+	}
+
+	if (known) {
+		ventilation_publish();
+	}
+
+	xSemaphoreGive(ventilation_mutex);
+
+	cJSON_Delete(root);
+}
+
+void ventilation_init() {
+	ventilation_mutex = xSemaphoreCreateMutexStatic(&ventilation_mutex_buffer);
+
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_SYSTEM, "ventilation", VENTILATION_PERIOD, &ventilation_control, NULL));
+
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_VENTILATION_TOPIC_COMMAND), ventilation_commands, NULL);
+
+	LOGI(LOG_VENTILATION, "Ventilation control started with %d inputs", VENTILATION_INPUTS);
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef MAIN_FANS_VENTILATION_VENTILATION_H_
+#define MAIN_FANS_VENTILATION_VENTILATION_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+// Local ventilation control. In automatic mode the fan starts when an input (humidity, H2S, CO2, TVOC)
+// rises above its on-threshold and stops when all inputs fall below their off-thresholds and the
+// minimum on-time passed. A manual command overrides it until CONFIG_VENTILATION_OVERRIDE_TIMEOUT expires.
+// Mode and fan state are published on CONFIG_VENTILATION_TOPIC_DATA when they change.
+
+#define VENTILATION_PERIOD 5000
+
+void ventilation_init();
+
+// 1 - back to automatic mode, 2 - toggle the fan in manual mode
+void ventilation_on_click(uint8_t click_index);
+
+// Manual override for CONFIG_VENTILATION_OVERRIDE_TIMEOUT. The fan command topics go through it
+// while the ventilation control owns the fan.
+void ventilation_override(bool on);
+
+#endif /* MAIN_FANS_VENTILATION_VENTILATION_H_ */
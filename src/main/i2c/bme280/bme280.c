@@ -2,36 +2,271 @@
 
 #include "string.h"
 #include "sdkconfig.h"
-
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
 
 #include "bme280_api.h"
-#include "cJSON.h"
+#include "../../cjson/json_writer.h"
 #include "../../common/mqtt.h"
+#include "../../common/scheduler.h"
+#include "../../common/snapshot.h"
+#include "../../common/report_policy.h"
+#include "cJSON.h"
+#include "../../cjson/cjson_helper.h"
 #include "../../log/log.h"
 
-#define BME280_EXEC_PERIOD 30000000
+#define BME280_EXEC_PERIOD 30000
+#define BME280_MAX_SUBSCRIBERS 8
+#define BME280_PROFILE_BUFFER_SIZE 256
 
-void bme280_timer_exec_function(void* arg) {
+typedef struct {
+	bme280_subscriber_t function;
+	void * arg;
+} bme280_subscription_t;
+
+static bme280_data_t bme280_cache;
+static int64_t bme280_cache_updated = 0;	// 0 - nothing read yet
+static bme280_subscription_t bme280_subscribers[BME280_MAX_SUBSCRIBERS];
+static uint8_t bme280_subscribers_count = 0;
+static portMUX_TYPE bme280_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// indexed by bme280_filter and bme280_standby_time
+static const uint8_t bme280_filter_coefficients[] = { 0, 2, 4, 8, 16 };
+static const uint16_t bme280_standby_ms_x10[] = { 5, 625, 1250, 2500, 5000, 10000, 100, 200 };
+
+static const char * const bme280_report_fields[] = { "temperature", "humidity", "pressure" };
+static const report_policy_deadband_t bme280_report_deadbands[] = { { .absolute = 0.2 }, { .absolute = 1 }, { .absolute = 50 } };
+static report_policy_t bme280_report_policy;
+
+static bool bme280_parse_osr(cJSON * item, bme280_ocr * osr) {
+	if (item == NULL) {
+		return true;
+	}
+
+	uint8_t samples = get_number8_from_json(item, 0xFF);
+	for (bme280_ocr i = OSR_Off; i<=OSR_X16; i++) {
+		if (bme280_osr_samples(i) == samples) {
+			*osr = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool bme280_parse_filter(cJSON * item, bme280_filter * filter) {
+	if (item == NULL) {
+		return true;
+	}
+
+	uint8_t coefficient = get_number8_from_json(item, 0xFF);
+	for (uint8_t i = 0; i<sizeof(bme280_filter_coefficients); i++) {
+		if (bme280_filter_coefficients[i] == coefficient) {
+			*filter = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool bme280_parse_standby(cJSON * item, bme280_standby_time * time) {
+	if (item == NULL) {
+		return true;
+	}
+
+	float standby = get_float_from_json(item, -1);
+	if (standby < 0) {
+		return false;
+	}
+
+	uint16_t standby_x10 = standby * 10 + 0.5;
+	for (uint8_t i = 0; i<sizeof(bme280_standby_ms_x10) / sizeof(bme280_standby_ms_x10[0]); i++) {
+		if (bme280_standby_ms_x10[i] == standby_x10) {
+			*time = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// {"type":"profile","mode":"forced","osr_t":1,"osr_p":1,"osr_h":1,"filter":0,"standby":1000}
+// osr_* - oversampling 0 (off), 1, 2, 4, 8, 16; filter - IIR coefficient 0 (off), 2, 4, 8, 16;
+// standby - ms between normal mode measurements: 0.5, 10, 20, 62.5, 125, 250, 500, 1000.
+// Every key is optional, the reply contains the resulting profile and its measurement time in us.
+// No "type" in the reply: it goes to the command topic and the broker echoes it back.
+static void bme280_profile_command(cJSON * root) {
+	bme280_settings_t current;
+	bme280_get_settings(&current);
+	bme280_settings_t settings = current;
+
+	bool valid = true;
+
+	char * mode = cJSON_GetStringValue(cJSON_GetObjectItem(root, "mode"));
+	if (mode && strcmp(mode, "forced") == 0) {
+		settings.mode = Mode_Forced;
+	} else if (mode && strcmp(mode, "normal") == 0) {
+		settings.mode = Mode_Normal;
+	} else if (mode) {
+		valid = false;
+	}
+
+	valid = bme280_parse_osr(cJSON_GetObjectItem(root, "osr_t"), &settings.tosr) && valid;
+	valid = bme280_parse_osr(cJSON_GetObjectItem(root, "osr_p"), &settings.posr) && valid;
+	valid = bme280_parse_osr(cJSON_GetObjectItem(root, "osr_h"), &settings.hosr) && valid;
+	valid = bme280_parse_filter(cJSON_GetObjectItem(root, "filter"), &settings.filter) && valid;
+	valid = bme280_parse_standby(cJSON_GetObjectItem(root, "standby"), &settings.time) && valid;
+
+	esp_err_t res = ESP_ERR_INVALID_ARG;
+	if (valid && memcmp(&settings, &current, sizeof(bme280_settings_t)) == 0) {
+		// unchanged: no sensor reconfiguration and no NVS write
+		res = ESP_OK;
+	} else if (valid) {
+		res = bme280_save_settings(&settings);
+	}
+
+	if (res != ESP_OK) {
+		LOGW(LOG_BME280, "Profile not applied: %04X", res);
+	}
+
+	bme280_get_settings(&settings);
+
+	char buffer[BME280_PROFILE_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_bool(&writer, "applied", res == ESP_OK);
+	json_writer_add_string(&writer, "mode", settings.mode == Mode_Forced ? "forced" : "normal");
+	json_writer_add_int(&writer, "osr_t", bme280_osr_samples(settings.tosr));
+	json_writer_add_int(&writer, "osr_p", bme280_osr_samples(settings.posr));
+	json_writer_add_int(&writer, "osr_h", bme280_osr_samples(settings.hosr));
+	json_writer_add_int(&writer, "filter", bme280_filter_coefficients[settings.filter]);
+	json_writer_add_float(&writer, "standby", bme280_standby_ms_x10[settings.time] / 10.0, 1);
+	json_writer_add_int(&writer, "measurement_time", bme280_measurement_time(&settings));
+
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish_nojournal(MQTT_TOPIC(CONFIG_BME280_TOPIC_COMMAND), json);
+	}
+}
+
+void bme280_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
+	if (root == NULL) {
+		return;
+	}
+
+	char * type = cJSON_GetStringValue(cJSON_GetObjectItem(root, "type"));
+	if (type != NULL && strcmp(type, "profile") == 0) {
+		bme280_profile_command(root);
+	} else {
+		report_policy_command(&bme280_report_policy, root, MQTT_TOPIC(CONFIG_BME280_TOPIC_COMMAND));
+	}
+
+	cJSON_Delete(root);
+}
+
+esp_err_t bme280_subscribe(bme280_subscriber_t subscriber, void * arg) {
+	if (subscriber == NULL) {
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	bool full = false;
+	portENTER_CRITICAL(&bme280_lock);
+	if (bme280_subscribers_count < BME280_MAX_SUBSCRIBERS) {
+		bme280_subscribers[bme280_subscribers_count].function = subscriber;
+		bme280_subscribers[bme280_subscribers_count].arg = arg;
+		bme280_subscribers_count++;
+	} else {
+		full = true;
+	}
+	portEXIT_CRITICAL(&bme280_lock);
+
+	if (full) {
+		LOGE(LOG_BME280, "Cant subscribe: max %d subscribers", BME280_MAX_SUBSCRIBERS);
+		return ESP_ERR_NO_MEM;
+	}
+
+	bme280_data_t data;
+	if (bme280_get(&data, NULL)) {
+		subscriber(&data, arg);
+	}
+
+	return ESP_OK;
+}
+
+bool bme280_get(bme280_data_t * data, uint32_t * age_ms) {
+	portENTER_CRITICAL(&bme280_lock);
+	int64_t updated = bme280_cache_updated;
+	*data = bme280_cache;
+	portEXIT_CRITICAL(&bme280_lock);
+
+	if (updated == 0) {
+		return false;
+	}
+
+	if (age_ms) {
+		*age_ms = (esp_timer_get_time() - updated) / 1000;
+	}
+
+	return true;
+}
+
+// the only place that reads the sensor
+void bme280_timer_sample_function(void* arg) {
 	bme280_data_t data = { 0 };
 	if (bme280_read(&data)) {
 		return;
 	}
 
+	portENTER_CRITICAL(&bme280_lock);
+	bme280_cache = data;
+	bme280_cache_updated = esp_timer_get_time();
+	uint8_t subscribers_count = bme280_subscribers_count;
+	portEXIT_CRITICAL(&bme280_lock);
+
+	snapshot_set_float("temperature", data.temperature, 2);
+	snapshot_set_float("humidity", data.humidity, 2);
+	snapshot_set_int("pressure", data.pressure);
+
+	for (uint8_t i = 0; i<subscribers_count; i++) {
+		bme280_subscribers[i].function(&data, bme280_subscribers[i].arg);
+	}
+}
+
+void bme280_timer_exec_function(void* arg) {
+	bme280_data_t data;
+	uint32_t age_ms = 0;
+	if (!bme280_get(&data, &age_ms)) {
+		return;
+	}
+
+	if (age_ms > CONFIG_BME280_SAMPLE_PERIOD * 2000) {
+		LOGW(LOG_BME280, "Cached sample is %lu ms old, not published", age_ms);
+		return;
+	}
+
 	LOGI(LOG_BME280, "Temperature: %f; Humidity: %f%%", data.temperature, data.humidity);
 
-	cJSON *root = cJSON_CreateObject();
-	cJSON_AddNumberToObject(root, "temperature", data.temperature);
-	cJSON_AddNumberToObject(root, "humidity", data.humidity);
-	cJSON_AddNumberToObject(root, "pressure", data.pressure);
-	cJSON_AddNumberToObject(root, "heatindex", data.heatindex);
-	cJSON_AddNumberToObject(root, "absolute_humidity", data.absolute_humidity);
+	float values[3] = { data.temperature, data.humidity, data.pressure };
+	if (!report_policy_check(&bme280_report_policy, values)) {
+		return;
+	}
 
-	char * json = cJSON_Print(root);
-	mqtt_publish(CONFIG_BME280_TOPIC_DATA, json);
-	cJSON_free(json);
+	char buffer[JSON_WRITER_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_float(&writer, "temperature", data.temperature, 2);
+	json_writer_add_float(&writer, "humidity", data.humidity, 2);
+	json_writer_add_int(&writer, "pressure", data.pressure);
+	json_writer_add_int(&writer, "heatindex", data.heatindex);
+	json_writer_add_float(&writer, "absolute_humidity", data.absolute_humidity, 2);
 
-	cJSON_Delete(root);
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(MQTT_TOPIC(CONFIG_BME280_TOPIC_DATA), json);
+	}
 }
 
 void bme280_init() {
@@ -43,13 +278,12 @@ void bme280_init() {
 		LOGI(LOG_BME280, "BME280 driver initialized");
 	}
 
-	esp_timer_create_args_t periodic_timer_args = {
-			.callback = &bme280_timer_exec_function,
-			/* name is optional, but may help identify the timer when debugging */
-			.name = "bme280 publish value"
-	};
+	report_policy_init(&bme280_report_policy, "bme280", bme280_report_fields, 3, bme280_report_deadbands);
+
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_BME280_TOPIC_COMMAND), bme280_commands, NULL);
+
+	bme280_timer_sample_function(NULL);
 
-	esp_timer_handle_t periodic_timer;
-	ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-	ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, BME280_EXEC_PERIOD));
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_I2C, "bme280 sample", CONFIG_BME280_SAMPLE_PERIOD * 1000, &bme280_timer_sample_function, NULL));
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_SYSTEM, "bme280 publish value", BME280_EXEC_PERIOD, &bme280_timer_exec_function, NULL));
 }
@@ -1,8 +1,24 @@
 #ifndef MAIN_I2C_BME280_BME280_H_
 #define MAIN_I2C_BME280_BME280_H_
 
+#include "stdint.h"
+#include "stdbool.h"
+#include "esp_err.h"
 #include "../i2c_impl.h"
+#include "bme280_api.h"
+
+// The sensor is read once per CONFIG_BME280_SAMPLE_PERIOD into a cache. Consumers use the cache
+// or subscribe to new samples instead of reading the bus themselves.
+
+// Called from the I2C scheduler task after every successful read, must not block.
+typedef void (* bme280_subscriber_t)(const bme280_data_t * data, void * arg);
 
 void bme280_init();
 
+// The subscriber is called right away if a sample is already cached.
+esp_err_t bme280_subscribe(bme280_subscriber_t subscriber, void * arg);
+
+// Latest sample, false if there is none yet. age_ms may be NULL.
+bool bme280_get(bme280_data_t * data, uint32_t * age_ms);
+
 #endif /* MAIN_I2C_BME280_BME280_H_ */
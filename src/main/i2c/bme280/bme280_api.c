@@ -1,11 +1,17 @@
 #include "bme280_api.h"
 
 #include "bme280_math.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "../../log/log.h"
+#include "../../common/nvs_rw.h"
 
 #include "../i2c_impl.h"
 
 #include "string.h"
+#include "stdlib.h"
+#include "stdbool.h"
 
 // Thanks to https://github.com/letscontrolit/ESPEasy/blob/mega/src/src/PluginStructs/P028_data_struct.cpp
 // Thanks to https://github.com/finitespace/BME280/blob/master/src/BME280.cpp
@@ -14,6 +20,7 @@
 #define BME280_I2C_TIMEOUT 50
 
 #define REGISTER_CTRL_HUM   0xF2
+#define REGISTER_STATUS     0xF3
 #define REGISTER_CTRL_MEAS  0xF4
 #define REGISTER_CONFIG     0xF5
 
@@ -21,12 +28,39 @@
 
 #define SENSOR_DATA_LENGTH 8
 
+#define STATUS_MEASURING    0x08
+#define MEASURING_RETRIES   5
+
+#define BME280_SETTINGS_NVS_NAME    "bme280_prof"
+#define BME280_SETTINGS_NVS_VERSION 1
+
+typedef struct {
+	uint8_t version;
+	uint8_t mode;
+	uint8_t tosr;
+	uint8_t hosr;
+	uint8_t posr;
+	uint8_t time;
+	uint8_t filter;
+} bme280_settings_nvs_t;
+
 static bme280_math_calibration_table_t * calibration_table = NULL;
 static i2c_handler_t * bme280_i2c = NULL;
 
+// Datasheet 3.5.1 "weather monitoring": forced mode, x1 everywhere, no filter.
+static bme280_settings_t bme280_settings = {
+	.tosr = OSR_X1,
+	.hosr = OSR_X1,
+	.posr = OSR_X1,
+	.mode = Mode_Forced,
+	.time = StandbyTime_1000ms,
+	.filter = Filter_Off
+};
+
 esp_err_t bme280_write_register(uint8_t register_id, uint8_t value);
 esp_err_t bme280_read_registers(uint8_t from_register_id, uint8_t * buffer, uint8_t buffer_size);
 esp_err_t bme280_update_settings();
+void bme280_load_settings();
 
 double bme280_round(double value) {
 	int32_t temp = value * 10;
@@ -65,7 +99,7 @@ esp_err_t bme280_read_calibration_table() {
 }
 
 esp_err_t bme280_init_driver() {
-	bme280_i2c = i2c_get_handlers(BME280_I2C_ADDRESS, BME280_I2C_TIMEOUT);
+	bme280_i2c = i2c_get_handlers(CONFIG_BME280_I2C_PORT, BME280_I2C_ADDRESS, BME280_I2C_TIMEOUT, I2C_PRIORITY_HIGH);
 	if (bme280_i2c == NULL) {
 		LOGE(LOG_BME280, "Cant init I2C for address %d", BME280_I2C_ADDRESS);
 		return ESP_ERR_INVALID_STATE;
@@ -77,6 +111,8 @@ esp_err_t bme280_init_driver() {
 		return res;
 	}
 
+	bme280_load_settings();
+
 	res = bme280_update_settings();
 	if (res) {
 		LOGE(LOG_BME280, "Cant wakeup sensor: %d", res);
@@ -86,12 +122,63 @@ esp_err_t bme280_init_driver() {
 	return ESP_OK;
 }
 
+uint8_t bme280_osr_samples(bme280_ocr osr) {
+	return osr == OSR_Off ? 0 : 1 << (osr - 1);
+}
+
+// Datasheet appendix B, maximum measurement time:
+// 1.25 + 2.3 * osr_t + (2.3 * osr_p + 0.575) + (2.3 * osr_h + 0.575) ms, a disabled channel adds nothing.
+uint32_t bme280_measurement_time(const bme280_settings_t * settings) {
+	uint32_t result = 1250 + 2300 * bme280_osr_samples(settings->tosr);
+	if (settings->posr != OSR_Off) {
+		result += 2300 * bme280_osr_samples(settings->posr) + 575;
+	}
+	if (settings->hosr != OSR_Off) {
+		result += 2300 * bme280_osr_samples(settings->hosr) + 575;
+	}
+	return result;
+}
+
+// Starts one measurement and waits until its data is ready. The sensor sleeps again afterwards.
+static esp_err_t bme280_measure_forced() {
+	bme280_settings_t settings = bme280_settings;
+
+	uint8_t ctrl_meas = (settings.tosr << 5) | (settings.posr << 2) | Mode_Forced;
+	esp_err_t res = bme280_write_register(REGISTER_CTRL_MEAS, ctrl_meas);
+	if (res) {
+		return res;
+	}
+
+	uint32_t wait_ms = (bme280_measurement_time(&settings) + 999) / 1000;
+	vTaskDelay((wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+
+	for (uint8_t i = 0; i<MEASURING_RETRIES; i++) {
+		uint8_t status = 0;
+		res = bme280_read_registers(REGISTER_STATUS, &status, 1);
+		if (res || (status & STATUS_MEASURING) == 0) {
+			return res;
+		}
+
+		vTaskDelay(1);
+	}
+
+	LOGW(LOG_BME280, "Measurement is not ready after %lu ms", wait_ms);
+	return ESP_ERR_TIMEOUT;
+}
+
 esp_err_t bme280_read(bme280_data_t * to) {
 	if (calibration_table == NULL) {
 		LOGE(LOG_BME280, "Driver not initialized.");
 		return ESP_FAIL;
 	}
 
+	if (bme280_settings.mode == Mode_Forced) {
+		esp_err_t err = bme280_measure_forced();
+		if (err) {
+			return err;
+		}
+	}
+
 	uint8_t buffer[SENSOR_DATA_LENGTH] = { 0 };
 
 	esp_err_t err = bme280_read_registers(REGISTER_PRESS, buffer, SENSOR_DATA_LENGTH);
@@ -115,38 +202,101 @@ esp_err_t bme280_read(bme280_data_t * to) {
 }
 
 esp_err_t bme280_update_settings() {
-	bme280_settings_t settings = {
-		.tosr = OSR_X1,
-		.hosr = OSR_X1,
-		.posr = OSR_X1,
-		.mode = Mode_Normal,
-		.time = StandbyTime_1000ms,
-		.filter = Filter_Off
-	};
+	bme280_settings_t settings = bme280_settings;
+	if (settings.mode == Mode_Forced) {
+		// forced measurements are started by bme280_read(), until then the sensor sleeps
+		settings.mode = Mode_Sleep;
+	}
 
 	uint8_t ctrl_hum = settings.hosr;
 	uint8_t ctrl_meas = (settings.tosr << 5) | (settings.posr << 2) | settings.mode;
 	uint8_t config = settings.time << 5 | settings.filter << 2;
 
-	esp_err_t res = bme280_write_register(REGISTER_CTRL_HUM, ctrl_hum);
+	// ctrl_hum is applied only after the ctrl_meas write, so all three go out in one bus transaction
+	uint8_t buffer_hum[2]    = { REGISTER_CTRL_HUM, ctrl_hum };
+	uint8_t buffer_meas[2]   = { REGISTER_CTRL_MEAS, ctrl_meas };
+	uint8_t buffer_config[2] = { REGISTER_CONFIG, config };
+	i2c_op_t ops[] = {
+		{ .type = I2C_OP_WRITE, .write_buffer = buffer_hum,    .write_size = 2 },
+		{ .type = I2C_OP_WRITE, .write_buffer = buffer_meas,   .write_size = 2 },
+		{ .type = I2C_OP_WRITE, .write_buffer = buffer_config, .write_size = 2 },
+	};
+
+	esp_err_t res = bme280_i2c->transaction(bme280_i2c->context, ops, sizeof(ops) / sizeof(ops[0]));
 	if (res) {
-		LOGE(LOG_BME280, "Cant write to control register %02x value %02x", REGISTER_CTRL_HUM, ctrl_hum);
+		LOGE(LOG_BME280, "Cant write control registers hum %02x / meas %02x / config %02x: %d", ctrl_hum, ctrl_meas, config, res);
 		return res;
 	}
 
-	res = bme280_write_register(REGISTER_CTRL_MEAS, ctrl_meas);
+	return ESP_OK;
+}
+
+void bme280_load_settings() {
+	size_t buffer_size = 0;
+	uint8_t * buffer = NULL;
+
+	if (nvs_read_buffer(BME280_SETTINGS_NVS_NAME, &buffer, &buffer_size) != ESP_OK) {
+		return;
+	}
+
+	bme280_settings_nvs_t stored;
+	bool valid = (buffer_size == sizeof(bme280_settings_nvs_t));
+	if (valid) {
+		memcpy(&stored, buffer, sizeof(bme280_settings_nvs_t));
+	}
+	free(buffer);
+
+	if (!valid || stored.version != BME280_SETTINGS_NVS_VERSION) {
+		LOGW(LOG_BME280, "Bad settings in NVS");
+		return;
+	}
+
+	bme280_settings.mode = stored.mode;
+	bme280_settings.tosr = stored.tosr;
+	bme280_settings.hosr = stored.hosr;
+	bme280_settings.posr = stored.posr;
+	bme280_settings.time = stored.time;
+	bme280_settings.filter = stored.filter;
+}
+
+void bme280_get_settings(bme280_settings_t * settings) {
+	*settings = bme280_settings;
+}
+
+esp_err_t bme280_save_settings(bme280_settings_t * settings) {
+	if (bme280_i2c == NULL) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	if ((settings->mode != Mode_Forced && settings->mode != Mode_Normal)
+			|| settings->tosr > OSR_X16 || settings->hosr > OSR_X16 || settings->posr > OSR_X16
+			|| settings->time > StandbyTime_20ms || settings->filter > Filter_16) {
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	bme280_settings = *settings;
+
+	esp_err_t res = bme280_update_settings();
 	if (res) {
-		LOGE(LOG_BME280, "Cant write to control register %02x value %02x", REGISTER_CTRL_MEAS, ctrl_meas);
 		return res;
 	}
 
-	res = bme280_write_register(REGISTER_CONFIG, config);
+	bme280_settings_nvs_t stored = {
+		.version = BME280_SETTINGS_NVS_VERSION,
+		.mode = settings->mode,
+		.tosr = settings->tosr,
+		.hosr = settings->hosr,
+		.posr = settings->posr,
+		.time = settings->time,
+		.filter = settings->filter,
+	};
+
+	res = nvs_write_buffer(BME280_SETTINGS_NVS_NAME, (const uint8_t *)&stored, sizeof(bme280_settings_nvs_t));
 	if (res) {
-		LOGE(LOG_BME280, "Cant write to control register %02x value %02x", REGISTER_CONFIG, config);
-		return res;
+		LOGE(LOG_BME280, "Cant store settings: %04X", res);
 	}
 
-	return ESP_OK;
+	return res;
 }
 
 esp_err_t bme280_write_register(uint8_t register_id, uint8_t value) {
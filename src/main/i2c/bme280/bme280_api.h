@@ -37,7 +37,7 @@ typedef enum bme280_standby_time
    StandbyTime_62500us = 1,
    StandbyTime_125ms   = 2,
    StandbyTime_250ms   = 3,
-   StandbyTime_50ms    = 4,
+   StandbyTime_500ms   = 4,
    StandbyTime_1000ms  = 5,
    StandbyTime_10ms    = 6,
    StandbyTime_20ms    = 7
@@ -61,7 +61,16 @@ typedef struct bme280_settings_t {
 	bme280_filter filter;
 } bme280_settings_t;
 
+// Applies settings and keeps them in NVS. Only Mode_Forced and Mode_Normal are accepted,
+// in forced mode every bme280_read() starts a measurement and waits for it.
 esp_err_t bme280_save_settings(bme280_settings_t * settings);
+void bme280_get_settings(bme280_settings_t * settings);
+
+// oversampling factor, 0 - channel disabled
+uint8_t bme280_osr_samples(bme280_ocr osr);
+
+// maximum measurement time from the datasheet, us
+uint32_t bme280_measurement_time(const bme280_settings_t * settings);
 
 esp_err_t bme280_init_driver();
 
@@ -2,6 +2,7 @@
 
 #include "stdlib.h"
 
+#include "../../common/diag.h"
 #include "../../log/log.h"
 
 #define HI_COEFF1 -42.379
@@ -20,7 +21,7 @@
 #define absf(x) (((x) > 0) ? (x) : -(x))
 
 bme280_math_calibration_table_t * bme280_math_init_calibration_table(uint8_t * buffer_88, uint8_t * buffer_e1) {
-	bme280_math_calibration_table_t * calibration_table = malloc(sizeof(bme280_math_calibration_table_t));
+	bme280_math_calibration_table_t * calibration_table = diag_malloc(DIAG_HEAP_I2C, sizeof(bme280_math_calibration_table_t));
 
 	calibration_table->dig_T1 = (buffer_88[1] << 8)  | buffer_88[0];
 	calibration_table->dig_T2 = (buffer_88[3] << 8)  | buffer_88[2];
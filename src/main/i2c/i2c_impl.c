@@ -1,58 +1,322 @@
 #include "i2c_impl.h"
 
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "driver/i2c_master.h"
+#include "esp_timer.h"
 
+#include "../common/diag.h"
+#include "../common/profiler.h"
+#include "../common/mqtt.h"
+#include "../common/scheduler.h"
+#include "../cjson/json_writer.h"
 #include "../log/log.h"
 #include "string.h"
+#include "stdio.h"
 
 #define I2C_DEFAULT_SPEED 100000
 #define I2C_MASTER_TX_BUF_DISABLE 0                           /*!< I2C master doesn't need buffer */
 #define I2C_MASTER_RX_BUF_DISABLE 0                           /*!< I2C master doesn't need buffer */
 
-#define I2C_MUTEX_AWAIT ((TickType_t) 500)
-#define I2C_COMMAND_AWAIT (1000 / portTICK_PERIOD_MS)
+#define I2C_QUEUE_LENGTH      8
+#define I2C_QUEUE_AWAIT       ((TickType_t) 500)
+#define I2C_REQUEST_DEADLINE  1000000	// us in queue, after that the request fails without touching the bus
+#define I2C_TASK_STACK_SIZE   3072
+#define I2C_STATS_BUFFER_SIZE 512
 
 #define I2C_DEBUG_OUTPUT false
 
 typedef struct i2c_context_t {
+	uint8_t port;
 	uint8_t addr;
+	i2c_priority_t priority;
 	i2c_master_dev_handle_t dev_handle;
 	uint16_t transfer_timeout_ms;
 } i2c_context_t;
 
-SemaphoreHandle_t i2c_mutex = NULL;
-i2c_master_bus_handle_t i2c_bus_handle = NULL;
+// lives on the caller stack until done is given
+typedef struct {
+	const i2c_context_t * context;
+	const i2c_op_t * ops;
+	uint8_t ops_count;
+	int64_t queued_at;
+	esp_err_t result;
+	SemaphoreHandle_t done;
+} i2c_request_t;
+
+typedef struct {
+	uint32_t transactions;
+	uint32_t ops;
+	uint32_t errors;
+	uint32_t expired;	// waited longer than I2C_REQUEST_DEADLINE
+	uint32_t rejected;	// queue full
+	uint32_t contended;	// bus was busy or had queued requests on submit
+	uint32_t queued_max;
+	int64_t busy_us;
+	int64_t wait_us;
+	int64_t wait_max_us;
+} i2c_stats_t;
+
+typedef struct {
+	i2c_master_bus_handle_t bus;
+	TaskHandle_t task;
+	volatile bool busy;
+
+	QueueHandle_t queues[I2C_PRIORITY_MAX];
+	StaticQueue_t queues_buffer[I2C_PRIORITY_MAX];
+	uint8_t queues_storage[I2C_PRIORITY_MAX][I2C_QUEUE_LENGTH * sizeof(i2c_request_t *)];
+
+	SemaphoreHandle_t pending;
+	StaticSemaphore_t pending_buffer;
+
+	i2c_stats_t stats;
+	int64_t stats_since;
+} i2c_port_context_t;
+
+static i2c_port_context_t i2c_ports[I2C_PORTS];
+static portMUX_TYPE i2c_stats_lock = portMUX_INITIALIZER_UNLOCKED;
 
 esp_err_t i2c_read(void * i2c_handler_context, uint8_t* buffer, uint8_t buffer_size);
 esp_err_t i2c_write(void * i2c_handler_context, const uint8_t* buffer, uint8_t buffer_size);
 esp_err_t i2c_write_read(void * i2c_handler_context, const uint8_t* write_buffer, uint8_t write_buffer_size, uint8_t* read_buffer, uint8_t read_buffer_size);
+esp_err_t i2c_transaction(void * i2c_handler_context, const i2c_op_t * ops, uint8_t ops_count);
+
+static esp_err_t i2c_execute(const i2c_context_t * context, const i2c_op_t * op) {
+	PROFILER_SCOPE(PROFILER_SPAN_I2C);
+
+#if I2C_DEBUG_OUTPUT
+	LOGI(LOG_I2C, "i2c op %d for addr %02x on port %d", op->type, context->addr, context->port);
+	if (op->write_size) {
+		LOG_BUFFER_HEXDUMP(LOG_I2C, op->write_buffer, op->write_size, ESP_LOG_INFO);
+	}
+#endif
+
+	esp_err_t res = ESP_ERR_INVALID_ARG;
+	switch (op->type) {
+	case I2C_OP_WRITE:
+		res = i2c_master_transmit(context->dev_handle, op->write_buffer, op->write_size, context->transfer_timeout_ms);
+		break;
+	case I2C_OP_READ:
+		res = i2c_master_receive(context->dev_handle, op->read_buffer, op->read_size, context->transfer_timeout_ms);
+		break;
+	case I2C_OP_WRITE_READ:
+		memset(op->read_buffer, 0xAB, op->read_size);
+		res = i2c_master_transmit_receive(context->dev_handle, op->write_buffer, op->write_size, op->read_buffer, op->read_size, context->transfer_timeout_ms);
+		break;
+	}
+
+#if I2C_DEBUG_OUTPUT
+	if (res == ESP_OK && op->read_size) {
+		LOGI(LOG_I2C, "i2c received buffer from addr %02x", context->addr);
+		LOG_BUFFER_HEXDUMP(LOG_I2C, op->read_buffer, op->read_size, ESP_LOG_INFO);
+	}
+#endif
+
+	return res;
+}
+
+static i2c_request_t * i2c_next_request(i2c_port_context_t * port) {
+	i2c_request_t * request = NULL;
+	for (int8_t priority = I2C_PRIORITY_MAX - 1; priority >= 0; priority--) {
+		if (xQueueReceive(port->queues[priority], &request, 0) == pdTRUE) {
+			return request;
+		}
+	}
+	return NULL;
+}
+
+static void i2c_port_task(void * arg) {
+	i2c_port_context_t * port = (i2c_port_context_t *) arg;
+
+	while (true) {
+		xSemaphoreTake(port->pending, portMAX_DELAY);
+
+		i2c_request_t * request = i2c_next_request(port);
+		if (request == NULL) {
+			continue;
+		}
+
+		port->busy = true;
+
+		int64_t started = esp_timer_get_time();
+		int64_t waited = started - request->queued_at;
+		uint8_t executed = 0;
+
+		if (waited > I2C_REQUEST_DEADLINE) {
+			LOGE(LOG_I2C, "Request for addr %02X expired after %lld us in queue", request->context->addr, waited);
+			request->result = ESP_ERR_TIMEOUT;
+		} else {
+			request->result = ESP_OK;
+			for (; executed < request->ops_count && request->result == ESP_OK; executed++) {
+				request->result = i2c_execute(request->context, &request->ops[executed]);
+			}
+		}
+
+		int64_t busy = esp_timer_get_time() - started;
+
+		portENTER_CRITICAL(&i2c_stats_lock);
+		i2c_stats_t * stats = &port->stats;
+		stats->transactions++;
+		stats->ops += executed;
+		stats->busy_us += busy;
+		stats->wait_us += waited;
+		if (waited > stats->wait_max_us) {
+			stats->wait_max_us = waited;
+		}
+		if (waited > I2C_REQUEST_DEADLINE) {
+			stats->expired++;
+		} else if (request->result != ESP_OK) {
+			stats->errors++;
+		}
+		portEXIT_CRITICAL(&i2c_stats_lock);
+
+		port->busy = false;
+
+		xSemaphoreGive(request->done);
+	}
+}
+
+static esp_err_t i2c_submit(const i2c_context_t * context, const i2c_op_t * ops, uint8_t ops_count) {
+	i2c_port_context_t * port = &i2c_ports[context->port];
+
+	StaticSemaphore_t done_buffer;
+	i2c_request_t request = {
+		.context = context,
+		.ops = ops,
+		.ops_count = ops_count,
+		.queued_at = esp_timer_get_time(),
+		.result = ESP_FAIL,
+		.done = xSemaphoreCreateBinaryStatic(&done_buffer),
+	};
+	i2c_request_t * request_pointer = &request;
+
+	uint32_t queued = uxSemaphoreGetCount(port->pending);
+	bool contended = port->busy || queued > 0;
+
+	if (xQueueSend(port->queues[context->priority], &request_pointer, I2C_QUEUE_AWAIT) != pdTRUE) {
+		LOGE(LOG_I2C, "Queue for port %d is full, request for addr %02X rejected", context->port, context->addr);
+		portENTER_CRITICAL(&i2c_stats_lock);
+		port->stats.rejected++;
+		portEXIT_CRITICAL(&i2c_stats_lock);
+		vSemaphoreDelete(request.done);
+		return ESP_ERR_TIMEOUT;
+	}
+
+	portENTER_CRITICAL(&i2c_stats_lock);
+	if (contended) {
+		port->stats.contended++;
+	}
+	if (queued + 1 > port->stats.queued_max) {
+		port->stats.queued_max = queued + 1;
+	}
+	portEXIT_CRITICAL(&i2c_stats_lock);
+
+	xSemaphoreGive(port->pending);
+
+	// the port task always completes a request: bus ops are bounded by transfer_timeout_ms
+	xSemaphoreTake(request.done, portMAX_DELAY);
+	vSemaphoreDelete(request.done);
+
+	return request.result;
+}
+
+#if CONFIG_I2C_STATS_ENABLED
+// {"0":{"transactions":n,"ops":n,"errors":n,"expired":n,"rejected":n,"contended":n,"queued_max":n,
+//       "utilization":%,"wait_avg":us,"wait_max":us},"1":{...}}
+// Counters cover the time since the previous publish.
+static void i2c_publish_stats(void *) {
+	static char buffer[I2C_STATS_BUFFER_SIZE];
+
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+
+	int64_t now = esp_timer_get_time();
+	for (uint8_t i = 0; i<I2C_PORTS; i++) {
+		i2c_port_context_t * port = &i2c_ports[i];
+		if (port->bus == NULL) {
+			continue;
+		}
+
+		portENTER_CRITICAL(&i2c_stats_lock);
+		i2c_stats_t stats = port->stats;
+		memset(&port->stats, 0, sizeof(i2c_stats_t));
+		int64_t elapsed = now - port->stats_since;
+		port->stats_since = now;
+		portEXIT_CRITICAL(&i2c_stats_lock);
+
+		char name[4];
+		snprintf(name, sizeof(name), "%d", i);
+
+		json_writer_begin_object(&writer, name);
+		json_writer_add_int(&writer, "transactions", stats.transactions);
+		json_writer_add_int(&writer, "ops", stats.ops);
+		json_writer_add_int(&writer, "errors", stats.errors);
+		json_writer_add_int(&writer, "expired", stats.expired);
+		json_writer_add_int(&writer, "rejected", stats.rejected);
+		json_writer_add_int(&writer, "contended", stats.contended);
+		json_writer_add_int(&writer, "queued_max", stats.queued_max);
+		json_writer_add_float(&writer, "utilization", elapsed > 0 ? stats.busy_us * 100.0 / elapsed : 0, 2);
+		json_writer_add_int(&writer, "wait_avg", stats.transactions ? stats.wait_us / stats.transactions : 0);
+		json_writer_add_int(&writer, "wait_max", stats.wait_max_us);
+		json_writer_end_object(&writer);
+	}
+
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish_nolog(MQTT_TOPIC(CONFIG_I2C_TOPIC_STATS), json);
+	}
+}
+#endif
+
+void i2c_init_driver(uint8_t port_id, int gpio_sda, int gpio_scl){
+	if (port_id >= I2C_PORTS) {
+		LOGE(LOG_I2C, "Bad I2C port %d", port_id);
+		return;
+	}
+
+	i2c_port_context_t * port = &i2c_ports[port_id];
 
-void i2c_init_driver(int gpio_sda, int gpio_scl){
 	i2c_master_bus_config_t conf = {
 		.clk_source = I2C_CLK_SRC_DEFAULT,
-		.i2c_port = I2C_NUM_0,
+		.i2c_port = port_id,
         .scl_io_num = gpio_scl,
         .sda_io_num = gpio_sda
 	};
 
-	ESP_ERROR_CHECK(i2c_new_master_bus(&conf, &i2c_bus_handle));
+	ESP_ERROR_CHECK(i2c_new_master_bus(&conf, &port->bus));
 
-	vSemaphoreCreateBinary(i2c_mutex);
-	if (i2c_mutex == NULL) {
-	    LOGE(LOG_I2C, "Cant init semaphore");
+	for (uint8_t i = 0; i<I2C_PRIORITY_MAX; i++) {
+		port->queues[i] = xQueueCreateStatic(I2C_QUEUE_LENGTH, sizeof(i2c_request_t *), port->queues_storage[i], &port->queues_buffer[i]);
+	}
+	port->pending = xSemaphoreCreateCountingStatic(I2C_QUEUE_LENGTH * I2C_PRIORITY_MAX, 0, &port->pending_buffer);
+	port->stats_since = esp_timer_get_time();
+
+	char task_name[8];
+	snprintf(task_name, sizeof(task_name), "i2c%d", port_id);
+	xTaskCreate(i2c_port_task, task_name, I2C_TASK_STACK_SIZE, port, 10, &port->task);
+	if (port->task == NULL) {
+		LOGE(LOG_I2C, "Cant start task for port %d", port_id);
+		port->bus = NULL;
 		return;
 	}
+	diag_register_task(port->task);
+
+#if CONFIG_I2C_STATS_ENABLED
+	static bool stats_scheduled = false;
+	if (!stats_scheduled) {
+		stats_scheduled = scheduler_add(SCHEDULER_BUS_SYSTEM, "i2c stats", CONFIG_I2C_STATS_PERIOD * 1000, i2c_publish_stats, NULL) == ESP_OK;
+	}
+#endif
 
-    LOGI(LOG_I2C, "I2C port with pins sda %d / scl %d initialized", gpio_sda, gpio_scl);
+    LOGI(LOG_I2C, "I2C port %d with pins sda %d / scl %d initialized", port_id, gpio_sda, gpio_scl);
 }
 
-i2c_handler_t * i2c_get_handlers(uint8_t addr, uint16_t transfer_timeout_ms){
-	if (i2c_bus_handle == NULL) {
-		LOGE(LOG_I2C, "I2C port not initialized yet");
+i2c_handler_t * i2c_get_handlers(uint8_t port, uint8_t addr, uint16_t transfer_timeout_ms, i2c_priority_t priority){
+	if (port >= I2C_PORTS || i2c_ports[port].bus == NULL) {
+		LOGE(LOG_I2C, "I2C port %d not initialized yet", port);
 		return NULL;
 	}
 
@@ -62,22 +326,25 @@ i2c_handler_t * i2c_get_handlers(uint8_t addr, uint16_t transfer_timeout_ms){
 	    .scl_speed_hz = I2C_DEFAULT_SPEED,
 	};
 	i2c_master_dev_handle_t dev_handle;
-	ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_bus_handle, &dev_cfg, &dev_handle));
+	ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_ports[port].bus, &dev_cfg, &dev_handle));
 
-    i2c_handler_t * result = (i2c_handler_t*) malloc(sizeof(i2c_handler_t));
+    i2c_handler_t * result = (i2c_handler_t*) diag_malloc(DIAG_HEAP_I2C, sizeof(i2c_handler_t));
     memset(result, 0, sizeof(i2c_handler_t));
 
     result->read = i2c_read;
     result->write = i2c_write;
     result->write_read = i2c_write_read;
-    result->context = malloc(sizeof(i2c_context_t));
+    result->transaction = i2c_transaction;
+    result->context = diag_malloc(DIAG_HEAP_I2C, sizeof(i2c_context_t));
     if (result->context == NULL) {
-    	free(result);
+    	diag_free(DIAG_HEAP_I2C, result);
     	result = NULL;
     	return NULL;
     }
 
+    ((i2c_context_t*)result->context)->port                = port;
     ((i2c_context_t*)result->context)->addr                = addr;
+    ((i2c_context_t*)result->context)->priority            = priority < I2C_PRIORITY_MAX ? priority : I2C_PRIORITY_NORMAL;
     ((i2c_context_t*)result->context)->dev_handle          = dev_handle;
     ((i2c_context_t*)result->context)->transfer_timeout_ms = transfer_timeout_ms;
 
@@ -85,76 +352,41 @@ i2c_handler_t * i2c_get_handlers(uint8_t addr, uint16_t transfer_timeout_ms){
 }
 
 esp_err_t i2c_read(void * i2c_handler_context, uint8_t* buffer, uint8_t buffer_size) {
-	i2c_context_t * context = (i2c_context_t *) i2c_handler_context;
-
-#if I2C_DEBUG_OUTPUT
-	LOGI(LOG_I2C, "i2c_read send request to port addr %02x", context->addr);
-#endif
-
-	if (xSemaphoreTake(i2c_mutex, I2C_MUTEX_AWAIT) != pdTRUE) {
-		LOGE(LOG_I2C, "i2c_read take mutex timeout for address %02X", context->addr);
-		return ESP_ERR_TIMEOUT;
-	}
-
-	esp_err_t res = i2c_master_receive(context->dev_handle, buffer, buffer_size, context->transfer_timeout_ms);
-
-    xSemaphoreGive(i2c_mutex);
-
-#if I2C_DEBUG_OUTPUT
-    if (res == ESP_OK) {
-    	LOGI(LOG_I2C, "i2c_read received buffer from addr %02x", context->addr);
-		LOG_BUFFER_HEXDUMP(LOG_I2C, buffer, buffer_size, ESP_LOG_INFO);
-    }
-#endif
+	i2c_op_t op = {
+		.type = I2C_OP_READ,
+		.read_buffer = buffer,
+		.read_size = buffer_size,
+	};
 
-    return res;
+	return i2c_submit((i2c_context_t *) i2c_handler_context, &op, 1);
 }
 
 esp_err_t i2c_write(void * i2c_handler_context, const uint8_t* buffer, uint8_t buffer_size) {
-	i2c_context_t * context = (i2c_context_t *) i2c_handler_context;
-
-#if I2C_DEBUG_OUTPUT
-	LOGI(LOG_I2C, "i2c_write sending buffer to addr %02x", context->addr);
-	LOG_BUFFER_HEXDUMP(LOG_I2C, buffer, buffer_size, ESP_LOG_INFO);
-#endif
-
-	if (xSemaphoreTake(i2c_mutex, I2C_MUTEX_AWAIT) != pdTRUE) {
-		LOGE(LOG_I2C, "i2c_write addr_id %d take mutex timeout", context->addr);
-		return ESP_ERR_TIMEOUT;
-	}
-
-	esp_err_t res = i2c_master_transmit(context->dev_handle, buffer, buffer_size, context->transfer_timeout_ms);
-
-    xSemaphoreGive(i2c_mutex);
+	i2c_op_t op = {
+		.type = I2C_OP_WRITE,
+		.write_buffer = buffer,
+		.write_size = buffer_size,
+	};
 
-    return res;
+	return i2c_submit((i2c_context_t *) i2c_handler_context, &op, 1);
 }
 
 esp_err_t i2c_write_read(void * i2c_handler_context, const uint8_t* write_buffer, uint8_t write_buffer_size, uint8_t* read_buffer, uint8_t read_buffer_size) {
-	i2c_context_t * context = (i2c_context_t *) i2c_handler_context;
-
-#if I2C_DEBUG_OUTPUT
-	LOGI(LOG_I2C, "i2c_write_read send buffer to addr %02x", context->addr);
-	LOG_BUFFER_HEXDUMP(LOG_I2C, write_buffer, write_buffer_size, ESP_LOG_INFO);
-#endif
-
-	memset(read_buffer, 0xAB, read_buffer_size);
-
-	if (xSemaphoreTake(i2c_mutex, I2C_MUTEX_AWAIT) != pdTRUE) {
-		LOGE(LOG_I2C, "i2c_write_read take mutex timeout for address %d", context->addr);
-		return ESP_ERR_TIMEOUT;
-	}
-
-	esp_err_t res = i2c_master_transmit_receive(context->dev_handle, write_buffer, write_buffer_size, read_buffer, read_buffer_size, context->transfer_timeout_ms);
+	i2c_op_t op = {
+		.type = I2C_OP_WRITE_READ,
+		.write_buffer = write_buffer,
+		.write_size = write_buffer_size,
+		.read_buffer = read_buffer,
+		.read_size = read_buffer_size,
+	};
 
-	xSemaphoreGive(i2c_mutex);
+	return i2c_submit((i2c_context_t *) i2c_handler_context, &op, 1);
+}
 
-#if I2C_DEBUG_OUTPUT
-	if (res == ESP_OK) {
-		LOGI(LOG_I2C, "i2c_write_read received buffer from addr %02x", context->addr);
-		LOG_BUFFER_HEXDUMP(LOG_I2C, read_buffer, read_buffer_size, ESP_LOG_INFO);
+esp_err_t i2c_transaction(void * i2c_handler_context, const i2c_op_t * ops, uint8_t ops_count) {
+	if (ops == NULL || ops_count == 0) {
+		return ESP_ERR_INVALID_ARG;
 	}
-#endif
 
-	return res;
+	return i2c_submit((i2c_context_t *) i2c_handler_context, ops, ops_count);
 }
@@ -4,19 +4,50 @@
 #include "stdint.h"
 #include "esp_err.h"
 
+// Every I2C port is served by its own task. Transactions wait in per-priority queues and
+// run one at a time, highest priority first. Bus utilization and contention are published
+// on CONFIG_I2C_TOPIC_STATS.
+
+#define I2C_PORTS 2
+
+typedef enum {
+	I2C_PRIORITY_LOW = 0,
+	I2C_PRIORITY_NORMAL,
+	I2C_PRIORITY_HIGH,
+
+	I2C_PRIORITY_MAX
+} i2c_priority_t;
+
+typedef enum {
+	I2C_OP_WRITE = 0,
+	I2C_OP_READ,
+	I2C_OP_WRITE_READ,
+} i2c_op_type_t;
+
+typedef struct {
+	i2c_op_type_t type;
+	const uint8_t * write_buffer;
+	uint8_t write_size;
+	uint8_t * read_buffer;
+	uint8_t read_size;
+} i2c_op_t;
+
 typedef esp_err_t (* i2c_read_function)(void * i2c_handler_context, uint8_t* buffer, uint8_t buffer_size);
 typedef esp_err_t (* i2c_write_function)(void * i2c_handler_context, const uint8_t* buffer, uint8_t buffer_size);
 typedef esp_err_t (* i2c_write_read_function)(void * i2c_handler_context, const uint8_t* write_buffer, uint8_t write_buffer_size, uint8_t* read_buffer, uint8_t read_buffer_size);
+// ops run back to back, no other device gets the bus in between. Stops on the first error.
+typedef esp_err_t (* i2c_transaction_function)(void * i2c_handler_context, const i2c_op_t * ops, uint8_t ops_count);
 
 typedef struct i2c_handler_t {
 	void * context;
 	i2c_read_function read;
 	i2c_write_function write;
 	i2c_write_read_function write_read;
+	i2c_transaction_function transaction;
 } i2c_handler_t;
 
-void i2c_init_driver(int gpio_sda, int gpio_scl);
+void i2c_init_driver(uint8_t port, int gpio_sda, int gpio_scl);
 
-i2c_handler_t * i2c_get_handlers(uint8_t addr, uint16_t transfer_timeout_ms);
+i2c_handler_t * i2c_get_handlers(uint8_t port, uint8_t addr, uint16_t transfer_timeout_ms, i2c_priority_t priority);
 
 #endif /* MAIN_I2C_I2C_IMPL_H_ */
@@ -0,0 +1,419 @@
+#include "sensirion_gas_index_algorithm_fix16.h"
+
+// Based on sensirion_gas_index_algorithm.c, see the float version for the algorithm description.
+// GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING exists in the original algorithm to keep
+// intermediate values inside the Q16.16 range. Processing uses integer math only, double is used
+// once at init for the estimator gammas.
+
+#define F16(x) ((fix16_t)(((x) >= 0) ? ((x) * 65536.0 + 0.5) : ((x) * 65536.0 - 0.5)))
+
+#define FIX16_ONE     ((fix16_t)0x00010000)
+#define FIX16_MAXIMUM ((fix16_t)0x7FFFFFFF)
+#define FIX16_MINIMUM ((fix16_t)0x80000000)
+
+static inline fix16_t fix16_from_int(int32_t value) {
+	return value * FIX16_ONE;
+}
+
+static inline int32_t fix16_cast_to_int(fix16_t value) {
+	return (value >= 0) ? ((value + (FIX16_ONE >> 1)) >> 16) : -((-value + (FIX16_ONE >> 1)) >> 16);
+}
+
+static inline fix16_t fix16_saturate(int64_t value) {
+	if (value > FIX16_MAXIMUM) {
+		return FIX16_MAXIMUM;
+	}
+	if (value < FIX16_MINIMUM) {
+		return FIX16_MINIMUM;
+	}
+	return (fix16_t)value;
+}
+
+static inline fix16_t fix16_mul(fix16_t a, fix16_t b) {
+	int64_t product = (int64_t)a * b;
+	return fix16_saturate((product + (product >= 0 ? 0x8000 : -0x8000)) / 0x10000);
+}
+
+static fix16_t fix16_div(fix16_t a, fix16_t b) {
+	if (b == 0) {
+		return (a >= 0) ? FIX16_MAXIMUM : FIX16_MINIMUM;
+	}
+
+	int64_t numerator = (int64_t)a * 0x10000;
+	int64_t half = ((b >= 0) == (a >= 0)) ? (b / 2) : -(b / 2);
+	return fix16_saturate((numerator + half) / b);
+}
+
+// sqrt of a Q16.16 value held in 64 bits, rounded to nearest
+static fix16_t fix16_sqrt64(int64_t value) {
+	if (value <= 0) {
+		return 0;
+	}
+
+	// integer sqrt of value << 16 gives the Q16.16 result
+	uint64_t number = (uint64_t)value << 16;
+	uint64_t result = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+
+	while (bit > number) {
+		bit >>= 2;
+	}
+
+	while (bit != 0) {
+		if (number >= result + bit) {
+			number -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	if (number > result) {
+		result++;
+	}
+
+	return fix16_saturate((int64_t)result);
+}
+
+// a * b of Q16.16 values held in 64 bits, rounded
+static inline int64_t fix16_mul64(int64_t a, int64_t b) {
+	int64_t product = a * b;
+	return (product + (product >= 0 ? 0x8000 : -0x8000)) / 0x10000;
+}
+
+// e^x = 2^(x * log2(e)): integer part is a shift, fractional part is a polynomial (error < 1 LSB).
+// Saturates one below the maximum so that 1 + e^x in the sigmoids cannot overflow.
+static fix16_t fix16_exp(fix16_t value) {
+	if (value >= F16(10.3972)) {
+		return FIX16_MAXIMUM - FIX16_ONE;
+	}
+	if (value <= F16(-11.7835)) {
+		return 0;
+	}
+
+	fix16_t y = fix16_mul(value, F16(1.4426950409));
+	int32_t k = y >> 16;
+	fix16_t f = y - fix16_from_int(k);
+
+	fix16_t p = F16(0.0013333558);
+	p = F16(0.0096181291) + fix16_mul(p, f);
+	p = F16(0.0555041087) + fix16_mul(p, f);
+	p = F16(0.2402265070) + fix16_mul(p, f);
+	p = F16(0.6931471806) + fix16_mul(p, f);
+	p = FIX16_ONE + fix16_mul(p, f);
+
+	if (k >= 0) {
+		int64_t result = (int64_t)p << k;
+		return (result > FIX16_MAXIMUM - FIX16_ONE) ? (FIX16_MAXIMUM - FIX16_ONE) : (fix16_t)result;
+	}
+
+	return (p + (1 << (-k - 1))) >> (-k);
+}
+
+// scale / (1 + e^x). For x > 0 as scale * e^-x / (1 + e^-x): e^x saturates at x = 10.4 and the
+// direct form would never go below 2 LSB, e^-x keeps the small values down to 0.
+static fix16_t fix16_logistic(fix16_t scale, fix16_t x) {
+	if (x > 0) {
+		fix16_t e = fix16_exp(-x);
+		return fix16_div(fix16_mul(scale, e), FIX16_ONE + e);
+	}
+
+	return fix16_div(scale, FIX16_ONE + fix16_exp(x));
+}
+
+static void GasIndexAlgorithmFix16__init_instances(GasIndexAlgorithmFix16Params* params);
+static void GasIndexAlgorithmFix16__mean_variance_estimator__set_parameters(GasIndexAlgorithmFix16Params* params);
+static void GasIndexAlgorithmFix16__mean_variance_estimator__process(GasIndexAlgorithmFix16Params* params, fix16_t sraw);
+static fix16_t GasIndexAlgorithmFix16__mox_model__process(GasIndexAlgorithmFix16Params* params, fix16_t sraw);
+static fix16_t GasIndexAlgorithmFix16__sigmoid_scaled__process(GasIndexAlgorithmFix16Params* params, fix16_t sample);
+static void GasIndexAlgorithmFix16__adaptive_lowpass__set_parameters(GasIndexAlgorithmFix16Params* params);
+static fix16_t GasIndexAlgorithmFix16__adaptive_lowpass__process(GasIndexAlgorithmFix16Params* params, fix16_t sample);
+
+void GasIndexAlgorithmFix16_init_with_sampling_interval(GasIndexAlgorithmFix16Params* params, int32_t algorithm_type, float sampling_interval) {
+	params->mAlgorithm_Type = algorithm_type;
+	params->mSamplingInterval = F16(sampling_interval);
+	if (algorithm_type == GasIndexAlgorithm_ALGORITHM_TYPE_NOX) {
+		params->mIndex_Offset = F16(GasIndexAlgorithm_NOX_INDEX_OFFSET_DEFAULT);
+		params->mSraw_Minimum = GasIndexAlgorithm_NOX_SRAW_MINIMUM;
+		params->mGating_Max_Duration_Minutes = F16(GasIndexAlgorithm_GATING_NOX_MAX_DURATION_MINUTES);
+		params->mInit_Duration_Mean = F16(GasIndexAlgorithm_INIT_DURATION_MEAN_NOX);
+		params->mInit_Duration_Variance = F16(GasIndexAlgorithm_INIT_DURATION_VARIANCE_NOX);
+		params->mGating_Threshold = F16(GasIndexAlgorithm_GATING_THRESHOLD_NOX);
+	} else {
+		params->mIndex_Offset = F16(GasIndexAlgorithm_VOC_INDEX_OFFSET_DEFAULT);
+		params->mSraw_Minimum = GasIndexAlgorithm_VOC_SRAW_MINIMUM;
+		params->mGating_Max_Duration_Minutes = F16(GasIndexAlgorithm_GATING_VOC_MAX_DURATION_MINUTES);
+		params->mInit_Duration_Mean = F16(GasIndexAlgorithm_INIT_DURATION_MEAN_VOC);
+		params->mInit_Duration_Variance = F16(GasIndexAlgorithm_INIT_DURATION_VARIANCE_VOC);
+		params->mGating_Threshold = F16(GasIndexAlgorithm_GATING_THRESHOLD_VOC);
+	}
+	params->mIndex_Gain = F16(GasIndexAlgorithm_INDEX_GAIN);
+	params->mTau_Mean_Hours = F16(GasIndexAlgorithm_TAU_MEAN_HOURS);
+	params->mTau_Variance_Hours = F16(GasIndexAlgorithm_TAU_VARIANCE_HOURS);
+	params->mSraw_Std_Initial = F16(GasIndexAlgorithm_SRAW_STD_INITIAL);
+	GasIndexAlgorithmFix16_reset(params);
+}
+
+void GasIndexAlgorithmFix16_reset(GasIndexAlgorithmFix16Params* params) {
+	params->mUptime = 0;
+	params->mSraw = 0;
+	params->mGas_Index = 0;
+	GasIndexAlgorithmFix16__init_instances(params);
+}
+
+static fix16_t GasIndexAlgorithmFix16__mean_variance_estimator__get_mean(const GasIndexAlgorithmFix16Params* params) {
+	return params->m_Mean_Variance_Estimator___Mean + params->m_Mean_Variance_Estimator___Sraw_Offset;
+}
+
+static void GasIndexAlgorithmFix16__mox_model__set_parameters(GasIndexAlgorithmFix16Params* params) {
+	params->m_Mox_Model__Sraw_Std = params->m_Mean_Variance_Estimator___Std;
+	params->m_Mox_Model__Sraw_Mean = GasIndexAlgorithmFix16__mean_variance_estimator__get_mean(params);
+}
+
+static void GasIndexAlgorithmFix16__init_instances(GasIndexAlgorithmFix16Params* params) {
+	GasIndexAlgorithmFix16__mean_variance_estimator__set_parameters(params);
+	GasIndexAlgorithmFix16__mox_model__set_parameters(params);
+	if (params->mAlgorithm_Type == GasIndexAlgorithm_ALGORITHM_TYPE_NOX) {
+		params->m_Sigmoid_Scaled__K = F16(GasIndexAlgorithm_SIGMOID_K_NOX);
+		params->m_Sigmoid_Scaled__X0 = F16(GasIndexAlgorithm_SIGMOID_X0_NOX);
+		params->m_Sigmoid_Scaled__Offset_Default = F16(GasIndexAlgorithm_NOX_INDEX_OFFSET_DEFAULT);
+	} else {
+		params->m_Sigmoid_Scaled__K = F16(GasIndexAlgorithm_SIGMOID_K_VOC);
+		params->m_Sigmoid_Scaled__X0 = F16(GasIndexAlgorithm_SIGMOID_X0_VOC);
+		params->m_Sigmoid_Scaled__Offset_Default = F16(GasIndexAlgorithm_VOC_INDEX_OFFSET_DEFAULT);
+	}
+	GasIndexAlgorithmFix16__adaptive_lowpass__set_parameters(params);
+}
+
+void GasIndexAlgorithmFix16_get_states(const GasIndexAlgorithmFix16Params* params, float* state0, float* state1) {
+	*state0 = (float)GasIndexAlgorithmFix16__mean_variance_estimator__get_mean(params) / 65536.0f;
+	*state1 = (float)params->m_Mean_Variance_Estimator___Std / 65536.0f;
+}
+
+void GasIndexAlgorithmFix16_set_states(GasIndexAlgorithmFix16Params* params, float state0, float state1) {
+	params->m_Mean_Variance_Estimator___Mean = F16(state0);
+	params->m_Mean_Variance_Estimator___Std = F16(state1);
+	params->m_Mean_Variance_Estimator___Uptime_Gamma = F16(GasIndexAlgorithm_PERSISTENCE_UPTIME_GAMMA);
+	params->m_Mean_Variance_Estimator___Initialized = true;
+	GasIndexAlgorithmFix16__mox_model__set_parameters(params);
+	params->mSraw = F16(state0);
+}
+
+void GasIndexAlgorithmFix16_process(GasIndexAlgorithmFix16Params* params, int32_t sraw, int32_t* gas_index) {
+	if (params->mUptime <= F16(GasIndexAlgorithm_INITIAL_BLACKOUT)) {
+		params->mUptime = params->mUptime + params->mSamplingInterval;
+	} else {
+		if (sraw > 0 && sraw < 65000) {
+			if (sraw < (params->mSraw_Minimum + 1)) {
+				sraw = params->mSraw_Minimum + 1;
+			} else if (sraw > (params->mSraw_Minimum + 32767)) {
+				sraw = params->mSraw_Minimum + 32767;
+			}
+			params->mSraw = fix16_from_int(sraw - params->mSraw_Minimum);
+		}
+		if (params->mAlgorithm_Type == GasIndexAlgorithm_ALGORITHM_TYPE_VOC ||
+				params->m_Mean_Variance_Estimator___Initialized) {
+			params->mGas_Index = GasIndexAlgorithmFix16__mox_model__process(params, params->mSraw);
+			params->mGas_Index = GasIndexAlgorithmFix16__sigmoid_scaled__process(params, params->mGas_Index);
+		} else {
+			params->mGas_Index = params->mIndex_Offset;
+		}
+		params->mGas_Index = GasIndexAlgorithmFix16__adaptive_lowpass__process(params, params->mGas_Index);
+		if (params->mGas_Index < F16(0.5)) {
+			params->mGas_Index = F16(0.5);
+		}
+		if (params->mSraw > 0) {
+			GasIndexAlgorithmFix16__mean_variance_estimator__process(params, params->mSraw);
+			GasIndexAlgorithmFix16__mox_model__set_parameters(params);
+		}
+	}
+	*gas_index = fix16_cast_to_int(params->mGas_Index);
+}
+
+static void GasIndexAlgorithmFix16__mean_variance_estimator__set_parameters(GasIndexAlgorithmFix16Params* params) {
+	// init time only: the gammas are computed in double, the sampling interval in hours (0.0028 for 10 s)
+	// has a relative error of 2.4e-4 in Q16.16 and it would be carried into every mean and std update
+	double interval = (double)params->mSamplingInterval / 65536.0;
+	double interval_hours = interval / 3600.0;
+	double tau_mean_hours = (double)params->mTau_Mean_Hours / 65536.0;
+	double tau_variance_hours = (double)params->mTau_Variance_Hours / 65536.0;
+	double tau_initial_mean = (params->mAlgorithm_Type == GasIndexAlgorithm_ALGORITHM_TYPE_NOX) ?
+			GasIndexAlgorithm_TAU_INITIAL_MEAN_NOX : GasIndexAlgorithm_TAU_INITIAL_MEAN_VOC;
+
+	params->m_Mean_Variance_Estimator___Initialized = false;
+	params->m_Mean_Variance_Estimator___Mean = 0;
+	params->m_Mean_Variance_Estimator___Sraw_Offset = 0;
+	params->m_Mean_Variance_Estimator___Std = params->mSraw_Std_Initial;
+	params->m_Mean_Variance_Estimator___Gamma_Mean = F16(
+			(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__ADDITIONAL_GAMMA_MEAN_SCALING * GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING * interval_hours) /
+			(tau_mean_hours + interval_hours));
+	params->m_Mean_Variance_Estimator___Gamma_Variance = F16(
+			(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING * interval_hours) / (tau_variance_hours + interval_hours));
+	params->m_Mean_Variance_Estimator___Gamma_Initial_Mean = F16(
+			(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__ADDITIONAL_GAMMA_MEAN_SCALING * GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING * interval) /
+			(tau_initial_mean + interval));
+	params->m_Mean_Variance_Estimator___Gamma_Initial_Variance = F16(
+			(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING * interval) / (GasIndexAlgorithm_TAU_INITIAL_VARIANCE + interval));
+	params->m_Mean_Variance_Estimator__Gamma_Mean = 0;
+	params->m_Mean_Variance_Estimator__Gamma_Variance = 0;
+	params->m_Mean_Variance_Estimator___Uptime_Gamma = 0;
+	params->m_Mean_Variance_Estimator___Uptime_Gating = 0;
+	params->m_Mean_Variance_Estimator___Gating_Duration_Minutes = 0;
+}
+
+static fix16_t GasIndexAlgorithmFix16__mean_variance_estimator___sigmoid__process(GasIndexAlgorithmFix16Params* params, fix16_t sample) {
+	fix16_t x = fix16_mul(params->m_Mean_Variance_Estimator___Sigmoid__K, sample - params->m_Mean_Variance_Estimator___Sigmoid__X0);
+	if (x < F16(-50.0)) {
+		return FIX16_ONE;
+	} else if (x > F16(50.0)) {
+		return 0;
+	} else {
+		return fix16_logistic(FIX16_ONE, x);
+	}
+}
+
+static void GasIndexAlgorithmFix16__mean_variance_estimator___calculate_gamma(GasIndexAlgorithmFix16Params* params) {
+	fix16_t uptime_limit = F16(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__FIX16_MAX) - params->mSamplingInterval;
+	if (params->m_Mean_Variance_Estimator___Uptime_Gamma < uptime_limit) {
+		params->m_Mean_Variance_Estimator___Uptime_Gamma += params->mSamplingInterval;
+	}
+	if (params->m_Mean_Variance_Estimator___Uptime_Gating < uptime_limit) {
+		params->m_Mean_Variance_Estimator___Uptime_Gating += params->mSamplingInterval;
+	}
+
+	params->m_Mean_Variance_Estimator___Sigmoid__X0 = params->mInit_Duration_Mean;
+	params->m_Mean_Variance_Estimator___Sigmoid__K = F16(GasIndexAlgorithm_INIT_TRANSITION_MEAN);
+	fix16_t sigmoid_gamma_mean = GasIndexAlgorithmFix16__mean_variance_estimator___sigmoid__process(params, params->m_Mean_Variance_Estimator___Uptime_Gamma);
+	fix16_t gamma_mean = params->m_Mean_Variance_Estimator___Gamma_Mean +
+			fix16_mul(params->m_Mean_Variance_Estimator___Gamma_Initial_Mean - params->m_Mean_Variance_Estimator___Gamma_Mean, sigmoid_gamma_mean);
+	fix16_t gating_threshold_mean = params->mGating_Threshold +
+			fix16_mul(F16(GasIndexAlgorithm_GATING_THRESHOLD_INITIAL) - params->mGating_Threshold,
+					GasIndexAlgorithmFix16__mean_variance_estimator___sigmoid__process(params, params->m_Mean_Variance_Estimator___Uptime_Gating));
+	params->m_Mean_Variance_Estimator___Sigmoid__X0 = gating_threshold_mean;
+	params->m_Mean_Variance_Estimator___Sigmoid__K = F16(GasIndexAlgorithm_GATING_THRESHOLD_TRANSITION);
+	fix16_t sigmoid_gating_mean = GasIndexAlgorithmFix16__mean_variance_estimator___sigmoid__process(params, params->mGas_Index);
+	params->m_Mean_Variance_Estimator__Gamma_Mean = fix16_mul(sigmoid_gating_mean, gamma_mean);
+
+	params->m_Mean_Variance_Estimator___Sigmoid__X0 = params->mInit_Duration_Variance;
+	params->m_Mean_Variance_Estimator___Sigmoid__K = F16(GasIndexAlgorithm_INIT_TRANSITION_VARIANCE);
+	fix16_t sigmoid_gamma_variance = GasIndexAlgorithmFix16__mean_variance_estimator___sigmoid__process(params, params->m_Mean_Variance_Estimator___Uptime_Gamma);
+	fix16_t gamma_variance = params->m_Mean_Variance_Estimator___Gamma_Variance +
+			fix16_mul(params->m_Mean_Variance_Estimator___Gamma_Initial_Variance - params->m_Mean_Variance_Estimator___Gamma_Variance,
+					sigmoid_gamma_variance - sigmoid_gamma_mean);
+	fix16_t gating_threshold_variance = params->mGating_Threshold +
+			fix16_mul(F16(GasIndexAlgorithm_GATING_THRESHOLD_INITIAL) - params->mGating_Threshold,
+					GasIndexAlgorithmFix16__mean_variance_estimator___sigmoid__process(params, params->m_Mean_Variance_Estimator___Uptime_Gating));
+	params->m_Mean_Variance_Estimator___Sigmoid__X0 = gating_threshold_variance;
+	params->m_Mean_Variance_Estimator___Sigmoid__K = F16(GasIndexAlgorithm_GATING_THRESHOLD_TRANSITION);
+	fix16_t sigmoid_gating_variance = GasIndexAlgorithmFix16__mean_variance_estimator___sigmoid__process(params, params->mGas_Index);
+	params->m_Mean_Variance_Estimator__Gamma_Variance = fix16_mul(sigmoid_gating_variance, gamma_variance);
+
+	params->m_Mean_Variance_Estimator___Gating_Duration_Minutes +=
+			fix16_mul(fix16_div(params->mSamplingInterval, F16(60.0)),
+					fix16_mul(FIX16_ONE - sigmoid_gating_mean, F16(1.0 + GasIndexAlgorithm_GATING_MAX_RATIO)) - F16(GasIndexAlgorithm_GATING_MAX_RATIO));
+	if (params->m_Mean_Variance_Estimator___Gating_Duration_Minutes < 0) {
+		params->m_Mean_Variance_Estimator___Gating_Duration_Minutes = 0;
+	}
+	if (params->m_Mean_Variance_Estimator___Gating_Duration_Minutes > params->mGating_Max_Duration_Minutes) {
+		params->m_Mean_Variance_Estimator___Uptime_Gating = 0;
+	}
+}
+
+static void GasIndexAlgorithmFix16__mean_variance_estimator__process(GasIndexAlgorithmFix16Params* params, fix16_t sraw) {
+	if (!params->m_Mean_Variance_Estimator___Initialized) {
+		params->m_Mean_Variance_Estimator___Initialized = true;
+		params->m_Mean_Variance_Estimator___Sraw_Offset = sraw;
+		params->m_Mean_Variance_Estimator___Mean = 0;
+		return;
+	}
+
+	if (params->m_Mean_Variance_Estimator___Mean >= F16(100.0) || params->m_Mean_Variance_Estimator___Mean <= F16(-100.0)) {
+		params->m_Mean_Variance_Estimator___Sraw_Offset += params->m_Mean_Variance_Estimator___Mean;
+		params->m_Mean_Variance_Estimator___Mean = 0;
+	}
+	sraw = sraw - params->m_Mean_Variance_Estimator___Sraw_Offset;
+	GasIndexAlgorithmFix16__mean_variance_estimator___calculate_gamma(params);
+
+	fix16_t delta_sgp = fix16_div(sraw - params->m_Mean_Variance_Estimator___Mean, F16(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING));
+
+	// std = sqrt((GAMMA_SCALING - gamma_variance) * (std^2 / GAMMA_SCALING + gamma_variance * delta^2)).
+	// std^2 is out of the Q16.16 range: 64-bit intermediates replace the additional scaling of the
+	// original algorithm, whose rounding of a per-sample factor biases the std down over the hours.
+	// |delta| <= 2^11 and std < 2^13 keep every product below 2^62.
+	int64_t std = params->m_Mean_Variance_Estimator___Std;
+	int64_t gamma_variance = params->m_Mean_Variance_Estimator__Gamma_Variance;
+	int64_t variance = fix16_mul64(std, std) / (int64_t)GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING +
+			fix16_mul64(gamma_variance, fix16_mul64(delta_sgp, delta_sgp));
+	params->m_Mean_Variance_Estimator___Std = fix16_sqrt64(
+			fix16_mul64(F16(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING) - gamma_variance, variance));
+
+	params->m_Mean_Variance_Estimator___Mean += fix16_div(
+			fix16_mul(params->m_Mean_Variance_Estimator__Gamma_Mean, delta_sgp),
+			F16(GasIndexAlgorithm_MEAN_VARIANCE_ESTIMATOR__ADDITIONAL_GAMMA_MEAN_SCALING));
+}
+
+static fix16_t GasIndexAlgorithmFix16__mox_model__process(GasIndexAlgorithmFix16Params* params, fix16_t sraw) {
+	if (params->mAlgorithm_Type == GasIndexAlgorithm_ALGORITHM_TYPE_NOX) {
+		return fix16_mul(fix16_div(sraw - params->m_Mox_Model__Sraw_Mean, F16(GasIndexAlgorithm_SRAW_STD_NOX)), params->mIndex_Gain);
+	}
+
+	return fix16_mul(
+			fix16_div(sraw - params->m_Mox_Model__Sraw_Mean, -(params->m_Mox_Model__Sraw_Std + F16(GasIndexAlgorithm_SRAW_STD_BONUS_VOC))),
+			params->mIndex_Gain);
+}
+
+static fix16_t GasIndexAlgorithmFix16__sigmoid_scaled__process(GasIndexAlgorithmFix16Params* params, fix16_t sample) {
+	fix16_t x = fix16_mul(params->m_Sigmoid_Scaled__K, sample - params->m_Sigmoid_Scaled__X0);
+	if (x < F16(-50.0)) {
+		return F16(GasIndexAlgorithm_SIGMOID_L);
+	} else if (x > F16(50.0)) {
+		return 0;
+	}
+
+	if (sample >= 0) {
+		fix16_t shift;
+		if (params->m_Sigmoid_Scaled__Offset_Default == FIX16_ONE) {
+			shift = fix16_mul(F16(500.0 / 499.0), FIX16_ONE - params->mIndex_Offset);
+		} else {
+			shift = fix16_div(F16(GasIndexAlgorithm_SIGMOID_L) - fix16_mul(F16(5.0), params->mIndex_Offset), F16(4.0));
+		}
+		return fix16_logistic(F16(GasIndexAlgorithm_SIGMOID_L) + shift, x) - shift;
+	}
+
+	return fix16_mul(
+			fix16_div(params->mIndex_Offset, params->m_Sigmoid_Scaled__Offset_Default),
+			fix16_logistic(F16(GasIndexAlgorithm_SIGMOID_L), x));
+}
+
+static void GasIndexAlgorithmFix16__adaptive_lowpass__set_parameters(GasIndexAlgorithmFix16Params* params) {
+	params->m_Adaptive_Lowpass__A1 = fix16_div(params->mSamplingInterval, F16(GasIndexAlgorithm_LP_TAU_FAST) + params->mSamplingInterval);
+	params->m_Adaptive_Lowpass__A2 = fix16_div(params->mSamplingInterval, F16(GasIndexAlgorithm_LP_TAU_SLOW) + params->mSamplingInterval);
+	params->m_Adaptive_Lowpass___Initialized = false;
+}
+
+static fix16_t GasIndexAlgorithmFix16__adaptive_lowpass__process(GasIndexAlgorithmFix16Params* params, fix16_t sample) {
+	if (!params->m_Adaptive_Lowpass___Initialized) {
+		params->m_Adaptive_Lowpass___X1 = sample;
+		params->m_Adaptive_Lowpass___X2 = sample;
+		params->m_Adaptive_Lowpass___X3 = sample;
+		params->m_Adaptive_Lowpass___Initialized = true;
+	}
+
+	params->m_Adaptive_Lowpass___X1 = fix16_mul(FIX16_ONE - params->m_Adaptive_Lowpass__A1, params->m_Adaptive_Lowpass___X1) +
+			fix16_mul(params->m_Adaptive_Lowpass__A1, sample);
+	params->m_Adaptive_Lowpass___X2 = fix16_mul(FIX16_ONE - params->m_Adaptive_Lowpass__A2, params->m_Adaptive_Lowpass___X2) +
+			fix16_mul(params->m_Adaptive_Lowpass__A2, sample);
+
+	fix16_t abs_delta = params->m_Adaptive_Lowpass___X1 - params->m_Adaptive_Lowpass___X2;
+	if (abs_delta < 0) {
+		abs_delta = -abs_delta;
+	}
+
+	fix16_t F1 = fix16_exp(fix16_mul(F16(GasIndexAlgorithm_LP_ALPHA), abs_delta));
+	fix16_t tau_a = fix16_mul(F16(GasIndexAlgorithm_LP_TAU_SLOW - GasIndexAlgorithm_LP_TAU_FAST), F1) + F16(GasIndexAlgorithm_LP_TAU_FAST);
+	fix16_t a3 = fix16_div(params->mSamplingInterval, params->mSamplingInterval + tau_a);
+	params->m_Adaptive_Lowpass___X3 = fix16_mul(FIX16_ONE - a3, params->m_Adaptive_Lowpass___X3) + fix16_mul(a3, sample);
+
+	return params->m_Adaptive_Lowpass___X3;
+}
@@ -0,0 +1,62 @@
+#ifndef MAIN_I2C_SGP41_RAW2INDEX_SENSIRION_GAS_INDEX_ALGORITHM_FIX16_H_
+#define MAIN_I2C_SGP41_RAW2INDEX_SENSIRION_GAS_INDEX_ALGORITHM_FIX16_H_
+
+// Q16.16 fixed-point port of sensirion_gas_index_algorithm.c (v3.2.0).
+// Same constants, same evaluation order, no float math in GasIndexAlgorithmFix16_process().
+// States are exchanged as float to stay compatible with the float version.
+
+#include "sensirion_gas_index_algorithm.h"
+
+typedef int32_t fix16_t;
+
+typedef struct {
+	int     mAlgorithm_Type;
+	fix16_t mSamplingInterval;
+	fix16_t mIndex_Offset;
+	int32_t mSraw_Minimum;
+	fix16_t mGating_Max_Duration_Minutes;
+	fix16_t mInit_Duration_Mean;
+	fix16_t mInit_Duration_Variance;
+	fix16_t mGating_Threshold;
+	fix16_t mIndex_Gain;
+	fix16_t mTau_Mean_Hours;
+	fix16_t mTau_Variance_Hours;
+	fix16_t mSraw_Std_Initial;
+	fix16_t mUptime;
+	fix16_t mSraw;
+	fix16_t mGas_Index;
+	bool    m_Mean_Variance_Estimator___Initialized;
+	fix16_t m_Mean_Variance_Estimator___Mean;
+	fix16_t m_Mean_Variance_Estimator___Sraw_Offset;
+	fix16_t m_Mean_Variance_Estimator___Std;
+	fix16_t m_Mean_Variance_Estimator___Gamma_Mean;
+	fix16_t m_Mean_Variance_Estimator___Gamma_Variance;
+	fix16_t m_Mean_Variance_Estimator___Gamma_Initial_Mean;
+	fix16_t m_Mean_Variance_Estimator___Gamma_Initial_Variance;
+	fix16_t m_Mean_Variance_Estimator__Gamma_Mean;
+	fix16_t m_Mean_Variance_Estimator__Gamma_Variance;
+	fix16_t m_Mean_Variance_Estimator___Uptime_Gamma;
+	fix16_t m_Mean_Variance_Estimator___Uptime_Gating;
+	fix16_t m_Mean_Variance_Estimator___Gating_Duration_Minutes;
+	fix16_t m_Mean_Variance_Estimator___Sigmoid__K;
+	fix16_t m_Mean_Variance_Estimator___Sigmoid__X0;
+	fix16_t m_Mox_Model__Sraw_Std;
+	fix16_t m_Mox_Model__Sraw_Mean;
+	fix16_t m_Sigmoid_Scaled__K;
+	fix16_t m_Sigmoid_Scaled__X0;
+	fix16_t m_Sigmoid_Scaled__Offset_Default;
+	fix16_t m_Adaptive_Lowpass__A1;
+	fix16_t m_Adaptive_Lowpass__A2;
+	bool    m_Adaptive_Lowpass___Initialized;
+	fix16_t m_Adaptive_Lowpass___X1;
+	fix16_t m_Adaptive_Lowpass___X2;
+	fix16_t m_Adaptive_Lowpass___X3;
+} GasIndexAlgorithmFix16Params;
+
+void GasIndexAlgorithmFix16_init_with_sampling_interval(GasIndexAlgorithmFix16Params* params, int32_t algorithm_type, float sampling_interval);
+void GasIndexAlgorithmFix16_reset(GasIndexAlgorithmFix16Params* params);
+void GasIndexAlgorithmFix16_get_states(const GasIndexAlgorithmFix16Params* params, float* state0, float* state1);
+void GasIndexAlgorithmFix16_set_states(GasIndexAlgorithmFix16Params* params, float state0, float state1);
+void GasIndexAlgorithmFix16_process(GasIndexAlgorithmFix16Params* params, int32_t sraw, int32_t* gas_index);
+
+#endif /* MAIN_I2C_SGP41_RAW2INDEX_SENSIRION_GAS_INDEX_ALGORITHM_FIX16_H_ */
@@ -3,55 +3,101 @@
 #include "string.h"
 
 #include "sdkconfig.h"
-#include "esp_timer.h"
 
 #include "../bme280/bme280.h"
 #include "cJSON.h"
+#include "../../cjson/json_writer.h"
 #include "../../common/mqtt.h"
+#include "../../common/scheduler.h"
+#include "../../common/snapshot.h"
+#include "../../common/report_policy.h"
 #include "../sgp41/sgp41_api.h"
 #include "../../log/log.h"
 
 #include "../bme280/bme280_api.h"
 
-#define SGP41_EXEC_PERIOD (SGP41_SAMPLING_INTERVAL*1000000)
-#define SGP41_APPLY_COMPENSATION_PERIOD 60000000
+#define SGP41_EXEC_PERIOD (SGP41_SAMPLING_INTERVAL*1000)
 
 void sgp41_init_auto_compensation();
 
+static const char * const sgp41_report_fields[] = { "tvoc", "nox" };
+static const report_policy_deadband_t sgp41_report_deadbands[] = { { .absolute = 5 }, { .absolute = 2 } };
+static report_policy_t sgp41_report_policy;
+
 void sgp41_timer_exec_function(void* arg) {
 	sgp41_data_t data = { 0 };
 	if (sgp41_read(&data)) {
 		return;
 	}
 
-	cJSON *root = cJSON_CreateObject();
 	if (data.tvoc != SGP41_VALUE_NODATA) {
-		cJSON_AddNumberToObject(root, "tvoc", data.tvoc);
+		snapshot_set_int("tvoc", data.tvoc);
+	}
+	if (data.nox != SGP41_VALUE_NODATA) {
+		snapshot_set_int("nox", data.nox);
+	}
+
+	float values[2] = { data.tvoc, data.nox };
+	if (!report_policy_check(&sgp41_report_policy, values)) {
+		return;
+	}
+
+	char buffer[JSON_WRITER_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	if (data.tvoc != SGP41_VALUE_NODATA) {
+		json_writer_add_int(&writer, "tvoc", data.tvoc);
 	}
 	if (data.nox != SGP41_VALUE_NODATA) {
-		cJSON_AddNumberToObject(root, "nox", data.nox);
+		json_writer_add_int(&writer, "nox", data.nox);
 	}
 	if (data.tvoc_raw != SGP41_VALUE_NODATA) {
-		cJSON_AddNumberToObject(root, "tvoc_raw", data.tvoc_raw);
+		json_writer_add_int(&writer, "tvoc_raw", data.tvoc_raw);
 	}
 	if (data.nox_raw != SGP41_VALUE_NODATA) {
-		cJSON_AddNumberToObject(root, "nox_raw", data.nox_raw);
+		json_writer_add_int(&writer, "nox_raw", data.nox_raw);
 	}
 
-	char * json = cJSON_Print(root);
-	mqtt_publish(CONFIG_SGP41_TOPIC_DATA, json);
-	cJSON_free(json);
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(MQTT_TOPIC(CONFIG_SGP41_TOPIC_DATA), json);
+	}
+}
+
+void sgp41_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
+	if (root == NULL) {
+		return;
+	}
+
+	char * type = cJSON_GetStringValue(cJSON_GetObjectItem(root, "type"));
+	if (type != NULL && strcmp(type, "stats") == 0) {
+		sgp41_stats_t stats;
+		sgp41_get_stats(&stats);
+
+		char buffer[JSON_WRITER_BUFFER_SIZE];
+		json_writer_t writer;
+		json_writer_begin(&writer, buffer, sizeof(buffer));
+		json_writer_add_int(&writer, "transactions", stats.transactions);
+		json_writer_add_int(&writer, "errors", stats.errors);
+		json_writer_add_int(&writer, "crc_errors", stats.crc_errors);
+		json_writer_add_int(&writer, "latency_last", stats.latency_last_us);
+		json_writer_add_int(&writer, "latency_avg", stats.latency_avg_us);
+		json_writer_add_int(&writer, "latency_max", stats.latency_max_us);
+
+		const char * json = json_writer_end(&writer);
+		if (json) {
+			mqtt_publish_nojournal(MQTT_TOPIC(CONFIG_SGP41_TOPIC_COMMAND), json);
+		}
+	} else {
+		report_policy_command(&sgp41_report_policy, root, MQTT_TOPIC(CONFIG_SGP41_TOPIC_COMMAND));
+	}
 
 	cJSON_Delete(root);
 }
 
-void sgp41_timer_apply_correction_function(void* arg) {
-#if CONFIG_BME280_ENABLED
-	bme280_data_t data = {0};
-	if (bme280_read(&data) == ESP_OK) {
-		sgp41_set_temp_humidity(data.temperature, data.humidity);
-	}
-#endif
+void sgp41_apply_compensation(const bme280_data_t * data, void * arg) {
+	sgp41_set_temp_humidity(data->temperature, data->humidity);
 }
 
 void sgp41_init() {
@@ -63,15 +109,11 @@ void sgp41_init() {
 		LOGI(LOG_SGP41, "SGP41 initialized");
 	}
 
-	esp_timer_create_args_t periodic_timer_args = {
-		.callback = &sgp41_timer_exec_function,
-		/* name is optional, but may help identify the timer when debugging */
-		.name = "sgp41 publish value"
-	};
+	report_policy_init(&sgp41_report_policy, "sgp41", sgp41_report_fields, 2, sgp41_report_deadbands);
+
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_SGP41_TOPIC_COMMAND), sgp41_commands, NULL);
 
-	esp_timer_handle_t periodic_timer;
-	ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-	ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, SGP41_EXEC_PERIOD));
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_I2C, "sgp41 publish value", SGP41_EXEC_PERIOD, &sgp41_timer_exec_function, NULL));
 
 #if CONFIG_BME280_ENABLED
 	sgp41_init_auto_compensation();
@@ -79,15 +121,5 @@ void sgp41_init() {
 }
 
 void sgp41_init_auto_compensation() {
-	esp_timer_create_args_t periodic_timer_args = {
-		.callback = &sgp41_timer_apply_correction_function,
-		/* name is optional, but may help identify the timer when debugging */
-		.name = "Humidity auto compensation from BME280 for SGP41"
-	};
-
-	esp_timer_handle_t periodic_timer;
-	ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-	ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, SGP41_APPLY_COMPENSATION_PERIOD));
-
-	sgp41_timer_apply_correction_function(NULL);
+	ESP_ERROR_CHECK(bme280_subscribe(sgp41_apply_compensation, NULL));
 }
@@ -3,12 +3,37 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
-
+#include "esp_timer.h"
+#include "esp_system.h"
+
+#if CONFIG_SGP41_GAS_INDEX_FIXED_POINT
+#include "raw2index/sensirion_gas_index_algorithm_fix16.h"
+
+typedef GasIndexAlgorithmFix16Params GasIndexParams;
+#define GasIndex_init_with_sampling_interval GasIndexAlgorithmFix16_init_with_sampling_interval
+#define GasIndex_reset                       GasIndexAlgorithmFix16_reset
+#define GasIndex_get_states                  GasIndexAlgorithmFix16_get_states
+#define GasIndex_set_states                  GasIndexAlgorithmFix16_set_states
+#define GasIndex_process                     GasIndexAlgorithmFix16_process
+#else
 #include "raw2index/sensirion_gas_index_algorithm.h"
 
+typedef GasIndexAlgorithmParams GasIndexParams;
+#define GasIndex_init_with_sampling_interval GasIndexAlgorithm_init_with_sampling_interval
+#define GasIndex_reset                       GasIndexAlgorithm_reset
+#define GasIndex_get_states                  GasIndexAlgorithm_get_states
+#define GasIndex_set_states                  GasIndexAlgorithm_set_states
+#define GasIndex_process                     GasIndexAlgorithm_process
+#endif
+
 #include "../../log/log.h"
 #include "string.h"
+#include "stdbool.h"
 #include "../i2c_impl.h"
+#include "../../common/nvs_rw.h"
+#include "../../common/profiler.h"
+#include "../../common/wifi.h"
+#include "time.h"
 
 #define SGP41_INIT_TASK_STACK_SIZE 4096
 
@@ -33,14 +58,45 @@ const uint8_t SGP41_GET_SERIAL_NUMBER[]    = { 0x36, 0x82 };
 const uint8_t SGP41_EXECUTE_CONDITIONING_ARGS[] = { 0x80, 0x00, 0xA2, 0x66, 0x66, 0x93 };
 #define SGP41_EXECUTE_CONDITIONING_ARGS_SIZE 6
 
+#define SGP41_MAX_ARGS_SIZE  6
+#define SGP41_MAX_WORDS      3
+
+// Gas-index VOC state checkpoint. Sensirion allows restoring it after an interruption up to 10 minutes,
+// and only after 3 hours of learning. A 16-byte blob every 5 minutes is far below NVS wear limits.
+#define SGP41_STATE_NVS_NAME          "sgp41_state"
+#define SGP41_STATE_VERSION           1
+#define SGP41_STATE_MAX_AGE           (10 * 60)
+#define SGP41_STATE_CHECKPOINT_PERIOD (5 * 60 / SGP41_SAMPLING_INTERVAL)
+#define SGP41_STATE_LEARNING_SAMPLES  (3 * 60 * 60 / SGP41_SAMPLING_INTERVAL)
+
+typedef struct {
+	uint32_t version;
+	uint32_t timestamp;
+	float    state0;
+	float    state1;
+} sgp41_state_t;
+
 static uint8_t sgp41_init_status = SGP41_INIT_STATUS_NOT_INITIALIZED;
 
 static int8_t sgp41_ref_temperature = SGP41_REF_UNKNOWN;
 static uint8_t sgp41_ref_humidity   = SGP41_REF_UNKNOWN;
 static i2c_handler_t * sgp41_i2c = NULL;
 
-static GasIndexAlgorithmParams sgp41_tvoc;
-static GasIndexAlgorithmParams sgp41_nox;
+static GasIndexParams sgp41_tvoc;
+static GasIndexParams sgp41_nox;
+
+// Transactions are serialized: init task runs before the driver is initialized, measurements after it
+static uint8_t sgp41_tx_buffer[2 + SGP41_MAX_ARGS_SIZE];
+static uint8_t sgp41_rx_buffer[SGP41_MAX_WORDS * 3];
+
+// measure_raw_signals command was sent, result is collected on the next sgp41_read()
+static bool sgp41_measure_pending = false;
+
+static bool sgp41_state_restore_pending = true;
+static uint32_t sgp41_samples_processed = 0;
+
+static sgp41_stats_t sgp41_stats;
+static uint64_t sgp41_latency_total = 0;
 
 esp_err_t sgp41_write_read_buffer(
 		uint16_t timeout_ms,
@@ -49,6 +105,9 @@ esp_err_t sgp41_write_read_buffer(
 		const uint8_t args_buffer_size,
 		uint16_t * buffer,
 		uint8_t buffer_size);
+static esp_err_t sgp41_write_command(const uint8_t * command, const uint8_t * args_buffer, const uint8_t args_buffer_size);
+static esp_err_t sgp41_read_words(const uint8_t * command, uint16_t * buffer, uint8_t buffer_size);
+static void sgp41_shutdown_handler();
 
 static uint8_t sgp41_crc(uint8_t byte1, uint8_t byte2) {
 	uint8_t crc = 0xFF;
@@ -131,7 +190,7 @@ void sgp41_set_temp_humidity(int8_t temperature, uint8_t humidity) {
 }
 
 esp_err_t sgp41_api_init() {
-	sgp41_i2c = i2c_get_handlers(SGP41_I2C_ADDRESS, SGP41_I2C_TIMEOUT);
+	sgp41_i2c = i2c_get_handlers(CONFIG_SGP41_I2C_PORT, SGP41_I2C_ADDRESS, SGP41_I2C_TIMEOUT, I2C_PRIORITY_NORMAL);
 	if (sgp41_i2c == NULL) {
 		LOGE(LOG_SGP41, "Cant init I2C for address %d", SGP41_I2C_ADDRESS);
 		return ESP_ERR_INVALID_STATE;
@@ -151,11 +210,16 @@ esp_err_t sgp41_api_init() {
 
 	sgp41_init_status = SGP41_INIT_STATUS_INITIALIZING;
 
-	memset(&sgp41_tvoc, 0, sizeof(GasIndexAlgorithmParams));
-	memset(&sgp41_nox,  0, sizeof(GasIndexAlgorithmParams));
+	memset(&sgp41_tvoc, 0, sizeof(GasIndexParams));
+	memset(&sgp41_nox,  0, sizeof(GasIndexParams));
 
-	GasIndexAlgorithm_init_with_sampling_interval(&sgp41_tvoc, GasIndexAlgorithm_ALGORITHM_TYPE_VOC, SGP41_SAMPLING_INTERVAL);
-	GasIndexAlgorithm_init_with_sampling_interval(&sgp41_nox,  GasIndexAlgorithm_ALGORITHM_TYPE_NOX, SGP41_SAMPLING_INTERVAL);
+	GasIndex_init_with_sampling_interval(&sgp41_tvoc, GasIndexAlgorithm_ALGORITHM_TYPE_VOC, SGP41_SAMPLING_INTERVAL);
+	GasIndex_init_with_sampling_interval(&sgp41_nox,  GasIndexAlgorithm_ALGORITHM_TYPE_NOX, SGP41_SAMPLING_INTERVAL);
+
+	esp_err_t shutdown_res = esp_register_shutdown_handler(sgp41_shutdown_handler);
+	if (shutdown_res != ESP_OK) {
+		LOGW(LOG_SGP41, "Cant register shutdown handler: %04X", shutdown_res);
+	}
 
 	xTaskCreate(sgp41_initializing_task, "sgp41 init task", SGP41_INIT_TASK_STACK_SIZE, NULL, 10, NULL);
 
@@ -173,12 +237,69 @@ void sgp41_ref_to_ticks(uint8_t value, uint8_t * result_byte_1, uint8_t * result
 	*result_byte_crc = sgp41_crc(*result_byte_1, *result_byte_2);
 }
 
-esp_err_t sgp41_read(sgp41_data_t * result) {
-	if (sgp41_init_status != SGP41_INIT_STATUS_INITIALIZED) {
-		LOGE(LOG_SGP41, "Driver not initialized. Init status == %d", sgp41_init_status);
-		return ESP_FAIL;
+static void sgp41_state_restore() {
+	if (!wifi_time_valid()) {
+		// power-on: wait for SNTP, age of the checkpoint is unknown
+		return;
+	}
+
+	sgp41_state_restore_pending = false;
+
+	size_t buffer_size = 0;
+	uint8_t * buffer = NULL;
+	if (nvs_read_buffer(SGP41_STATE_NVS_NAME, &buffer, &buffer_size) != ESP_OK) {
+		return;
+	}
+
+	sgp41_state_t state;
+	bool valid = (buffer_size == sizeof(sgp41_state_t));
+	if (valid) {
+		memcpy(&state, buffer, sizeof(sgp41_state_t));
+	}
+	free(buffer);
+
+	if (!valid || state.version != SGP41_STATE_VERSION) {
+		LOGW(LOG_SGP41, "Bad gas-index state in NVS");
+		return;
+	}
+
+	int64_t age = (int64_t)time(NULL) - state.timestamp;
+	if (age < 0 || age > SGP41_STATE_MAX_AGE) {
+		LOGI(LOG_SGP41, "Gas-index state is too old: %lli sec", age);
+		return;
 	}
 
+	GasIndex_reset(&sgp41_tvoc);
+	GasIndex_set_states(&sgp41_tvoc, state.state0, state.state1);
+	sgp41_samples_processed = SGP41_STATE_LEARNING_SAMPLES;
+
+	LOGI(LOG_SGP41, "Gas-index state restored, age %lli sec", age);
+}
+
+static void sgp41_state_checkpoint() {
+	if (sgp41_samples_processed < SGP41_STATE_LEARNING_SAMPLES || !wifi_time_valid()) {
+		return;
+	}
+
+	sgp41_state_t state = {
+		.version = SGP41_STATE_VERSION,
+		.timestamp = (uint32_t)time(NULL)
+	};
+	GasIndex_get_states(&sgp41_tvoc, &state.state0, &state.state1);
+
+	esp_err_t res = nvs_write_buffer(SGP41_STATE_NVS_NAME, (const uint8_t *)&state, sizeof(sgp41_state_t));
+	if (res != ESP_OK) {
+		LOGE(LOG_SGP41, "Cant store gas-index state: %04X", res);
+	}
+}
+
+static void sgp41_shutdown_handler() {
+	if (sgp41_init_status == SGP41_INIT_STATUS_INITIALIZED) {
+		sgp41_state_checkpoint();
+	}
+}
+
+static esp_err_t sgp41_measure_start() {
 	uint8_t args[6] = {0, 0, 0, 0, 0, 0};
 
 	int8_t temperature = sgp41_ref_temperature;
@@ -191,10 +312,18 @@ esp_err_t sgp41_read(sgp41_data_t * result) {
 		sgp41_ref_to_ticks((uint8_t)(SGP41_REF_DEFAULT_TEMPERATURE + 45), args + 3, args + 4, args + 5);
 	}
 
-	uint16_t buffer[2];
-	memset(buffer, 0, sizeof(uint16_t) * 2);
+	esp_err_t res = sgp41_write_command(SGP41_MEASURE_RAW_SIGNALS, args, 6);
+	sgp41_measure_pending = (res == ESP_OK);
 
-	esp_err_t res = sgp41_write_read_buffer(60, SGP41_MEASURE_RAW_SIGNALS, args, 6, buffer, 2);
+	return res;
+}
+
+static esp_err_t sgp41_measure_collect(sgp41_data_t * result) {
+	uint16_t buffer[2] = { 0, 0 };
+
+	sgp41_measure_pending = false;
+
+	esp_err_t res = sgp41_read_words(SGP41_MEASURE_RAW_SIGNALS, buffer, 2);
 	if (res != ESP_OK) {
 		return res;
 	}
@@ -202,8 +331,14 @@ esp_err_t sgp41_read(sgp41_data_t * result) {
 	result->tvoc_raw = buffer[0];
 	result->nox_raw = buffer[1];
 
+	if (sgp41_state_restore_pending) {
+		sgp41_state_restore();
+	}
+
 	int32_t resultvalue = SGP41_VALUE_NODATA;
-	GasIndexAlgorithm_process(&sgp41_tvoc, result->tvoc_raw, &resultvalue);
+	PROFILER_START(gas_index_started);
+	GasIndex_process(&sgp41_tvoc, result->tvoc_raw, &resultvalue);
+	PROFILER_STOP(PROFILER_SPAN_GAS_INDEX, gas_index_started);
 	if (resultvalue >= SGP41_VALUE_NODATA || resultvalue < 0) {
 		LOGW(LOG_SGP41, "Bad gas-index for tvoc: %li", resultvalue);
 		resultvalue = SGP41_VALUE_NODATA;
@@ -212,7 +347,9 @@ esp_err_t sgp41_read(sgp41_data_t * result) {
 	result->tvoc = resultvalue;
 
 	resultvalue = SGP41_VALUE_NODATA;
-	GasIndexAlgorithm_process(&sgp41_nox, result->nox_raw, &resultvalue);
+	PROFILER_START(gas_index_nox_started);
+	GasIndex_process(&sgp41_nox, result->nox_raw, &resultvalue);
+	PROFILER_STOP(PROFILER_SPAN_GAS_INDEX, gas_index_nox_started);
 	if (resultvalue >= SGP41_VALUE_NODATA || resultvalue < 0) {
 		LOGW(LOG_SGP41, "Bad gas-index for nox: %li", resultvalue);
 		resultvalue = SGP41_VALUE_NODATA;
@@ -220,53 +357,94 @@ esp_err_t sgp41_read(sgp41_data_t * result) {
 
 	result->nox = resultvalue;
 
+	sgp41_samples_processed++;
+	if (sgp41_samples_processed % SGP41_STATE_CHECKPOINT_PERIOD == 0) {
+		sgp41_state_checkpoint();
+	}
+
 	return ESP_OK;
 }
 
-esp_err_t sgp41_write_read_buffer(
-		uint16_t timeout_ms,
-		const uint8_t * command,
-		const uint8_t * args_buffer,
-		const uint8_t args_buffer_size,
-		uint16_t * buffer,
-		uint8_t buffer_size) {
-	esp_err_t res;
+// Two-phase measurement without sleeping: collect the result of the command issued on the previous call,
+// then issue the next one. The sensor needs 50 ms per measurement, much less than the sampling interval.
+esp_err_t sgp41_read(sgp41_data_t * result) {
+	if (sgp41_init_status != SGP41_INIT_STATUS_INITIALIZED) {
+		LOGE(LOG_SGP41, "Driver not initialized. Init status == %d", sgp41_init_status);
+		return ESP_FAIL;
+	}
 
-	if (args_buffer && args_buffer_size > 0) {
-		uint8_t * data = malloc(2 + args_buffer_size);
-		if (data == NULL) {
-			return ESP_ERR_NO_MEM;
-		}
+	esp_err_t res = ESP_ERR_NOT_FINISHED;
+	if (sgp41_measure_pending) {
+		res = sgp41_measure_collect(result);
+	}
 
-		memcpy(data, command, 2);
-		memcpy(data + 2, args_buffer, args_buffer_size);
-		res = sgp41_i2c->write(sgp41_i2c->context, data, 2 + args_buffer_size);
-		free(data);
-	} else {
-		res = sgp41_i2c->write(sgp41_i2c->context, command, 2);
+	esp_err_t start_res = sgp41_measure_start();
+	if (start_res != ESP_OK) {
+		LOGE(LOG_SGP41, "Cant start measurement: %02X", start_res);
+	}
+
+	return res;
+}
+
+void sgp41_get_stats(sgp41_stats_t * stats) {
+	*stats = sgp41_stats;
+	stats->latency_avg_us = sgp41_stats.transactions ? (uint32_t)(sgp41_latency_total / sgp41_stats.transactions) : 0;
+}
+
+static void sgp41_account_transaction(int64_t started, esp_err_t res) {
+	uint32_t latency = (uint32_t)(esp_timer_get_time() - started);
+
+	sgp41_stats.transactions++;
+	sgp41_stats.latency_last_us = latency;
+	if (latency > sgp41_stats.latency_max_us) {
+		sgp41_stats.latency_max_us = latency;
+	}
+	sgp41_latency_total += latency;
+
+	if (res == ESP_ERR_INVALID_CRC) {
+		sgp41_stats.crc_errors++;
+	} else if (res != ESP_OK) {
+		sgp41_stats.errors++;
+	}
+}
+
+static esp_err_t sgp41_write_command(const uint8_t * command, const uint8_t * args_buffer, const uint8_t args_buffer_size) {
+	if (args_buffer_size > SGP41_MAX_ARGS_SIZE) {
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	int64_t started = esp_timer_get_time();
+
+	memcpy(sgp41_tx_buffer, command, 2);
+	if (args_buffer && args_buffer_size > 0) {
+		memcpy(sgp41_tx_buffer + 2, args_buffer, args_buffer_size);
 	}
 
+	esp_err_t res = sgp41_i2c->write(sgp41_i2c->context, sgp41_tx_buffer, 2 + args_buffer_size);
 	if (res) {
 		LOGE(LOG_SGP41, "Write command %02x%02x [args size: %d] failed: %02X", command[0], command[1], args_buffer_size, res);
-		return res;
 	}
 
-	if (timeout_ms < portTICK_PERIOD_MS) {
-		timeout_ms = portTICK_PERIOD_MS;
-	}
-	vTaskDelay(timeout_ms / portTICK_PERIOD_MS);
+	sgp41_account_transaction(started, res);
+
+	return res;
+}
 
-	uint8_t * temp = malloc(buffer_size * 3);
-	if (temp == NULL) {
-		return ESP_ERR_NO_MEM;
+static esp_err_t sgp41_read_words(const uint8_t * command, uint16_t * buffer, uint8_t buffer_size) {
+	if (buffer_size > SGP41_MAX_WORDS) {
+		return ESP_ERR_INVALID_SIZE;
 	}
 
-	res = sgp41_i2c->read(sgp41_i2c->context, temp, buffer_size * 3);
+	int64_t started = esp_timer_get_time();
+
+	esp_err_t res = sgp41_i2c->read(sgp41_i2c->context, sgp41_rx_buffer, buffer_size * 3);
 	if (res) {
 		LOGE(LOG_SGP41, "Read command %02x%02x failed: %d", command[0], command[1], res);
+		sgp41_account_transaction(started, res);
 		return res;
 	}
 
+	uint8_t * temp = sgp41_rx_buffer;
 	for (int i = 0; i<buffer_size; i++) {
 		if (sgp41_crc(temp[i * 3], temp[i * 3 + 1]) != temp[i * 3 + 2] &&
 				(temp[i * 3] != 0xFF && temp[i * 3 + 1] != 0xFF && temp[i * 3 + 2] != 0xFF)) {
@@ -276,11 +454,34 @@ esp_err_t sgp41_write_read_buffer(
 					temp[i * 3 + 1],
 					sgp41_crc(temp[i * 3], temp[i * 3 + 1]),
 					temp[i * 3 + 2]);
+			sgp41_account_transaction(started, ESP_ERR_INVALID_CRC);
 			return ESP_ERR_INVALID_CRC;
 		}
 
 		buffer[i] = (temp[i * 3] << 8) + temp[i * 3 + 1];
 	}
 
+	sgp41_account_transaction(started, ESP_OK);
+
 	return ESP_OK;
 }
+
+esp_err_t sgp41_write_read_buffer(
+		uint16_t timeout_ms,
+		const uint8_t * command,
+		const uint8_t * args_buffer,
+		const uint8_t args_buffer_size,
+		uint16_t * buffer,
+		uint8_t buffer_size) {
+	esp_err_t res = sgp41_write_command(command, args_buffer, args_buffer_size);
+	if (res) {
+		return res;
+	}
+
+	if (timeout_ms < portTICK_PERIOD_MS) {
+		timeout_ms = portTICK_PERIOD_MS;
+	}
+	vTaskDelay(timeout_ms / portTICK_PERIOD_MS);
+
+	return sgp41_read_words(command, buffer, buffer_size);
+}
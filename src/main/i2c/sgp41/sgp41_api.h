@@ -9,10 +9,22 @@
 #define SGP41_VALUE_NODATA 0xFFFF
 #define SGP41_SAMPLING_INTERVAL 10
 
+typedef struct {
+	uint32_t transactions;
+	uint32_t errors;
+	uint32_t crc_errors;
+	uint32_t latency_last_us;
+	uint32_t latency_max_us;
+	uint32_t latency_avg_us;
+} sgp41_stats_t;
+
 void sgp41_set_temp_humidity(int8_t temperature, uint8_t humidity);
 
 esp_err_t sgp41_api_init();
 
+// returns ESP_ERR_NOT_FINISHED on the first call: it only starts a measurement
 esp_err_t sgp41_read(sgp41_data_t * result);
 
+void sgp41_get_stats(sgp41_stats_t * stats);
+
 #endif /* MAIN_I2C_SGP41_SGP41_API_H_ */
@@ -3,6 +3,8 @@
 #include "led_encoder.h"
 #include "../log/log.h"
 #include "../common/mqtt.h"
+#include "../common/diag.h"
+#include "../common/profiler.h"
 
 #include "cJSON.h"
 #include "string.h"
@@ -29,8 +31,8 @@ void led_update_color();
 void led_set_nightlight_color(uint32_t wrgb);
 void led_reset_nightlight_color();
 
-void led_commands(const char * data, void *) {
-	cJSON *root = cJSON_Parse(data);
+void led_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
 	if (root == NULL) {
 		return;
 	}
@@ -88,6 +90,7 @@ static void led_sender_task(void* arg) {
 				);
 */
 
+		PROFILER_START(send_started);
 		ESP_ERROR_CHECK(rmt_transmit(tx_channel,
 									 led_send_encoder,
 									 buffer,
@@ -95,6 +98,7 @@ static void led_sender_task(void* arg) {
 									 &transmit_config));
 
 		rmt_tx_wait_all_done(tx_channel, 100);
+		PROFILER_STOP(PROFILER_SPAN_LED, send_started);
 	}
 }
 
@@ -152,9 +156,11 @@ void led_init() {
 
     led_send_queue = xQueueCreate(10, sizeof(uint32_t));
 
-	xTaskCreate(led_sender_task, "LED sender", LED_SENDER_TASK_STACK_SIZE, NULL, 10, NULL);
+	TaskHandle_t task = NULL;
+	xTaskCreate(led_sender_task, "LED sender", LED_SENDER_TASK_STACK_SIZE, NULL, 10, &task);
+	diag_register_task(task);
 
-	mqtt_subscribe(CONFIG_LED_TOPIC_COMMANDS, led_commands, NULL);
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_LED_TOPIC_COMMANDS), led_commands, NULL);
 
 	led_set_color(0);
 
@@ -5,7 +5,9 @@
 
 #include "sdkconfig.h"
 
+#ifndef LOG_ALWAYS_ENABLED
 #define LOG_ALWAYS_ENABLED 0
+#endif
 
 // PMS7003 shares UART port with USB.
 // I disable logging to ensure some log messages
@@ -39,6 +41,8 @@
 #define LOG_TOUCHPAD     "touchpad"
 #define LOG_FAN          "fan"
 #define LOG_FANPWM		 "fanpwm"
+#define LOG_FANTACH		 "fantach"
+#define LOG_VENTILATION  "ventilation"
 #define LOG_MQ136		 "mq136"
 #define LOG_MQ7			 "mq7"
 #define LOG_LIGHT		 "light"
@@ -46,6 +50,8 @@
 #define LOG_OTA			 "ota"
 #define LOG_MHZ19B		 "mhz19b"
 #define LOG_PMS7003		 "pms7003"
+#define LOG_ADC			 "adc"
+#define LOG_SCHEDULER	 "scheduler"
 #define LOG_MAIN		 "main"
 
 #endif /* MAIN_LOG_LOG_H_ */
@@ -6,13 +6,16 @@
 
 #include "log/log.h"
 #include "led/led.h"
-#include "i2c/sgp41/sgp41.c"
+#include "i2c/sgp41/sgp41.h"
+#include "i2c/bme280/bme280.h"
 #include "i2c/i2c_impl.h"
 #include "touchpad/touchpad.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "fans/fan/fan.h"
 #include "fans/fan_pwm/fan_pwm.h"
+#include "fans/fan_tach/fan_tach.h"
+#include "fans/ventilation/ventilation.h"
 #include "adc/mq136/mq136.h"
 #include "adc/light/light.h"
 #include "adc/o2a2/o2a2.h"
@@ -21,20 +24,41 @@
 #include "common/wifi.h"
 #include "common/nvs_rw.h"
 #include "common/mqtt.h"
+#include "common/mqtt_journal.h"
+#include "common/scheduler.h"
+#include "common/snapshot.h"
+#include "common/diag.h"
+#include "common/profiler.h"
 #include "uart/mh_z19b/mh_z19b.h"
 #include "uart/pms7003/pms7003.h"
 
 void app_main(void)
 {
+	diag_init();
 	nvs_init();
+
+#if CONFIG_MQTT_JOURNAL_ENABLED
+	mqtt_journal_init();
+#endif
+
 	wifi_init();
+	scheduler_init();
+	snapshot_init();
+
+#if CONFIG_PROFILER_ENABLED
+	profiler_init();
+#endif
 
 #if CONFIG_LED_ENABLED
 	led_init();
 #endif
 
 #if CONFIG_I2C_ENABLED
-	i2c_init_driver(CONFIG_I2C_GPIO_SDA, CONFIG_I2C_GPIO_SCL);
+	i2c_init_driver(0, CONFIG_I2C_GPIO_SDA, CONFIG_I2C_GPIO_SCL);
+#endif
+
+#if CONFIG_I2C1_ENABLED
+	i2c_init_driver(1, CONFIG_I2C1_GPIO_SDA, CONFIG_I2C1_GPIO_SCL);
 #endif
 
 #if CONFIG_BME280_ENABLED
@@ -45,7 +69,7 @@ void app_main(void)
 	sgp41_init();
 #endif
 
-#if CONFIG_MQ136_ENABLED || CONFIG_LIGHT_ENABLED
+#if CONFIG_MQ136_ENABLED || CONFIG_MQ7_ENABLED || CONFIG_LIGHT_ENABLED || CONFIG_O2A2_ENABLED
 	adc_init();
 #endif
 
@@ -77,6 +101,14 @@ void app_main(void)
 	fanpwm_init();
 #endif
 
+#if CONFIG_FANTACH_ENABLED
+	fan_tach_init();
+#endif
+
+#if CONFIG_VENTILATION_ENABLED
+	ventilation_init();
+#endif
+
 #if CONFIG_MHZ19B_ENABLED
 	mhz19b_init();
 #endif
@@ -1,47 +1,136 @@
 #include "touchpad.h"
 
 #include "../log/log.h"
-#include "../cjson/cjson_helper.h"
+#include "../cjson/json_writer.h"
+#include "../common/diag.h"
 #include "../common/mqtt.h"
 #include "../led/led.h"
+#include "../fans/ventilation/ventilation.h"
 #include "string.h"
+#include "stdatomic.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "touchpad_api.h"
 
 #define TOUCHPAD_ON_KEY_DOWN_COLOR 0xFF000000
 
+// must be a power of two
+#define TOUCHPAD_QUEUE_SIZE 16
+
+typedef struct {
+	int64_t timestamp;	// us since boot, taken when the listener classified the event
+	uint8_t state;
+	uint8_t click_index;
+} touchpad_event_t;
+
+// Single producer (touchpad listener) / single consumer (publisher) ring buffer without locks:
+// the listener never waits for the publisher, a full queue drops the event.
+static touchpad_event_t touchpad_queue[TOUCHPAD_QUEUE_SIZE];
+static atomic_uint touchpad_queue_head = 0;	// written by the producer only
+static atomic_uint touchpad_queue_tail = 0;	// written by the consumer only
+static atomic_uint touchpad_queue_dropped = 0;
+
+static TaskHandle_t touchpad_publisher_task = NULL;
+
+static bool touchpad_queue_push(const touchpad_event_t * event) {
+	unsigned int head = atomic_load_explicit(&touchpad_queue_head, memory_order_relaxed);
+	unsigned int tail = atomic_load_explicit(&touchpad_queue_tail, memory_order_acquire);
+	if (head - tail >= TOUCHPAD_QUEUE_SIZE) {
+		atomic_fetch_add_explicit(&touchpad_queue_dropped, 1, memory_order_relaxed);
+		return false;
+	}
+
+	touchpad_queue[head & (TOUCHPAD_QUEUE_SIZE - 1)] = *event;
+	atomic_store_explicit(&touchpad_queue_head, head + 1, memory_order_release);
+
+	return true;
+}
+
+static bool touchpad_queue_pop(touchpad_event_t * event) {
+	unsigned int tail = atomic_load_explicit(&touchpad_queue_tail, memory_order_relaxed);
+	unsigned int head = atomic_load_explicit(&touchpad_queue_head, memory_order_acquire);
+	if (head == tail) {
+		return false;
+	}
+
+	*event = touchpad_queue[tail & (TOUCHPAD_QUEUE_SIZE - 1)];
+	atomic_store_explicit(&touchpad_queue_tail, tail + 1, memory_order_release);
+
+	return true;
+}
+
+// runs in the touchpad listener task, must not block
 void touchpad_callback_func(uint8_t state, uint8_t click_index) {
+	touchpad_event_t event = {
+		.timestamp = esp_timer_get_time(),
+		.state = state,
+		.click_index = click_index,
+	};
+
 	if (state == TOUCHPAD_ON_KEY_DOWN) {
 		led_set_override_color(TOUCHPAD_ON_KEY_DOWN_COLOR);
 	} else {
 		led_reset_override_color();
 	}
 
+	if (touchpad_queue_push(&event) && touchpad_publisher_task) {
+		xTaskNotifyGive(touchpad_publisher_task);
+	}
+}
 
-	cJSON *root = cJSON_CreateObject();
+static void touchpad_publish(const touchpad_event_t * event, uint32_t dropped) {
+	char buffer[JSON_WRITER_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
 
-	if (state == TOUCHPAD_ON_KEY_DOWN) {
-		cJSON_AddStringToObject(root, "value", "on_key_down");
-		cJSON_AddNumberToObject(root, "click", click_index);
-	} else if (state == TOUCHPAD_ON_KEY_UP) {
-		cJSON_AddStringToObject(root, "value", "on_key_up");
-		cJSON_AddNumberToObject(root, "click", click_index);
-	} else if (state == TOUCHPAD_ON_CLICK) {
-		cJSON_AddStringToObject(root, "value", "on_click");
-		cJSON_AddNumberToObject(root, "click", click_index);
-	} else if (state == TOUCHPAD_ON_ERROR) {
-		cJSON_AddStringToObject(root, "value", "on_error");
+	if (event->state == TOUCHPAD_ON_KEY_DOWN) {
+		json_writer_add_string(&writer, "value", "on_key_down");
+		json_writer_add_int(&writer, "click", event->click_index);
+	} else if (event->state == TOUCHPAD_ON_KEY_UP) {
+		json_writer_add_string(&writer, "value", "on_key_up");
+		json_writer_add_int(&writer, "click", event->click_index);
+	} else if (event->state == TOUCHPAD_ON_CLICK) {
+		json_writer_add_string(&writer, "value", "on_click");
+		json_writer_add_int(&writer, "click", event->click_index);
+	} else if (event->state == TOUCHPAD_ON_ERROR) {
+		json_writer_add_string(&writer, "value", "on_error");
 	} else {
-		cJSON_AddStringToObject(root, "value", "idle");
+		json_writer_add_string(&writer, "value", "idle");
 	}
 
-	char * json = cJSON_Print(root);
-	mqtt_publish_sync(CONFIG_TOUCHPAD_TOPIC_DATA, json);
-	cJSON_free(json);
+	json_writer_add_int64(&writer, "ts", event->timestamp);
+	if (dropped) {
+		json_writer_add_int(&writer, "dropped", dropped);
+	}
 
-	cJSON_Delete(root);
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish_sync(MQTT_TOPIC(CONFIG_TOUCHPAD_TOPIC_DATA), json);
+	}
+}
+
+static void touchpad_publisher(void *) {
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		touchpad_event_t event;
+		while (touchpad_queue_pop(&event)) {
+#if CONFIG_VENTILATION_ENABLED
+			if (event.state == TOUCHPAD_ON_CLICK) {
+				ventilation_on_click(event.click_index);
+			}
+#endif
+
+			touchpad_publish(&event, atomic_exchange_explicit(&touchpad_queue_dropped, 0, memory_order_relaxed));
+		}
+	}
 }
 
 void touchpad_init() {
+	xTaskCreate(touchpad_publisher, "touchpad publisher", 3072, NULL, 5, &touchpad_publisher_task);
+	diag_register_task(touchpad_publisher_task);
+
 	esp_err_t res = touchpad_setup(touchpad_callback_func);
 	if (res == ESP_OK) {
 		LOGI(LOG_TOUCHPAD, "Touchpad driver initialized");
@@ -6,15 +6,23 @@
 #include "driver/touch_pad.h"
 #include "soc/rtc_periph.h"
 #include "soc/sens_periph.h"
+#include "esp_timer.h"
 
+#include "../common/diag.h"
+#include "../common/profiler.h"
 #include "../log/log.h"
 
 // based on https://github.com/espressif/esp-idf/blob/master/examples/peripherals/touch_pad_interrupt/main/esp32/tp_interrupt_main.c
 
 #define TOUCHPAD_THRESH_NO_USE   (0)
 #define TOUCHPAD_FILTER_TOUCH_PERIOD (10)
-#define TOUCHPAD_MAX_AWAIT_DOUBLE_CLICK (10)
-#define TOUCHPAD_MAX_ONKEYDOWN_RETRIES (100)
+// the ESP32 touch sensor has no release interrupt, a pressed key is polled
+#define TOUCHPAD_KEY_DOWN_POLL_MS (10)
+#define TOUCHPAD_DOUBLE_CLICK_MS (220)
+#define TOUCHPAD_MAX_KEY_DOWN_MS (1000)
+// idle wake-up for threshold recalibration, the threshold is updated after TOUCHPAD_CALIBRATION_SAMPLES of them
+#define TOUCHPAD_CALIBRATION_PERIOD_MS (500)
+#define TOUCHPAD_CALIBRATION_SAMPLES (50)
 #define TOUCHPAD_THRESHOLD_CALC(value) (uint16_t) (((value) * 9.5) / 10.0)
 #define TOUCHPAD_LOG_VALUES false
 #define TOUCHPAD_FIRE_EVENT(last_state_variable, click_index_variable, new_state) \
@@ -26,18 +34,28 @@
 #define TOUCHPAD_ERROR        0xFF
 
 static touchpad_callback_t touchpad_callback = NULL;
-static volatile uint16_t touchpad_threshold = 0;
-static volatile uint32_t touchpad_calibration_val = 0;
-static volatile uint8_t touchpad_calibration_cnt = 0;
-static volatile uint16_t touchpad_onkeydown_retries = 0;
+static TaskHandle_t touchpad_task = NULL;
+static uint16_t touchpad_threshold = 0;
+static uint32_t touchpad_calibration_val = 0;
+static uint8_t touchpad_calibration_cnt = 0;
+static int64_t touchpad_key_down_at = 0;
+
+static void touchpad_set_threshold(uint16_t threshold) {
+	touchpad_threshold = threshold;
+
+	esp_err_t res = touch_pad_set_thresh(CONFIG_TOUCHPAD_ID, threshold);
+	if (res) {
+		LOGE(LOG_TOUCHPAD, "touch_pad_set_thresh error %d", res);
+	}
+}
 
 static void touchpad_process_autocalibration(uint16_t value, bool untouched) {
 	if (untouched) {
 		touchpad_calibration_val += value;
 		touchpad_calibration_cnt ++;
 
-		if (touchpad_calibration_cnt >= 50) {
-			touchpad_threshold = TOUCHPAD_THRESHOLD_CALC(touchpad_calibration_val / touchpad_calibration_cnt);
+		if (touchpad_calibration_cnt >= TOUCHPAD_CALIBRATION_SAMPLES) {
+			touchpad_set_threshold(TOUCHPAD_THRESHOLD_CALC(touchpad_calibration_val / touchpad_calibration_cnt));
 			touchpad_calibration_val = 0;
 			touchpad_calibration_cnt = 0;
 
@@ -51,7 +69,9 @@ static void touchpad_process_autocalibration(uint16_t value, bool untouched) {
 	}
 }
 
-static uint8_t touchpad_read_value() {
+static uint8_t touchpad_read_value(int64_t now) {
+	PROFILER_SCOPE(PROFILER_SPAN_TOUCHPAD);
+
 	uint16_t value = 0;
 	esp_err_t res = touch_pad_read_filtered(CONFIG_TOUCHPAD_ID, &value);
 	if (res) {
@@ -62,56 +82,84 @@ static uint8_t touchpad_read_value() {
 	LOGI(LOG_TOUCHPAD, "touch_pad_read_filtered == %d", value);
 #endif
 
-	if (touchpad_onkeydown_retries > TOUCHPAD_MAX_ONKEYDOWN_RETRIES) {
-		touchpad_onkeydown_retries = 0;
-		LOGI(LOG_TOUCHPAD, "Too many retries on on-key-down mode. Reset threshold");
-		touchpad_threshold = TOUCHPAD_THRESHOLD_CALC(value);
-		return TOUCHPAD_ERROR;
-	}
-
 	if (value > touchpad_threshold) {
-		touchpad_onkeydown_retries = 0;
+		touchpad_key_down_at = 0;
 
 		touchpad_process_autocalibration(value, true);
 		return TOUCHPAD_ON_KEY_UP;
-	} else {
-		touchpad_onkeydown_retries++;
+	}
 
-		touchpad_process_autocalibration(value, false);
-		return TOUCHPAD_ON_KEY_DOWN;
+	if (touchpad_key_down_at == 0) {
+		touchpad_key_down_at = now;
+	} else if (now - touchpad_key_down_at > TOUCHPAD_MAX_KEY_DOWN_MS * 1000) {
+		touchpad_key_down_at = 0;
+		LOGI(LOG_TOUCHPAD, "Key is down for too long. Reset threshold");
+		touchpad_set_threshold(TOUCHPAD_THRESHOLD_CALC(value));
+		return TOUCHPAD_ERROR;
 	}
+
+	touchpad_process_autocalibration(value, false);
+	return TOUCHPAD_ON_KEY_DOWN;
 }
 
-static void touchpad_sleep(uint8_t state) {
+// wakes the listener when the pad value drops below the threshold
+static void touchpad_isr(void *) {
+	uint32_t status = touch_pad_get_status();
+	touch_pad_clear_status();
+
+	if (status & (1UL << CONFIG_TOUCHPAD_ID)) {
+		// re-enabled by the listener once it waits for a touch again
+		touch_pad_intr_disable();
+
+		BaseType_t woken = pdFALSE;
+		vTaskNotifyGiveFromISR(touchpad_task, &woken);
+		portYIELD_FROM_ISR(woken);
+	}
+}
+
+// how long the listener sleeps in a state, a touch interrupt wakes it earlier in idle and key-up states
+static TickType_t touchpad_timeout(uint8_t state, int64_t state_at) {
 	switch (state) {
 	case TOUCHPAD_ON_KEY_DOWN:
 	case TOUCHPAD_ON_CLICK:
-		vTaskDelay(10 / portTICK_PERIOD_MS);
-		break;
-	case TOUCHPAD_ON_KEY_UP:
-		vTaskDelay(20 / portTICK_PERIOD_MS);
-		break;
+		return pdMS_TO_TICKS(TOUCHPAD_KEY_DOWN_POLL_MS);
+	case TOUCHPAD_ON_KEY_UP: {
+		int64_t left = TOUCHPAD_DOUBLE_CLICK_MS - (esp_timer_get_time() - state_at) / 1000;
+		return left > 0 ? pdMS_TO_TICKS(left) : 0;
+	}
 	case TOUCHPAD_IDLE:
 	default:
-		vTaskDelay(50 / portTICK_PERIOD_MS);
-		break;
+		return pdMS_TO_TICKS(TOUCHPAD_CALIBRATION_PERIOD_MS);
 	}
 }
 
 static void touchpad_listener(void* arg) {
 	uint8_t last_touchpad_pressed = TOUCHPAD_IDLE;
 	uint8_t click_index = 0;
-	uint8_t un_key_up_await_double_click = 0;
+	int64_t state_at = esp_timer_get_time();
+
 	for (;;) {
-		touchpad_sleep(last_touchpad_pressed);
+		bool await_touch = (last_touchpad_pressed == TOUCHPAD_IDLE || last_touchpad_pressed == TOUCHPAD_ON_KEY_UP);
+		if (await_touch) {
+			touch_pad_clear_status();
+			touch_pad_intr_enable();
+		} else {
+			touch_pad_intr_disable();
+		}
+
+		ulTaskNotifyTake(pdTRUE, touchpad_timeout(last_touchpad_pressed, state_at));
 
-		uint8_t touchpad_pressed = touchpad_read_value();
+		int64_t now = esp_timer_get_time();
+		uint8_t previous_state = last_touchpad_pressed;
+		bool window_passed = (now - state_at) >= TOUCHPAD_DOUBLE_CLICK_MS * 1000;
+
+		uint8_t touchpad_pressed = touchpad_read_value(now);
 		if (touchpad_pressed == TOUCHPAD_ERROR) {
 			if (last_touchpad_pressed != TOUCHPAD_IDLE) {
 				TOUCHPAD_FIRE_EVENT(last_touchpad_pressed, click_index, TOUCHPAD_ON_ERROR);
 				click_index = 0;
-				un_key_up_await_double_click = 0;
 				last_touchpad_pressed = TOUCHPAD_IDLE;
+				state_at = now;
 			}
 
 			continue;
@@ -123,7 +171,6 @@ static void touchpad_listener(void* arg) {
 				// do nothing, idle mode
 			} else {
 				click_index = 1;
-				un_key_up_await_double_click = 0;
 
 				TOUCHPAD_FIRE_EVENT(last_touchpad_pressed, click_index, TOUCHPAD_ON_KEY_DOWN);
 			}
@@ -134,12 +181,10 @@ static void touchpad_listener(void* arg) {
 				click_index = 0;
 
 				TOUCHPAD_FIRE_EVENT(last_touchpad_pressed, click_index, TOUCHPAD_IDLE);
-			} else {
-				if (un_key_up_await_double_click++ > TOUCHPAD_MAX_AWAIT_DOUBLE_CLICK) {
-					click_index = 1;
+			} else if (window_passed) {
+				click_index = 1;
 
-					TOUCHPAD_FIRE_EVENT(last_touchpad_pressed, click_index, TOUCHPAD_ON_KEY_DOWN);
-				}
+				TOUCHPAD_FIRE_EVENT(last_touchpad_pressed, click_index, TOUCHPAD_ON_KEY_DOWN);
 			}
 			break;
 		}
@@ -153,7 +198,7 @@ static void touchpad_listener(void* arg) {
 		}
 		case TOUCHPAD_ON_KEY_UP: {
 			if (touchpad_pressed == TOUCHPAD_ON_KEY_UP) {
-				if (un_key_up_await_double_click++ > TOUCHPAD_MAX_AWAIT_DOUBLE_CLICK) {
+				if (window_passed) {
 					TOUCHPAD_FIRE_EVENT(last_touchpad_pressed, click_index, TOUCHPAD_ON_CLICK);
 				}
 			} else {
@@ -167,6 +212,10 @@ static void touchpad_listener(void* arg) {
 			// do nothing
 			break;
 		}
+
+		if (last_touchpad_pressed != previous_state) {
+			state_at = now;
+		}
 	}
 }
 
@@ -211,9 +260,23 @@ esp_err_t touchpad_setup(touchpad_callback_t callback) {
 	}
 
 	LOGI(LOG_TOUCHPAD, "touch_pad_read_filtered: readed value %d", touch_value);
-	touchpad_threshold = TOUCHPAD_THRESHOLD_CALC(touch_value);
+	touchpad_set_threshold(TOUCHPAD_THRESHOLD_CALC(touch_value));
+
+	res = touch_pad_set_trigger_mode(TOUCH_TRIGGER_BELOW);
+	if (res) {
+		LOGE(LOG_TOUCHPAD, "touch_pad_set_trigger_mode error %d", res);
+		return res;
+	}
 
-	xTaskCreate(touchpad_listener, "on touch pad listener", 2048, NULL, 10, NULL);
+	xTaskCreate(touchpad_listener, "on touch pad listener", 2048, NULL, 10, &touchpad_task);
+	diag_register_task(touchpad_task);
+
+	// the listener enables the interrupt itself
+	res = touch_pad_isr_register(touchpad_isr, NULL);
+	if (res) {
+		LOGE(LOG_TOUCHPAD, "touch_pad_isr_register error %d", res);
+		return res;
+	}
 
 	return ESP_OK;
 }
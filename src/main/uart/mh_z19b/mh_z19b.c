@@ -1,6 +1,5 @@
 #include "mh_z19b.h"
 
-#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -9,7 +8,11 @@
 
 #include "cJSON.h"
 #include "../../cjson/cjson_helper.h"
+#include "../../cjson/json_writer.h"
 #include "../../common/mqtt.h"
+#include "../../common/scheduler.h"
+#include "../../common/snapshot.h"
+#include "../../common/report_policy.h"
 #include "../../log/log.h"
 #include "string.h"
 
@@ -24,11 +27,15 @@ static uint8_t COMMAND_MHZ19_CALIBRATE_ZERO[] = { 0x87, 0x00, 0x00, 0x00, 0x00,
 #define MHZ19B_QUEUE_SIZE      10
 #define MHZ19B_UART_PORT       2
 #define MHZ19B_AWAIT_RESPONSE  1000
-#define MHZ19B_EXEC_PERIOD 	   10000000
+#define MHZ19B_EXEC_PERIOD 	   10000
 
 uint8_t mhz19b_crc(const uint8_t * buffer);
 esp_err_t mhz19b_send_buffer(const uint8_t * buffer, uint8_t * reply);
-void mhz19b_commands(const char * data, void *);
+void mhz19b_commands(const char * data, size_t len, void *);
+
+static const char * const mhz19b_report_fields[] = { "co2" };
+static const report_policy_deadband_t mhz19b_report_deadbands[] = { { .absolute = 20 } };
+static report_policy_t mhz19b_report_policy;
 void mhz19b_timer_exec_function(void*);
 esp_err_t mhz19b_validate(const uint8_t * send, const uint8_t * reply);
 
@@ -41,7 +48,7 @@ esp_err_t mhz19b_calibrate() {
 }
 
 void mhz19b_init() {
-	esp_err_t res = uart_core_init(LOG_PMS7003, MHZ19B_UART_PORT, CONFIG_MHZ19B_TX, CONFIG_MHZ19B_RX);
+	esp_err_t res = uart_core_init(LOG_PMS7003, MHZ19B_UART_PORT, CONFIG_MHZ19B_TX, CONFIG_MHZ19B_RX, NULL);
 	if (res) {
 		return;
 	}
@@ -62,16 +69,11 @@ void mhz19b_init() {
 		LOGE(LOG_MHZ19B, "mh_z19b_autocalibrate(false) error: %04X", res);
 	}
 
-	mqtt_subscribe(CONFIG_MHZ19B_TOPIC_COMMAND, mhz19b_commands, NULL);
-
-	esp_timer_create_args_t periodic_timer_args = {
-			.callback = &mhz19b_timer_exec_function,
-	};
+	report_policy_init(&mhz19b_report_policy, "mhz19b", mhz19b_report_fields, 1, mhz19b_report_deadbands);
 
-	esp_timer_handle_t periodic_timer;
-	ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-	ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, MHZ19B_EXEC_PERIOD));
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_MHZ19B_TOPIC_COMMAND), mhz19b_commands, NULL);
 
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_UART2, "mhz19b publish value", MHZ19B_EXEC_PERIOD, &mhz19b_timer_exec_function, NULL));
 }
 
 esp_err_t mhz19b_read(uint16_t * co2) {
@@ -126,15 +128,17 @@ esp_err_t mhz19b_validate(const uint8_t * send, const uint8_t * reply) {
 	return ESP_OK;
 }
 
-void mhz19b_commands(const char * data, void *) {
-	cJSON *root = cJSON_Parse(data);
+void mhz19b_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
 	if (root == NULL) {
 		return;
 	}
 
 	char * type = cJSON_GetStringValue(cJSON_GetObjectItem(root, "type"));
-	if (strcmp(type, "calibrate") == 0) {
+	if (type && strcmp(type, "calibrate") == 0) {
 		mhz19b_calibrate();
+	} else {
+		report_policy_command(&mhz19b_report_policy, root, MQTT_TOPIC(CONFIG_MHZ19B_TOPIC_COMMAND));
 	}
 
 	cJSON_Delete(root);
@@ -146,12 +150,20 @@ void mhz19b_timer_exec_function(void*) {
 		return;
 	}
 
-	cJSON *root = cJSON_CreateObject();
-	cJSON_AddNumberToObject(root, "co2", co2);
+	snapshot_set_int("co2", co2);
+
+	float values[1] = { co2 };
+	if (!report_policy_check(&mhz19b_report_policy, values)) {
+		return;
+	}
 
-	char * json = cJSON_Print(root);
-	mqtt_publish(CONFIG_MHZ19B_TOPIC_DATA, json);
-	cJSON_free(json);
+	char buffer[JSON_WRITER_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	json_writer_add_int(&writer, "co2", co2);
 
-	cJSON_Delete(root);
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(MQTT_TOPIC(CONFIG_MHZ19B_TOPIC_DATA), json);
+	}
 }
@@ -2,39 +2,103 @@
 
 #include "pms7003_def.h"
 
-#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "driver/uart.h"
 
 #include "driver/gpio.h"
 
 #include "../uart_core.h"
 
-#include "cJSON.h"
-#include "../../cjson/cjson_helper.h"
+#include "../../cjson/json_writer.h"
 #include "../../common/mqtt.h"
+#include "../../common/scheduler.h"
+#include "../../common/snapshot.h"
+#include "../../common/report_policy.h"
+#include "../../common/diag.h"
+#include "cJSON.h"
 #include "../../log/log.h"
 #include "string.h"
 
 #define PMS7003_UART_PORT 1
 
 #define PMS7003_BUF_SIZE 32
+#define PMS7003_FRAME_LENGTH (PMS7003_BUF_SIZE - 4)
 #define PMS7003_AWAIT_RESPONSE 1000
-#define PMS7003_EXEC_PERIOD 30000000
+#define PMS7003_EXEC_PERIOD 30000
+
+#define PMS7003_AVERAGE_FRAMES 16
+#define PMS7003_READER_TASK_STACK_SIZE 2048
+#define PMS7003_READ_CHUNK_SIZE 64
+#define PMS7003_MUTEX_AWAIT ((TickType_t) 100)
+#define PMS7003_JSON_BUFFER_SIZE 480
 
 #define PMS7003_COMMAND_SIZE        7
 #define PMS7003_COMMAND_WAKEUP      { 0x42, 0x4D, 0xE4, 0x00, 0x01, 0x01, 0x74 }
 #define PMS7003_COMMAND_SET_ACTIVE  { 0x42, 0x4D, 0xE1, 0x00, 0x01, 0x01, 0x71 }
-#define PMS7003_COMMAND_READ_DATA   { 0x42, 0x4D, 0xE2, 0x00, 0x00, 0x01, 0x71 }
+
+static const char * const pms7003_field_names[PMS7003_FIELDS_COUNT] = {
+	"cf1_pm_1_0",
+	"cf1_pm_2_5",
+	"cf1_pm_10_0",
+	"atmospheric_pm_1_0",
+	"atmospheric_pm_2_5",
+	"atmospheric_pm_10_0",
+	"particles_0_3",
+	"particles_0_5",
+	"particles_1_0",
+	"particles_2_5",
+	"particles_5_0",
+	"particles_10_0"
+};
+
+// In active mode the sensor streams frames by itself, the reader task parses them from the UART event queue.
+// Publishing only takes the rolling average, without any UART exchange.
+static QueueHandle_t pms7003_uart_queue = NULL;
+static SemaphoreHandle_t pms7003_mutex = NULL;
+
+static uint8_t pms7003_frame[PMS7003_BUF_SIZE];
+static uint8_t pms7003_frame_index = 0;
+
+static pms7003_data_t pms7003_latest;
+static pms7003_data_t pms7003_history[PMS7003_AVERAGE_FRAMES];
+static uint32_t pms7003_sums[PMS7003_FIELDS_COUNT];
+static uint8_t pms7003_history_head = 0;
+static uint8_t pms7003_history_count = 0;
+static uint32_t pms7003_frames_received = 0;
+static uint32_t pms7003_frames_published = 0;
 
 esp_err_t pms7003_set_active();
 esp_err_t pms7003_wakeup();
 void pms7003_timer_exec_function(void* arg);
+void pms7003_reader_task(void*);
 esp_err_t pms7003_validate(const uint8_t *, const uint8_t *);
 
+// mass concentrations in ug/m3, particle counts per 0.1L
+static const report_policy_deadband_t pms7003_report_deadbands[PMS7003_FIELDS_COUNT] = {
+	{ .absolute = 2 }, { .absolute = 2 }, { .absolute = 2 },
+	{ .absolute = 2 }, { .absolute = 2 }, { .absolute = 2 },
+	{ .relative = 20 }, { .relative = 20 }, { .relative = 20 },
+	{ .relative = 20 }, { .relative = 20 }, { .relative = 20 },
+};
+static report_policy_t pms7003_report_policy;
+
+void pms7003_commands(const char * data, size_t len, void *) {
+	cJSON *root = cJSON_ParseWithLength(data, len);
+	if (root == NULL) {
+		return;
+	}
+
+	report_policy_command(&pms7003_report_policy, root, MQTT_TOPIC(CONFIG_PMS7003_TOPIC_COMMAND));
+
+	cJSON_Delete(root);
+}
+
 void pms7003_init() {
-	esp_err_t res = uart_core_init(LOG_PMS7003, PMS7003_UART_PORT, CONFIG_PMS7003_TX, CONFIG_PMS7003_RX);
+	esp_err_t res = uart_core_init(LOG_PMS7003, PMS7003_UART_PORT, CONFIG_PMS7003_TX, CONFIG_PMS7003_RX, &pms7003_uart_queue);
 	if (res) {
 		return;
 	}
@@ -69,13 +133,21 @@ void pms7003_init() {
 		return;
 	}
 
-	esp_timer_create_args_t periodic_timer_args = {
-			.callback = &pms7003_timer_exec_function,
-	};
+	pms7003_mutex = xSemaphoreCreateMutex();
+	if (pms7003_mutex == NULL) {
+		LOGE(LOG_PMS7003, "Cant init mutex");
+		return;
+	}
+
+	TaskHandle_t task = NULL;
+	xTaskCreate(pms7003_reader_task, "pms7003 reader", PMS7003_READER_TASK_STACK_SIZE, NULL, 10, &task);
+	diag_register_task(task);
 
-	esp_timer_handle_t periodic_timer;
-	ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-	ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, PMS7003_EXEC_PERIOD));
+	report_policy_init(&pms7003_report_policy, "pms7003", pms7003_field_names, PMS7003_FIELDS_COUNT, pms7003_report_deadbands);
+
+	mqtt_subscribe(MQTT_TOPIC(CONFIG_PMS7003_TOPIC_COMMAND), pms7003_commands, NULL);
+
+	ESP_ERROR_CHECK(scheduler_add(SCHEDULER_BUS_UART1, "pms7003 publish value", PMS7003_EXEC_PERIOD, &pms7003_timer_exec_function, NULL));
 }
 
 esp_err_t pms7003_set_active() {
@@ -114,41 +186,166 @@ esp_err_t pms7003_validate(const uint8_t * send, const uint8_t * reply) {
 }
 
 
-esp_err_t pms7003_read(pms7003_data_t * data) {
-	uint8_t command[] = PMS7003_COMMAND_READ_DATA;
-	uint8_t reply[PMS7003_BUF_SIZE] = { 0 };
+static void pms7003_store_frame(const uint8_t * frame) {
+	pms7003_data_t data;
+	for (uint8_t i = 0; i<PMS7003_FIELDS_COUNT; i++) {
+		data.values[i] = (frame[4 + i*2] << 8) + frame[5 + i*2];
+	}
 
-	esp_err_t res = uart_core_send_buffer(LOG_PMS7003, PMS7003_UART_PORT, command, PMS7003_COMMAND_SIZE, reply, PMS7003_BUF_SIZE, pms7003_validate, PMS7003_AWAIT_RESPONSE);
-	if (res) {
-		return res;
+	if (xSemaphoreTake(pms7003_mutex, PMS7003_MUTEX_AWAIT) != pdTRUE) {
+		return;
+	}
+
+	if (pms7003_history_count == PMS7003_AVERAGE_FRAMES) {
+		for (uint8_t i = 0; i<PMS7003_FIELDS_COUNT; i++) {
+			pms7003_sums[i] -= pms7003_history[pms7003_history_head].values[i];
+		}
+	} else {
+		pms7003_history_count++;
+	}
+
+	for (uint8_t i = 0; i<PMS7003_FIELDS_COUNT; i++) {
+		pms7003_sums[i] += data.values[i];
+	}
+
+	pms7003_history[pms7003_history_head] = data;
+	pms7003_history_head = (pms7003_history_head + 1) % PMS7003_AVERAGE_FRAMES;
+	pms7003_latest = data;
+	pms7003_frames_received++;
+
+	xSemaphoreGive(pms7003_mutex);
+}
+
+// Streaming parser: sync on 0x42 0x4D, check frame length, validate checksum of a complete frame
+static void pms7003_parse_byte(uint8_t byte) {
+	if (pms7003_frame_index == 0 && byte != 0x42) {
+		return;
 	}
 
-	data->atmospheric_pm_1_0 =  (reply[10] << 8) + reply[11];
-	data->atmospheric_pm_2_5 =  (reply[12] << 8) + reply[13];
-	data->atmospheric_pm_10_0 = (reply[14] << 8) + reply[15];
+	if (pms7003_frame_index == 1 && byte != 0x4D) {
+		pms7003_frame_index = (byte == 0x42) ? 1 : 0;
+		return;
+	}
+
+	pms7003_frame[pms7003_frame_index++] = byte;
+
+	if (pms7003_frame_index == 4 && ((pms7003_frame[2] << 8) + pms7003_frame[3]) != PMS7003_FRAME_LENGTH) {
+		// not a data frame (e.g. a command reply) or a false sync
+		pms7003_frame_index = 0;
+		return;
+	}
+
+	if (pms7003_frame_index == PMS7003_BUF_SIZE) {
+		pms7003_frame_index = 0;
+		if (pms7003_validate(NULL, pms7003_frame) == ESP_OK) {
+			pms7003_store_frame(pms7003_frame);
+		}
+	}
+}
+
+void pms7003_reader_task(void*) {
+	uart_event_t event;
+	uint8_t buffer[PMS7003_READ_CHUNK_SIZE];
+
+	uart_flush_input(PMS7003_UART_PORT);
+	xQueueReset(pms7003_uart_queue);
+
+	while (true) {
+		if (xQueueReceive(pms7003_uart_queue, &event, portMAX_DELAY) != pdTRUE) {
+			continue;
+		}
+
+		switch (event.type) {
+			case UART_DATA: {
+				size_t remain = event.size;
+				while (remain > 0) {
+					int length = uart_read_bytes(PMS7003_UART_PORT, buffer, (remain < sizeof(buffer) ? remain : sizeof(buffer)), 0);
+					if (length <= 0) {
+						break;
+					}
+
+					for (int i = 0; i<length; i++) {
+						pms7003_parse_byte(buffer[i]);
+					}
+
+					remain -= length;
+				}
+				break;
+			}
+
+			case UART_FIFO_OVF:
+			case UART_BUFFER_FULL:
+				LOGW(LOG_PMS7003, "UART overflow, drop buffered data");
+				uart_flush_input(PMS7003_UART_PORT);
+				xQueueReset(pms7003_uart_queue);
+				pms7003_frame_index = 0;
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+esp_err_t pms7003_read(pms7003_data_t * latest, pms7003_data_t * average) {
+	if (xSemaphoreTake(pms7003_mutex, PMS7003_MUTEX_AWAIT) != pdTRUE) {
+		return ESP_ERR_TIMEOUT;
+	}
+
+	if (pms7003_history_count == 0 || pms7003_frames_received == pms7003_frames_published) {
+		xSemaphoreGive(pms7003_mutex);
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	if (latest) {
+		*latest = pms7003_latest;
+	}
+
+	if (average) {
+		for (uint8_t i = 0; i<PMS7003_FIELDS_COUNT; i++) {
+			average->values[i] = (pms7003_sums[i] + pms7003_history_count / 2) / pms7003_history_count;
+		}
+	}
+
+	pms7003_frames_published = pms7003_frames_received;
+
+	xSemaphoreGive(pms7003_mutex);
 
 	return ESP_OK;
 }
 
 void pms7003_timer_exec_function(void* arg) {
-	pms7003_data_t data = {
-		.atmospheric_pm_1_0  = 0,
-		.atmospheric_pm_2_5  = 0,
-		.atmospheric_pm_10_0 = 0
-	};
+	pms7003_data_t data = { 0 };
 
-	if (pms7003_read(&data)) {
+	esp_err_t res = pms7003_read(NULL, &data);
+	if (res) {
+		if (res == ESP_ERR_NOT_FOUND) {
+			LOGW(LOG_PMS7003, "No new frames from sensor");
+		}
 		return;
 	}
 
-	cJSON *root = cJSON_CreateObject();
-	cJSON_AddNumberToObject(root, "atmospheric_pm_1_0",  data.atmospheric_pm_1_0);
-	cJSON_AddNumberToObject(root, "atmospheric_pm_2_5",  data.atmospheric_pm_2_5);
-	cJSON_AddNumberToObject(root, "atmospheric_pm_10_0", data.atmospheric_pm_10_0);
+	snapshot_set_int("pm1_0", data.values[PMS7003_ATMOSPHERIC_PM_1_0]);
+	snapshot_set_int("pm2_5", data.values[PMS7003_ATMOSPHERIC_PM_2_5]);
+	snapshot_set_int("pm10", data.values[PMS7003_ATMOSPHERIC_PM_10_0]);
 
-	char * json = cJSON_Print(root);
-	mqtt_publish(CONFIG_PMS7003_TOPIC_DATA, json);
-	cJSON_free(json);
+	float values[PMS7003_FIELDS_COUNT];
+	for (uint8_t i = 0; i<PMS7003_FIELDS_COUNT; i++) {
+		values[i] = data.values[i];
+	}
+	if (!report_policy_check(&pms7003_report_policy, values)) {
+		return;
+	}
 
-	cJSON_Delete(root);
+	char buffer[PMS7003_JSON_BUFFER_SIZE];
+	json_writer_t writer;
+	json_writer_begin(&writer, buffer, sizeof(buffer));
+	for (uint8_t i = 0; i<PMS7003_FIELDS_COUNT; i++) {
+		json_writer_add_int(&writer, pms7003_field_names[i], data.values[i]);
+	}
+
+	const char * json = json_writer_end(&writer);
+	if (json) {
+		mqtt_publish(MQTT_TOPIC(CONFIG_PMS7003_TOPIC_DATA), json);
+	}
 }
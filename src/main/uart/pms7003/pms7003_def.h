@@ -3,10 +3,26 @@
 
 #include "stdint.h"
 
+// data fields of the sensor frame, in frame order
+typedef enum {
+	PMS7003_CF1_PM_1_0 = 0,
+	PMS7003_CF1_PM_2_5,
+	PMS7003_CF1_PM_10_0,
+	PMS7003_ATMOSPHERIC_PM_1_0,
+	PMS7003_ATMOSPHERIC_PM_2_5,
+	PMS7003_ATMOSPHERIC_PM_10_0,
+	PMS7003_PARTICLES_0_3,
+	PMS7003_PARTICLES_0_5,
+	PMS7003_PARTICLES_1_0,
+	PMS7003_PARTICLES_2_5,
+	PMS7003_PARTICLES_5_0,
+	PMS7003_PARTICLES_10_0,
+
+	PMS7003_FIELDS_COUNT
+} pms7003_field_t;
+
 typedef struct {
-	uint16_t atmospheric_pm_1_0;
-	uint16_t atmospheric_pm_2_5;
-	uint16_t atmospheric_pm_10_0;
+	uint16_t values[PMS7003_FIELDS_COUNT];
 } pms7003_data_t;
 
 #endif /* MAIN_UART_PMS7003_PMS7003_DEF_H_ */
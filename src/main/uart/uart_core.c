@@ -1,13 +1,14 @@
 #include "uart_core.h"
 
 #include "driver/uart.h"
+#include "../common/profiler.h"
 #include "../log/log.h"
 #include "string.h"
 
 #define PMS7003_DRIVER_BUF_SIZE 1024
 #define PMS7003_QUEUE_SIZE 10
 
-esp_err_t uart_core_init(const char * tag, uint8_t port, uint8_t tx, uint8_t rx) {
+esp_err_t uart_core_init(const char * tag, uint8_t port, uint8_t tx, uint8_t rx, QueueHandle_t * event_queue) {
 	uart_config_t uart_config = {
 			.baud_rate = 9600,
 			.data_bits = UART_DATA_8_BITS,
@@ -24,7 +25,7 @@ esp_err_t uart_core_init(const char * tag, uint8_t port, uint8_t tx, uint8_t rx)
 
 	esp_err_t res = uart_driver_install(port,
 			PMS7003_DRIVER_BUF_SIZE, PMS7003_DRIVER_BUF_SIZE,
-			PMS7003_QUEUE_SIZE, NULL, intr_alloc_flags);
+			PMS7003_QUEUE_SIZE, event_queue, intr_alloc_flags);
 	if (res) {
 		LOGE(tag, "uart_driver_install error: %04X", res);
 		return res;
@@ -50,6 +51,8 @@ esp_err_t uart_core_init(const char * tag, uint8_t port, uint8_t tx, uint8_t rx)
 }
 
 esp_err_t uart_core_send_buffer(const char * tag, uint8_t port, const uint8_t * send, uint8_t send_size, uint8_t * reply, uint8_t reply_size, uart_core_validate_buffer validator, uint16_t timeout) {
+	PROFILER_SCOPE(PROFILER_SPAN_UART);
+
 	while (true) {
 		uint8_t buf;
 